@@ -6,22 +6,40 @@
 #include "script/script.h"
 #include "primitives/transaction.h"
 
+#include <algorithm>
+
+/**
+ * Key of an output in the address UTXO index. After the address and the
+ * output class (txType 0 coins, 1 tokens, 2 IPC) come the token symbol, zero
+ * padded to SYMBOL_WIDTH bytes and empty unless txType is 1, and the height
+ * big-endian, so that the outputs of an address and class are stored by
+ * symbol and then by height and a query can seek straight to a symbol, a
+ * height or the key it stopped at.
+ */
 struct CAddressUnspentKey {
+	static const unsigned int SYMBOL_WIDTH = 8;
+
 	unsigned int type;
 	uint160 hashBytes;
 	uint8_t txType;  // txtype 0 1 --- 0   ,4 5 -- 1   ,2 3 ----2
+	std::string tokensymbol;
+	int blockHeight;
 	uint256 txhash;
 	size_t index;
 	
 
 	size_t GetSerializeSize() const {
-		return 58;
+		return 70;
 	}
 	template<typename Stream>
 	void Serialize(Stream& s) const {
 		ser_writedata8(s, type);
 		hashBytes.Serialize(s);
 		ser_writedata8(s, txType);
+		char symbol[SYMBOL_WIDTH] = {};
+		memcpy(symbol, tokensymbol.data(), std::min<size_t>(tokensymbol.size(), SYMBOL_WIDTH));
+		s.write(symbol, SYMBOL_WIDTH);
+		ser_writedata32be(s, blockHeight);
 		txhash.Serialize(s);
 		ser_writedata32(s, index);
 	}
@@ -30,14 +48,20 @@ struct CAddressUnspentKey {
 		type = ser_readdata8(s);
 		hashBytes.Unserialize(s);
 		txType = ser_readdata8(s);
+		char symbol[SYMBOL_WIDTH];
+		s.read(symbol, SYMBOL_WIDTH);
+		tokensymbol.assign(symbol, std::find(symbol, symbol + SYMBOL_WIDTH, '\0'));
+		blockHeight = ser_readdata32be(s);
 		txhash.Unserialize(s);
 		index = ser_readdata32(s);
 	}
 
-	CAddressUnspentKey(unsigned int addressType, uint160 addressHash, uint8_t txtype, uint256 txid, size_t indexValue) {
+	CAddressUnspentKey(unsigned int addressType, uint160 addressHash, uint8_t txtype, const std::string& symbol, int height, uint256 txid, size_t indexValue) {
 		type = addressType;
 		hashBytes = addressHash;
 		txType = txtype;
+		tokensymbol = symbol;
+		blockHeight = height;
 		txhash = txid;
 		index = indexValue;
 	}
@@ -50,6 +74,8 @@ struct CAddressUnspentKey {
 		type = 0;
 		hashBytes.SetNull();
 		txType = 0;
+		tokensymbol.clear();
+		blockHeight = 0;
 		txhash.SetNull();
 		index = 0;
 	}
@@ -138,43 +164,170 @@ struct CAddressUnspentValue {
 		return unspentout.IsNull();
 	}
 };
-struct CAddressIndexIteratorKey {
-	unsigned int type;
-	uint160 hashBytes;
-	uint8_t txType;
+/**
+ * Subject of a TxDBProcess index sequence: an address hash160, an IPC hash or
+ * a token symbol. Serialized as a one byte type followed by a fixed number of
+ * raw bytes so that keys sort by subject and never need string parsing.
+ */
+struct CTxIndexEntity {
+	enum {
+		TYPE_ADDRESS = 'a',  // address type (1 keyid, 2 scriptid) + hash160
+		TYPE_IPC = 'i',      // IPC label hash
+		TYPE_TOKEN = 's',    // token symbol, zero padded
+	};
+	static const unsigned int TOKEN_SYMBOL_WIDTH = 8;
+
+	uint8_t type;
+	std::vector<unsigned char> vch;
+
+	static unsigned int Width(uint8_t nType) {
+		switch (nType)
+		{
+		case TYPE_ADDRESS:
+			return 21;
+		case TYPE_IPC:
+			return 16;
+		case TYPE_TOKEN:
+			return TOKEN_SYMBOL_WIDTH;
+		default:
+			return 0;
+		}
+	}
+
+	static CTxIndexEntity Address(int addressType, const uint160& hashBytes) {
+		CTxIndexEntity entity(TYPE_ADDRESS);
+		entity.vch[0] = addressType;
+		memcpy(&entity.vch[1], hashBytes.begin(), 20);
+		return entity;
+	}
+
+	static CTxIndexEntity IPC(const uint128& hash) {
+		CTxIndexEntity entity(TYPE_IPC);
+		memcpy(&entity.vch[0], hash.begin(), 16);
+		return entity;
+	}
+
+	static CTxIndexEntity Token(const std::string& symbol) {
+		CTxIndexEntity entity(TYPE_TOKEN);
+		memcpy(&entity.vch[0], symbol.data(), std::min<size_t>(symbol.size(), TOKEN_SYMBOL_WIDTH));
+		return entity;
+	}
+
+	CTxIndexEntity() : type(0) {}
+	explicit CTxIndexEntity(uint8_t typeIn) : type(typeIn), vch(Width(typeIn), 0) {}
+
+	bool IsNull() const {
+		return vch.empty();
+	}
 
 	size_t GetSerializeSize() const {
-		return 22;
+		return 1 + vch.size();
 	}
 	template<typename Stream>
 	void Serialize(Stream& s) const {
 		ser_writedata8(s, type);
-		hashBytes.Serialize(s);
-		ser_writedata8(s, txType);
+		s.write((const char*)vch.data(), vch.size());
 	}
 	template<typename Stream>
 	void Unserialize(Stream& s) {
 		type = ser_readdata8(s);
-		hashBytes.Unserialize(s);
-		txType = ser_readdata8(s);
+		vch.resize(Width(type));
+		if (vch.empty() && type != 0)
+			throw std::ios_base::failure("CTxIndexEntity::Unserialize: unknown type");
+		s.read((char*)vch.data(), vch.size());
 	}
 
-	CAddressIndexIteratorKey(unsigned int addressType, uint160 addressHash,uint8_t txtype) {
-		type = addressType;
-		hashBytes = addressHash;
-		txType = txtype;
+	friend bool operator<(const CTxIndexEntity& a, const CTxIndexEntity& b) {
+		return a.type < b.type || (a.type == b.type && a.vch < b.vch);
+	}
+	friend bool operator==(const CTxIndexEntity& a, const CTxIndexEntity& b) {
+		return a.type == b.type && a.vch == b.vch;
 	}
+};
 
-	CAddressIndexIteratorKey() {
-		SetNull();
+/** Position of a txid in the sequence of an entity; the sequence number is big-endian so LevelDB keeps them in order */
+struct CTxIndexEntryKey {
+	CTxIndexEntity entity;
+	uint64_t nSeq;
+
+	size_t GetSerializeSize() const {
+		return entity.GetSerializeSize() + 8;
+	}
+	template<typename Stream>
+	void Serialize(Stream& s) const {
+		entity.Serialize(s);
+		ser_writedata64be(s, nSeq);
+	}
+	template<typename Stream>
+	void Unserialize(Stream& s) {
+		entity.Unserialize(s);
+		nSeq = ser_readdata64be(s);
 	}
 
-	void SetNull() {
-		type = 0;
-		hashBytes.SetNull();
-		txType = 0;
+	CTxIndexEntryKey(const CTxIndexEntity& entityIn, uint64_t nSeqIn) : entity(entityIn), nSeq(nSeqIn) {}
+
+	CTxIndexEntryKey() : nSeq(0) {}
+
+	friend bool operator<(const CTxIndexEntryKey& a, const CTxIndexEntryKey& b) {
+		return a.entity < b.entity || (a.entity == b.entity && a.nSeq < b.nSeq);
+	}
+};
+
+/** Confirmed totals of an address, either in coins or in one token */
+struct CTxIndexBalance {
+	CAmount nBalance;
+	CAmount nReceived;
+	CAmount nSent;
+	uint64_t nTxCount;
+
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(nBalance);
+		READWRITE(nReceived);
+		READWRITE(nSent);
+		READWRITE(VARINT(nTxCount));
+	}
+
+	CTxIndexBalance() : nBalance(0), nReceived(0), nSent(0), nTxCount(0) {}
+
+	bool IsNull() const {
+		return nTxCount == 0;
+	}
+};
+
+/** What one transaction adds to a CTxIndexBalance; token is null for the coin balance */
+struct CTxIndexBalanceDelta {
+	CTxIndexEntity address;
+	CTxIndexEntity token;
+	CTxIndexBalance delta;
+
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(address);
+		READWRITE(token);
+		READWRITE(delta);
 	}
 };
 
+/** Number of live entries and highest sequence number handed out for an entity */
+struct CTxIndexCounter {
+	uint64_t nCount;
+	uint64_t nMax;
+
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(VARINT(nCount));
+		READWRITE(VARINT(nMax));
+	}
+
+	CTxIndexCounter() : nCount(0), nMax(0) {}
+};
+
 
 #endif // BITCOIN_ADDRESSINDEX_H
\ No newline at end of file
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "base58.h"
 #include "consensus/merkle.h"
 #include "tinyformat.h"
 #include "util.h"
@@ -51,6 +52,17 @@ static CBlock CreateGenesisBlock(uint32_t nTime, uint32_t nNonce, uint32_t nBits
 	return CreateGenesisBlock(pszTimestamp, genesisOutputScript, nTime, nNonce, nBits, nVersion, genesisReward);
 }
 
+void CChainParams::SetSystemAccount()
+{
+    // Params() is not selected yet while the networks are constructed, so check against this one
+    CBitcoinAddress address;
+    bool fValid = address.SetString(system_account_address.c_str(), base58Prefixes[PUBKEY_ADDRESS].size()) &&
+        address.GetKeyID(systemAccountID, *this);
+    assert(fValid);
+    systemAccountScript = GetScriptForDestination(systemAccountID);
+    fSystemAccount = true;
+}
+
 /**
  * Main network
  */
@@ -143,6 +155,8 @@ public:
                         //   (the tx=... number in the SetBestChain debug.log lines)
             0.07         // * estimated number of transactions per second after that timestamp
         };
+
+        SetSystemAccount();
     }
 };
 static CMainParams mainParams;
@@ -232,6 +246,7 @@ public:
             0.08
         };
 
+        SetSystemAccount();
     }
 };
 static CTestNetParams testNetParams;
@@ -10,6 +10,7 @@
 #include "consensus/params.h"
 #include "primitives/block.h"
 #include "protocol.h"
+#include "script/standard.h"
 
 #include <vector>
 
@@ -79,11 +80,23 @@ public:
     const ChainTxData& TxData() const { return chainTxData; }
 
 	std::string system_account_address;
+	/** The system account as a key id and as the script paying to it, decoded once from system_account_address */
+	const CKeyID& SystemAccountID() const { return systemAccountID; }
+	const CScript& SystemAccountScript() const { return systemAccountScript; }
+	/** Whether dest is the system account, compared by key id instead of by its base58 encoding */
+	bool IsSystemAccount(const CTxDestination& dest) const
+	{
+		const CKeyID* keyID = boost::get<CKeyID>(&dest);
+		return fSystemAccount && keyID && *keyID == systemAccountID;
+	}
 	CAmount MIN_DEPOSI;
 	int CHECK_START_BLOCKCOUNT;
 	int ADJUSTDP_BLOCKS;
 protected:
-    CChainParams() {}
+    CChainParams() : fSystemAccount(false) {}
+
+    /** Decode system_account_address with the PUBKEY_ADDRESS prefix of this network */
+    void SetSystemAccount();
 
     Consensus::Params consensus;
     CMessageHeader::MessageStartChars pchMessageStart;
@@ -100,6 +113,9 @@ protected:
     bool fMineBlocksOnDemand;
     CCheckpointData checkpointData;
     ChainTxData chainTxData;
+    bool fSystemAccount;
+    CKeyID systemAccountID;
+    CScript systemAccountScript;
 };
 
 /**
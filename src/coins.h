@@ -236,7 +236,7 @@ public:
     size_t DynamicMemoryUsage() const {
         size_t ret = memusage::DynamicUsage(vout);
         BOOST_FOREACH(const CTxOut &out, vout) {
-            ret += RecursiveDynamicUsage(out.scriptPubKey);
+            ret += RecursiveDynamicUsage(out);
         }
         return ret;
     }
@@ -447,6 +447,9 @@ public:
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! Add the memory used by the cached outputs to the total of their output type
+    void GetMemoryUsageByType(std::map<uint8_t, size_t>& mapUsage) const;
+
     /** 
      * Amount of bitcoins coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
@@ -120,52 +120,23 @@ public:
 		{
 
 		case 1:
-			txout.labelLen = txout.devoteLabel.size();
-			READWRITE(txout.labelLen);
-			if (txout.labelLen > 0)
-			{
-				READWRITE(txout.devoteLabel);
-			}
-
+			txout.SerializeLabel<DevoteLabel>(s, ser_action);
 			break;
 
 		case 2:
 		case 3:
-			txout.labelLen = txout.ipcLabel.size();
-			READWRITE(txout.labelLen);
-			if (txout.labelLen > 0)
-			{
-				READWRITE(txout.ipcLabel);
-			}
-
+			txout.SerializeLabel<IPCLabel>(s, ser_action);
 			break;
 
 		case 4:
-			txout.labelLen = txout.tokenRegLabel.size();
-			READWRITE(txout.labelLen);
-			if (txout.labelLen > 0)
-			{
-				READWRITE(txout.tokenRegLabel);
-			}
-
+			txout.SerializeLabel<TokenRegLabel>(s, ser_action);
 			break;
 
 		case 5:
-			txout.labelLen = txout.tokenLabel.size();
-			READWRITE(txout.labelLen);
-			if (txout.labelLen > 0)
-			{
-				READWRITE(txout.tokenLabel);
-			}
+			txout.SerializeLabel<TokenLabel>(s, ser_action);
 			break;
 		case TXOUT_ADDTOKEN:
-			txout.labelLen = txout.addTokenLabel.size();
-			READWRITE(txout.labelLen);
-			if (txout.labelLen > 0)
-			{
-				READWRITE(txout.addTokenLabel);
-			}
-
+			txout.SerializeLabel<AddTokenLabel>(s, ser_action);
 			break;
 		case 0:
 			break;
@@ -6,13 +6,18 @@
 #ifndef BITCOIN_CONSENSUS_VALIDATION_H
 #define BITCOIN_CONSENSUS_VALIDATION_H
 
+#include <limits>
 #include <string>
 #include <map>
+#include "hash.h"
+#include "random.h"
 #include "uint256.h"
 #include "serialize.h"
 #include "streams.h"
 #include "clientversion.h"
 
+#include <boost/unordered_map.hpp>
+
 /** "reject" message codes */
 static const unsigned char REJECT_MALFORMED = 0x01;
 static const unsigned char REJECT_INVALID = 0x10;
@@ -90,38 +95,101 @@ public:
     std::string GetDebugMessage() const { return strDebugMessage; }
 };
 
-//IPC global MAP is used to determine whether the unique field is unique. 
-//The keyword is the value of the unique field, uint256 is txid, int is temporary or permanent marker.
-// Transactions that are not registered in a block are temporary, 
-//may be cleared, and transactions registered in a block are permanent
-class IPCCheckMaps
+/**
+ * A value that only one transaction of the chain may register: the hash of an
+ * IPC ownership output, or the symbol or hash of a token registration or
+ * additional issuance output. Hashes are kept as their 16 raw bytes.
+ */
+class CIPCUniqueKey
 {
 public:
-	IPCCheckMaps(){};
-	~IPCCheckMaps(){};
-
-	void clear()
-	{
-		TokenSymbolMap.clear();
-		TokenHashMap.clear();
-		IPCHashMap.clear();
+	enum Type : unsigned char {
+		IPC_HASH = 'I',
+		TOKEN_SYMBOL = 'S',
+		TOKEN_HASH = 'T',
 	};
 
-	//Related unique value of token trade
-	std::map<std::string, std::pair<uint256, int>> TokenSymbolMap;
-	std::map<uint128, std::pair<uint256, int>> TokenHashMap;
-	//Knowledge of transaction related unique value
-	std::map<uint128, std::pair<uint256, int>> IPCHashMap;
-/*	ADD_SERIALIZE_METHODS;
+	unsigned char type;
+	std::string data;
+
+	CIPCUniqueKey() : type(0) {}
+	CIPCUniqueKey(unsigned char typeIn, const std::string& dataIn) : type(typeIn), data(dataIn) {}
+
+	static CIPCUniqueKey IPCHash(const uint128& hash) { return CIPCUniqueKey(IPC_HASH, std::string(hash.begin(), hash.end())); }
+	static CIPCUniqueKey TokenSymbol(const std::string& symbol) { return CIPCUniqueKey(TOKEN_SYMBOL, symbol); }
+	static CIPCUniqueKey TokenHash(const uint128& hash) { return CIPCUniqueKey(TOKEN_HASH, std::string(hash.begin(), hash.end())); }
+
+	friend bool operator==(const CIPCUniqueKey& a, const CIPCUniqueKey& b) { return a.type == b.type && a.data == b.data; }
+	friend bool operator<(const CIPCUniqueKey& a, const CIPCUniqueKey& b) { return a.type < b.type || (a.type == b.type && a.data < b.data); }
+
+	ADD_SERIALIZE_METHODS;
 
 	template <typename Stream, typename Operation>
 	inline void SerializationOp(Stream& s, Operation ser_action) {
-		READWRITE(TokenSymbolMap);
-		READWRITE(TokenHashMap);
-		READWRITE(IPCHashMap);
+		READWRITE(type);
+		READWRITE(data);
+	}
+};
+
+/** Salted hasher for CIPCUniqueKey, symbols are chosen by whoever registers them */
+class CIPCUniqueKeyHasher
+{
+private:
+	const uint64_t k0, k1;
+
+public:
+	CIPCUniqueKeyHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+	size_t operator()(const CIPCUniqueKey& key) const {
+		return CSipHasher(k0, k1).Write(&key.type, 1).Write((const unsigned char*)key.data.data(), key.data.size()).Finalize();
 	}
-	*/
 };
+
+/** Lookup of the transaction that registered a unique IPC or token value */
+class CIPCUniqueView
+{
+public:
+	/** Txid of the transaction owning key, false if no transaction registered it */
+	virtual bool GetOwner(const CIPCUniqueKey& key, uint256& txid) const = 0;
+	virtual ~CIPCUniqueView() {}
+};
+
+/**
+ * Keys registered on top of a base view and not written anywhere, such as
+ * the ones of the earlier transactions of the block being connected.
+ */
+class CIPCUniqueViewCache : public CIPCUniqueView
+{
+public:
+	typedef boost::unordered_map<CIPCUniqueKey, uint256, CIPCUniqueKeyHasher> KeyMap;
+
+	CIPCUniqueViewCache(const CIPCUniqueView* baseIn) : base(baseIn) {}
+
+	bool GetOwner(const CIPCUniqueKey& key, uint256& txid) const
+	{
+		KeyMap::const_iterator it = mapKeys.find(key);
+		if (it != mapKeys.end()) {
+			txid = it->second;
+			return true;
+		}
+		return base->GetOwner(key, txid);
+	}
+
+	/** Register key for txid unless a transaction already owns it */
+	void Add(const CIPCUniqueKey& key, const uint256& txid)
+	{
+		uint256 owner;
+		if (!GetOwner(key, owner))
+			mapKeys.insert(std::make_pair(key, txid));
+	}
+
+	const KeyMap& GetKeys() const { return mapKeys; }
+
+private:
+	const CIPCUniqueView* base;
+	KeyMap mapKeys;
+};
+
 class CKSizeClass
 {
 public:
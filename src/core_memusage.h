@@ -25,8 +25,31 @@ static inline size_t RecursiveDynamicUsage(const CTxIn& in) {
     return mem;
 }
 
+template<typename T>
+static inline size_t LabelAllocationUsage() {
+    return CTxOutLabelTraits<T>::INLINE ? 0 : memusage::MallocUsage(sizeof(T));
+}
+
+static inline size_t RecursiveDynamicUsage(const CTxOutLabel& label) {
+    if (label.Holds<IPCLabel>())
+        return LabelAllocationUsage<IPCLabel>() + memusage::DynamicUsage(label.Get<IPCLabel>().labelTitle);
+    if (label.Holds<TokenRegLabel>())
+        return LabelAllocationUsage<TokenRegLabel>();
+    if (label.Holds<AddTokenLabel>())
+        return LabelAllocationUsage<AddTokenLabel>() + memusage::DynamicUsage(label.Get<AddTokenLabel>().extendinfo);
+    return 0;
+}
+
 static inline size_t RecursiveDynamicUsage(const CTxOut& out) {
-    return RecursiveDynamicUsage(out.scriptPubKey);
+    return RecursiveDynamicUsage(out.scriptPubKey) + RecursiveDynamicUsage(out.label) +
+           memusage::DynamicUsage(out.coinbaseScript) + memusage::DynamicUsage(out.txLabel);
+}
+
+/** Add the memory used by each output, including its slot in the vector, to the total of its txType */
+static inline void AddTxOutUsageByType(std::map<uint8_t, size_t>& mapUsage, const std::vector<CTxOut>& vout) {
+    for (const CTxOut& out : vout) {
+        mapUsage[out.txType] += sizeof(CTxOut) + RecursiveDynamicUsage(out);
+    }
 }
 
 static inline size_t RecursiveDynamicUsage(const CTransaction& tx) {
@@ -4,9 +4,13 @@
 
 #include "dbwrapper.h"
 
+#include "base58.h"
+#include "memusage.h"
+
 #include "util.h"
 #include "random.h"
 
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 
 #include <leveldb/cache.h>
@@ -16,784 +20,946 @@
 #include <stdint.h>
 #include "util.h"
 
-//add by xxy
-
-TxDBProcess::TxDBProcess(){
-	db = NULL; 
-	dbpath = GetDataDir().string() + "/txdb";
-	options.create_if_missing = true;
-}
-TxDBProcess::~TxDBProcess(){}
-bool TxDBProcess::Init()
-{
-	s = leveldb::DB::Open(options, dbpath, &db);
-	if (!s.ok())
-	{
-		LogPrintf("open database txdb false! \n");
-		return false;
-	}
-	return true;
-}
-
-
-bool TxDBProcess::ReadKeyInfo(leveldb::DB *db, char *Key, KeyInfo *keyinfo)
-{
-	char *recsum = (char *)malloc(17 * sizeof(char));
-	char *recmax = (char *)malloc(17 * sizeof(char));
-	char *keyinforecord = (char *)malloc(MEMORY_ALLOCATION_MAX*sizeof(char));
-	memset(recsum, 0x00, sizeof(recsum));
-	memset(recmax, 0x00, sizeof(recmax));
-	memset(keyinforecord, 0x00, sizeof(keyinforecord));
-	std::string ReadResult;
-	s = db->Get(leveldb::ReadOptions(), Key, &ReadResult);
-	if (!s.ok())
-		return false;
-	keyinforecord = (char *)ReadResult.c_str();
-
-	int _pos1 = ReadResult.find('-');
-	int _pos2 = ReadResult.find('-', _pos1 + 1);
-	int _pos3 = ReadResult.find('-', _pos2 + 1);
-
-	strncpy(keyinfo->StartKey, keyinforecord, _pos1);
-	strncpy(keyinfo->EndKey, keyinforecord + _pos1 + 1, _pos2 - _pos1 - 1);
-	strncpy(recsum, keyinforecord + _pos2 + 1, _pos3 - _pos2 - 1);
-	strcpy(recmax, keyinforecord + _pos3 + 1);
-
-	sscanf(recsum, "%d", &(keyinfo->RecordSum));
-	sscanf(recmax, "%d", &(keyinfo->KeyHight));
-
-
-	return true;
-
-
-}
-
-bool TxDBProcess::UpdateKeyInfo(leveldb::DB *db, char *Key, KeyInfo *keyinfo)
-{
-	char *MakeKeyInfoRecord = (char *)malloc(MEMORY_ALLOCATION_MAX*sizeof(char));
-	char *recsum = (char *)malloc(17 * sizeof(char));
-	char *recmax = (char *)malloc(17 * sizeof(char));
-	memset(MakeKeyInfoRecord, 0x00, sizeof(MakeKeyInfoRecord));
-	memset(recsum, 0x00, sizeof(recsum));
-	memset(recmax, 0x00, sizeof(recmax));
-	sprintf(recsum, "%d", keyinfo->RecordSum);
-	sprintf(recmax, "%d", keyinfo->KeyHight);
-	strcpy(MakeKeyInfoRecord, (const char*)keyinfo->StartKey);
-	strcat(MakeKeyInfoRecord, (const char *)"-");
-	strcat(MakeKeyInfoRecord, (const char *)keyinfo->EndKey);
-	strcat(MakeKeyInfoRecord, (const char *)"-");
-	strcat(MakeKeyInfoRecord, (const char*)recsum);
-	strcat(MakeKeyInfoRecord, (const char *)"-");
-	strcat(MakeKeyInfoRecord, (const char*)recmax);
-
-
-	s = db->Put(leveldb::WriteOptions(), Key, MakeKeyInfoRecord);
-	if (!s.ok())
-	{
-		return false;
-	}
-
-	return true;
-
-}
-
-bool TxDBProcess::InsertTxid(leveldb::DB *db, char *Key, char* txid)
-{
-
-	KeyInfo *tmpkeyinfo = (KeyInfo *)malloc(sizeof(KeyInfo));
-	memset(tmpkeyinfo, 0x00, sizeof(tmpkeyinfo));
-	char *recmax = (char *)malloc(17 * sizeof(char));
-	memset(recmax, 0x00, sizeof(recmax));
-	if (!ReadKeyInfo(db, Key, tmpkeyinfo))
-	{
-
-		strcpy(tmpkeyinfo->StartKey, Key);
-		strcat(tmpkeyinfo->StartKey, (const char*)"0000000000000001");
-		strcpy(tmpkeyinfo->EndKey, Key);
-		strcat(tmpkeyinfo->EndKey, (const char*)"0000000000000001");
-		tmpkeyinfo->RecordSum = 1;
-		tmpkeyinfo->KeyHight = 1;
-
-	}
-	else
-	{
-		sprintf(recmax, "%d", tmpkeyinfo->KeyHight + 1);
-		tmpkeyinfo->RecordSum++;
-		tmpkeyinfo->KeyHight++;
-		char *tmpstr = (char *)malloc(MEMORY_ALLOCATION_MIN*sizeof(char));
-		memset(tmpstr, 0x00, sizeof(tmpstr));
-		strcpy(tmpkeyinfo->EndKey, Key);
-		strcpy(tmpstr, "0000000000000000");
-		strcat(tmpstr, recmax);
-
-		strcat(tmpkeyinfo->EndKey, tmpstr + strlen(recmax));
-
-
-	}
-	if (!UpdateKeyInfo(db, Key, tmpkeyinfo))
-	{
-		return false;
-	}
-
-	s = db->Put(leveldb::WriteOptions(), tmpkeyinfo->EndKey, txid);
-	if (!s.ok())
-	{
-
-		return false;
-	}
-
-
-
-
-	return true;
-
-
-}
-
-bool TxDBProcess::SelectTxid(leveldb::DB *db, char *Key, std::vector<std::string> &txids, int64_t get_num, int16_t out_of_order)
-{
-	KeyInfo *tmpkeyinfo = (KeyInfo *)malloc(sizeof(KeyInfo));
-
-	if (!ReadKeyInfo(db, Key, tmpkeyinfo))
-		return false;
-	leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
-	int64_t i = 0;
-	if (out_of_order == 0)
-	{
-
-		for (it->Seek(tmpkeyinfo->EndKey); it->Valid() && i < get_num; it->Prev())
-		{
-			txids.push_back(it->value().ToString());
-			i++;
-		}
-	}
-	else
-	{
-		for (it->Seek(tmpkeyinfo->StartKey); it->Valid() && i < get_num; it->Next())
-		{
-			txids.push_back(it->value().ToString());
-			i++;
-		}
-
-	}
-
-	return true;
-
-}
-
-bool TxDBProcess::DeleteTxid(leveldb::DB *db, char *Key, char *txid)
-{
-	KeyInfo *tempkeyinfo = (KeyInfo *)malloc(sizeof(KeyInfo));
-	char *tempstr = (char *)malloc(MEMORY_ALLOCATION_MID*sizeof(char));
-	memset(tempkeyinfo, 0x00, sizeof(tempkeyinfo));
-	memset(tempstr, 0x00, sizeof(tempstr));
-
-	char *todelkey = NULL;
-
-	if (!ReadKeyInfo(db, Key, tempkeyinfo))
-		return false;
-
-	leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
-	for (it->Seek(tempkeyinfo->EndKey); it->Valid(); it->Prev())
-	{
-
-		tempstr = (char *)it->value().ToString().c_str();
-		if (strcmp(tempstr, txid) == 0)
-		{
-			todelkey = (char *)it->key().ToString().c_str();
-
-			if (tempkeyinfo->RecordSum == 1)
-			{
-				if (strcmp(todelkey, tempkeyinfo->StartKey) == 0)
-				{
-					s = db->Delete(leveldb::WriteOptions(), Key);
-					if (!s.ok())
-						return false;
-				}
-			}
-			else if (strcmp(todelkey, tempkeyinfo->EndKey) == 0)
-			{
-				it->Prev();
-				strcpy(tempkeyinfo->EndKey, it->key().ToString().c_str());
-			}
-			else if (strcmp(todelkey, tempkeyinfo->StartKey) == 0)
-			{
-				it->Next();
-				strcpy(tempkeyinfo->StartKey, it->key().ToString().c_str());
-			}
-
-			break;
-		}
-	}
-
-	if (todelkey == NULL)
-		return false;
-
-	s = db->Delete(leveldb::WriteOptions(), todelkey);
-
-	if (tempkeyinfo->RecordSum > 1)
-	{
-		if (!UpdateKeyInfo(db, Key, tempkeyinfo))
-			return false;
-	}
-
-	return true;
-
-}
-
-int64_t TxDBProcess::GetTotalNum(leveldb::DB *db, char *Key)
-{
-	KeyInfo *tempkeyinfo = (KeyInfo *)malloc(sizeof(KeyInfo));
-	memset(tempkeyinfo, 0x00, sizeof(tempkeyinfo));
-	if (!ReadKeyInfo(db, Key, tempkeyinfo))
-		return 0;
-	return tempkeyinfo->RecordSum;
-}
-int64_t TxDBProcess::GetHeight(leveldb::DB *db, char *Key)
-{
-	KeyInfo *tempkeyinfo = (KeyInfo *)malloc(sizeof(KeyInfo));
-	memset(tempkeyinfo, 0x00, sizeof(tempkeyinfo));
-	if (!ReadKeyInfo(db, Key, tempkeyinfo))
-		return 0;
-	return tempkeyinfo->KeyHight;
-
-}
-
+//add by xxy
 
-/************************************************************************/
-/* FuctionName: Insert  (Atomic Updates)
-* Explain:  Insert Key-value sequence
-* return: ok true   failed false
-* @parameter1: db (leveldb::DB *)  input  database path and name
-* @parameter2: Key (char *)  input a uniqueness key
-* @parameter3: Value (char *)  input a data value
-* three put operations make Atomic update
-* (key =Key value = sum-max )
-* (key = KeyIndex value = Value)
-* (key = KeyValue value = KeyIndex)
-*  2017-11-22  ck(kevin)
-*/
-/************************************************************************/
-
-bool TxDBProcess::Insert(leveldb::DB *db, char *Key, char* Value)
-{
-	//judge to write record is exist
-	
-	char * keyindex = (char*)malloc(257 * sizeof(char));
-	if (SearchKeyTxByIndex(db, Key, keyindex, Value))
-	{
-		free(keyindex); keyindex = NULL;
-		return true;
+static const char DB_TXINDEX_ENTRY = 'e';
+static const char DB_TXINDEX_POSITION = 'p';
+static const char DB_TXINDEX_COUNTER = 'c';
+static const char DB_TXINDEX_TXDATA = 't';
+static const char DB_TXINDEX_BALANCE = 'b';
+static const char DB_TXINDEX_BALANCEDELTA = 'd';
+static const char DB_TXINDEX_VERSION = 'V';
+static const char DB_TXINDEX_INCOMPLETE = 'i';
+
+//! Version 2 added the balance totals
+static const int TXINDEX_DB_VERSION = 2;
+static const size_t TXINDEX_DB_CACHE = 8 << 20;
+//! Counters and balances kept in memory after a flush before the cache is dropped
+static const size_t TXINDEX_MAX_CACHED_COUNTERS = 100000;
+
+static const char DB_IPCUNIQUE_KEY = 'k';
+static const char DB_IPCUNIQUE_VERSION = 'V';
+
+static const int IPCUNIQUE_DB_VERSION = 1;
+static const size_t IPCUNIQUE_DB_CACHE = 2 << 20;
+//! Entries kept in memory after a flush before the cache is dropped
+static const size_t IPCUNIQUE_MAX_CACHED_KEYS = 100000;
+
+static const char DB_TOKEN_RECORD = 'r';
+static const char DB_TOKEN_ISSUE = 'a';
+static const char DB_TOKEN_ISSUEOUT = 'o';
+static const char DB_TOKEN_VERSION = 'V';
+
+static const int TOKEN_DB_VERSION = 1;
+static const size_t TOKEN_DB_CACHE = 2 << 20;
+//! Symbols kept in memory after a flush before the cache is dropped
+static const size_t TOKEN_MAX_CACHED_SYMBOLS = 10000;
+
+TxDBProcess::TxDBProcess(){
+	dbpath = GetDataDir() / "addressindex";
+	fIncompleteBalances = false;
+}
+TxDBProcess::~TxDBProcess()
+{
+	Flush();
+}
+
+bool TxDBProcess::Init(bool fReindex)
+{
+	LOCK(cs);
+	try {
+		db.reset(new CDBWrapper(dbpath, TXINDEX_DB_CACHE, false, false, false));
 	}
-	free(keyindex); keyindex = NULL;
-	
-	//define want to use string var and Allocate memory
-	char *RecSum = (char *)malloc(17 * sizeof(char));
-	char *RecMax = (char *)malloc(17 * sizeof(char));
-	char *RecSumAndRecMax = (char *)malloc(35 * sizeof(char));
-	char *RecMaxLong = (char *)malloc(35 * sizeof(char));
-	
-	//get record sum and max record number
-	long recsum = GetSum(db, Key);
-	long recmax = GetMax(db, Key);
-
-
-	// make new counter and key sequence
-	if (recsum == 0)
+	catch (const dbwrapper_error& e) {
+		LogPrintf("open database addressindex false! %s\n", e.what());
+		return false;
+	}
+
+	int nVersion = 0;
+	bool fFound = db->Read(DB_TXINDEX_VERSION, nVersion);
+	if (!fFound)
 	{
-		strcpy(RecSumAndRecMax, (const char*)"1-1");
-		strcpy(RecMaxLong, (const char*)"0000000000000001");
+		boost::filesystem::path legacyPath = GetDataDir() / "txdb";
+		if (boost::filesystem::exists(legacyPath))
+		{
+			if (!MigrateLegacyDB(legacyPath))
+				return false;
+			nVersion = 1;
+		}
+		else
+			nVersion = TXINDEX_DB_VERSION;
 	}
-	else
+	// Kept across restarts until a reindex, so that the balances are never
+	// served as if they were complete
+	if (nVersion < TXINDEX_DB_VERSION)
+		db->Write(DB_TXINDEX_INCOMPLETE, true, true);
+	if (!fFound || nVersion < TXINDEX_DB_VERSION)
+		db->Write(DB_TXINDEX_VERSION, TXINDEX_DB_VERSION, true);
+	if (fReindex)
+		db->Erase(DB_TXINDEX_INCOMPLETE, true);
+	fIncompleteBalances = db->Exists(DB_TXINDEX_INCOMPLETE);
+	if (fIncompleteBalances)
+		LogPrintf("Address index balances only cover blocks connected since the upgrade, restart with -reindex to rebuild them\n");
+	return true;
+}
+
+/** Counter of entity, loaded on first use and kept until it has been flushed */
+CTxIndexCounter& TxDBProcess::GetCounter(const CTxIndexEntity& entity)
+{
+	AssertLockHeld(cs);
+	std::map<CTxIndexEntity, CTxIndexCounter>::iterator it = mapCounters.find(entity);
+	if (it != mapCounters.end())
+		return it->second;
+
+	CTxIndexCounter counter;
+	db->Read(std::make_pair(DB_TXINDEX_COUNTER, entity), counter);
+	return mapCounters.insert(std::make_pair(entity, counter)).first->second;
+}
+
+bool TxDBProcess::ReadPosition(const CTxIndexEntity& entity, const uint256& txid, uint64_t& nSeq)
+{
+	AssertLockHeld(cs);
+	std::pair<CTxIndexEntity, uint256> key(entity, txid);
+	std::map<std::pair<CTxIndexEntity, uint256>, uint64_t>::const_iterator it = mapPendingPositions.find(key);
+	if (it != mapPendingPositions.end())
 	{
-		recsum++;
-		recmax++;
-		sprintf(RecSum, "%d", recsum);
-		sprintf(RecMax, "%d", recmax);
-		strcpy(RecSumAndRecMax, RecSum);
-		strcat(RecSumAndRecMax, (const char*)"-");
-		strcat(RecSumAndRecMax, RecMax);
-		char * tmpstr = (char *)malloc(33 * sizeof(char));
-		strcpy(tmpstr, (const char*)"0000000000000000");
-		strcat(tmpstr, RecMax);
-		strcpy(RecMaxLong, tmpstr + strlen(RecMax));
-		free(tmpstr); tmpstr = NULL;
+		nSeq = it->second;
+		return nSeq != 0;
 	}
+	CVarInt<uint64_t> varSeq(nSeq);
+	return db->Read(std::make_pair(DB_TXINDEX_POSITION, key), varSeq);
+}
 
-	// make KeyIndex
-	char * KeyIndex = (char *)malloc(257 * sizeof(char));
-	strcpy(KeyIndex, Key);
-	strcat(KeyIndex, RecMaxLong);
-
-	//make KeyValue
-	char *KeyValue = (char *)malloc(257 * sizeof(char));
-	strcpy(KeyValue, Key);
-	strcat(KeyValue, Value);
-	//cout << "5" << endl;
-
-	//Automic update
-	leveldb::WriteBatch Insertbatch;
-	Insertbatch.Put(Key, RecSumAndRecMax);
-	Insertbatch.Put(KeyIndex, Value);
-	Insertbatch.Put(KeyValue, KeyIndex);
-
-	s = db->Write(leveldb::WriteOptions(), &Insertbatch);
-	if (!s.ok())
+bool TxDBProcess::ReadTx(const uint256& txid, CTxIndexTx& txIndex)
+{
+	AssertLockHeld(cs);
+	std::map<uint256, CTxIndexTx>::const_iterator it = mapPendingTxs.find(txid);
+	if (it != mapPendingTxs.end())
 	{
-		free(RecSum); RecSum = NULL;
-		free(RecMax); RecMax = NULL;
-		free(RecSumAndRecMax); RecSumAndRecMax = NULL;
-		free(RecMaxLong); RecMaxLong = NULL;
-		free(KeyValue); KeyValue = NULL;
-		free(KeyIndex); KeyIndex = NULL;
-		return false;
+		txIndex = it->second;
+		return !txIndex.vEntities.empty() || !txIndex.vData.empty();
 	}
+	return db->Read(std::make_pair(DB_TXINDEX_TXDATA, txid), txIndex);
+}
 
-	free(RecSum); RecSum = NULL;
-	free(RecMax); RecMax = NULL;
-	free(RecSumAndRecMax); RecSumAndRecMax = NULL;
-	free(RecMaxLong); RecMaxLong = NULL;
-	free(KeyValue); KeyValue = NULL;
-	free(KeyIndex); KeyIndex = NULL;
+bool TxDBProcess::Insert(const CTxIndexEntity& entity, const uint256& txid)
+{
+	AssertLockHeld(cs);
+	uint64_t nSeq = 0;
+	if (ReadPosition(entity, txid, nSeq))
+		return false;
+
+	CTxIndexCounter& counter = GetCounter(entity);
+	nSeq = counter.nMax + 1;
+	mapPendingEntries[CTxIndexEntryKey(entity, nSeq)] = txid;
+	mapPendingPositions[std::make_pair(entity, txid)] = nSeq;
+	counter.nCount++;
+	counter.nMax = nSeq;
+	setDirtyCounters.insert(entity);
 	return true;
+}
+
+bool TxDBProcess::Erase(const CTxIndexEntity& entity, const uint256& txid)
+{
+	AssertLockHeld(cs);
+	uint64_t nSeq = 0;
+	if (!ReadPosition(entity, txid, nSeq))
+		return false;
 
+	CTxIndexCounter& counter = GetCounter(entity);
+	if (counter.nCount > 0)
+		counter.nCount--;
+	if (nSeq == counter.nMax)
+		counter.nMax = nSeq - 1;
+	mapPendingEntries[CTxIndexEntryKey(entity, nSeq)].SetNull();
+	mapPendingPositions[std::make_pair(entity, txid)] = 0;
+	setDirtyCounters.insert(entity);
+	return true;
 }
 
-/************************************************************************/
-/* FuctionName: Select
-* Explain:  Get values by key
-* return: ok true   failed false
-* @parameter1: db  (leveldb::DB *) input  database path and name
-* @parameter2: Key  （char *） input a uniqueness key
-* @parameter3: values  (vector<string>) output  values data
-* @parameter4: newest_num  (long) input   want to get values quantity, default(0) return all records
-* 2017-11-22  ck(kevin)
-*/
-/************************************************************************/
+bool TxDBProcess::AddTx(const uint256& txid, const std::vector<CTxIndexEntity>& vEntities, const std::vector<CTxaddressData>& TxInfo)
+{
+	LOCK(cs);
+	if (!db)
+		return false;
+	CTxIndexTx txIndex;
+	if (ReadTx(txid, txIndex))
+		return true;
+
+	txIndex.vData = TxInfo;
+	for (std::vector<CTxIndexEntity>::const_iterator it = vEntities.begin(); it != vEntities.end(); ++it)
+		if (Insert(*it, txid))
+			txIndex.vEntities.push_back(*it);
+	mapPendingTxs[txid] = txIndex;
+	return true;
+}
 
-long TxDBProcess::Select(leveldb::DB *db, char *Key, std::vector<std::string> &values, long newest_num)
+bool TxDBProcess::RemoveTx(const uint256& txid)
 {
-	long recsum = GetSum(db, Key);
-	if (recsum <= 0) return recsum;
-	long recmax = GetMax(db, Key);
-	if (recmax <= 0) return recmax;
+	LOCK(cs);
+	if (!db)
+		return false;
+	CTxIndexTx txIndex;
+	if (!ReadTx(txid, txIndex))
+		return false;
 
-	char * KeyIndex = (char *)malloc(257 * sizeof(char));
-	if (!GetMaxKey(db, Key, KeyIndex))
-	{
+	for (std::vector<CTxIndexEntity>::const_iterator it = txIndex.vEntities.begin(); it != txIndex.vEntities.end(); ++it)
+		Erase(*it, txid);
+	mapPendingTxs[txid] = CTxIndexTx();
+	return true;
+}
+
+bool TxDBProcess::Select(const CTxIndexEntity& entity, std::vector<uint256>& txids, long newest_num, const uint256* pfrom)
+{
+	LOCK(cs);
+	if (!db)
+		return false;
+	const CTxIndexCounter& counter = GetCounter(entity);
+	if (counter.nCount == 0)
 		return false;
+
+	uint64_t nStart = counter.nMax;
+	if (pfrom)
+	{
+		uint64_t nSeq = 0;
+		if (!ReadPosition(entity, *pfrom, nSeq))
+			return false;
+		if (nSeq <= 1)
+			return true;
+		nStart = nSeq - 1;
 	}
-	
-	long readsum;
-	if (newest_num == 0)
-		readsum = recsum;
+
+	// Walk backwards from nStart: position on the first key past it, then step back
+	std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+	pcursor->Seek(std::make_pair(DB_TXINDEX_ENTRY, CTxIndexEntryKey(entity, nStart + 1)));
+	if (pcursor->Valid())
+		pcursor->Prev();
 	else
-		readsum = recsum < newest_num ? recsum : newest_num;
-	int i = 0;
-	leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
-	for (it->Seek(KeyIndex); it->Valid() && i < readsum; it->Prev())
+		pcursor->SeekToLast();
+
+	// Merge in the pending entries, which take precedence at the same sequence number
+	std::map<CTxIndexEntryKey, uint256>::const_iterator pbegin = mapPendingEntries.lower_bound(CTxIndexEntryKey(entity, 0));
+	std::map<CTxIndexEntryKey, uint256>::const_iterator pit = mapPendingEntries.upper_bound(CTxIndexEntryKey(entity, nStart));
+	while (newest_num <= 0 || (long)txids.size() < newest_num)
 	{
-		if (it->value().ToString().find('-') != -1)
+		std::pair<char, CTxIndexEntryKey> key;
+		bool fDisk = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_TXINDEX_ENTRY && key.second.entity == entity;
+		bool fPending = pit != pbegin;
+		if (!fDisk && !fPending)
 			break;
-		values.push_back(it->value().ToString());
-		i++;	
+		if (fPending)
+		{
+			std::map<CTxIndexEntryKey, uint256>::const_iterator prev = pit;
+			--prev;
+			if (!fDisk || prev->first.nSeq >= key.second.nSeq)
+			{
+				if (fDisk && prev->first.nSeq == key.second.nSeq)
+					pcursor->Prev();
+				if (!prev->second.IsNull())
+					txids.push_back(prev->second);
+				pit = prev;
+				continue;
+			}
+		}
+		uint256 txid;
+		if (!pcursor->GetValue(txid))
+			return error("%s: failed to read index entry", __func__);
+		txids.push_back(txid);
+		pcursor->Prev();
 	}
-	delete it;
-	free(KeyIndex); KeyIndex = NULL;
 	return true;
 }
 
-/*Select overloading */
-/************************************************************************/
-/* FuctionName: Select
-* Explain:  Get values by key
-* return: ok true   failed false
-* @parameter1: db  (leveldb::DB *) input  database path and name
-* @parameter2: Key  （char *） input a uniqueness key
-* @parameter3: values  (vector<string>) output  values data
-* @parameter4: newest_num  (long) input   want to get values quantity
-* @parameter5: value (char *) input value to search the value postion and return front newest_num records
-*  2017-11-22  ck(kevin)
-*/
-/************************************************************************/
-long TxDBProcess::Select(leveldb::DB *db, char *Key, std::vector<std::string> &values, long newest_num, char *Value)
-{
-	//get sum the Key-Value and judge recsum is <=0
-	long recsum = GetSum(db, Key);
-	if (recsum <= 0) return recsum;
-
-	//judge to write record is exist
-	char *keyindex = (char*)malloc(257 * sizeof(char));
-	if (!SearchKeyTxByIndex(db, Key, keyindex, Value))
+uint64_t TxDBProcess::GetCount(const CTxIndexEntity& entity)
+{
+	LOCK(cs);
+	if (!db)
 		return 0;
+	return GetCounter(entity).nCount;
+}
+
+bool TxDBProcess::Select(const uint256& txid, std::vector<CTxaddressData>& TxInfo)
+{
+	LOCK(cs);
+	if (!db)
+		return false;
+	CTxIndexTx txIndex;
+	if (!ReadTx(txid, txIndex))
+		return false;
+	TxInfo = txIndex.vData;
+	return true;
+}
 
-	int i = 0;
-	long readsum = recsum < newest_num ? recsum : (newest_num+1);
+CTxIndexBalance& TxDBProcess::GetBalanceEntry(const BalanceKey& key)
+{
+	AssertLockHeld(cs);
+	std::map<BalanceKey, CTxIndexBalance>::iterator it = mapBalances.find(key);
+	if (it != mapBalances.end())
+		return it->second;
+
+	CTxIndexBalance balance;
+	db->Read(std::make_pair(DB_TXINDEX_BALANCE, key), balance);
+	return mapBalances.insert(std::make_pair(key, balance)).first->second;
+}
 
-	leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
-	for (it->Seek(keyindex); it->Valid() && i<readsum; it->Prev())
+bool TxDBProcess::ReadDeltas(const uint256& txid, std::vector<CTxIndexBalanceDelta>& vDeltas)
+{
+	AssertLockHeld(cs);
+	std::map<uint256, std::vector<CTxIndexBalanceDelta> >::const_iterator it = mapPendingDeltas.find(txid);
+	if (it != mapPendingDeltas.end())
 	{
-		if (i == 0)
-		{
-			i++;
-			continue;
-		}
-		if (it->value().ToString().find('-') != -1)
-			break;
-		values.push_back(it->value().ToString());
-		i++;
+		vDeltas = it->second;
+		return !vDeltas.empty();
 	}
-	delete it;
-	free(keyindex); keyindex = NULL;
-	return true;
+	return db->Read(std::make_pair(DB_TXINDEX_BALANCEDELTA, txid), vDeltas);
 }
 
-/************************************************************************/
-/* FuctionName: DeleteTx
-* Explain:  delete a key-value and update counter
-* return: 1 ok,0 failed
-* @parameter1: db  (leveldb::DB *) input  database path and name
-* @parameter2: Key  （char *） input a uniqueness key to delete sonkey
-* @parameter5: value (char *) input value to delete
-*  2017-11-22  ck(kevin)
-*/
-/************************************************************************/
-int TxDBProcess::DeleteTx(leveldb::DB *db, char *Key, char* Value)
-{
-	// get max and sum
-	long max = GetMax(db, Key);
-	long sum = GetSum(db, Key);
-	if (sum == 0 || max == 0)
-		return 0;
-	// get keyindex by Key and Value
-	char *keyindex = (char *)malloc(257 * sizeof(char));
-	char *keyvalue = (char *)malloc(257 * sizeof(char));
-	strcpy(keyvalue, Key);
-	strcat(keyvalue, Value);
-	if (!SearchKeyTxByIndex(db, Key, keyindex, Value))
-		return 0;
-	// if only one record, delete keyinfo_table and delete keyindex record 
-	if (sum == 1)
+void TxDBProcess::ApplyDeltas(const std::vector<CTxIndexBalanceDelta>& vDeltas, int nSign)
+{
+	AssertLockHeld(cs);
+	for (std::vector<CTxIndexBalanceDelta>::const_iterator it = vDeltas.begin(); it != vDeltas.end(); ++it)
 	{
-		leveldb::WriteBatch delbatch;
-		delbatch.Delete(Key);
-		delbatch.Delete(keyindex);
-		delbatch.Delete(keyvalue);
-		s = db->Write(leveldb::WriteOptions(), &delbatch);
-		if (!s.ok())
-		{
-			free(keyindex); keyindex = NULL;
-			return 0;
-		}
-		free(keyindex); keyindex = NULL;
-		free(keyvalue); keyvalue = NULL;
-		return 1;
+		BalanceKey key(it->address, it->token);
+		CTxIndexBalance& balance = GetBalanceEntry(key);
+		balance.nBalance += nSign * it->delta.nBalance;
+		balance.nReceived += nSign * it->delta.nReceived;
+		balance.nSent += nSign * it->delta.nSent;
+		balance.nTxCount += nSign * (int64_t)it->delta.nTxCount;
+		setDirtyBalances.insert(key);
 	}
+}
+
+bool TxDBProcess::ConnectBalances(const uint256& txid, const std::vector<CTxIndexBalanceDelta>& vDeltas)
+{
+	LOCK(cs);
+	if (!db)
+		return false;
+	// Blocks replayed after an unclean shutdown may already be accounted for
+	std::vector<CTxIndexBalanceDelta> vApplied;
+	if (vDeltas.empty() || ReadDeltas(txid, vApplied))
+		return true;
+
+	ApplyDeltas(vDeltas, 1);
+	mapPendingDeltas[txid] = vDeltas;
+	return true;
+}
+
+bool TxDBProcess::DisconnectBalances(const uint256& txid)
+{
+	LOCK(cs);
+	if (!db)
+		return false;
+	std::vector<CTxIndexBalanceDelta> vDeltas;
+	if (!ReadDeltas(txid, vDeltas))
+		return false;
+
+	ApplyDeltas(vDeltas, -1);
+	mapPendingDeltas[txid].clear();
+	return true;
+}
+
+bool TxDBProcess::GetBalance(const CTxIndexEntity& address, const CTxIndexEntity& token, CTxIndexBalance& balance)
+{
+	LOCK(cs);
+	if (!db)
+		return false;
+	balance = GetBalanceEntry(BalanceKey(address, token));
+	return !balance.IsNull();
+}
+
+bool TxDBProcess::HasCompleteBalances()
+{
+	LOCK(cs);
+	return db && !fIncompleteBalances;
+}
+
+bool TxDBProcess::Flush()
+{
+	LOCK(cs);
+	if (!db || (setDirtyCounters.empty() && mapPendingTxs.empty() && setDirtyBalances.empty() && mapPendingDeltas.empty()))
+		return true;
 
-	//if not only one record then get maxkey record
-	char * maxkey = (char *)malloc(257 * sizeof(char));
-	if (!GetMaxKey(db, Key, maxkey))
+	CDBBatch batch(*db);
+	for (std::map<CTxIndexEntryKey, uint256>::const_iterator it = mapPendingEntries.begin(); it != mapPendingEntries.end(); ++it)
 	{
-		free(keyindex); keyindex = NULL;
-		free(maxkey); maxkey = NULL;
-		free(keyvalue); keyvalue = NULL;
-		return 0;
+		if (it->second.IsNull())
+			batch.Erase(std::make_pair(DB_TXINDEX_ENTRY, it->first));
+		else
+			batch.Write(std::make_pair(DB_TXINDEX_ENTRY, it->first), it->second);
 	}
-
-	// judge if to delete key is maxkey find it and find prevkey to give getkeyinfo
-	char *getkeyinfo = (char *)malloc(257 * sizeof(char));
-	if (strcmp(maxkey, (const char*)keyindex) == 0)
+	for (std::map<std::pair<CTxIndexEntity, uint256>, uint64_t>::const_iterator it = mapPendingPositions.begin(); it != mapPendingPositions.end(); ++it)
 	{
-		leveldb::Iterator * it = db->NewIterator(leveldb::ReadOptions());
-		it->Seek(maxkey);
-		it->Prev();
-		strcpy(getkeyinfo, (const char*)it->key().ToString().c_str());
-		delete it;
+		if (it->second == 0)
+			batch.Erase(std::make_pair(DB_TXINDEX_POSITION, it->first));
+		else
+			batch.Write(std::make_pair(DB_TXINDEX_POSITION, it->first), VARINT(it->second));
 	}
-	//if to delete key is not the maxkey copy maxkey to getkeyinfo
-	else
+	for (std::map<uint256, CTxIndexTx>::const_iterator it = mapPendingTxs.begin(); it != mapPendingTxs.end(); ++it)
 	{
-		strcpy(getkeyinfo, maxkey);
+		if (it->second.vEntities.empty() && it->second.vData.empty())
+			batch.Erase(std::make_pair(DB_TXINDEX_TXDATA, it->first));
+		else
+			batch.Write(std::make_pair(DB_TXINDEX_TXDATA, it->first), it->second);
 	}
-	// all total subtract 1
-	sum--;
-	// make keyinfo record
-	char *maxstr = (char *)malloc(17 * sizeof(char));
-	char *sumstr = (char *)malloc(17 * sizeof(char));
-	char *sum_max = (char *)malloc(35 * sizeof(char));
-	strcpy(maxstr, (const char*)(getkeyinfo + (strlen(getkeyinfo) - 16)));
-	sscanf(maxstr, "%d", &max);
-	sprintf(sumstr, "%d", sum);
-	sprintf(maxstr, "%d", max);
-	strcpy(sum_max, sumstr);
-	strcat(sum_max, (const char*)"-");
-	strcat(sum_max, maxstr);
-
-	leveldb::WriteBatch batch;
-	batch.Delete(keyindex);
-	batch.Delete(keyvalue);
-	batch.Put(Key, sum_max);
-	s = db->Write(leveldb::WriteOptions(), &batch);
-	if (!s.ok())
+	for (std::set<CTxIndexEntity>::const_iterator it = setDirtyCounters.begin(); it != setDirtyCounters.end(); ++it)
 	{
-		free(getkeyinfo);	getkeyinfo = NULL;
-		free(maxkey); maxkey = NULL;
-		free(maxstr); maxstr = NULL;
-		free(sumstr); sumstr = NULL;
-		free(sum_max); sum_max = NULL;
-		free(keyindex); keyindex = NULL;
-		free(keyvalue); keyvalue = NULL;
-		return 0;
+		const CTxIndexCounter& counter = mapCounters[*it];
+		if (counter.nCount == 0)
+			batch.Erase(std::make_pair(DB_TXINDEX_COUNTER, *it));
+		else
+			batch.Write(std::make_pair(DB_TXINDEX_COUNTER, *it), counter);
+	}
+	for (std::set<BalanceKey>::const_iterator it = setDirtyBalances.begin(); it != setDirtyBalances.end(); ++it)
+	{
+		const CTxIndexBalance& balance = mapBalances[*it];
+		if (balance.IsNull())
+			batch.Erase(std::make_pair(DB_TXINDEX_BALANCE, *it));
+		else
+			batch.Write(std::make_pair(DB_TXINDEX_BALANCE, *it), balance);
+	}
+	for (std::map<uint256, std::vector<CTxIndexBalanceDelta> >::const_iterator it = mapPendingDeltas.begin(); it != mapPendingDeltas.end(); ++it)
+	{
+		if (it->second.empty())
+			batch.Erase(std::make_pair(DB_TXINDEX_BALANCEDELTA, it->first));
+		else
+			batch.Write(std::make_pair(DB_TXINDEX_BALANCEDELTA, it->first), it->second);
+	}
+	try {
+		db->WriteBatch(batch, true);
+	}
+	catch (const dbwrapper_error& e) {
+		return error("%s: %s", __func__, e.what());
 	}
 
-	free(getkeyinfo);	getkeyinfo = NULL;
-	free(maxkey); maxkey = NULL;
-	free(maxstr); maxstr = NULL;
-	free(sumstr); sumstr = NULL;
-	free(sum_max); sum_max = NULL;
-	free(keyindex); keyindex = NULL;
-	free(keyvalue); keyvalue = NULL;
-
-	return 1;  //Returns the number of deletes
-
+	mapPendingEntries.clear();
+	mapPendingPositions.clear();
+	mapPendingTxs.clear();
+	setDirtyCounters.clear();
+	setDirtyBalances.clear();
+	mapPendingDeltas.clear();
+	if (mapCounters.size() > TXINDEX_MAX_CACHED_COUNTERS)
+		mapCounters.clear();
+	if (mapBalances.size() > TXINDEX_MAX_CACHED_COUNTERS)
+		mapBalances.clear();
+	return true;
 }
 
-
-long TxDBProcess::GetSum(leveldb::DB *db, char *Key)
+size_t TxDBProcess::DynamicMemoryUsage()
 {
-	int sum;
-	std::string keyvalue;
-	s = db->Get(leveldb::ReadOptions(), Key, &keyvalue);
-	if (!s.ok())
-		return 0;
-
-	char *sumstr = (char *)malloc(17 * sizeof(char));
-	char *getkeyinfo = (char *)malloc(33 * sizeof(char));
-	//getkeyinfo = (char *)keyvalue.c_str();
-	strcpy(getkeyinfo, (const char*)keyvalue.c_str());
-	int _pos = keyvalue.find('-');
-	strncpy(sumstr, getkeyinfo, _pos);
-	sscanf(sumstr, "%d", &sum);
-	free(sumstr); sumstr = NULL;
-	free(getkeyinfo); getkeyinfo = NULL;
-	return sum;
+	LOCK(cs);
+	size_t nUsage = memusage::DynamicUsage(mapCounters) + memusage::DynamicUsage(setDirtyCounters) +
+		memusage::DynamicUsage(mapPendingEntries) + memusage::DynamicUsage(mapPendingPositions) +
+		memusage::DynamicUsage(mapPendingTxs) + memusage::DynamicUsage(mapBalances) +
+		memusage::DynamicUsage(setDirtyBalances) + memusage::DynamicUsage(mapPendingDeltas);
+	// Each entity also owns a small heap buffer
+	nUsage += (mapCounters.size() + mapPendingEntries.size() + mapPendingPositions.size() + 2 * mapBalances.size()) *
+		memusage::MallocUsage(CTxIndexEntity::Width(CTxIndexEntity::TYPE_ADDRESS));
+	for (std::map<uint256, CTxIndexTx>::const_iterator it = mapPendingTxs.begin(); it != mapPendingTxs.end(); ++it)
+		nUsage += memusage::DynamicUsage(it->second.vEntities) + memusage::DynamicUsage(it->second.vData) +
+			it->second.vData.size() * memusage::MallocUsage(CTxIndexEntity::Width(CTxIndexEntity::TYPE_ADDRESS));
+	for (std::map<uint256, std::vector<CTxIndexBalanceDelta> >::const_iterator it = mapPendingDeltas.begin(); it != mapPendingDeltas.end(); ++it)
+		nUsage += memusage::DynamicUsage(it->second);
+	return nUsage;
+}
 
+static bool IsDecimalDigit(char c)
+{
+	return c >= '0' && c <= '9';
 }
 
-long TxDBProcess::GetMax(leveldb::DB *db, char *Key)
+/** Records of the old string-keyed txdb: the "sum-max" counter of a key */
+static bool IsLegacyCounter(const std::string& value)
 {
-	int max;
-	std::string keyvalue;
-	s = db->Get(leveldb::ReadOptions(), Key, &keyvalue);
-	if (!s.ok())
-		return 0;
+	size_t pos = value.find('-');
+	if (pos == std::string::npos || pos == 0 || pos + 1 == value.size())
+		return false;
+	for (size_t i = 0; i < value.size(); i++)
+		if (i != pos && !IsDecimalDigit(value[i]))
+			return false;
+	return true;
+}
 
-	char *maxstr = (char *)malloc(17 * sizeof(char));
-	char *getkeyinfo = (char *)malloc(33 * sizeof(char));
-	strcpy(getkeyinfo, (const char*)keyvalue.c_str());
-	int _pos = keyvalue.find('-');
-	strcpy(maxstr, (const char*)(getkeyinfo + _pos + 1));
-	sscanf(maxstr, "%d", &max);
-	free(maxstr); maxstr = NULL;
-	free(getkeyinfo); getkeyinfo = NULL;
-	return max;
+/** Records of the old string-keyed txdb: ",address,type,amount@" per input and output of a tx, base58 address decoded */
+static bool ParseLegacyTxData(const std::string& value, std::vector<CTxaddressData>& TxInfo)
+{
+	size_t begin = 0;
+	while (begin < value.size())
+	{
+		size_t end = value.find('@', begin);
+		if (end == std::string::npos || value[begin] != ',')
+			return false;
+		std::string item = value.substr(begin + 1, end - begin - 1);
+		std::vector<std::string> fields;
+		boost::split(fields, item, boost::is_any_of(","));
+		if (fields.size() != 3)
+			return false;
+		CTxaddressData data;
+		uint160 hashBytes;
+		int type = 0;
+		if (CBitcoinAddress(fields[0]).GetIndexKey(hashBytes, type))
+			data.address = CTxIndexEntity::Address(type, hashBytes);
+		data.ntype = atoi(fields[1]);
+		data.amount = atoi64(fields[2]);
+		TxInfo.push_back(data);
+		begin = end + 1;
+	}
+	return true;
 }
 
+static bool GetLegacyEntity(const std::string& key, CTxIndexEntity& entity)
+{
+	uint160 hashBytes;
+	int type = 0;
+	if (CBitcoinAddress(key).GetIndexKey(hashBytes, type))
+		entity = CTxIndexEntity::Address(type, hashBytes);
+	else if (key.size() == 32 && IsHex(key))
+	{
+		uint128 hash;
+		hash.SetHex(key);
+		entity = CTxIndexEntity::IPC(hash);
+	}
+	else if (!key.empty() && key.size() <= CTxIndexEntity::TOKEN_SYMBOL_WIDTH)
+		entity = CTxIndexEntity::Token(key);
+	else
+		return false;
+	return true;
+}
 
-/*Iterator iterates over the calendar to find out if a record exists*/
-bool TxDBProcess::SearchKeyTxByItor(leveldb::DB *db, char *Key, char *Value)
+/**
+ * Copy the string-keyed txdb into the binary schema. Sequences are copied in
+ * their original order so paging through the RPCs is unaffected. The legacy
+ * directory is removed once everything has been written.
+ */
+bool TxDBProcess::MigrateLegacyDB(const boost::filesystem::path& legacyPath)
 {
-	int sum = GetSum(db, Key);
-	if (sum == 0) return false;
-	std::vector<std::string> ExistTxid;
-	leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
-	int i = 0;
-	for (it->Seek(Key); it->Valid() && i <= sum; it->Next())
+	LogPrintf("Migrating address index from %s\n", legacyPath.string());
+	int64_t nStart = GetTimeMillis();
+
+	leveldb::DB* plegacy = NULL;
+	leveldb::Options options;
+	leveldb::Status status = leveldb::DB::Open(options, legacyPath.string(), &plegacy);
+	if (!status.ok())
 	{
-		if (strcmp(it->value().ToString().c_str(), Value) == 0)
+		LogPrintf("open database txdb false! %s\n", status.ToString());
+		return false;
+	}
+
+	std::map<std::string, CTxIndexEntity> mapLegacyKeys;
+	size_t nTxData = 0;
+	{
+		std::unique_ptr<leveldb::Iterator> it(plegacy->NewIterator(leveldb::ReadOptions()));
+		CDBBatch batch(*db);
+		for (it->SeekToFirst(); it->Valid(); it->Next())
 		{
-			ExistTxid.push_back(it->key().ToString());
+			std::string key = it->key().ToString();
+			std::string value = it->value().ToString();
+			CTxIndexEntity entity;
+			if (IsLegacyCounter(value) && GetLegacyEntity(key, entity))
+			{
+				mapLegacyKeys[key] = entity;
+				continue;
+			}
+			CTxIndexTx txIndex;
+			if (key.size() == 64 && IsHex(key) && ParseLegacyTxData(value, txIndex.vData))
+			{
+				// Keep the subjects of a record written by an interrupted migration
+				CTxIndexTx txExisting;
+				if (db->Read(std::make_pair(DB_TXINDEX_TXDATA, uint256S(key)), txExisting))
+					continue;
+				batch.Write(std::make_pair(DB_TXINDEX_TXDATA, uint256S(key)), txIndex);
+				nTxData++;
+			}
 		}
+		db->WriteBatch(batch);
+	}
 
+	size_t nEntries = 0;
+	for (std::map<std::string, CTxIndexEntity>::const_iterator mi = mapLegacyKeys.begin(); mi != mapLegacyKeys.end(); ++mi)
+	{
+		// Entries are Key followed by a 16 digit, zero padded sequence number
+		const std::string& prefix = mi->first;
+		std::unique_ptr<leveldb::Iterator> it(plegacy->NewIterator(leveldb::ReadOptions()));
+		for (it->Seek(prefix + "0000000000000000"); it->Valid(); it->Next())
+		{
+			std::string key = it->key().ToString();
+			if (key.compare(0, prefix.size(), prefix) != 0)
+				break;
+			if (key.size() != prefix.size() + 16 || !std::all_of(key.begin() + prefix.size(), key.end(), IsDecimalDigit))
+				continue;
+			std::string value = it->value().ToString();
+			if (value.size() != 64 || !IsHex(value))
+				continue;
+			// Record the subject on the transaction too, so that RemoveTx un-indexes it
+			uint256 txid = uint256S(value);
+			if (Insert(mi->second, txid))
+			{
+				CTxIndexTx txIndex;
+				ReadTx(txid, txIndex);
+				txIndex.vEntities.push_back(mi->second);
+				mapPendingTxs[txid] = txIndex;
+			}
+			if (++nEntries % 100000 == 0 && !Flush())
+			{
+				delete plegacy;
+				return false;
+			}
+		}
 	}
-	delete it;
-	if (ExistTxid.size() == 0)
+	delete plegacy;
+
+	if (!Flush())
 		return false;
+	db->Write(DB_TXINDEX_VERSION, 1, true);
+	boost::filesystem::remove_all(legacyPath);
+	LogPrintf("Migrated %u keys, %u entries and %u transactions of the address index in %dms\n",
+		mapLegacyKeys.size(), nEntries, nTxData, GetTimeMillis() - nStart);
 	return true;
 }
+
 
-/*The index method query is whether a record exists*/
-bool TxDBProcess::SearchKeyTxByIndex(leveldb::DB *db, char *Key, char * KeyIndex, char *Value)
+CIPCUniqueDB::CIPCUniqueDB() : fNew(false)
 {
-	int sum = GetSum(db, Key);
-	if (sum == 0) return false;
+	dbpath = GetDataDir() / "ipcunique";
+}
 
-	//Define query targets Key
-	char *searchdest = (char *)malloc(257 * sizeof(char));
+CIPCUniqueDB::~CIPCUniqueDB()
+{
+	Flush();
+}
 
-	strcpy(searchdest, Key);
-	strcat(searchdest, Value);
-	std::string keyindex;
-	s = db->Get(leveldb::ReadOptions(), searchdest, &keyindex);
-	if (!s.ok())
-	{
-		free(searchdest); searchdest = NULL;
+bool CIPCUniqueDB::Init(bool fWipe)
+{
+	LOCK(cs);
+	cacheKeys.clear();
+	try {
+		db.reset(new CDBWrapper(dbpath, IPCUNIQUE_DB_CACHE, false, fWipe, false));
+	}
+	catch (const dbwrapper_error& e) {
+		LogPrintf("open database ipcunique false! %s\n", e.what());
 		return false;
 	}
 
-	std::string valuestr;
-	s = db->Get(leveldb::ReadOptions(), keyindex, &valuestr);
-	if (!s.ok())
+	int nVersion = 0;
+	fNew = !db->Read(DB_IPCUNIQUE_VERSION, nVersion) && !fWipe;
+	if (nVersion == 0)
+		db->Write(DB_IPCUNIQUE_VERSION, IPCUNIQUE_DB_VERSION, true);
+	return true;
+}
+
+CIPCUniqueDB::CacheEntry* CIPCUniqueDB::Fetch(const CIPCUniqueKey& key) const
+{
+	AssertLockHeld(cs);
+	CacheMap::iterator it = cacheKeys.find(key);
+	if (it != cacheKeys.end())
+		return &it->second;
+
+	if (!db)
+		return NULL;
+	// A miss is cached too, with a null owner
+	CacheEntry& entry = cacheKeys[key];
+	if (!db->Read(std::make_pair(DB_IPCUNIQUE_KEY, key), entry.txid))
+		entry.txid.SetNull();
+	return &entry;
+}
+
+bool CIPCUniqueDB::GetOwner(const CIPCUniqueKey& key, uint256& txid) const
+{
+	LOCK(cs);
+	const CacheEntry* entry = Fetch(key);
+	if (!entry || entry->txid.IsNull())
 		return false;
+	txid = entry->txid;
+	return true;
+}
 
-	char *searchvalue = (char *)malloc(129 * sizeof(char));
-	strcpy(searchvalue, (const char*)valuestr.c_str());
+void CIPCUniqueDB::Add(const CIPCUniqueKey& key, const uint256& txid)
+{
+	LOCK(cs);
+	const CacheEntry* existing = Fetch(key);
+	if (existing && !existing->txid.IsNull())
+		return;
+	CacheEntry& entry = cacheKeys[key];
+	entry.txid = txid;
+	entry.fDirty = true;
+}
+
+void CIPCUniqueDB::Remove(const CIPCUniqueKey& key, const uint256& txid)
+{
+	LOCK(cs);
+	CacheEntry* entry = Fetch(key);
+	if (!entry || entry->txid != txid)
+		return;
+	entry->txid.SetNull();
+	entry->fDirty = true;
+}
 
-	if (strcmp(Value, searchvalue) != 0)
+bool CIPCUniqueDB::Flush()
+{
+	LOCK(cs);
+	if (!db)
+		return true;
+
+	CDBBatch batch(*db);
+	for (CacheMap::const_iterator it = cacheKeys.begin(); it != cacheKeys.end(); ++it)
 	{
-		free(searchdest); searchdest = NULL;
-		free(searchvalue), searchvalue = NULL;
-		return false;
+		if (!it->second.fDirty)
+			continue;
+		if (it->second.txid.IsNull())
+			batch.Erase(std::make_pair(DB_IPCUNIQUE_KEY, it->first));
+		else
+			batch.Write(std::make_pair(DB_IPCUNIQUE_KEY, it->first), it->second.txid);
+	}
+	try {
+		db->WriteBatch(batch, true);
+	}
+	catch (const dbwrapper_error& e) {
+		return error("%s: %s", __func__, e.what());
 	}
-	else
-	{
-		strcpy(KeyIndex, (const char*)keyindex.c_str());
 
-		free(searchdest); searchdest = NULL;
-		free(searchvalue), searchvalue = NULL;
+	if (cacheKeys.size() > IPCUNIQUE_MAX_CACHED_KEYS)
+	{
+		cacheKeys.clear();
 		return true;
 	}
-
+	for (CacheMap::iterator it = cacheKeys.begin(); it != cacheKeys.end(); ++it)
+		it->second.fDirty = false;
+	return true;
 }
 
-bool TxDBProcess::GetMaxKey(leveldb::DB *db, char *Key, char *MaxKey)
+size_t CIPCUniqueDB::DynamicMemoryUsage() const
 {
-	long recmax = GetMax(db, Key);
-	if (recmax <= 0) return false;
-	char *RecMax = (char *)malloc(17 * sizeof(char));
-	sprintf(RecMax, "%d", recmax);
-	char * tmpstr = (char *)malloc(257 * sizeof(char));
-	char *ptmpstr = tmpstr;
-	strcpy(tmpstr, (const char*)"0000000000000000");
-	strcat(tmpstr, RecMax);
-	tmpstr += strlen(RecMax);
-	strcpy(MaxKey, Key);
-	strcat(MaxKey, tmpstr);
-	free(RecMax); RecMax = NULL;
-	tmpstr = ptmpstr;
-	free(tmpstr); tmpstr = NULL;
-	return true;
+	LOCK(cs);
+	size_t nUsage = memusage::DynamicUsage(cacheKeys);
+	for (CacheMap::const_iterator it = cacheKeys.begin(); it != cacheKeys.end(); ++it)
+		nUsage += memusage::DynamicUsage(it->first.data);
+	return nUsage;
+}
+
+CTokenRegistry::CTokenRegistry() : fNew(false)
+{
+	dbpath = GetDataDir() / "tokenregistry";
 }
 
-/************************************************************************/
-/* FuctionName: Insert  (Atomic Updates)
-* Explain:  Insert Key-value sequence
-* return: ok true   failed false
-* @parameter1: db (leveldb::DB *)  input  database path and name
-* @parameter2: Key (char *)  input a uniqueness key  txid
-* @parameter3: txdatas (std::vector<CTxaddressData> )  iutput a vector  type data
-* three put operations make Atomic update
-
-*  2017-11-23  ck(kevin)
-*/
-/************************************************************************/
-
-bool TxDBProcess::Insert(leveldb::DB *db, char *Key, std::vector<CTxaddressData> &TxInfo)
-{
-
-	int nTxInfo = TxInfo.size();
+CTokenRegistry::~CTokenRegistry()
+{
+	Flush();
+}
 
-	char *TxInfoStr = (char *)malloc(nTxInfo*(64 * sizeof(char)+sizeof(int)+sizeof(long long)));
-	memset(TxInfoStr, 0x00, sizeof(TxInfoStr));
-	char *nTypeStr = (char *)malloc(2 * sizeof(char));
-	char *amountStr = (char *)malloc(33 * sizeof(char));
-	for (int i = 0; i < nTxInfo; i++)
-	{
-		strcat(TxInfoStr,(const char*)",");
-		strcat(TxInfoStr, (const char *)TxInfo.at(i).address.c_str());
-		strcat(TxInfoStr, (const char*)",");
-		sprintf(nTypeStr, "%d", TxInfo.at(i).ntype);
-		strcat(TxInfoStr, nTypeStr);
-		strcat(TxInfoStr, (const char*)",");
-		sprintf(amountStr, "%lld", TxInfo.at(i).amount);
-		strcat(TxInfoStr, amountStr);
-		strcat(TxInfoStr, (const char*)"@");
+bool CTokenRegistry::Init(bool fWipe)
+{
+	LOCK(cs);
+	cacheTokens.clear();
+	mapPendingIssues.clear();
+	mapPendingIssueOuts.clear();
+	try {
+		db.reset(new CDBWrapper(dbpath, TOKEN_DB_CACHE, false, fWipe, false));
+	}
+	catch (const dbwrapper_error& e) {
+		LogPrintf("open database tokenregistry false! %s\n", e.what());
+		return false;
+	}
+
+	int nVersion = 0;
+	fNew = !db->Read(DB_TOKEN_VERSION, nVersion) && !fWipe;
+	if (nVersion == 0)
+		db->Write(DB_TOKEN_VERSION, TOKEN_DB_VERSION, true);
+	return true;
+}
 
+CTokenRegistry::CacheEntry* CTokenRegistry::Fetch(const std::string& symbol) const
+{
+	AssertLockHeld(cs);
+	CacheMap::iterator it = cacheTokens.find(symbol);
+	if (it != cacheTokens.end())
+		return &it->second;
+
+	CTokenRecord record;
+	if (!db || !db->Read(std::make_pair(DB_TOKEN_RECORD, symbol), record))
+		return NULL;
+	CacheEntry& entry = cacheTokens[symbol];
+	entry.record = record;
+	return &entry;
+}
+
+bool CTokenRegistry::ReadIssue(const IssueKey& key, AddTokenReg& issue) const
+{
+	AssertLockHeld(cs);
+	std::map<IssueKey, AddTokenReg>::const_iterator it = mapPendingIssues.find(key);
+	if (it != mapPendingIssues.end()) {
+		issue = it->second;
+		return !issue.m_txid.empty();
 	}
-	s = db->Put(leveldb::WriteOptions(), Key, TxInfoStr);
-	if (!s.ok())
-	{
-		free(TxInfoStr); TxInfoStr = NULL;
-		free(nTypeStr); nTypeStr = NULL;
-		free(amountStr); amountStr = NULL;
+	return db && db->Read(std::make_pair(DB_TOKEN_ISSUE, key), issue);
+}
+
+bool CTokenRegistry::ReadIssueKey(const COutPoint& out, IssueKey& key) const
+{
+	AssertLockHeld(cs);
+	std::map<COutPoint, IssueKey>::const_iterator it = mapPendingIssueOuts.find(out);
+	if (it != mapPendingIssueOuts.end()) {
+		key = it->second;
+		return !key.first.empty();
+	}
+	return db && db->Read(std::make_pair(DB_TOKEN_ISSUEOUT, out), key);
+}
+
+bool CTokenRegistry::GetToken(const std::string& symbol, CTokenRecord& record) const
+{
+	LOCK(cs);
+	const CacheEntry* entry = Fetch(symbol);
+	if (!entry || entry->record.IsNull())
 		return false;
+	record = entry->record;
+	return true;
+}
+
+bool CTokenRegistry::HaveIssue(const COutPoint& out) const
+{
+	LOCK(cs);
+	IssueKey key;
+	return ReadIssueKey(out, key);
+}
+
+bool CTokenRegistry::GetIssues(const std::string& symbol, std::vector<AddTokenReg>& vIssues) const
+{
+	LOCK(cs);
+	const CacheEntry* entry = Fetch(symbol);
+	if (!entry || entry->record.nType != TXOUT_ADDTOKEN)
+		return false;
+	vIssues.reserve(vIssues.size() + entry->record.nIssues);
+	for (uint32_t i = 0; i < entry->record.nIssues; i++)
+	{
+		AddTokenReg issue;
+		if (!ReadIssue(std::make_pair(symbol, i), issue))
+			return error("%s: issuance %u of %s is missing", __func__, i, symbol);
+		vIssues.push_back(issue);
 	}
+	return true;
+}
 
-	free(TxInfoStr); TxInfoStr = NULL;
-	free(nTypeStr); nTypeStr = NULL;
-	free(amountStr); amountStr = NULL;
-	return true;
-}
-
-
-/*Select overloading2 */
-/************************************************************************/
-/* FuctionName: Select
-* Explain:  Get values by key
-* return: ok true   failed false
-* @parameter1: db  (leveldb::DB *) input  database path and name
-* @parameter2: Key  （char *） input a uniqueness key
-* @parameter3: txdatas(std::vector<CTxaddressData>) output  std::vector<CTxaddressData> type data
-
-*  2017-11-22  ck(kevin)
-*/
-/************************************************************************/
-bool TxDBProcess::Select(leveldb::DB *db, char *Key, std::vector<CTxaddressData> &TxInfo)
-{
-	CTxaddressData ctad;
-	std::string txinfostr;
-	
-	char *nTypeStr = (char *)malloc(2 * sizeof(char));
-	char *amountStr = (char *)malloc(33 * sizeof(char));
-	s = db->Get(leveldb::ReadOptions(), Key, &txinfostr);
-	if (!s.ok())
+void CTokenRegistry::Connect(const CTokenViewCache& tokens)
+{
+	LOCK(cs);
+	for (CTokenViewCache::TokenMap::const_iterator it = tokens.GetTokens().begin(); it != tokens.GetTokens().end(); ++it)
 	{
-		free(nTypeStr); nTypeStr = NULL;
-		free(amountStr); amountStr = NULL;
-		return false;
+		CacheEntry& entry = cacheTokens[it->first];
+		entry.record = it->second;
+		entry.fDirty = true;
 	}
-	std::string tmpstr;
-	int pos = 0;
-	while (pos != -1)
+	for (CTokenViewCache::IssueMap::const_iterator it = tokens.GetIssues().begin(); it != tokens.GetIssues().end(); ++it)
 	{
-		memset(amountStr, 0x00, sizeof(amountStr));
-		pos = txinfostr.find(',');
-		txinfostr = txinfostr.substr(pos+1);
-		pos = txinfostr.find(',');
-		ctad.address = txinfostr.substr(0,pos);
-		txinfostr = txinfostr.substr(pos + 1);
-		pos = txinfostr.find(',');
-		strncpy(nTypeStr, (const char *)txinfostr.c_str(), pos);
-		sscanf(nTypeStr, "%d", &ctad.ntype);
-		txinfostr = txinfostr.substr(pos + 1);
-		pos = txinfostr.find('@');
-		std::string str1 = txinfostr.substr(0, pos);
-		sscanf((char*)str1.c_str(), "%lld", &ctad.amount);
-		txinfostr = txinfostr.substr(pos + 1);
-		TxInfo.push_back(ctad);
-		pos = txinfostr.find(',');
-	
+		IssueKey key(it->second.second.m_addTokenLabel.getTokenSymbol(), it->second.first);
+		mapPendingIssues[key] = it->second.second;
+		mapPendingIssueOuts[it->first] = key;
 	}
+}
 
-	
-	free(nTypeStr); nTypeStr = NULL;
-	free(amountStr); amountStr = NULL;
+void CTokenRegistry::DisconnectRegistration(const uint256& txid, const std::string& symbol)
+{
+	LOCK(cs);
+	CacheEntry* entry = Fetch(symbol);
+	if (!entry || entry->record.nType != TXOUT_TOKENREG || entry->record.txid != txid)
+		return;
+	entry->record.SetNull();
+	entry->fDirty = true;
+}
 
+void CTokenRegistry::DisconnectIssue(const COutPoint& out)
+{
+	LOCK(cs);
+	IssueKey key;
+	AddTokenReg issue;
+	if (!ReadIssueKey(out, key) || !ReadIssue(key, issue))
+		return;
+	CacheEntry* entry = Fetch(key.first);
+	//Blocks are disconnected last first, only the latest issuance of a symbol can be undone
+	if (!entry || entry->record.nType != TXOUT_ADDTOKEN || entry->record.nIssues != key.second + 1)
+	{
+		LogPrintf("CTokenRegistry: %s is not the latest issuance of %s, not disconnected\n", out.ToString(), key.first);
+		return;
+	}
+	entry->record.nIssued -= issue.m_addTokenLabel.currentCount;
+	if (--entry->record.nIssues == 0)
+		entry->record.SetNull();
+	entry->fDirty = true;
+	mapPendingIssues[key] = AddTokenReg();
+	mapPendingIssueOuts[out] = IssueKey();
+}
 
-	
-	return true;
-}
+bool CTokenRegistry::Flush()
+{
+	LOCK(cs);
+	if (!db)
+		return true;
 
+	CDBBatch batch(*db);
+	for (CacheMap::const_iterator it = cacheTokens.begin(); it != cacheTokens.end(); ++it)
+	{
+		if (!it->second.fDirty)
+			continue;
+		if (it->second.record.IsNull())
+			batch.Erase(std::make_pair(DB_TOKEN_RECORD, it->first));
+		else
+			batch.Write(std::make_pair(DB_TOKEN_RECORD, it->first), it->second.record);
+	}
+	for (std::map<IssueKey, AddTokenReg>::const_iterator it = mapPendingIssues.begin(); it != mapPendingIssues.end(); ++it)
+	{
+		if (it->second.m_txid.empty())
+			batch.Erase(std::make_pair(DB_TOKEN_ISSUE, it->first));
+		else
+			batch.Write(std::make_pair(DB_TOKEN_ISSUE, it->first), it->second);
+	}
+	for (std::map<COutPoint, IssueKey>::const_iterator it = mapPendingIssueOuts.begin(); it != mapPendingIssueOuts.end(); ++it)
+	{
+		if (it->second.first.empty())
+			batch.Erase(std::make_pair(DB_TOKEN_ISSUEOUT, it->first));
+		else
+			batch.Write(std::make_pair(DB_TOKEN_ISSUEOUT, it->first), it->second);
+	}
+	try {
+		db->WriteBatch(batch, true);
+	}
+	catch (const dbwrapper_error& e) {
+		return error("%s: %s", __func__, e.what());
+	}
+
+	mapPendingIssues.clear();
+	mapPendingIssueOuts.clear();
+	if (cacheTokens.size() > TOKEN_MAX_CACHED_SYMBOLS)
+	{
+		cacheTokens.clear();
+		return true;
+	}
+	for (CacheMap::iterator it = cacheTokens.begin(); it != cacheTokens.end();)
+	{
+		if (it->second.record.IsNull())
+			it = cacheTokens.erase(it);
+		else
+		{
+			it->second.fDirty = false;
+			++it;
+		}
+	}
+	return true;
+}
+
+size_t CTokenRegistry::DynamicMemoryUsage() const
+{
+	LOCK(cs);
+	size_t nUsage = memusage::DynamicUsage(cacheTokens) + memusage::DynamicUsage(mapPendingIssues) + memusage::DynamicUsage(mapPendingIssueOuts);
+	for (CacheMap::const_iterator it = cacheTokens.begin(); it != cacheTokens.end(); ++it)
+	{
+		const AddTokenReg& issue = it->second.record.firstIssue;
+		nUsage += memusage::DynamicUsage(it->first) + memusage::DynamicUsage(issue.m_txid) +
+			memusage::DynamicUsage(issue.address) + memusage::DynamicUsage(issue.m_addTokenLabel.extendinfo);
+	}
+	for (std::map<IssueKey, AddTokenReg>::const_iterator it = mapPendingIssues.begin(); it != mapPendingIssues.end(); ++it)
+		nUsage += memusage::DynamicUsage(it->first.first) + memusage::DynamicUsage(it->second.m_txid) +
+			memusage::DynamicUsage(it->second.address) + memusage::DynamicUsage(it->second.m_addTokenLabel.extendinfo);
+	for (std::map<COutPoint, IssueKey>::const_iterator it = mapPendingIssueOuts.begin(); it != mapPendingIssueOuts.end(); ++it)
+		nUsage += memusage::DynamicUsage(it->second.first);
+	return nUsage;
+}
 
 //end
 
@@ -907,7 +1073,9 @@ bool CDBWrapper::IsEmpty()
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
+void CDBIterator::SeekToLast() { piter->SeekToLast(); }
 void CDBIterator::Next() { piter->Next(); }
+void CDBIterator::Prev() { piter->Prev(); }
 
 namespace dbwrapper_private {
 
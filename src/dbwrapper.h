@@ -8,15 +8,22 @@
 #include "clientversion.h"
 #include "serialize.h"
 #include "streams.h"
+#include "sync.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #include "version.h"
 
 #include <boost/filesystem/path.hpp>
 
+#include <map>
+#include <memory>
+#include <set>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 #include "addressindex.h"
+#include "consensus/validation.h"
+#include "tokenregistry.h"
 
 
 //static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
@@ -31,17 +38,42 @@ static const int64_t MEMORY_ALLOCATION_MIN = 33;
 class CTxaddressData
 {
 public:
-	std::string  address;
+	CTxIndexEntity address;	//address type + hash160, null if the script has none; base58 only when printed
 	int ntype;				
 	int64_t amount;			
 
-	CTxaddressData(){}
-	CTxaddressData(std::string& str, int type, int64_t nvalue){
-		address = str;
+	CTxaddressData() : ntype(0), amount(0) {}
+	CTxaddressData(const CTxIndexEntity& entity, int type, int64_t nvalue){
+		address = entity;
 		ntype = type;
 		amount = nvalue;
 	}
 
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(address);
+		READWRITE(VARINT(ntype));
+		READWRITE(amount);
+	}
+
+};
+
+/** Address index record of a transaction: the subjects it was filed under and its input/output data */
+class CTxIndexTx
+{
+public:
+	std::vector<CTxIndexEntity> vEntities;
+	std::vector<CTxaddressData> vData;
+
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(vEntities);
+		READWRITE(vData);
+	}
 };
 
 
@@ -138,6 +170,8 @@ public:
 
     void SeekToFirst();
 
+    void SeekToLast();
+
     template<typename K> void Seek(const K& key) {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
@@ -148,6 +182,8 @@ public:
 
     void Next();
 
+    void Prev();
+
     template<typename K> bool GetKey(K& key) {
         leveldb::Slice slKey = piter->key();
         try {
@@ -315,45 +351,191 @@ public:
     bool IsEmpty();
 };
 
+/**
+ * Address, IPC hash and token symbol index behind the getaddresstxids,
+ * getipchashtxids and gettokensymboltxids RPCs. Every subject (a
+ * CTxIndexEntity) owns a sequence of txids keyed by a big-endian sequence
+ * number, plus a reverse txid -> sequence record used to deduplicate and to
+ * page from a given txid. Confirmed balance, received, sent and tx count
+ * totals are kept per address and per (address, token symbol).
+ *
+ * Changes are kept in memory, visible to readers, and written in a single
+ * batch together with their counters by Flush(), which FlushStateToDisk calls
+ * right before the chainstate is written.
+ */
 class TxDBProcess
 {
 public:
-	struct KeyInfo{
+	TxDBProcess();
+	~TxDBProcess();
+	/** Open the index; a reindex connects every block again and so completes the balances */
+	bool Init(bool fReindex);
+
+	/** File txid under every entity in vEntities and store its input/output data */
+	bool AddTx(const uint256& txid, const std::vector<CTxIndexEntity>& vEntities, const std::vector<CTxaddressData>& TxInfo);
+	/** Undo AddTx, e.g. when the block containing txid is disconnected */
+	bool RemoveTx(const uint256& txid);
+
+	/**
+	 * Newest first, at most newest_num (0 for all) txids of entity. If pfrom is
+	 * given only txids older than it are returned. False if there are none or
+	 * pfrom is not part of the sequence.
+	 */
+	bool Select(const CTxIndexEntity& entity, std::vector<uint256>& txids, long newest_num, const uint256* pfrom = NULL);
+	uint64_t GetCount(const CTxIndexEntity& entity);
+	bool Select(const uint256& txid, std::vector<CTxaddressData>& TxInfo);
+
+	/** Apply the balance changes of a transaction connected in a block */
+	bool ConnectBalances(const uint256& txid, const std::vector<CTxIndexBalanceDelta>& vDeltas);
+	/** Revert ConnectBalances for a transaction of a disconnected block */
+	bool DisconnectBalances(const uint256& txid);
+	/** Totals of address in coins, or in token unless it is null; false if it never appeared in a block */
+	bool GetBalance(const CTxIndexEntity& address, const CTxIndexEntity& token, CTxIndexBalance& balance);
+	/** False while blocks connected before the balance totals were added are missing from them */
+	bool HasCompleteBalances();
+
+	/** Write all pending changes in one batch */
+	bool Flush();
+	/** Memory held by changes waiting for Flush() */
+	size_t DynamicMemoryUsage();
 
-		char StartKey[MEMORY_ALLOCATION_MAX];   /* The initial key of the key sequence */
-		char EndKey[MEMORY_ALLOCATION_MAX];     /* The end key of the keyx sequence */
-		int64_t RecordSum;                        /* The total number of records in the Key sequence */
-		int64_t KeyHight;
+private:
+	CCriticalSection cs;
+	std::unique_ptr<CDBWrapper> db;
+	boost::filesystem::path dbpath;
+	bool fIncompleteBalances;
+	std::map<CTxIndexEntity, CTxIndexCounter> mapCounters;
+	std::set<CTxIndexEntity> setDirtyCounters;
+
+	//! Pending changes; a null txid, a zero sequence number or an empty record marks an erase
+	std::map<CTxIndexEntryKey, uint256> mapPendingEntries;
+	std::map<std::pair<CTxIndexEntity, uint256>, uint64_t> mapPendingPositions;
+	std::map<uint256, CTxIndexTx> mapPendingTxs;
+
+	typedef std::pair<CTxIndexEntity, CTxIndexEntity> BalanceKey;
+	std::map<BalanceKey, CTxIndexBalance> mapBalances;
+	std::set<BalanceKey> setDirtyBalances;
+	//! Balance changes per connected transaction, kept to undo them; empty marks an erase
+	std::map<uint256, std::vector<CTxIndexBalanceDelta> > mapPendingDeltas;
+
+	CTxIndexCounter& GetCounter(const CTxIndexEntity& entity);
+	CTxIndexBalance& GetBalanceEntry(const BalanceKey& key);
+	bool ReadDeltas(const uint256& txid, std::vector<CTxIndexBalanceDelta>& vDeltas);
+	void ApplyDeltas(const std::vector<CTxIndexBalanceDelta>& vDeltas, int nSign);
+	bool ReadPosition(const CTxIndexEntity& entity, const uint256& txid, uint64_t& nSeq);
+	bool ReadTx(const uint256& txid, CTxIndexTx& txIndex);
+	bool Insert(const CTxIndexEntity& entity, const uint256& txid);
+	bool Erase(const CTxIndexEntity& entity, const uint256& txid);
+	bool MigrateLegacyDB(const boost::filesystem::path& legacyPath);
+};
+
+/**
+ * Owner txids of the unique IPC hashes and token symbols and hashes of the
+ * active chain. Lookups go through an in-memory cache of recently used and
+ * changed entries, keys without an owner included, as most lookups are for
+ * new hashes; changes are written in a single batch by Flush(), which
+ * FlushStateToDisk calls right before the chainstate is written, and the
+ * cache is dropped afterwards once it grows past its bound.
+ *
+ * Entries only ever point at the transaction that registered them, so a
+ * disconnected block is undone by removing its own keys again.
+ */
+class CIPCUniqueDB : public CIPCUniqueView
+{
+public:
+	CIPCUniqueDB();
+	~CIPCUniqueDB();
+	/** Open the database, wiping it if fWipe is set */
+	bool Init(bool fWipe);
+	/** True if Init() created an empty database that was not asked to be wiped */
+	bool IsNew() const { return fNew; }
+
+	bool GetOwner(const CIPCUniqueKey& key, uint256& txid) const;
+	/** Register key for txid unless a transaction already owns it */
+	void Add(const CIPCUniqueKey& key, const uint256& txid);
+	/** Undo Add(), only if txid is the owner of key */
+	void Remove(const CIPCUniqueKey& key, const uint256& txid);
+
+	/** Write all pending changes in one batch */
+	bool Flush();
+	/** Memory held by the cache */
+	size_t DynamicMemoryUsage() const;
+
+private:
+	struct CacheEntry {
+		uint256 txid; //!< null if the key has no owner
+		bool fDirty;
+		CacheEntry() : fDirty(false) {}
 	};
+	typedef boost::unordered_map<CIPCUniqueKey, CacheEntry, CIPCUniqueKeyHasher> CacheMap;
 
-	leveldb::Status s;
-	leveldb::DB *db;
-	leveldb::Options options;
-	std::string dbpath;
+	mutable CCriticalSection cs;
+	std::unique_ptr<CDBWrapper> db;
+	boost::filesystem::path dbpath;
+	bool fNew;
+	mutable CacheMap cacheKeys;
 
-	TxDBProcess();
-	~TxDBProcess();
-	bool Init();
-	bool InsertTxid(leveldb::DB *db, char *Key, char* txid);
-	bool SelectTxid(leveldb::DB *db, char *Key, std::vector<std::string> &txids, int64_t get_num, int16_t out_of_order);
-	bool DeleteTxid(leveldb::DB *db, char *Key, char *txid);
-	int64_t GetTotalNum(leveldb::DB *db, char *Key);
-	int64_t GetHeight(leveldb::DB *db, char *Key);
-	bool ReadKeyInfo(leveldb::DB *db, char *Key, KeyInfo *keyinfo);
-	bool UpdateKeyInfo(leveldb::DB *db, char *Key, KeyInfo *keyinfo);
-
-	long Select(leveldb::DB *db, char *Key, std::vector<std::string> &values, long newest_num);
-	long Select(leveldb::DB *db, char *Key, std::vector<std::string> &values, long newest_num, char *Value);
-	bool Insert(leveldb::DB *db, char *Key, char* Value);
-	int DeleteTx(leveldb::DB *db, char *Key, char* Value);
-	long GetSum(leveldb::DB *db, char *Key);
-	long GetMax(leveldb::DB *db, char *Key);
-	bool SearchKeyTxByItor(leveldb::DB *db, char *Key, char *Value);
-	bool SearchKeyTxByIndex(leveldb::DB *db, char *Key, char* KeyIndex, char *Value);
-	bool GetMaxKey(leveldb::DB *db, char *Key, char *MaxKey);
-	bool Insert(leveldb::DB *db, char *Key, std::vector<CTxaddressData> &TxInfo);
-	bool Select(leveldb::DB *db, char *Key, std::vector<CTxaddressData> &TxInfo);
+	CacheEntry* Fetch(const CIPCUniqueKey& key) const;
+};
+
+/**
+ * Token symbols of the active chain and the additional issuances of each,
+ * kept by symbol and by the output of every issuance. Changes are written in
+ * a single batch by Flush(), which FlushStateToDisk calls right before the
+ * chainstate is written.
+ *
+ * Records of recently used symbols stay in memory until the cache grows past
+ * its bound; issuances are only read from disk when they are listed.
+ */
+class CTokenRegistry : public CTokenView
+{
+public:
+	CTokenRegistry();
+	~CTokenRegistry();
+	/** Open the database, wiping it if fWipe is set */
+	bool Init(bool fWipe);
+	/** True if Init() created an empty database that was not asked to be wiped */
+	bool IsNew() const { return fNew; }
+
+	bool GetToken(const std::string& symbol, CTokenRecord& record) const;
+	bool HaveIssue(const COutPoint& out) const;
+	/** All issuances of symbol in the order they were connected, false if it is not an issued token */
+	bool GetIssues(const std::string& symbol, std::vector<AddTokenReg>& vIssues) const;
+
+	/** Apply the registrations and issuances of a connected block */
+	void Connect(const CTokenViewCache& tokens);
+	/** Undo the registration of symbol if txid made it */
+	void DisconnectRegistration(const uint256& txid, const std::string& symbol);
+	/** Undo the issuance at out, which must be the last one of its symbol */
+	void DisconnectIssue(const COutPoint& out);
+
+	/** Write all pending changes in one batch */
+	bool Flush();
+	/** Memory held by the cache and the pending changes */
+	size_t DynamicMemoryUsage() const;
 
+private:
+	struct CacheEntry {
+		CTokenRecord record; //!< null if the symbol does not exist
+		bool fDirty;
+		CacheEntry() : fDirty(false) {}
+	};
+	typedef boost::unordered_map<std::string, CacheEntry, CTokenSymbolHasher> CacheMap;
+	typedef std::pair<std::string, uint32_t> IssueKey;
+
+	mutable CCriticalSection cs;
+	std::unique_ptr<CDBWrapper> db;
+	boost::filesystem::path dbpath;
+	bool fNew;
+	mutable CacheMap cacheTokens;
+
+	//! Pending changes; an empty txid or symbol marks an erase
+	std::map<IssueKey, AddTokenReg> mapPendingIssues;
+	std::map<COutPoint, IssueKey> mapPendingIssueOuts;
+
+	CacheEntry* Fetch(const std::string& symbol) const;
+	bool ReadIssue(const IssueKey& key, AddTokenReg& issue) const;
+	bool ReadIssueKey(const COutPoint& out, IssueKey& key) const;
 };
 
 #endif // BITCOIN_DBWRAPPER_H
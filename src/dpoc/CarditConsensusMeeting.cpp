@@ -13,6 +13,9 @@
 #include <list>
 #include "../net.h"
 
+//Number of sorted meeting orders GetMeetingList keeps
+static const size_t MAX_MEETING_ORDERS = 16;
+
 extern void  generateDPOCForMeetingForPackage(uint160 pubkey160hash, uint32_t nPeriodCount, uint64_t  nPeriodStartTime, uint32_t  nTimePeriod);
 
 CCarditConsensusMeeting::CCarditConsensusMeeting():bInit(true),bHasCompleteNewMeeting(false),nInitPeriodStartTime(0)
@@ -566,42 +569,40 @@ int CCarditConsensusMeeting::getLast2RoundMeetingInfo(int64_t curPeriodStartTime
 bool CCarditConsensusMeeting::GetMeetingList(int64_t nStartTime, std::list<std::shared_ptr<CConsensusAccount>> &conList)
 {
 	LogPrintf("[CCarditConsensusMeeting::GetMeetingList] begin\n");
-    static  int64_t tempStartTime = 0;
-    static std::list<std::shared_ptr<CConsensusAccount>> tempconList;
-    static std::list<std::shared_ptr<CConsensusAccount>> sortconList;
-  if(tempStartTime == nStartTime && tempconList.size() == conList.size()&&tempconList.size()!=0){
-        std::list<std::shared_ptr<CConsensusAccount>>::iterator itor1 = tempconList.begin();
-        std::list<std::shared_ptr<CConsensusAccount>>::iterator itor2 = conList.begin();
-        bool getdifference = false;
-           while(itor1!=tempconList.end()&&itor2!=conList.end()){
-               uint160 pk1 = (*itor1)->getPubicKey160hash();
-               uint160 pk2 = (*itor2)->getPubicKey160hash();
-               if(pk1 != pk2){
-                   getdifference = true;
-                       break;
-                }
-               itor1++;
-               itor2++;
-           }
-           if(!getdifference){
-                conList.clear();
-                std::copy(sortconList.begin(), sortconList.end(), std::back_inserter(conList));
-                LogPrintf("[CCarditConsensusMeeting::GetMeetingList] end temp used conList_size:%d\n",conList.size());
-                return true;
-           }
-    }
-    tempStartTime = nStartTime;
-    tempconList.clear();
-    tempconList = conList;
+	CHashWriter ss(SER_GETHASH, 0);
+	ss << (uint64_t)conList.size();
+	for (std::list<std::shared_ptr<CConsensusAccount>>::iterator it = conList.begin(); it != conList.end(); ++it)
+	{
+		ss << (*it)->getPubicKey160hash();
+	}
+	MeetingOrderKey key(nStartTime, ss.GetHash());
 
+	//The lock is held while sorting so that threads asking for the same order wait for it
+	//instead of sorting it again, sortConsensusList takes no other lock
+	meetingOrderLock lock(mutexMeetingOrders);
+	std::map<MeetingOrderKey, MeetingOrderList::iterator>::iterator iter = mapMeetingOrders.find(key);
+	if (iter != mapMeetingOrders.end())
+	{
+		meetingOrders.splice(meetingOrders.begin(), meetingOrders, iter->second);
+		conList = iter->second->second;
+		LogPrintf("[CCarditConsensusMeeting::GetMeetingList] end cached conList_size:%d\n", conList.size());
+		return true;
+	}
 
 	CLocalAccount account;
-    CMeetingItem meetingItem(account, conList, nStartTime);
+	CMeetingItem meetingItem(account, conList, nStartTime);
 	meetingItem.sortConsensusList();
 	meetingItem.GetConsensusList(conList);
-    sortconList = conList;
 
-    LogPrintf("[CCarditConsensusMeeting::GetMeetingList] endl\n");
+	meetingOrders.push_front(std::make_pair(key, conList));
+	mapMeetingOrders[key] = meetingOrders.begin();
+	if (meetingOrders.size() > MAX_MEETING_ORDERS)
+	{
+		mapMeetingOrders.erase(meetingOrders.back().first);
+		meetingOrders.pop_back();
+	}
+
+	LogPrintf("[CCarditConsensusMeeting::GetMeetingList] endl\n");
 	return true;
 }
 
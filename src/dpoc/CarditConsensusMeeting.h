@@ -6,9 +6,11 @@
 #include "MeetingItem.h"
 #include "TimeService.h"
 #include <list>
+#include <map>
 #include <boost/shared_ptr.hpp>
 #include <memory>
 #include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 #include "ConsensusAccountPool.h"
 #include "ConsensusAccount.h"
 
@@ -66,5 +68,14 @@ private:
 	boost::shared_mutex  rwmutex;
 	typedef boost::shared_lock<boost::shared_mutex> readLock;
 	typedef boost::unique_lock<boost::shared_mutex> writeLock;
+
+	//Sorted meeting orders by period start time and digest of the candidate list,
+	//the most recently used first
+	typedef std::pair<int64_t, uint256> MeetingOrderKey;
+	typedef std::list<std::pair<MeetingOrderKey, std::list<std::shared_ptr<CConsensusAccount>>>> MeetingOrderList;
+	MeetingOrderList meetingOrders;
+	std::map<MeetingOrderKey, MeetingOrderList::iterator> mapMeetingOrders;
+	boost::mutex  mutexMeetingOrders;
+	typedef boost::unique_lock<boost::mutex> meetingOrderLock;
 };
 #endif // CARDIT_CONSENSUS_MEETING_H
@@ -1,5 +1,8 @@
 ﻿
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <limits>
 #include <utility>
 #include "../util.h"
 #include "../chain.h"
@@ -19,6 +22,7 @@
 #include "TimeService.h"
 #include "SerializeDpoc.h"
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 #include "wallet/wallet.h"
 
 extern int g_ConsensusSwitchingHeight;
@@ -65,15 +69,95 @@ SnapshotClass::SnapshotClass(const SnapshotClass& in){
 	cachedBanList = in.cachedBanList;
 }
 
+static void AddContainerUsage(const void* pId, size_t nUsage, std::set<const void*> &setCounted, size_t &nTotal)
+{
+	if (setCounted.insert(pId).second)
+		nTotal += nUsage;
+}
+
+size_t SnapshotClass::DynamicMemoryUsage(std::set<const void*> &setCounted) const
+{
+	size_t nTotal = 0;
+	AddContainerUsage(curCandidateIndexList.Id(), curCandidateIndexList.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(curSeriousPunishIndexAdded.Id(), curSeriousPunishIndexAdded.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(curTimeoutIndexRecord.Id(), curTimeoutIndexRecord.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(curRefundIndexList.Id(), curRefundIndexList.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(curTimeoutPunishList.Id(), curTimeoutPunishList.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(curBanList.Id(), curBanList.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(cachedIndexsToRefund.Id(), cachedIndexsToRefund.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(cachedTimeoutPunishToRun.Id(), cachedTimeoutPunishToRun.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(cachedMeetingAccounts.Id(), cachedMeetingAccounts.DynamicMemoryUsage(), setCounted, nTotal);
+	AddContainerUsage(cachedBanList.Id(), cachedBanList.DynamicMemoryUsage(), setCounted, nTotal);
+	return nTotal;
+}
+
+CSnapshotDelta::CSnapshotDelta(const SnapshotClass &snapshotIn, const SnapshotClass *pbase) : nBaseHeight(NO_BASE), nShareMask(0), snapshot(snapshotIn)
+{
+	if (!pbase)
+		return;
+
+	nBaseHeight = pbase->blockHeight;
+	if (snapshot.curCandidateIndexList == pbase->curCandidateIndexList)
+		nShareMask |= SHARE_CANDIDATE;
+	if (snapshot.curSeriousPunishIndexAdded == pbase->curSeriousPunishIndexAdded)
+		nShareMask |= SHARE_SERIOUSPUNISHADDED;
+	if (snapshot.curTimeoutIndexRecord == pbase->curTimeoutIndexRecord)
+		nShareMask |= SHARE_TIMEOUTRECORD;
+	if (snapshot.curRefundIndexList == pbase->curRefundIndexList)
+		nShareMask |= SHARE_REFUND;
+	if (snapshot.curTimeoutPunishList == pbase->curTimeoutPunishList)
+		nShareMask |= SHARE_TIMEOUTPUNISH;
+	if (snapshot.curBanList == pbase->curBanList)
+		nShareMask |= SHARE_BAN;
+	if (snapshot.cachedIndexsToRefund == pbase->cachedIndexsToRefund)
+		nShareMask |= SHARE_CACHEDREFUND;
+	if (snapshot.cachedTimeoutPunishToRun == pbase->cachedTimeoutPunishToRun)
+		nShareMask |= SHARE_CACHEDTIMEOUTPUNISH;
+	if (snapshot.cachedMeetingAccounts == pbase->cachedMeetingAccounts)
+		nShareMask |= SHARE_CACHEDMEETING;
+	if (snapshot.cachedBanList == pbase->cachedBanList)
+		nShareMask |= SHARE_CACHEDBAN;
+}
 
-void CConsensusAccountPool::printsets(std::set<uint16_t> list)
+bool CSnapshotDelta::Resolve(const SnapshotClass *pbase)
+{
+	if (nBaseHeight == NO_BASE)
+		return true;
+	if (!pbase || pbase->blockHeight != nBaseHeight)
+		return false;
+
+	if (nShareMask & SHARE_CANDIDATE)
+		snapshot.curCandidateIndexList = pbase->curCandidateIndexList;
+	if (nShareMask & SHARE_SERIOUSPUNISHADDED)
+		snapshot.curSeriousPunishIndexAdded = pbase->curSeriousPunishIndexAdded;
+	if (nShareMask & SHARE_TIMEOUTRECORD)
+		snapshot.curTimeoutIndexRecord = pbase->curTimeoutIndexRecord;
+	if (nShareMask & SHARE_REFUND)
+		snapshot.curRefundIndexList = pbase->curRefundIndexList;
+	if (nShareMask & SHARE_TIMEOUTPUNISH)
+		snapshot.curTimeoutPunishList = pbase->curTimeoutPunishList;
+	if (nShareMask & SHARE_BAN)
+		snapshot.curBanList = pbase->curBanList;
+	if (nShareMask & SHARE_CACHEDREFUND)
+		snapshot.cachedIndexsToRefund = pbase->cachedIndexsToRefund;
+	if (nShareMask & SHARE_CACHEDTIMEOUTPUNISH)
+		snapshot.cachedTimeoutPunishToRun = pbase->cachedTimeoutPunishToRun;
+	if (nShareMask & SHARE_CACHEDMEETING)
+		snapshot.cachedMeetingAccounts = pbase->cachedMeetingAccounts;
+	if (nShareMask & SHARE_CACHEDBAN)
+		snapshot.cachedBanList = pbase->cachedBanList;
+	return true;
+}
+
+
+void CConsensusAccountPool::printsets(const std::set<uint16_t> &list)
 {
 	if (g_bStdCout)
 	{
 		std::cout << "--------------------list--------------------" << std::endl;
 	}
 	LogPrintf("--------------------list--------------------\n");
-	std::set<uint16_t>::iterator it;
+	std::set<uint16_t>::const_iterator it;
 	for (it = list.begin(); it != list.end(); it++) {
 		if (*it == 0)
 		{
@@ -95,7 +179,7 @@ void CConsensusAccountPool::printsets(std::set<uint16_t> list)
 	LogPrintf("\n");
 }
 
-void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
+void CConsensusAccountPool::printsnapshots(const std::vector<SnapshotRef> &list)
 {
     if(!fPrintToDebugLog)
         return;
@@ -103,9 +187,9 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		std::cout << "--------------------check snapshots--------------------" << std::endl;
 	}
-	std::set<uint16_t>::iterator it;
-	std::map<uint16_t, int>::iterator mapit;
-	std::vector<std::pair<uint16_t, int64_t>>::iterator meetingit;
+	std::set<uint16_t>::const_iterator it;
+	std::map<uint16_t, int>::const_iterator mapit;
+	std::vector<std::pair<uint16_t, int64_t>>::const_iterator meetingit;
 	
 	if (g_bStdCout)
 	{
@@ -116,10 +200,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (it = list.at(i).curCandidateIndexList.begin(); it != list.at(i).curCandidateIndexList.end(); it++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (it = list.at(i)->curCandidateIndexList.begin(); it != list.at(i)->curCandidateIndexList.end(); it++) {
 			if (g_bStdCout)
 			{
 				std::cout << *it << " ";
@@ -147,10 +231,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (meetingit = list.at(i).cachedMeetingAccounts.begin(); meetingit != list.at(i).cachedMeetingAccounts.end(); meetingit++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (meetingit = list.at(i)->cachedMeetingAccounts.begin(); meetingit != list.at(i)->cachedMeetingAccounts.end(); meetingit++) {
 			if (g_bStdCout)
 			{
 				std::cout << (*meetingit).first << "-" << (*meetingit).second << " ";
@@ -179,10 +263,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (it = list.at(i).curRefundIndexList.begin(); it != list.at(i).curRefundIndexList.end(); it++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (it = list.at(i)->curRefundIndexList.begin(); it != list.at(i)->curRefundIndexList.end(); it++) {
 			if (g_bStdCout)
 			{
 				std::cout << *it << " ";
@@ -210,10 +294,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (it = list.at(i).cachedIndexsToRefund.begin(); it != list.at(i).cachedIndexsToRefund.end(); it++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (it = list.at(i)->cachedIndexsToRefund.begin(); it != list.at(i)->cachedIndexsToRefund.end(); it++) {
 			if (g_bStdCout)
 			{
 				std::cout << *it << " ";
@@ -241,10 +325,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (mapit = list.at(i).curTimeoutIndexRecord.begin(); mapit != list.at(i).curTimeoutIndexRecord.end(); mapit++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (mapit = list.at(i)->curTimeoutIndexRecord.begin(); mapit != list.at(i)->curTimeoutIndexRecord.end(); mapit++) {
 			if (g_bStdCout)
 			{
 				std::cout << mapit->first << "-" << mapit->second << " ";
@@ -272,10 +356,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (it = list.at(i).curTimeoutPunishList.begin(); it != list.at(i).curTimeoutPunishList.end(); it++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (it = list.at(i)->curTimeoutPunishList.begin(); it != list.at(i)->curTimeoutPunishList.end(); it++) {
 			if (g_bStdCout)
 			{
 				std::cout << *it << " ";
@@ -303,10 +387,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (it = list.at(i).cachedTimeoutPunishToRun.begin(); it != list.at(i).cachedTimeoutPunishToRun.end(); it++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (it = list.at(i)->cachedTimeoutPunishToRun.begin(); it != list.at(i)->cachedTimeoutPunishToRun.end(); it++) {
 			if (g_bStdCout)
 			{
 				std::cout << *it << " ";
@@ -334,10 +418,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (it = list.at(i).curBanList.begin(); it != list.at(i).curBanList.end(); it++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (it = list.at(i)->curBanList.begin(); it != list.at(i)->curBanList.end(); it++) {
 			if (g_bStdCout)
 			{
 				std::cout << *it << " ";
@@ -365,10 +449,10 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
-		for (it = list.at(i).cachedBanList.begin(); it != list.at(i).cachedBanList.end(); it++) {
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
+		for (it = list.at(i)->cachedBanList.begin(); it != list.at(i)->cachedBanList.end(); it++) {
 			if (g_bStdCout)
 			{
 				std::cout << *it << " ";
@@ -396,12 +480,12 @@ void CConsensusAccountPool::printsnapshots(std::vector<SnapshotClass> list)
 	{
 		if (g_bStdCout)
 		{
-			std::cout << list.at(i).blockHeight << " | " << list.at(i).pkHashIndex << " 	| " << list.at(i).blockTime << " | ";
-			std::cout << list.at(i).meetingstarttime << "  " << list.at(i).meetingstoptime;
+			std::cout << list.at(i)->blockHeight << " | " << list.at(i)->pkHashIndex << " 	| " << list.at(i)->blockTime << " | ";
+			std::cout << list.at(i)->meetingstarttime << "  " << list.at(i)->meetingstoptime;
 		}
-		LogPrintf("%d	|%03d	|%d	|", list.at(i).blockHeight, list.at(i).pkHashIndex, list.at(i).blockTime);
+		LogPrintf("%d	|%03d	|%d	|", list.at(i)->blockHeight, list.at(i)->pkHashIndex, list.at(i)->blockTime);
 		LogPrintf("%u	%u", 
-			list.at(i).meetingstarttime, list.at(i).meetingstoptime);
+			list.at(i)->meetingstarttime, list.at(i)->meetingstoptime);
 
 		if (g_bStdCout)
 		{
@@ -596,7 +680,7 @@ bool CConsensusAccountPool::getPublicKeyFromSignstring(const std::string signstr
 
 bool CConsensusAccountPool::verifyDPOCTx(const CTransaction& tx, DPOC_errtype &errorType)
 {
-	SnapshotClass lastsnapshot;
+	SnapshotRef lastsnapshot;
 	if (!GetLastSnapshot(lastsnapshot))
 	{
 		if (g_bStdCout)
@@ -632,28 +716,28 @@ bool CConsensusAccountPool::verifyDPOCTx(const CTransaction& tx, DPOC_errtype &e
 
 		//If you are already in the current list of candidates, you are not allowed to join again
 		//If a refund is being processed, the refund transaction cannot be rejoined
-		if (lastsnapshot.curCandidateIndexList.count(pkhashindex))
+		if (lastsnapshot->curCandidateIndexList.count(pkhashindex))
 		{
-			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The public key HASH is already in the current candidate list %d++%d\n", pkhashindex,lastsnapshot.blockHeight);
+			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The public key HASH is already in the current candidate list %d++%d\n", pkhashindex,lastsnapshot->blockHeight);
 			errorType = JOIN_PUBKEY_ALREADY_EXIST_IN_LIST;
 			return false;
 		}
-		else if (lastsnapshot.curBanList.count(pkhashindex) ||
-			lastsnapshot.cachedBanList.count(pkhashindex))
+		else if (lastsnapshot->curBanList.count(pkhashindex) ||
+			lastsnapshot->cachedBanList.count(pkhashindex))
 		{
 			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The current public key HASH is in the blacklist list\n");
 			errorType = JOIN_PUBKEY_IS_BANNED;
 			return false;
 		}
-		else if (lastsnapshot.cachedTimeoutPunishToRun.count(pkhashindex) ||
-			lastsnapshot.curTimeoutPunishList.count(pkhashindex))
+		else if (lastsnapshot->cachedTimeoutPunishToRun.count(pkhashindex) ||
+			lastsnapshot->curTimeoutPunishList.count(pkhashindex))
 		{
 			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The current public key HASH is being punished with a timeout\n");
 			errorType = JOIN_PUBKEY_IS_TIMEOUT_PUNISHED;
 			return false;
 		}
-		else if (lastsnapshot.cachedIndexsToRefund.count(pkhashindex) ||
-			lastsnapshot.curRefundIndexList.count(pkhashindex))
+		else if (lastsnapshot->cachedIndexsToRefund.count(pkhashindex) ||
+			lastsnapshot->curRefundIndexList.count(pkhashindex))
 		{
 			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The current public key HASH is performing a refund operation\n");
 			errorType = JOIN_PUBKEY_IS_DEPOSING;
@@ -662,9 +746,9 @@ bool CConsensusAccountPool::verifyDPOCTx(const CTransaction& tx, DPOC_errtype &e
 		else
 		{
 			//If a refund is to be performed in a snapshot of the cache block length, it is not allowed to join again
-			uint32_t cachedHeight = lastsnapshot.blockHeight - CACHED_BLOCK_COUNT;
-			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] Prepare to get the block height between %d-%d cache\n", cachedHeight, lastsnapshot.blockHeight);
-			std::vector<SnapshotClass> cachedSnapshotList;
+			uint32_t cachedHeight = lastsnapshot->blockHeight - CACHED_BLOCK_COUNT;
+			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] Prepare to get the block height between %d-%d cache\n", cachedHeight, lastsnapshot->blockHeight);
+			std::vector<SnapshotRef> cachedSnapshotList;
 			if (!GetSnapshotsByHeight(cachedSnapshotList, cachedHeight))
 			{
 				LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The list of cached snapshots failed！\n");
@@ -672,17 +756,17 @@ bool CConsensusAccountPool::verifyDPOCTx(const CTransaction& tx, DPOC_errtype &e
 				return false;
 			}
 
-			std::vector<SnapshotClass>::iterator pSnapshot;
+			std::vector<SnapshotRef>::iterator pSnapshot;
 
 			for (pSnapshot = cachedSnapshotList.begin(); pSnapshot != cachedSnapshotList.end(); pSnapshot++)
 			{
-				if ((*pSnapshot).curTimeoutPunishList.count(pkhashindex))
+				if ((*pSnapshot)->curTimeoutPunishList.count(pkhashindex))
 				{
 					LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The current public key HASH is being punished with a timeout\n");
 					errorType = EXIT_PUBKEY_IS_TIMEOUT_PUNISHED;
 					return false;
 				}
-				if ((*pSnapshot).curRefundIndexList.count(pkhashindex))
+				if ((*pSnapshot)->curRefundIndexList.count(pkhashindex))
 				{
 					LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The current public key HASH is performing a refund operation\n");
 					errorType = EXIT_PUBKEY_IS_DEPOSING;
@@ -709,9 +793,9 @@ bool CConsensusAccountPool::verifyDPOCTx(const CTransaction& tx, DPOC_errtype &e
 		}
 
 		//If not in the current list of candidates, do not let exit
-		if (!lastsnapshot.curCandidateIndexList.count(pkhashindex))
+		if (!lastsnapshot->curCandidateIndexList.count(pkhashindex))
 		{
-			printsets(lastsnapshot.curCandidateIndexList);
+			printsets(lastsnapshot->curCandidateIndexList);
 
 			LogPrintf("[CConsensusAccountPool::verifyDPOCTx] The public key HASH is not in the current candidate list\n");
 			errorType = EXIT_PUBKEY_NOT_EXIST_IN_LIST;
@@ -727,14 +811,14 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	LogPrintf("[CConsensusAccountPool::checkNewBlock] INBLOCK nPeriodStartTime %d, nPeriodCount %d, nTimePeriod %d, blockTime %d height=%d\n",
 		pblock->nPeriodStartTime, pblock->nPeriodCount, pblock->nTimePeriod, pblock->nTime, blockHeight);
 
-	SnapshotClass lastsnapshot;
+	SnapshotRef lastsnapshot;
 	if (!GetLastSnapshot(lastsnapshot))
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] Gets a snapshot to record the tail block failed\n");
 		return false;
 	}
 
-	if (blockHeight > lastsnapshot.blockHeight +1)
+	if (blockHeight > lastsnapshot->blockHeight +1)
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] The incoming block is too new to no verify\n");
 		errorType = BLOCK_TOO_NEW_FOR_SNAPSHOT;
@@ -752,8 +836,8 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 
 	//Time to check
 	int64_t calcTime = (pblock->nPeriodStartTime + (pblock->nTimePeriod + 1) * BLOCK_GEN_TIME) / 1000;
-	LogPrintf("[CConsensusAccountPool::checkNewBlock] The current calculation should be packaged time=%d, The last block in the snapshot should be packaged Time=%d\n", calcTime, lastsnapshot.timestamp);
-	if (calcTime < (lastsnapshot.timestamp + BLOCK_GEN_TIME/1000 ))
+	LogPrintf("[CConsensusAccountPool::checkNewBlock] The current calculation should be packaged time=%d, The last block in the snapshot should be packaged Time=%d\n", calcTime, lastsnapshot->timestamp);
+	if (calcTime < (lastsnapshot->timestamp + BLOCK_GEN_TIME/1000 ))
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] The last block gap in the current calculation is less than the last one in the snapshot %d ms，Continuous block, severe punishment！\n", BLOCK_GEN_TIME);
 		return false;
@@ -762,14 +846,14 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	if (pblock->nTime != calcTime) {
 		LogPrintf("[CConsensusAccountPool::checkNewBlock]  pblock->nTime != calcTime\n");
 		
-		if ((pblock->nTime - calcTime < 0) &&(lastsnapshot.blockHeight >= Params().CHECK_START_BLOCKCOUNT))
+		if ((pblock->nTime - calcTime < 0) &&(lastsnapshot->blockHeight >= Params().CHECK_START_BLOCKCOUNT))
 		{
 			LogPrintf("[CConsensusAccountPool::checkNewBlock] Packaging time is earlier than computation time，Or the time difference between the package time and the computation time is greater than %d seconds\n", MAX_BLOCK_TIME_DIFF);
 			errorType = PUNISH_BLOCK;
 			return false;
 		}
 		/*
-		else if ((pblock->nTime - calcTime > MAX_BLOCK_TIME_DIFF) &&(lastsnapshot.blockHeight >= Params().CHECK_START_BLOCKCOUNT))
+		else if ((pblock->nTime - calcTime > MAX_BLOCK_TIME_DIFF) &&(lastsnapshot->blockHeight >= Params().CHECK_START_BLOCKCOUNT))
 		{   //It's possible to have a block delay
 			LogPrintf("[CConsensusAccountPool::checkNewBlock] The packaging time is earlier than the calculation time, or the time difference between the packaging time and the computation time is greater than %d seconds\n", MAX_BLOCK_TIME_DIFF);
 			return false;
@@ -779,7 +863,7 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	
 	//Look for a snapshot of the current session's start time
 	int64_t curStarttime = pblock->nPeriodStartTime / 1000;
-	SnapshotClass meetingStartSnapshot;
+	SnapshotRef meetingStartSnapshot;
 	if (!GetSnapshotByTime(meetingStartSnapshot, curStarttime))
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] A snapshot of the start time of this session failed\n");
@@ -787,9 +871,9 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	}
 
 	LogPrintf("[CConsensusAccountPool::checkNewBlock] current start time %d ,block height in snapshot %d\n",
-		curStarttime, meetingStartSnapshot.blockHeight);
+		curStarttime, meetingStartSnapshot->blockHeight);
 
-	if (meetingStartSnapshot.blockHeight == 0 && meetingStartSnapshot.timestamp > curStarttime)
+	if (meetingStartSnapshot->blockHeight == 0 && meetingStartSnapshot->timestamp > curStarttime)
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] The current block time is earlier than the creation block, error！\n");
 		errorType = PUNISH_BLOCK;
@@ -799,20 +883,20 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	if (!bReboot)
 	{
 		//the time doesn't match, it could be the missing block or the wrong block
-		if (meetingStartSnapshot.timestamp != curStarttime
-			&& meetingStartSnapshot.blockHeight >= Params().CHECK_START_BLOCKCOUNT)
+		if (meetingStartSnapshot->timestamp != curStarttime
+			&& meetingStartSnapshot->blockHeight >= Params().CHECK_START_BLOCKCOUNT)
 		{
 			LogPrintf("[CConsensusAccountPool::checkNewBlock] The current block start time is not consistent with the snapshot packaging time found at that time，You need to verify that the block is missing。curstarttime=%d，snapshot time=%d\n",
-				curStarttime, meetingStartSnapshot.timestamp);
+				curStarttime, meetingStartSnapshot->timestamp);
 
 			//Case handling: ignore the possibility of missing a full round
 			LogPrintf("[CConsensusAccountPool::checkNewBlock] Snapshot meeting starttime=%d, endtime=%d\n",
-				meetingStartSnapshot.meetingstarttime, meetingStartSnapshot.meetingstoptime);
+				meetingStartSnapshot->meetingstarttime, meetingStartSnapshot->meetingstoptime);
 
 			//Determines whether the end time of the last block found is the start time of the current block
 			//If it is, the block that is missing in the middle is cross-round, and the block is still valid
 			/*
-			if (meetingStartSnapshot.meetingstoptime != pblock->nPeriodStartTime)
+			if (meetingStartSnapshot->meetingstoptime != pblock->nPeriodStartTime)
 			{
 				LogPrintf("[CConsensusAccountPool::checkNewBlock] The end of the session of the snapshot does not equal the start time of the current block，There may be more than one round，error\n");
 				return false;
@@ -825,15 +909,15 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	//find the cache block
 	
 	int foundcachedcount = CACHED_BLOCK_COUNT;
-	if (meetingStartSnapshot.blockHeight < Params().CHECK_START_BLOCKCOUNT)
+	if (meetingStartSnapshot->blockHeight < Params().CHECK_START_BLOCKCOUNT)
 	{
-		foundcachedcount = meetingStartSnapshot.blockHeight < CACHED_BLOCK_COUNT ? meetingStartSnapshot.blockHeight : CACHED_BLOCK_COUNT;
+		foundcachedcount = meetingStartSnapshot->blockHeight < CACHED_BLOCK_COUNT ? meetingStartSnapshot->blockHeight : CACHED_BLOCK_COUNT;
 	}
-	uint32_t cachedTime = (meetingStartSnapshot.meetingstoptime - foundcachedcount * BLOCK_GEN_TIME) / 1000;
+	uint32_t cachedTime = (meetingStartSnapshot->meetingstoptime - foundcachedcount * BLOCK_GEN_TIME) / 1000;
 	LogPrintf("[CConsensusAccountPool::checkNewBlock] Calculate the cache time is %d \n", cachedTime);
 	
 	//The consensus of this round
-	SnapshotClass cachedsnapshot;
+	SnapshotRef cachedsnapshot;
 	if (!GetSnapshotByTime(cachedsnapshot, cachedTime))
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] The cache time corresponds to a snapshot failure, and the block information is problematic\n");
@@ -841,15 +925,15 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	}
 	
 	LogPrintf("[CConsensusAccountPool::checkNewBlock] find block height = %d , find block time= %d \n",
-		cachedsnapshot.blockHeight, cachedsnapshot.timestamp);
+		cachedsnapshot->blockHeight, cachedsnapshot->timestamp);
 	
-	std::set<uint16_t> accounts = cachedsnapshot.curCandidateIndexList;
+	const std::set<uint16_t> &accounts = cachedsnapshot->curCandidateIndexList;
 	
 	printsets(accounts);
-	if (accounts.size() != pblock->nPeriodCount && cachedsnapshot.curCandidateIndexList.size() != pblock->nPeriodCount)
+	if (accounts.size() != pblock->nPeriodCount && cachedsnapshot->curCandidateIndexList.size() != pblock->nPeriodCount)
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] The number of meetings recorded in the block is inconsistent with the number of meetings in the snapshot,PeriodCount=%d,cachedsnapshot PeriodCount=%d，The number of people removed from the blacklist=%d \n",
-			pblock->nPeriodCount,cachedsnapshot.curCandidateIndexList.size(), accounts.size());
+			pblock->nPeriodCount,cachedsnapshot->curCandidateIndexList.size(), accounts.size());
 		/*
 		if (Params().NetworkIDString() == CBaseChainParams::TESTNET)
 		{
@@ -868,7 +952,7 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	
 	std::list<std::shared_ptr<CConsensusAccount >> consensusList;
 	consensusList.clear();
-	std::set<uint16_t>::iterator candidateit;
+	std::set<uint16_t>::const_iterator candidateit;
 	for (candidateit= accounts.begin(); candidateit != accounts.end(); candidateit++)
 	{
 		std::shared_ptr<CConsensusAccount> tmpaccount = std::make_shared<CConsensusAccount>(candidatelist.at(*candidateit));
@@ -878,7 +962,7 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 	uint64_t meetingstarttime = 0;
 	if (!bReboot)
 	{
-		meetingstarttime = meetingStartSnapshot.meetingstoptime;
+		meetingstarttime = meetingStartSnapshot->meetingstoptime;
 	}
 	else
 	{
@@ -932,10 +1016,10 @@ bool  CConsensusAccountPool::checkNewBlock(const std::shared_ptr<const CBlock> p
 		return false;
 	}
 	CBlockIndex* pblockindex = mapBlockIndex[pblock->GetBlockHeader().hashPrevBlock];
-	if (pblockindex->nHeight != lastsnapshot.blockHeight)
+	if (pblockindex->nHeight != lastsnapshot->blockHeight)
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] this block prevHASH %s ,prevblock height %d, snapshot tail height %d ,no match\n",
-			pblock->GetBlockHeader().hashPrevBlock.GetHex().c_str(), pblockindex->nHeight, lastsnapshot.blockHeight);
+			pblock->GetBlockHeader().hashPrevBlock.GetHex().c_str(), pblockindex->nHeight, lastsnapshot->blockHeight);
 		
 		return false;
 	}
@@ -1050,22 +1134,22 @@ bool CConsensusAccountPool::verifyDPOCBlock(const std::shared_ptr<const CBlock>
 	tmpcachedTimeoutToPunish.clear();
 	verifysuccessed = false;
 
-	SnapshotClass lastSnapshot;
+	SnapshotRef lastSnapshot;
 	if (GetLastSnapshot(lastSnapshot))
 	{
-		tmpcachedIndexsToRefund = lastSnapshot.cachedIndexsToRefund;
-		tmpcachedTimeoutToPunish = lastSnapshot.cachedTimeoutPunishToRun;
+		tmpcachedIndexsToRefund = lastSnapshot->cachedIndexsToRefund;
+		tmpcachedTimeoutToPunish = lastSnapshot->cachedTimeoutPunishToRun;
 
-		uint32_t cachedHeight = (lastSnapshot.blockHeight > CACHED_BLOCK_COUNT)?(lastSnapshot.blockHeight-CACHED_BLOCK_COUNT):0;
-		SnapshotClass cachedSnapshot;
+		uint32_t cachedHeight = (lastSnapshot->blockHeight > CACHED_BLOCK_COUNT)?(lastSnapshot->blockHeight-CACHED_BLOCK_COUNT):0;
+		SnapshotRef cachedSnapshot;
 		LogPrintf("[CConsensusAccountPool::verifyDPOCBlock] get cache snapshot height is %d\n", cachedHeight);
 		if (!GetSnapshotByHeight(cachedSnapshot, cachedHeight))
 		{
 			LogPrintf("[CConsensusAccountPool::verifyDPOCBlock] to get cache snapshot faile\n");
 			return false;
 		}
-		std::set<uint16_t>::iterator it;
-		for (it = cachedSnapshot.curRefundIndexList.begin(); it != cachedSnapshot.curRefundIndexList.end(); it++)
+		std::set<uint16_t>::const_iterator it;
+		for (it = cachedSnapshot->curRefundIndexList.begin(); it != cachedSnapshot->curRefundIndexList.end(); it++)
 		{
 			if (!tmpcachedIndexsToRefund.count(*it))
 				tmpcachedIndexsToRefund.insert(*it);
@@ -1074,7 +1158,7 @@ bool CConsensusAccountPool::verifyDPOCBlock(const std::shared_ptr<const CBlock>
 		LogPrintf("[CConsensusAccountPool::verifyDPOCBlock]The currently saved temporary list of waiting refunds is：\n");
 		printsets(tmpcachedIndexsToRefund);
 
-		for (it = cachedSnapshot.curTimeoutPunishList.begin(); it != cachedSnapshot.curTimeoutPunishList.end(); it++)
+		for (it = cachedSnapshot->curTimeoutPunishList.begin(); it != cachedSnapshot->curTimeoutPunishList.end(); it++)
 		{
 			if (!tmpcachedTimeoutToPunish.count(*it))
 				tmpcachedTimeoutToPunish.insert(*it);
@@ -1102,7 +1186,7 @@ bool CConsensusAccountPool::verifyDPOCBlock(const std::shared_ptr<const CBlock>
 					if (txout.GetCampaignType() == TYPE_CONSENSUS_RETURN_DEPOSI)
 					{
 						uint16_t pkindex;
-						if (!ContainPK(txout.devoteLabel.hash, pkindex))
+						if (!ContainPK(txout.GetDevoteLabel().hash, pkindex))
 						{
 							LogPrintf("[CConsensusAccountPool::verifyDPOCBlock] The refund public key is not in the cache list\n");
 							return false;
@@ -1117,7 +1201,7 @@ bool CConsensusAccountPool::verifyDPOCBlock(const std::shared_ptr<const CBlock>
 					else if (txout.GetCampaignType() == TYPE_CONSENSUS_ORDINARY_PUSNISHMENT)
 					{
 						uint16_t pkindex;
-						if (!ContainPK(txout.devoteLabel.hash, pkindex))
+						if (!ContainPK(txout.GetDevoteLabel().hash, pkindex))
 						{
 							LogPrintf("[CConsensusAccountPool::verifyDPOCBlock] The penalty public key is not in the cache list\n");
 							return false;
@@ -1172,9 +1256,9 @@ bool CConsensusAccountPool::ContainPK(uint160 pk, uint16_t& index)
 	return false;
 }
 
-bool CConsensusAccountPool::contain(std::vector<std::pair<uint16_t, int64_t>> list, uint16_t indexIn)
+bool CConsensusAccountPool::contain(const std::vector<std::pair<uint16_t, int64_t>> &list, uint16_t indexIn)
 {
-	std::vector<std::pair<uint16_t, int64_t>>::iterator it;
+	std::vector<std::pair<uint16_t, int64_t>>::const_iterator it;
 	for (it=list.begin(); it!=list.end(); it++)
 	{
 		if ((*it).first == indexIn)
@@ -1213,49 +1297,49 @@ uint256 CConsensusAccountPool::GetTXhashBypkhash(uint160 pkhash)
 bool CConsensusAccountPool::IsAviableUTXO(const uint256 hash)
 {
 	LogPrintf("[CConsensusAccountPool::IsAviableUTXO] get utxo state\n");
-	SnapshotClass cursnapshot;
+	SnapshotRef cursnapshot;
 	if (!GetLastSnapshot(cursnapshot))
 	{
 		LogPrintf("[CConsensusAccountPool::checkNewBlock] Gets a snapshot to record the tail block failed\n");
 		return false;
 	}
 	
-	std::set<uint16_t>::iterator refundit;
-	for (refundit = cursnapshot.curCandidateIndexList.begin(); refundit != cursnapshot.curCandidateIndexList.end(); refundit++)
+	std::set<uint16_t>::const_iterator refundit;
+	for (refundit = cursnapshot->curCandidateIndexList.begin(); refundit != cursnapshot->curCandidateIndexList.end(); refundit++)
 	{
 		if (candidatelist[*refundit].getTxhash() == hash)
 		return false;
 	}
-	for (refundit = cursnapshot.cachedIndexsToRefund.begin(); refundit != cursnapshot.cachedIndexsToRefund.end(); refundit++)
+	for (refundit = cursnapshot->cachedIndexsToRefund.begin(); refundit != cursnapshot->cachedIndexsToRefund.end(); refundit++)
 	{
 		if (candidatelist[*refundit].getTxhash() == hash)
 		return false;
 	}
-	for (refundit = cursnapshot.cachedTimeoutPunishToRun.begin(); refundit != cursnapshot.cachedTimeoutPunishToRun.end(); refundit++)
+	for (refundit = cursnapshot->cachedTimeoutPunishToRun.begin(); refundit != cursnapshot->cachedTimeoutPunishToRun.end(); refundit++)
 	{
 		if (candidatelist[*refundit].getTxhash() == hash)
 		return false;
 	}
 
-	std::vector<SnapshotClass> cachedSnapshots;
-	uint32_t cachedHeight = cursnapshot.blockHeight - CACHED_BLOCK_COUNT;
-	LogPrintf("[CConsensusAccountPool::pushDPOCBlock] to get cachedHeight between %d-%d \n", cachedHeight, cursnapshot.blockHeight);
+	std::vector<SnapshotRef> cachedSnapshots;
+	uint32_t cachedHeight = cursnapshot->blockHeight - CACHED_BLOCK_COUNT;
+	LogPrintf("[CConsensusAccountPool::pushDPOCBlock] to get cachedHeight between %d-%d \n", cachedHeight, cursnapshot->blockHeight);
 	if (!GetSnapshotsByHeight(cachedSnapshots, cachedHeight))
 	{
 		LogPrintf("[CConsensusAccountPool::pushDPOCBlock] to get the list of cached snapshots failed\n");
 		return false;
 	}
-	std::vector<SnapshotClass>::iterator searchIt;
+	std::vector<SnapshotRef>::iterator searchIt;
 	bool founded = false;
 	for (searchIt = cachedSnapshots.begin(); searchIt != cachedSnapshots.end(); searchIt++)
 	{
 
-		for (refundit = (*searchIt).curRefundIndexList.begin(); refundit != (*searchIt).curRefundIndexList.end(); refundit++)
+		for (refundit = (*searchIt)->curRefundIndexList.begin(); refundit != (*searchIt)->curRefundIndexList.end(); refundit++)
 		{
             if (*refundit <= candidatelist.size() && candidatelist[*refundit].getTxhash() == hash)
 			return false;
 		}
-		for (refundit = (*searchIt).curTimeoutPunishList.begin(); refundit != (*searchIt).curTimeoutPunishList.end(); refundit++)
+		for (refundit = (*searchIt)->curTimeoutPunishList.begin(); refundit != (*searchIt)->curTimeoutPunishList.end(); refundit++)
 		{
             if (*refundit <= candidatelist.size() && candidatelist[*refundit].getTxhash() == hash)
 			return false;
@@ -1265,10 +1349,10 @@ bool CConsensusAccountPool::IsAviableUTXO(const uint256 hash)
 	return true;
 }
 
-bool CConsensusAccountPool::getCreditFromSnapshotByIndex(SnapshotClass snapshot, const uint16_t indexIn, int64_t &credit)
+bool CConsensusAccountPool::getCreditFromSnapshotByIndex(const SnapshotClass &snapshot, const uint16_t indexIn, int64_t &credit)
 {
 	LogPrintf("[CConsensusAccountPool::getCreditFromSnapshotByIndex] called\n");
-	for (std::vector<std::pair<uint16_t, int64_t>>::iterator accountit = snapshot.cachedMeetingAccounts.begin();
+	for (std::vector<std::pair<uint16_t, int64_t>>::const_iterator accountit = snapshot.cachedMeetingAccounts.begin();
 		accountit != snapshot.cachedMeetingAccounts.end(); accountit ++)
 	{
 		if ( (*accountit).first == indexIn)
@@ -1304,7 +1388,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 		newsnapshot.blockHeight, newsnapshot.timestamp, newsnapshot.blockTime,
 		newsnapshot.meetingstarttime, newsnapshot.meetingstoptime);
 
-	SnapshotClass lastSnapshot;
+	SnapshotRef lastSnapshot;
 	if (!GetLastSnapshot(lastSnapshot))//generate block
 	{
 		uint160 MeetingHash;
@@ -1323,11 +1407,11 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 	}
 	else
 	{
-		newsnapshot.curCandidateIndexList = lastSnapshot.curCandidateIndexList;
-		newsnapshot.cachedIndexsToRefund = lastSnapshot.cachedIndexsToRefund;
-		newsnapshot.cachedTimeoutPunishToRun = lastSnapshot.cachedTimeoutPunishToRun;
-		newsnapshot.curTimeoutIndexRecord = lastSnapshot.curTimeoutIndexRecord;
-		newsnapshot.cachedBanList = lastSnapshot.cachedBanList;
+		newsnapshot.curCandidateIndexList = lastSnapshot->curCandidateIndexList;
+		newsnapshot.cachedIndexsToRefund = lastSnapshot->cachedIndexsToRefund;
+		newsnapshot.cachedTimeoutPunishToRun = lastSnapshot->cachedTimeoutPunishToRun;
+		newsnapshot.curTimeoutIndexRecord = lastSnapshot->curTimeoutIndexRecord;
+		newsnapshot.cachedBanList = lastSnapshot->cachedBanList;
 		
 		std::set<uint16_t>::iterator banit;
 		for (banit = newsnapshot.cachedBanList.begin(); banit != newsnapshot.cachedBanList.end(); banit++)
@@ -1345,14 +1429,14 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 			tmpcachedTimeoutToPunish.clear();
 			verifysuccessed = false;
 
-            //SnapshotClass lastSnapshot;
+            //SnapshotRef lastSnapshot;
             //if (GetLastSnapshot(lastSnapshot))
             {
-				tmpcachedIndexsToRefund = lastSnapshot.cachedIndexsToRefund;
-				tmpcachedTimeoutToPunish = lastSnapshot.cachedTimeoutPunishToRun;
+				tmpcachedIndexsToRefund = lastSnapshot->cachedIndexsToRefund;
+				tmpcachedTimeoutToPunish = lastSnapshot->cachedTimeoutPunishToRun;
 
-				uint32_t cachedHeight = (lastSnapshot.blockHeight > CACHED_BLOCK_COUNT) ? (lastSnapshot.blockHeight - CACHED_BLOCK_COUNT) : 0;
-				SnapshotClass cachedSnapshot;
+				uint32_t cachedHeight = (lastSnapshot->blockHeight > CACHED_BLOCK_COUNT) ? (lastSnapshot->blockHeight - CACHED_BLOCK_COUNT) : 0;
+				SnapshotRef cachedSnapshot;
 				LogPrintf("[CConsensusAccountPool::pushDPOCBlock] ready to get snapshot height = %d\n", cachedHeight);
 				if (!GetSnapshotByHeight(cachedSnapshot, cachedHeight))
 				{
@@ -1360,8 +1444,8 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 					return false;
 				}
 
-				std::set<uint16_t>::iterator it;
-				for (it = cachedSnapshot.curRefundIndexList.begin(); it != cachedSnapshot.curRefundIndexList.end(); it++)
+				std::set<uint16_t>::const_iterator it;
+				for (it = cachedSnapshot->curRefundIndexList.begin(); it != cachedSnapshot->curRefundIndexList.end(); it++)
 				{
 					if (!tmpcachedIndexsToRefund.count(*it))
 						tmpcachedIndexsToRefund.insert(*it);
@@ -1370,7 +1454,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 				LogPrintf("[CConsensusAccountPool::pushDPOCBlock]The currently saved temporary list of waiting refunds is：\n");
 				printsets(tmpcachedIndexsToRefund);
 
-				for (it = cachedSnapshot.curTimeoutPunishList.begin(); it != cachedSnapshot.curTimeoutPunishList.end(); it++)
+				for (it = cachedSnapshot->curTimeoutPunishList.begin(); it != cachedSnapshot->curTimeoutPunishList.end(); it++)
 				{
 					if (!tmpcachedTimeoutToPunish.count(*it))
 						tmpcachedTimeoutToPunish.insert(*it);
@@ -1393,7 +1477,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 		}
 
 		uint64_t cacheTime = (pblock->nPeriodStartTime - CACHED_BLOCK_COUNT * BLOCK_GEN_TIME) / 1000;
-		SnapshotClass cachedsnapshot;
+		SnapshotRef cachedsnapshot;
 		if (!GetSnapshotByTime(cachedsnapshot, cacheTime))
 		{
 			LogPrintf("[CConsensusAccountPool::pushDPOCBlock] GetSnapshotByTime faile！\n");
@@ -1432,7 +1516,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 			}
 
 			std::map<uint16_t, int> timeoutaccountindexs;
-			if (!GetTimeoutIndexs(pblock, lastSnapshot, timeoutaccountindexs))
+			if (!GetTimeoutIndexs(pblock, *lastSnapshot, timeoutaccountindexs))
 			{
 				LogPrintf("[CConsensusAccountPool::pushDPOCBlock] Failed to obtain timeout record\n");
 				return false;
@@ -1453,28 +1537,28 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 					LogPrintf("[CConsensusAccountPool::pushDPOCBlock] The record of the penalty record or the new overtime penalty record includes the index, and no overtime record is added\n");
 					continue;
 				}
-				if (lastSnapshot.curBanList.count(curtimeoutindex) ||
-					lastSnapshot.cachedBanList.count(curtimeoutindex))
+				if (lastSnapshot->curBanList.count(curtimeoutindex) ||
+					lastSnapshot->cachedBanList.count(curtimeoutindex))
 				{
 					newsnapshot.curTimeoutIndexRecord.erase(curtimeoutindex);
 					LogPrintf("[CConsensusAccountPool::pushDPOCBlock] This index is included in the serious penalty record, which removes the timeout record of the node\n");
 					continue;
 				}
 
-				std::vector<SnapshotClass> cachedSnapshots;
-				uint32_t cachedHeight = lastSnapshot.blockHeight - CACHED_BLOCK_COUNT;
-				LogPrintf("[CConsensusAccountPool::pushDPOCBlock] ready to get snapshots when height in %d-%d\n", cachedHeight, lastSnapshot.blockHeight);
+				std::vector<SnapshotRef> cachedSnapshots;
+				uint32_t cachedHeight = lastSnapshot->blockHeight - CACHED_BLOCK_COUNT;
+				LogPrintf("[CConsensusAccountPool::pushDPOCBlock] ready to get snapshots when height in %d-%d\n", cachedHeight, lastSnapshot->blockHeight);
 				if (!GetSnapshotsByHeight(cachedSnapshots, cachedHeight))
 				{
 					LogPrintf("[CConsensusAccountPool::pushDPOCBlock] get snapshot faile\n");
 					return false;
 				}
-				std::vector<SnapshotClass>::iterator searchIt;
+				std::vector<SnapshotRef>::iterator searchIt;
 				bool founded = false;
 				for (searchIt = cachedSnapshots.begin(); searchIt != cachedSnapshots.end(); searchIt++)
 				{
-					printsets((*searchIt).curTimeoutPunishList);
-					if ((*searchIt).curTimeoutPunishList.count(curtimeoutindex))
+					printsets((*searchIt)->curTimeoutPunishList);
+					if ((*searchIt)->curTimeoutPunishList.count(curtimeoutindex))
 					{
 						LogPrintf("[CConsensusAccountPool::pushDPOCBlock] The cached new timeout penalty record includes the index, which does not add a timeout record\n");
 						founded = true;
@@ -1496,7 +1580,9 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 			}
 
 			//According to the time-out record list, once there are N consecutive records that do not block, the execution timeout penalty
-			std::map<uint16_t, int>::iterator iterTimeout = newsnapshot.curTimeoutIndexRecord.begin();
+			//The record is only read here and the expired entries are erased afterwards, so it stays shared when nothing expires
+			std::vector<uint16_t> timeoutExpired;
+			std::map<uint16_t, int>::const_iterator iterTimeout = newsnapshot.curTimeoutIndexRecord.begin();
 			
 			while(iterTimeout != newsnapshot.curTimeoutIndexRecord.end())
 			{
@@ -1533,7 +1619,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 
 					//iterTimeout = 
 					++iterTimeout;
-					newsnapshot.curTimeoutIndexRecord.erase(pkhashindex);
+					timeoutExpired.push_back(pkhashindex);
 					bErase = true;
 
 					if (newsnapshot.curCandidateIndexList.count(pkhashindex))
@@ -1547,14 +1633,18 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 					++iterTimeout;
 				}
 			}
+			for (std::vector<uint16_t>::const_iterator expiredIt = timeoutExpired.begin(); expiredIt != timeoutExpired.end(); expiredIt++)
+			{
+				newsnapshot.curTimeoutIndexRecord.erase(*expiredIt);
+			}
 
 		}
 
 		//Calculate the current chunk order index and plug in the snapshot list
 		std::list<std::shared_ptr<CConsensusAccount >> consensusList;
 		consensusList.clear();
-		std::set<uint16_t>::iterator candidateit;
-		for (candidateit = cachedsnapshot.curCandidateIndexList.begin(); candidateit != cachedsnapshot.curCandidateIndexList.end(); candidateit++)
+		std::set<uint16_t>::const_iterator candidateit;
+		for (candidateit = cachedsnapshot->curCandidateIndexList.begin(); candidateit != cachedsnapshot->curCandidateIndexList.end(); candidateit++)
 		{
 			std::shared_ptr<CConsensusAccount> tmpaccount = std::make_shared<CConsensusAccount>(candidatelist.at(*candidateit));
 			consensusList.push_back(tmpaccount);
@@ -1563,14 +1653,19 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 		if (result)
 		{
 			std::list<std::shared_ptr<CConsensusAccount >>::iterator consensusListIt;
-			newsnapshot.cachedMeetingAccounts.clear();
+			std::vector<std::pair<uint16_t, int64_t>> meetingAccounts;
 			for (consensusListIt = consensusList.begin(); consensusListIt != consensusList.end(); consensusListIt++)
 			{
 				uint16_t tmpIndex = -1;
 				uint160 tmppkhash = (*consensusListIt)->getPubicKey160hash();
 				ContainPK(tmppkhash, tmpIndex);
-				newsnapshot.cachedMeetingAccounts.push_back(std::make_pair(tmpIndex, (*consensusListIt)->getCredit()));
+				meetingAccounts.push_back(std::make_pair(tmpIndex, (*consensusListIt)->getCredit()));
 			}
+			//Keep sharing the previous list when the meeting order did not change
+			if (lastSnapshot && meetingAccounts == lastSnapshot->cachedMeetingAccounts.get())
+				newsnapshot.cachedMeetingAccounts = lastSnapshot->cachedMeetingAccounts;
+			else
+				newsnapshot.cachedMeetingAccounts = meetingAccounts;
 		}
 
 	}
@@ -1587,7 +1682,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 				uint16_t pkindex;
 				if (txout.GetCampaignType() == TYPE_CONSENSUS_RETURN_DEPOSI)
 				{
-					if (ContainPK(txout.devoteLabel.hash, pkindex))
+					if (ContainPK(txout.GetDevoteLabel().hash, pkindex))
 					{
 						LogPrintf("[CConsensusAccountPool::pushDPOCBlock] Deal with refund\n");
 						if (newsnapshot.cachedIndexsToRefund.count(pkindex))
@@ -1604,7 +1699,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 							{
 								uint160 accountmyself;
 								accountmyself.SetHex(localpkhashhexstring);
-								if (accountmyself == txout.devoteLabel.hash &&
+								if (accountmyself == txout.GetDevoteLabel().hash &&
 									analysisfinished) {
 									
 									LogPrintf("[CConsensusAccountPool::pushDPOCBlock] Delete the local accounting account %s\n", localpkhashhexstring.c_str());
@@ -1620,7 +1715,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 										ss << nStatus;
 										std::string strStatusNew = ss.str();
 
-										std::string strHash(txout.devoteLabel.hash.ToString());
+										std::string strHash(txout.GetDevoteLabel().hash.ToString());
 										SetConsensusStatus(strStatusNew, strHash);
 									}
 									
@@ -1636,7 +1731,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 				//Update the penalty list according to the penalty status
 				else if (txout.GetCampaignType() == TYPE_CONSENSUS_ORDINARY_PUSNISHMENT)
 				{
-					if (ContainPK(txout.devoteLabel.hash, pkindex))
+					if (ContainPK(txout.GetDevoteLabel().hash, pkindex))
 					{
 						if ((pkindex >= 0) && (pkindex < candidatelist.size()))
 						{
@@ -1654,8 +1749,8 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 						
 						//The timeout penalty that has been executed is cleared from the timeout record
 						LogPrintf("[CConsensusAccountPool::pushDPOCBlock] Prepare to delete the timeout record\n");
-						std::vector<SnapshotClass> vecforprint;
-						vecforprint.push_back(newsnapshot);
+						std::vector<SnapshotRef> vecforprint;
+						vecforprint.push_back(MakeSnapshotRef(newsnapshot));
 						printsnapshots(vecforprint);	 
 						if (newsnapshot.cachedTimeoutPunishToRun.count(pkindex))
 						{
@@ -1665,7 +1760,7 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 				
 						//Set the average penalty value
 						std::string strStatus("1");
-						std::string strHash(txout.devoteLabel.hash.ToString());
+						std::string strHash(txout.GetDevoteLabel().hash.ToString());
 						SetConsensusStatus(strStatus, strHash);
 
 						//Give the public key a refund
@@ -1760,14 +1855,14 @@ bool CConsensusAccountPool::pushDPOCBlock(const std::shared_ptr<const CBlock> pb
 		}
 	}
 
-	if (!PushSnapshot(newsnapshot))
+	if (!PushSnapshot(MakeSnapshotRef(newsnapshot)))
 	{
 		LogPrintf("[CConsensusAccountPool::pushDPOCBlock]PushSnapshot Adding a snapshot to the list faile！\n");
 		return false;
 	}
 
 	uint32_t cachedHeight = (blockHeight > CACHED_BLOCK_COUNT) ? blockHeight - CACHED_BLOCK_COUNT : 0;
-	std::vector<SnapshotClass> listforprint;
+	std::vector<SnapshotRef> listforprint;
 	if (!GetSnapshotsByHeight(listforprint, cachedHeight, blockHeight))
 	{
 		LogPrintf("[CConsensusAccountPool::pushDPOCBlock] get snapshot height %d-%d to print reslut faile\n", blockHeight - CACHED_BLOCK_COUNT, blockHeight);
@@ -1782,14 +1877,14 @@ bool CConsensusAccountPool::rollbackCandidatelist(uint32_t nHeight)
 {
 	writeLock wtlock(rwmutex);
 	
-	std::map<uint32_t, SnapshotClass>::iterator iterList = snapshotlist.end();
+	std::map<uint32_t, SnapshotRef>::iterator iterList = snapshotlist.end();
 	while (iterList != snapshotlist.begin())
 	{
 		iterList--;
 		if (nHeight < iterList->first)
 		{
 			uint16_t tmpIndex;
-			std::map<uint32_t, SnapshotClass>::iterator iterLast = iterList;
+			std::map<uint32_t, SnapshotRef>::iterator iterLast = iterList;
 			if (iterLast != snapshotlist.begin())
 			{
 				iterLast--;
@@ -1797,8 +1892,8 @@ bool CConsensusAccountPool::rollbackCandidatelist(uint32_t nHeight)
 
 			//From the previous snapshot to the current pending delete snapshot, 
 			//if the blacklist operation is performed, the credit value is rolled back
-			for (std::set<uint16_t>::iterator banit = iterLast->second.curBanList.begin();
-				banit != iterLast->second.curBanList.end(); banit++)
+			for (std::set<uint16_t>::const_iterator banit = iterLast->second->curBanList.begin();
+				banit != iterLast->second->curBanList.end(); banit++)
 			{
 				tmpIndex = *banit;
 				candidatelist[tmpIndex].revertCredit();
@@ -1806,7 +1901,7 @@ bool CConsensusAccountPool::rollbackCandidatelist(uint32_t nHeight)
 				
 				//Sets the credit value of the current node directly to the credit value in the previous snapshot
 				int64_t tmpCredit;
-				if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+				if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 				{
 					candidatelist[tmpIndex].setCredit(tmpCredit);
 					LogPrintf("[CConsensusAccountPool::rollbackCandidatelist] Rollback the public key index = %d directly from the snapshot, To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -1814,38 +1909,38 @@ bool CConsensusAccountPool::rollbackCandidatelist(uint32_t nHeight)
 			}
 
 			//For the current pending delete snapshot, the credit value of the added public key of the block person needs to be rolled back
-			tmpIndex = iterList->second.pkHashIndex;
+			tmpIndex = iterList->second->pkHashIndex;
 
 			//Sets the credit value of the current node directly to the credit value in the previous snapshot
 			int64_t tmpCredit;
-			if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+			if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 			{
 				candidatelist[tmpIndex].setCredit(tmpCredit);
 				LogPrintf("[CConsensusAccountPool::popDPOCBlock] Rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
 			}
 
 			//The credit value that is deducted in the timeout record needs to be rolled back
-			std::vector<SnapshotClass> listforprint;
+			std::vector<SnapshotRef> listforprint;
 			listforprint.push_back(iterLast->second);
 			listforprint.push_back(iterList->second);
 			printsnapshots(listforprint);
-			for (std::map<uint16_t, int>::iterator timeoutit = iterList->second.curTimeoutIndexRecord.begin();
-				timeoutit != iterList->second.curTimeoutIndexRecord.end(); timeoutit++)
+			for (std::map<uint16_t, int>::const_iterator timeoutit = iterList->second->curTimeoutIndexRecord.begin();
+				timeoutit != iterList->second->curTimeoutIndexRecord.end(); timeoutit++)
 			{
 				LogPrintf("[CConsensusAccountPool::rollbackCandidatelist] The current timeout record for deleting a snapshot includes indexe = %d\n", timeoutit->first);
 				
-				if (iterLast->second.curTimeoutIndexRecord.count(timeoutit->first))
+				if (iterLast->second->curTimeoutIndexRecord.count(timeoutit->first))
 				{
 					LogPrintf("[CConsensusAccountPool::rollbackCandidatelist] An index=%d is included in the timeout record for the previous snapshot\n", timeoutit->first);
 					LogPrintf("[CConsensusAccountPool::rollbackCandidatelist] Last snapshot of the timeout record index=%d number=%d，The number of times to delete a snapshot = %d\n",
-						timeoutit->first, iterLast->second.curTimeoutIndexRecord[timeoutit->first], timeoutit->second);
+						timeoutit->first, iterLast->second->curTimeoutIndexRecord.at(timeoutit->first), timeoutit->second);
 
-					if (iterLast->second.curTimeoutIndexRecord[timeoutit->first] < timeoutit->second)
+					if (iterLast->second->curTimeoutIndexRecord.at(timeoutit->first) < timeoutit->second)
 					{
 						tmpIndex = timeoutit->first;
 						
 						int64_t tmpCredit;
-						if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+						if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 						{
 							candidatelist[tmpIndex].setCredit(tmpCredit);
 							LogPrintf("[CConsensusAccountPool::rollbackCandidatelist] rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -1857,7 +1952,7 @@ bool CConsensusAccountPool::rollbackCandidatelist(uint32_t nHeight)
 				{
 					tmpIndex = timeoutit->first;
 					int64_t tmpCredit;
-					if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+					if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 					{
 						candidatelist[tmpIndex].setCredit(tmpCredit);
 						LogPrintf("[CConsensusAccountPool::rollbackCandidatelist]  rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -1867,19 +1962,19 @@ bool CConsensusAccountPool::rollbackCandidatelist(uint32_t nHeight)
 
 			//If the current snapshot has a timeout penalty, 
 			//and the previous snapshot does not have this timeout penalty, revert is required
-			for (std::set<uint16_t>::iterator punishit = iterList->second.curTimeoutPunishList.begin();
-				punishit != iterList->second.curTimeoutPunishList.end();
+			for (std::set<uint16_t>::const_iterator punishit = iterList->second->curTimeoutPunishList.begin();
+				punishit != iterList->second->curTimeoutPunishList.end();
 				punishit++)
 			{
 				tmpIndex = (*punishit);
 
 				LogPrintf("[CConsensusAccountPool::rollbackCandidatelist] An index=%d is included in the timeout penalty list for the snapshot\n", tmpIndex);
-				if (!iterLast->second.curTimeoutPunishList.count(tmpIndex) &&
-					iterLast->second.curTimeoutIndexRecord.count(tmpIndex))
+				if (!iterLast->second->curTimeoutPunishList.count(tmpIndex) &&
+					iterLast->second->curTimeoutIndexRecord.count(tmpIndex))
 				{						
 					//Sets the credit value of the current node directly to the credit value in the previous snapshot
 					int64_t tmpCredit;
-					if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+					if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 					{
 						candidatelist[tmpIndex].setCredit(tmpCredit);
 						LogPrintf("[CConsensusAccountPool::rollbackCandidatelist] 2rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -1904,7 +1999,7 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 	//uint64_t u64NewFileSizeSnapshot = m_mapSnapshotIndex[blockHeight + 1];
 
 	uint32_t u32OldHeight = 0;
-	std::map<uint32_t, SnapshotClass>::iterator iterSnapshot = snapshotlist.end();
+	std::map<uint32_t, SnapshotRef>::iterator iterSnapshot = snapshotlist.end();
 	if (iterSnapshot != snapshotlist.begin())
 	{
 		iterSnapshot--;
@@ -1916,7 +2011,7 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 	}
 
 	bool bUpdate = false;
-	std::map<uint32_t, SnapshotClass>::iterator iterList = snapshotlist.end();
+	std::map<uint32_t, SnapshotRef>::iterator iterList = snapshotlist.end();
 	while(iterList != snapshotlist.begin())
 	{		
         iterList--;
@@ -1924,21 +2019,21 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 		{
 			bUpdate = true;
 			uint16_t tmpIndex;
-			std::map<uint32_t, SnapshotClass>::iterator iterLast = iterList;
+			std::map<uint32_t, SnapshotRef>::iterator iterLast = iterList;
 			if (iterLast != snapshotlist.begin())
 			{
 				iterLast--;
 			}
 
-			for (std::set<uint16_t>::iterator banit = iterLast->second.curBanList.begin();
-				banit != iterLast->second.curBanList.end(); banit++)
+			for (std::set<uint16_t>::const_iterator banit = iterLast->second->curBanList.begin();
+				banit != iterLast->second->curBanList.end(); banit++)
 			{
 				tmpIndex = *banit;
 				candidatelist[tmpIndex].revertCredit();
 				LogPrintf("[CConsensusAccountPool::popDPOCBlock] rollback the public key index=%d,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
 				
 				int64_t tmpCredit;
-				if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+				if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 				{
 					candidatelist[tmpIndex].setCredit(tmpCredit);
 					LogPrintf("[CConsensusAccountPool::popDPOCBlock] rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -1950,36 +2045,36 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 
 			}
 
-			tmpIndex = iterList->second.pkHashIndex;
+			tmpIndex = iterList->second->pkHashIndex;
 			
 			int64_t tmpCredit;
-			if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+			if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 			{
 				candidatelist[tmpIndex].setCredit(tmpCredit);
 				LogPrintf("[CConsensusAccountPool::popDPOCBlock] rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
 			}
 
-			std::vector<SnapshotClass> listforprint;
+			std::vector<SnapshotRef> listforprint;
 			listforprint.push_back(iterLast->second);
 			listforprint.push_back(iterList->second);
 			printsnapshots(listforprint);
-			for (std::map<uint16_t, int>::iterator timeoutit = iterList->second.curTimeoutIndexRecord.begin();
-				timeoutit != iterList->second.curTimeoutIndexRecord.end(); timeoutit++)
+			for (std::map<uint16_t, int>::const_iterator timeoutit = iterList->second->curTimeoutIndexRecord.begin();
+				timeoutit != iterList->second->curTimeoutIndexRecord.end(); timeoutit++)
 			{
 				LogPrintf("[CConsensusAccountPool::popDPOCBlock] The current timeout record for deleting a snapshot includes index = %d\n", timeoutit->first);
 				
-				if (iterLast->second.curTimeoutIndexRecord.count(timeoutit->first))
+				if (iterLast->second->curTimeoutIndexRecord.count(timeoutit->first))
 				{
 					LogPrintf("[CConsensusAccountPool::popDPOCBlock] An index=%d is included in the timeout record for the previous snapshot\n", timeoutit->first);
 					LogPrintf("[CConsensusAccountPool::popDPOCBlock] Last snapshot of the timeout record index=%d number=%d，The number of times to delete a snapshot = %d\n\n",
-						timeoutit->first, iterLast->second.curTimeoutIndexRecord[timeoutit->first], timeoutit->second);
+						timeoutit->first, iterLast->second->curTimeoutIndexRecord.at(timeoutit->first), timeoutit->second);
 				
-					if (iterLast->second.curTimeoutIndexRecord[timeoutit->first] < timeoutit->second)
+					if (iterLast->second->curTimeoutIndexRecord.at(timeoutit->first) < timeoutit->second)
 					{
 						tmpIndex = timeoutit->first;
 					
 						int64_t tmpCredit;
-						if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+						if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 						{
 							candidatelist[tmpIndex].setCredit(tmpCredit);
 							LogPrintf("[CConsensusAccountPool::popDPOCBlock] rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -1991,7 +2086,7 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 					tmpIndex = timeoutit->first;
 				
 					int64_t tmpCredit;
-					if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+					if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 					{
 						candidatelist[tmpIndex].setCredit(tmpCredit);
 						LogPrintf("[CConsensusAccountPool::popDPOCBlock] rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -1999,17 +2094,17 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 				}
 			}
 
-			for (std::set<uint16_t>::iterator punishit = iterList->second.curTimeoutPunishList.begin();
-				punishit != iterList->second.curTimeoutPunishList.end();
+			for (std::set<uint16_t>::const_iterator punishit = iterList->second->curTimeoutPunishList.begin();
+				punishit != iterList->second->curTimeoutPunishList.end();
 				punishit++)
 			{
 				tmpIndex = (*punishit);
 				LogPrintf("[CConsensusAccountPool::popDPOCBlock] An index=%d is included in the timeout penalty list for the snapshot\n", tmpIndex);
-				if (!iterLast->second.curTimeoutPunishList.count(tmpIndex) &&
-					iterLast->second.curTimeoutIndexRecord.count(tmpIndex))
+				if (!iterLast->second->curTimeoutPunishList.count(tmpIndex) &&
+					iterLast->second->curTimeoutIndexRecord.count(tmpIndex))
 				{
 					int64_t tmpCredit;
-					if (getCreditFromSnapshotByIndex(iterLast->second, tmpIndex, tmpCredit))
+					if (getCreditFromSnapshotByIndex(*iterLast->second, tmpIndex, tmpCredit))
 					{
 						candidatelist[tmpIndex].setCredit(tmpCredit);
 						LogPrintf("[CConsensusAccountPool::popDPOCBlock] rollback the public key index=%d directly from the snapshot,To creditValue %d\n", tmpIndex, candidatelist[tmpIndex].getCredit());
@@ -2030,6 +2125,7 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 
 	if (bUpdate)
 	{
+		rebuildSnapshotTimeIndex();
 		writeCandidatelistToFile();
 		truncateSnapshotFile(u32OldHeight, blockHeight);
 	}
@@ -2042,22 +2138,22 @@ bool CConsensusAccountPool::popDPOCBlock( uint32_t blockHeight)
 
 bool CConsensusAccountPool::AddDPOCCoinbaseToBlock(CBlock* pblockNew, CBlockIndex* pindexPrev, uint32_t blockHeight, CMutableTransaction &coinbaseTx)
 {
-	SnapshotClass cursnapshot;
+	SnapshotRef cursnapshot;
 	if (!GetLastSnapshot(cursnapshot))
 	{
 		LogPrintf("[CConsensusAccountPool::AddDPOCCoinbaseToBlock] You can't get the latest snapshot, perhaps because the snapshot list is empty and return true\n");
 		return false;
 	}
 
-	std::set<uint16_t>::iterator refundit;
-	for (refundit = cursnapshot.cachedIndexsToRefund.begin(); refundit!= cursnapshot.cachedIndexsToRefund.end(); refundit++)
+	std::set<uint16_t>::const_iterator refundit;
+	for (refundit = cursnapshot->cachedIndexsToRefund.begin(); refundit!= cursnapshot->cachedIndexsToRefund.end(); refundit++)
 	{
-		if(contain(cursnapshot.cachedMeetingAccounts, *refundit))
+		if(contain(cursnapshot->cachedMeetingAccounts, *refundit))
 		{
 			//LogPrintf("[CConsensusAccountPool::AddDPOCCoinbaseToBlock] Delay the refund of the public key deposit %d\n", *refundit);
 			continue;
 		}
-		if (cursnapshot.curBanList.count(*refundit) || cursnapshot.cachedBanList.count(*refundit))
+		if (cursnapshot->curBanList.count(*refundit) || cursnapshot->cachedBanList.count(*refundit))
 		{
 			LogPrintf("[CConsensusAccountPool::AddDPOCCoinbaseToBlock] The refund account is on the blacklist！\n");
 		}
@@ -2071,9 +2167,9 @@ bool CConsensusAccountPool::AddDPOCCoinbaseToBlock(CBlock* pblockNew, CBlockInde
 	}
 
 	//Ordinary punishment
-	for (refundit = cursnapshot.cachedTimeoutPunishToRun.begin(); refundit != cursnapshot.cachedTimeoutPunishToRun.end(); refundit++)
+	for (refundit = cursnapshot->cachedTimeoutPunishToRun.begin(); refundit != cursnapshot->cachedTimeoutPunishToRun.end(); refundit++)
 	{
-		if (contain(cursnapshot.cachedMeetingAccounts, *refundit))
+		if (contain(cursnapshot->cachedMeetingAccounts, *refundit))
 		{
 			LogPrintf("[CConsensusAccountPool::AddDPOCCoinbaseToBlock] Delay the refund of the public key index %d\n", *refundit);
 			continue;
@@ -2084,7 +2180,7 @@ bool CConsensusAccountPool::AddDPOCCoinbaseToBlock(CBlock* pblockNew, CBlockInde
 		coinbaseTx.vout.emplace_back(std::move(curTimeoutPunish));
 	}
 
-	for (refundit = cursnapshot.curBanList.begin(); refundit != cursnapshot.curBanList.end(); refundit++)
+	for (refundit = cursnapshot->curBanList.begin(); refundit != cursnapshot->curBanList.end(); refundit++)
 	{
 		LogPrintf("[CConsensusAccountPool::AddDPOCCoinbaseToBlock] Severe punishment publickey=%d,the credit=%d", *refundit, candidatelist[*refundit].getJoinIPC());
 		CTxOut curBanTx(TYPE_CONSENSUS_SEVERE_PUNISHMENT, candidatelist[*refundit].getPubicKey160hash());
@@ -2211,48 +2307,44 @@ bool CConsensusAccountPool::addSignToCoinBase(CBlock* pblock, CBlockIndex* pinde
 	return true;
 }
 
-bool CConsensusAccountPool::GetSnapshotByTime(SnapshotClass &snapshot, uint64_t readtime)
+bool CConsensusAccountPool::GetSnapshotByTime(SnapshotRef &snapshot, uint64_t readtime)
 {
 	readLock rdlock(rwmutex);
 
-	if (snapshotlist.size()==0)
+	if (snapshotlist.empty() || m_dequeSnapshotTime.empty())
 	{
 		LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] The snapshot list is empty，cannot check\n");
 		return false;
 	}
 
 	LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] Passed-in cache time= %d \n", readtime);
+	LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] The last snapshot time= %d \n", snapshotlist.rbegin()->second->timestamp);
 
-	//Find the time corresponding block as a cache block, give it back value, and cache the list of candidates
-	if (snapshotlist.size() > 0)
+	//The highest snapshot whose time is not later than readtime is the last time index entry not greater than readtime
+	std::deque<std::pair<uint64_t, uint32_t>>::const_iterator timeit = std::upper_bound(m_dequeSnapshotTime.begin(), m_dequeSnapshotTime.end(),
+		std::make_pair(readtime, std::numeric_limits<uint32_t>::max()));
+	if (timeit == m_dequeSnapshotTime.begin())
 	{
-		std::map<uint32_t, SnapshotClass>::iterator mapit = snapshotlist.end();
-		mapit--;
-		LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] The last snapshot time= %d \n", mapit->second.timestamp);
-		
-		while (mapit->second.timestamp > readtime)
-		{
-			if (mapit == snapshotlist.begin()) 
-			{
-				LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] No matching snapshot was found\n");
-				return false;
-			}
-			mapit--;
-		}
-		LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] Find the height of the snapshot block= %d , time= %d \n",
-			mapit->second.blockHeight, mapit->second.timestamp);
-
-		snapshot = mapit->second;
-		return true;
+		LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] No matching snapshot was found\n");
+		return false;
 	}
+	--timeit;
 
-	LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] The snapshot list is empty\n");
+	std::map<uint32_t, SnapshotRef>::const_iterator mapit = snapshotlist.find(timeit->second);
+	if (mapit == snapshotlist.end())
+	{
+		LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] The time index is out of step with the snapshot list at height %d\n", timeit->second);
+		return false;
+	}
+	LogPrintf("[CConsensusAccountPool::GetSnapshotByTime] Find the height of the snapshot block= %d , time= %d \n",
+		mapit->second->blockHeight, mapit->second->timestamp);
 
-	return false;
+	snapshot = mapit->second;
+	return true;
 }
 
 
-bool CConsensusAccountPool::GetSnapshotByHeight(SnapshotClass &snapshot, uint32_t height)
+bool CConsensusAccountPool::GetSnapshotByHeight(SnapshotRef &snapshot, uint32_t height)
 {
 	readLock rdlock(rwmutex);
 
@@ -2262,12 +2354,8 @@ bool CConsensusAccountPool::GetSnapshotByHeight(SnapshotClass &snapshot, uint32_
 		return false;
 	}
 
-	std::map<uint32_t, SnapshotClass>::iterator mapit = snapshotlist.end();
-	mapit--;
-	while (mapit->second.blockHeight > height && mapit != snapshotlist.begin())
-		mapit--;
-
-	if (mapit->second.blockHeight > height)
+	std::map<uint32_t, SnapshotRef>::const_iterator mapit = snapshotlist.upper_bound(height);
+	if (mapit == snapshotlist.begin())
 	{
 		if (g_bStdCout)
 		{
@@ -2277,12 +2365,13 @@ bool CConsensusAccountPool::GetSnapshotByHeight(SnapshotClass &snapshot, uint32_
 		
 		return false;
 	}
+	--mapit;
 
 	snapshot = mapit->second;
 	return true;
 }
 
-bool CConsensusAccountPool::GetSnapshotsByHeight(std::vector<SnapshotClass> &snapshots, uint32_t lowest, uint32_t highest)
+bool CConsensusAccountPool::GetSnapshotsByHeight(std::vector<SnapshotRef> &snapshots, uint32_t lowest, uint32_t highest)
 {
 	readLock rdlock(rwmutex);
 
@@ -2294,35 +2383,33 @@ bool CConsensusAccountPool::GetSnapshotsByHeight(std::vector<SnapshotClass> &sna
 		return false;
 	}
 
-	std::map<uint32_t, SnapshotClass>::iterator mapit = snapshotlist.end();
-	mapit--;
-
+	std::map<uint32_t, SnapshotRef>::const_iterator mapit = snapshotlist.end();
 	if (highest != 0)
 	{
-		while (mapit->second.blockHeight > highest && mapit != snapshotlist.begin())
-			mapit--;
-
-		if (mapit == snapshotlist.begin())
+		mapit = snapshotlist.upper_bound(highest);
+		if (mapit == snapshotlist.begin() || --mapit == snapshotlist.begin())
 		{
 			LogPrintf("[CConsensusAccountPool::GetSnapshotsByHeight] There is no less than the highest height in the snapshot list！\n");
 			return false;
 		}
+		++mapit;
 	}
 
+	//Walk down from the highest match until the first snapshot below lowest, newest first
 	snapshots.clear();
-	while (mapit->second.blockHeight >= lowest)
+	while (mapit != snapshotlist.begin())
 	{
-		LogPrintf("[CConsensusAccountPool::GetSnapshotsByHeight] Find the snapshot height %d\n", mapit->second.blockHeight);
-		snapshots.push_back(mapit->second);
-		if (mapit == snapshotlist.begin())
+		--mapit;
+		if (mapit->second->blockHeight < lowest)
 			break;
-		mapit--;
+		LogPrintf("[CConsensusAccountPool::GetSnapshotsByHeight] Find the snapshot height %d\n", mapit->second->blockHeight);
+		snapshots.push_back(mapit->second);
 	}
 
 	return true;
 }
 
-bool CConsensusAccountPool::GetLastSnapshot(SnapshotClass &snapshot)
+bool CConsensusAccountPool::GetLastSnapshot(SnapshotRef &snapshot)
 {
 	readLock rdlock(rwmutex);
 
@@ -2332,52 +2419,78 @@ bool CConsensusAccountPool::GetLastSnapshot(SnapshotClass &snapshot)
 		return false;
 	}
 
-	std::map<uint32_t, SnapshotClass>::iterator mapit = snapshotlist.end();
-	mapit--;
-
-	snapshot = mapit->second;
+	snapshot = snapshotlist.rbegin()->second;
 	LogPrintf("[CConsensusAccountPool::GetLastSnapshot] Get the snapshot tail height=%d, Plan package time=%d,Actually package time=%d\n",
-		snapshot.blockHeight, snapshot.timestamp, snapshot.blockTime);
+		snapshot->blockHeight, snapshot->timestamp, snapshot->blockTime);
 
 	return true;
 }
 
-bool CConsensusAccountPool::PushSnapshot(SnapshotClass snapshot)
+void CConsensusAccountPool::insertSnapshot(const SnapshotRef &snapshot)
 {
-	writeLock wtlock(rwmutex);
-	
-	boost::filesystem::path curTargetDir = GetDataDir();
-	if (snapshotlist.count(snapshot.blockHeight))
+	bool bAppend = snapshotlist.empty() || snapshotlist.rbegin()->first < snapshot->blockHeight;
+	snapshotlist[snapshot->blockHeight] = snapshot;
+
+	if (bAppend)
 	{
-		LogPrintf("[CConsensusAccountPool::PushSnapshot] add  height = %d of sanpshot to list\n", snapshot.blockHeight);
-		return false;
+		//Older snapshots that are not earlier than the new tail can never be the answer to a time lookup again
+		while (!m_dequeSnapshotTime.empty() && m_dequeSnapshotTime.back().first >= snapshot->timestamp)
+			m_dequeSnapshotTime.pop_back();
+		m_dequeSnapshotTime.push_back(std::make_pair(snapshot->timestamp, snapshot->blockHeight));
+	}
+	else
+	{
+		rebuildSnapshotTimeIndex();
 	}
 
-	LogPrintf("[CConsensusAccountPool::PushSnapshot] add  height = %d of sanpshot to list\n", snapshot.blockHeight);
-	snapshotlist[snapshot.blockHeight] = snapshot;
-
-	//---------begin
 	if (snapshotlist.size() > SNAPSHOTLENGTH)
 	{
+		if (!m_dequeSnapshotTime.empty() && m_dequeSnapshotTime.front().second == snapshotlist.begin()->first)
+			m_dequeSnapshotTime.pop_front();
 		snapshotlist.erase(snapshotlist.begin());
 		m_mapSnapshotIndex.erase(m_mapSnapshotIndex.begin());
 	}
-	//---------end
+}
+
+void CConsensusAccountPool::rebuildSnapshotTimeIndex()
+{
+	m_dequeSnapshotTime.clear();
+	for (std::map<uint32_t, SnapshotRef>::const_iterator mapit = snapshotlist.begin(); mapit != snapshotlist.end(); ++mapit)
+	{
+		while (!m_dequeSnapshotTime.empty() && m_dequeSnapshotTime.back().first >= mapit->second->timestamp)
+			m_dequeSnapshotTime.pop_back();
+		m_dequeSnapshotTime.push_back(std::make_pair(mapit->second->timestamp, mapit->first));
+	}
+}
+
+bool CConsensusAccountPool::PushSnapshot(const SnapshotRef &snapshot)
+{
+	writeLock wtlock(rwmutex);
+	
+	boost::filesystem::path curTargetDir = GetDataDir();
+	if (snapshotlist.count(snapshot->blockHeight))
+	{
+		LogPrintf("[CConsensusAccountPool::PushSnapshot] add  height = %d of sanpshot to list\n", snapshot->blockHeight);
+		return false;
+	}
+
+	LogPrintf("[CConsensusAccountPool::PushSnapshot] add  height = %d of sanpshot to list\n", snapshot->blockHeight);
+	insertSnapshot(snapshot);
 
 	//Synchronous write file
-	if ((0 == (snapshot.blockHeight % SNAPSHOTINSERT)) && (snapshot.blockHeight != 0))
+	if ((0 == (snapshot->blockHeight % SNAPSHOTINSERT)) && (snapshot->blockHeight != 0))
 	{
 		writeCandidatelistToFile();
 
 		//The initial block height to be stored
 		int  nPushBeginHeight = 0;
-		if (snapshot.blockHeight == SNAPSHOTINSERT)
+		if (snapshot->blockHeight == SNAPSHOTINSERT)
 		{
 			nPushBeginHeight = 0;
 		}
 		else
 		{
-			nPushBeginHeight = snapshot.blockHeight - SNAPSHOTINSERT;
+			nPushBeginHeight = snapshot->blockHeight - SNAPSHOTINSERT;
 			++nPushBeginHeight;
 		}
 
@@ -2419,10 +2532,15 @@ bool CConsensusAccountPool::PushSnapshot(SnapshotClass snapshot)
 		}
 
 		//File starting height
-		std::map<uint32_t, SnapshotClass>::iterator iter = snapshotlist.find(nPushBeginHeight);
+		std::map<uint32_t, SnapshotRef>::iterator iter = snapshotlist.find(nPushBeginHeight);
 		
+		//The first snapshot of each batch is written in full, the rest only store the containers changed from their predecessor
+		const SnapshotClass *pbase = NULL;
 		for (; iter != snapshotlist.end(); ++iter)
 		{
+			CSnapshotDelta snapshotDelta(*iter->second, pbase);
+			pbase = iter->second.get();
+
 			//Write a snapshot
 			CAutoFile fileout(fileSnapshot, SER_DISK, CLIENT_VERSION);
 			if (fileout.IsNull())
@@ -2433,7 +2551,7 @@ bool CConsensusAccountPool::PushSnapshot(SnapshotClass snapshot)
 			}
 
 			try {
-				fileout << (iter->second);
+				fileout << snapshotDelta;
 			}
 			catch (const std::exception& e) {
 				LogPrintf("CSerializeDpoc::WriteToDisk return false by %d \n", e.what());
@@ -2465,7 +2583,7 @@ bool CConsensusAccountPool::PushSnapshot(SnapshotClass snapshot)
 			fileIndex = fileoutIndex.release();
 
 			m_mapSnapshotIndex[sanpshotIndex.nHeight] = sanpshotIndex.nOffset;
-			fileSize = fileSize + getSnapshotSize(iter->second);
+			fileSize = fileSize + GetSerializeSize(snapshotDelta, SER_DISK, CLIENT_VERSION);
 			m_u32WriteHeight = sanpshotIndex.nHeight;
 		}
 
@@ -2506,7 +2624,7 @@ bool CConsensusAccountPool::getPKIndexBySortedIndex(uint16_t &pkIndex, uint160 &
 	return ContainPK(pkhash, pkIndex);
 }
 
-bool CConsensusAccountPool::GetTimeoutIndexs(const std::shared_ptr<const CBlock> pblock, SnapshotClass lastsnapshot, std::map<uint16_t, int>& timeoutindexs)
+bool CConsensusAccountPool::GetTimeoutIndexs(const std::shared_ptr<const CBlock> pblock, const SnapshotClass &lastsnapshot, std::map<uint16_t, int>& timeoutindexs)
 {
 	timeoutindexs.clear();
 
@@ -2519,7 +2637,7 @@ bool CConsensusAccountPool::GetTimeoutIndexs(const std::shared_ptr<const CBlock>
 
 		//Calculate the sorting of the current wheel meeting
 		uint64_t currentmeetingcachedtime = (pblock->nPeriodStartTime - CACHED_BLOCK_COUNT * BLOCK_GEN_TIME) /1000;
-		SnapshotClass currentmeetingcachedsnapshot;
+		SnapshotRef currentmeetingcachedsnapshot;
 		if (!GetSnapshotByTime(currentmeetingcachedsnapshot, currentmeetingcachedtime))
 		{
 			LogPrintf("[CConsensusAccountPool::GetTimeoutIndexs] The list of candidates for the cache failed\n");
@@ -2528,9 +2646,9 @@ bool CConsensusAccountPool::GetTimeoutIndexs(const std::shared_ptr<const CBlock>
 
 		std::list<std::shared_ptr<CConsensusAccount >> consensusList;
 		consensusList.clear();
-		std::set<uint16_t>::iterator candidateit;
-		for (candidateit = currentmeetingcachedsnapshot.curCandidateIndexList.begin();
-			candidateit != currentmeetingcachedsnapshot.curCandidateIndexList.end();
+		std::set<uint16_t>::const_iterator candidateit;
+		for (candidateit = currentmeetingcachedsnapshot->curCandidateIndexList.begin();
+			candidateit != currentmeetingcachedsnapshot->curCandidateIndexList.end();
 			candidateit++)
 		{
 			std::shared_ptr<CConsensusAccount> tmpaccount = std::make_shared<CConsensusAccount>(candidatelist.at(*candidateit));
@@ -2604,9 +2722,9 @@ bool CConsensusAccountPool::GetTimeoutIndexs(const std::shared_ptr<const CBlock>
 				return false;
 			}
 			consensusList.clear();
-			std::set<uint16_t>::iterator candidateit;
-			for (candidateit = currentmeetingcachedsnapshot.curCandidateIndexList.begin();
-				candidateit != currentmeetingcachedsnapshot.curCandidateIndexList.end();
+			std::set<uint16_t>::const_iterator candidateit;
+			for (candidateit = currentmeetingcachedsnapshot->curCandidateIndexList.begin();
+				candidateit != currentmeetingcachedsnapshot->curCandidateIndexList.end();
 				candidateit++)
 			{
 				std::shared_ptr<CConsensusAccount> tmpaccount = std::make_shared<CConsensusAccount>(candidatelist.at(*candidateit));
@@ -2753,14 +2871,14 @@ CAmount CConsensusAccountPool::GetCurDepositAdjust(uint160 pkhash, uint32_t bloc
 bool CConsensusAccountPool::listSnapshotsToTime(std::list<std::shared_ptr<CConsensusAccount>> &listConsus, int readtime)
 {
 	listConsus.clear();
-	SnapshotClass cachedsnapshot;
+	SnapshotRef cachedsnapshot;
 	if (!GetSnapshotByTime(cachedsnapshot, readtime))
 	{
 		LogPrintf("[CConsensusAccountPool::listSnapshotsToTime] Lookup cache snapshot failed\n");
 		return false;
 	}
 
-	std::set<uint16_t> accounts = cachedsnapshot.curCandidateIndexList;
+	const std::set<uint16_t> &accounts = cachedsnapshot->curCandidateIndexList;
 	std::set<uint16_t>::const_iterator iter;
 
 	for (iter = accounts.begin(); iter != accounts.end(); iter++)
@@ -2780,6 +2898,144 @@ bool CConsensusAccountPool::listSnapshots(std::list<std::shared_ptr<CConsensusAc
 	return listSnapshotsToTime(listConsus, nNowTime);
 }
 
+//Run of snapshot records that starts with a full snapshot; its deltas only refer to earlier records of the same run
+struct CSnapshotLoadSegment
+{
+	const CMappedFileDpoc *pSnapshotFile;
+	size_t nFile;
+	std::vector<CSnapshotIndex> vIndex;
+	std::vector<std::pair<CSnapshotIndex, SnapshotRef>> vLoaded;
+	bool fDone;
+
+	CSnapshotLoadSegment(const CMappedFileDpoc *pSnapshotFileIn, size_t nFileIn) : pSnapshotFile(pSnapshotFileIn), nFile(nFileIn), fDone(false) {}
+};
+
+static void DecodeSnapshotSegment(CSnapshotLoadSegment &segment)
+{
+	std::map<uint32_t, SnapshotRef> mapLoaded;
+	for (std::vector<CSnapshotIndex>::const_iterator it = segment.vIndex.begin(); it != segment.vIndex.end(); ++it)
+	{
+		CSnapshotDelta snapshotDelta;
+		if (!segment.pSnapshotFile->Read(snapshotDelta, it->nOffset))
+			break;
+
+		const SnapshotClass *pbase = NULL;
+		std::map<uint32_t, SnapshotRef>::const_iterator baseit = mapLoaded.find(snapshotDelta.nBaseHeight);
+		if (baseit != mapLoaded.end())
+			pbase = baseit->second.get();
+		if (!snapshotDelta.Resolve(pbase))
+		{
+			LogPrintf("[CConsensusAccountPool::loadSnapshotFiles] base height %d of snapshot %d is not loaded\n",
+				snapshotDelta.nBaseHeight, it->nHeight);
+			break;
+		}
+
+		SnapshotRef snapshot = MakeSnapshotRef(snapshotDelta.snapshot);
+		mapLoaded[snapshot->blockHeight] = snapshot;
+		segment.vLoaded.push_back(std::make_pair(*it, snapshot));
+	}
+}
+
+static void ThreadDecodeSnapshotSegments(std::vector<CSnapshotLoadSegment> &vSegments, std::atomic<size_t> &nNextSegment,
+	boost::mutex &csDone, boost::condition_variable &condDone)
+{
+	RenameThread("ipchain-snapload");
+	while (true)
+	{
+		size_t nSegment = nNextSegment++;
+		if (nSegment >= vSegments.size())
+			break;
+
+		DecodeSnapshotSegment(vSegments[nSegment]);
+		{
+			boost::unique_lock<boost::mutex> lock(csDone);
+			vSegments[nSegment].fDone = true;
+		}
+		condDone.notify_all();
+	}
+}
+
+int CConsensusAccountPool::getFirstSnapshotFileToLoad(int nFiles)
+{
+	//With a single file this is -1, a file that does not exist, so nothing is loaded
+	return (nFiles-2) ?  (nFiles-2):0;
+}
+
+int CConsensusAccountPool::loadSnapshotFiles(const std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>> &vSnapshotFiles)
+{
+	int64_t nStart = GetTimeMillis();
+
+	//Split every file at its full snapshots, each run can be decoded on its own
+	std::vector<std::shared_ptr<CMappedFileDpoc>> vMappedFiles;
+	std::vector<CSnapshotLoadSegment> vSegments;
+	for (size_t nFile = 0; nFile < vSnapshotFiles.size(); ++nFile)
+	{
+		std::shared_ptr<CMappedFileDpoc> mappedSnapshot = std::make_shared<CMappedFileDpoc>();
+		CMappedFileDpoc mappedIndex;
+		if (!mappedSnapshot->Open(vSnapshotFiles[nFile].first) || !mappedIndex.Open(vSnapshotFiles[nFile].second))
+		{
+			LogPrintf("[CConsensusAccountPool::loadSnapshotFiles] map %s failed \n", vSnapshotFiles[nFile].first.string());
+			break;
+		}
+		vMappedFiles.push_back(mappedSnapshot);
+
+		for (uint64_t nBegin = 0; nBegin + m_u64SnapshotIndexSize <= mappedIndex.size(); nBegin += m_u64SnapshotIndexSize)
+		{
+			CSnapshotIndex snapshotIndex;
+			uint32_t nBaseHeight = 0;
+			if (!mappedIndex.Read(snapshotIndex, nBegin) || !mappedSnapshot->Read(nBaseHeight, snapshotIndex.nOffset))
+				break;
+
+			if (vSegments.empty() || vSegments.back().nFile != nFile || nBaseHeight == CSnapshotDelta::NO_BASE)
+				vSegments.push_back(CSnapshotLoadSegment(mappedSnapshot.get(), nFile));
+			vSegments.back().vIndex.push_back(snapshotIndex);
+		}
+	}
+
+	std::atomic<size_t> nNextSegment(0);
+	boost::mutex csDone;
+	boost::condition_variable condDone;
+	boost::thread_group threadGroup;
+	int nThreads = std::max(1, std::min(std::min(GetNumCores(), MAXSNAPSHOTLOADTHREADS), (int)vSegments.size()));
+	for (int i = 0; i < nThreads; ++i)
+		threadGroup.create_thread(boost::bind(&ThreadDecodeSnapshotSegments, boost::ref(vSegments), boost::ref(nNextSegment),
+			boost::ref(csDone), boost::ref(condDone)));
+
+	//Merge in file order, a run that stopped early ends the loading of its file
+	int nLoaded = 0;
+	size_t nSkipFile = std::numeric_limits<size_t>::max();
+	for (size_t nSegment = 0; nSegment < vSegments.size(); ++nSegment)
+	{
+		CSnapshotLoadSegment &segment = vSegments[nSegment];
+		{
+			boost::unique_lock<boost::mutex> lock(csDone);
+			while (!segment.fDone)
+				condDone.wait(lock);
+		}
+		if (segment.nFile == nSkipFile)
+			continue;
+
+		{
+			writeLock wtlock(rwmutex);
+			for (size_t i = 0; i < segment.vLoaded.size(); ++i)
+			{
+				m_mapSnapshotIndex[segment.vLoaded[i].first.nHeight] = segment.vLoaded[i].first.nOffset;
+				insertSnapshot(segment.vLoaded[i].second);
+			}
+		}
+		nLoaded += segment.vLoaded.size();
+		if (segment.vLoaded.size() != segment.vIndex.size())
+			nSkipFile = segment.nFile;
+
+		std::vector<std::pair<CSnapshotIndex, SnapshotRef>>().swap(segment.vLoaded);
+	}
+	threadGroup.join_all();
+
+	LogPrintf("[CConsensusAccountPool::loadSnapshotFiles] %d snapshots from %u files in %u runs on %d threads, %dms\n",
+		nLoaded, vMappedFiles.size(), vSegments.size(), nThreads, GetTimeMillis() - nStart);
+	return nLoaded;
+}
+
 bool  CConsensusAccountPool::analysisConsensusSnapshots()
 {
 	LogPrintf("[CConsensusAccountPool::analysisConsensusSnapshots] begin\n");
@@ -2793,12 +3049,14 @@ bool  CConsensusAccountPool::analysisConsensusSnapshots()
 
 	boost::filesystem::path curTargetDir = GetDataDir();
 	int nAllSnapshotSize = 0;
+	std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>> vSnapshotFiles;
 	{
 		writeLock wtlock(rwmutex);
 		//Load consensus public key HASH
 		readCandidatelistFromFile();
 
 		splitSnapshotFile();
+		convertLegacySnapshotFiles();
 		
 		int nTargetIndex = 0;
 		while (true)
@@ -2814,71 +3072,24 @@ bool  CConsensusAccountPool::analysisConsensusSnapshots()
 			}
 			++nTargetIndex;
 		}
-		
 
-		int nIndex = (nTargetIndex-2) ?  (nTargetIndex-2):0;
-		while (true)
-		{	
+		for (int nIndex = getFirstSnapshotFileToLoad(nTargetIndex); nIndex < nTargetIndex; ++nIndex)
+		{
 			setSnapshotFilePath(nIndex);
-
-			boost::filesystem::path pathIndex = curTargetDir / m_strSnapshotDir / m_strSnapshotIndexPath;
-			boost::filesystem::path pathSnapshot = curTargetDir / m_strSnapshotDir / m_strSnapshotPath;
-			if (!boost::filesystem::exists(pathIndex) || !boost::filesystem::exists(pathSnapshot))
-			{
-				LogPrintf("[CConsensusAccountPool::analysisConsensusSnapshots] SnapshotFile is null \n");
-				break;
-			}
-			else
-			{
-				uint64_t u64fileSizeSnapshot = boost::filesystem::file_size(pathSnapshot);
-				uint64_t u64FileSizeIndex = boost::filesystem::file_size(pathIndex);
-				if ((u64fileSizeSnapshot > 0)&&(u64FileSizeIndex >= m_u64SnapshotIndexSize))
-				{
-					for (uint64_t nBegin = 0; nBegin <= u64FileSizeIndex - m_u64SnapshotIndexSize; nBegin += m_u64SnapshotIndexSize)
-					{
-						CSerializeDpoc<CSnapshotIndex> serializeIndex;
-						CSnapshotIndex  sanpshotIndex;
-						serializeIndex.ReadFromDiskS(sanpshotIndex, nBegin, m_strSnapshotIndexPath);
-						
-						//Load the snapshot
-						if (sanpshotIndex.nOffset < u64fileSizeSnapshot)
-						{
-							CSerializeDpoc<SnapshotClass> serializeSnapshot;
-							SnapshotClass snapshot;
-							serializeSnapshot.ReadFromDiskS(snapshot, sanpshotIndex.nOffset, m_strSnapshotPath);
-							
-							snapshotlist[sanpshotIndex.nHeight] = snapshot;
-							m_mapSnapshotIndex[sanpshotIndex.nHeight] = sanpshotIndex.nOffset;
-					
-							if(snapshotlist.size() > SNAPSHOTLENGTH)
-							{
-								snapshotlist.erase(snapshotlist.begin());
-								m_mapSnapshotIndex.erase(m_mapSnapshotIndex.begin());
-							}
-
-							++nAllSnapshotSize;
-					
-							if ((sanpshotIndex.nOffset+getSnapshotSize(snapshot)) >= u64fileSizeSnapshot)
-							{
-								break;
-							}
-						}
-						else
-						{
-							break;
-						}
-					}//for
-
-				 }
-			}
-
-			++nIndex;
-			
+			vSnapshotFiles.push_back(std::make_pair(curTargetDir / m_strSnapshotDir / m_strSnapshotPath,
+				curTargetDir / m_strSnapshotDir / m_strSnapshotIndexPath));
 		}
+	}
+
+	//The files are decoded on a worker pool without the pool lock and merged in height order,
+	//so that readers can query the snapshots already merged while the rest is still loading
+	nAllSnapshotSize = loadSnapshotFiles(vSnapshotFiles);
+	{
+		readLock rdlock(rwmutex);
 		LogPrintf("[CConsensusAccountPool::analysisConsensusSnapshots] loop.num  ：%d\n", nAllSnapshotSize);
 		if (1 < snapshotlist.size())
 		{
-			std::map<uint32_t, SnapshotClass>::iterator iterMap = snapshotlist.end();
+			std::map<uint32_t, SnapshotRef>::const_iterator iterMap = snapshotlist.end();
 			
 			LogPrintf("[CConsensusAccountPool::analysisConsensusSnapshots] snapshotlist nAllSnapshotSize ：%d\n", nAllSnapshotSize);
 			--iterMap;
@@ -2890,6 +3101,7 @@ bool  CConsensusAccountPool::analysisConsensusSnapshots()
 		LogPrintf("[CConsensusAccountPool::analysisConsensusSnapshots] snapshotlist size：%d\n", snapshotlist.size());
 		LogPrintf("[CConsensusAccountPool::analysisConsensusSnapshots] Read the file completion and read the height from the file %d\n", nAllSnapshotSize);
 	}
+	LogPrintf("[CConsensusAccountPool::analysisConsensusSnapshots] snapshotlist memory usage：%u\n", getSnapshotListMemoryUsage());
 
 	//chainActive height < Snapshot height 
 	if (nChainHeight < nAllSnapshotSize)
@@ -2926,6 +3138,7 @@ bool  CConsensusAccountPool::analysisConsensusSnapshots()
 
 			m_mapSnapshotIndex.clear();
 			snapshotlist.clear();
+			m_dequeSnapshotTime.clear();
 
 			candidatelist.clear();
 			//writeCandidatelistToFile();
@@ -3026,7 +3239,7 @@ uint64_t CConsensusAccountPool::getCSnapshotIndexSize()
 	return ssSnapshotIndex.size();
 }
 
-uint64_t CConsensusAccountPool::getSnapshotSize(SnapshotClass &snapshot)
+uint64_t CConsensusAccountPool::getSnapshotSize(const SnapshotClass &snapshot)
 {
 	CDataStream ssSnapshot(SER_DISK, CLIENT_VERSION);
 	ssSnapshot << snapshot;
@@ -3249,30 +3462,30 @@ bool CConsensusAccountPool::getSignPkByBlockIndex(const CBlockIndex *pindexTest,
 bool CConsensusAccountPool::getConsensusListByBlock(const CBlock& block, std::set<uint16_t> &setAccounts, std::list<std::shared_ptr<CConsensusAccount >> &consensusList)
 {
 	int64_t curStarttime = block.nPeriodStartTime / 1000;
-	SnapshotClass meetingStartSnapshot;
+	SnapshotRef meetingStartSnapshot;
 	if (!GetSnapshotByTime(meetingStartSnapshot, curStarttime))
 	{
 		LogPrintf("[CConsensusAccountPool::getConsensusListByBlock] A snapshot of the start time of this session failed\n");
 		return false;
 	}
 
-	uint64_t meetingstarttime = meetingStartSnapshot.meetingstoptime;
+	uint64_t meetingstarttime = meetingStartSnapshot->meetingstoptime;
 	int foundcachedcount = CACHED_BLOCK_COUNT;
-	if (meetingStartSnapshot.blockHeight < Params().CHECK_START_BLOCKCOUNT)
+	if (meetingStartSnapshot->blockHeight < Params().CHECK_START_BLOCKCOUNT)
 	{
-		foundcachedcount = meetingStartSnapshot.blockHeight < CACHED_BLOCK_COUNT ? meetingStartSnapshot.blockHeight : CACHED_BLOCK_COUNT;
+		foundcachedcount = meetingStartSnapshot->blockHeight < CACHED_BLOCK_COUNT ? meetingStartSnapshot->blockHeight : CACHED_BLOCK_COUNT;
 	}
-	uint32_t cachedTime = (meetingStartSnapshot.meetingstoptime - foundcachedcount * BLOCK_GEN_TIME) / 1000;
+	uint32_t cachedTime = (meetingStartSnapshot->meetingstoptime - foundcachedcount * BLOCK_GEN_TIME) / 1000;
 	LogPrintf("[CConsensusAccountPool::getConsensusListByBlock] The calculated cache time is %d \n", cachedTime);
 
-	SnapshotClass cachedsnapshot;
+	SnapshotRef cachedsnapshot;
 	if (!GetSnapshotByTime(cachedsnapshot, cachedTime))
 	{
 		LogPrintf("[CConsensusAccountPool::getConsensusListByBlock] The cache time corresponds to a snapshot failure, and the block information is problematic\n");
 		return false;
 	}
 
-	setAccounts = cachedsnapshot.curCandidateIndexList;
+	setAccounts = cachedsnapshot->curCandidateIndexList;
 	consensusList.clear();
 	std::set<uint16_t>::iterator candidateit;
 	for (candidateit = setAccounts.begin(); candidateit != setAccounts.end(); candidateit++)
@@ -3351,23 +3564,23 @@ bool CConsensusAccountPool::setTotalAmount(const CBlock &block,bool bAdd)
 bool CConsensusAccountPool::verifyPkInCandidateListByTime(int64_t curStarttime, CKeyID &pubicKey160hash)
 {
 	//Look for a snapshot of the current session's start time
-	SnapshotClass meetingStartSnapshot;
+	SnapshotRef meetingStartSnapshot;
 	if (!GetSnapshotByTime(meetingStartSnapshot, curStarttime))
 	{
 		LogPrintf("[CConsensusAccountPool::verifyPkInCandidateList] A snapshot of the start time of this session failed\n");
 		return false;
 	}
 
-	uint64_t meetingstarttime = meetingStartSnapshot.meetingstoptime;
+	uint64_t meetingstarttime = meetingStartSnapshot->meetingstoptime;
 	int foundcachedcount = CACHED_BLOCK_COUNT;
-	if (meetingStartSnapshot.blockHeight < Params().CHECK_START_BLOCKCOUNT)
+	if (meetingStartSnapshot->blockHeight < Params().CHECK_START_BLOCKCOUNT)
 	{
-		foundcachedcount = meetingStartSnapshot.blockHeight < CACHED_BLOCK_COUNT ? meetingStartSnapshot.blockHeight : CACHED_BLOCK_COUNT;
+		foundcachedcount = meetingStartSnapshot->blockHeight < CACHED_BLOCK_COUNT ? meetingStartSnapshot->blockHeight : CACHED_BLOCK_COUNT;
 	}
-	uint32_t cachedTime = (meetingStartSnapshot.meetingstoptime - foundcachedcount * BLOCK_GEN_TIME) / 1000;
+	uint32_t cachedTime = (meetingStartSnapshot->meetingstoptime - foundcachedcount * BLOCK_GEN_TIME) / 1000;
 	LogPrintf("[CConsensusAccountPool::verifyPkInCandidateList] The calculated cache time is %d \n", cachedTime);
 
-	SnapshotClass cachedsnapshot;
+	SnapshotRef cachedsnapshot;
 	if (!GetSnapshotByTime(cachedsnapshot, cachedTime))
 	{
 		LogPrintf("[CConsensusAccountPool::verifyPkInCandidateList] Take the cache time corresponding to the snapshot failure, block information has a problem\n");
@@ -3375,9 +3588,9 @@ bool CConsensusAccountPool::verifyPkInCandidateListByTime(int64_t curStarttime,
 	}
 
 	LogPrintf("[CConsensusAccountPool::verifyPkInCandidateList] Find the height of the block= %d , Find the block time= %d \n",
-		cachedsnapshot.blockHeight, cachedsnapshot.timestamp);
+		cachedsnapshot->blockHeight, cachedsnapshot->timestamp);
 
-	std::set<uint16_t> accounts = cachedsnapshot.curCandidateIndexList;
+	const std::set<uint16_t> &accounts = cachedsnapshot->curCandidateIndexList;
 	printsets(accounts);
 
 	//If the current public key is on the blacklist, reject the block
@@ -3389,8 +3602,8 @@ bool CConsensusAccountPool::verifyPkInCandidateListByTime(int64_t curStarttime,
 	}
 	//LogPrintf("[CConsensusAccountPool::verifyPkInCandidateList] Packaging public key Index =%d\n", pkindex);
 
-	std::set<uint16_t>::iterator iter = cachedsnapshot.curCandidateIndexList.begin();
-	for (; iter != cachedsnapshot.curCandidateIndexList.end(); ++iter)
+	std::set<uint16_t>::const_iterator iter = cachedsnapshot->curCandidateIndexList.begin();
+	for (; iter != cachedsnapshot->curCandidateIndexList.end(); ++iter)
 	{
 		if (pkindex == *iter)
 		{
@@ -3468,14 +3681,22 @@ bool CConsensusAccountPool::getCreditbyPkhash(uint160 pkhash, int64_t &n64Credit
 	}
 }
 
-bool CConsensusAccountPool::setSnapshotFilePath(int nNum)
+bool CConsensusAccountPool::setSnapshotFilePath(int nNum, bool fLegacy)
 {
 	std::stringstream sstream;
 	sstream << nNum;
 	std::string strFileNum = sstream.str();
 
-	m_strSnapshotPath = std::string("Snapshot");
-	m_strSnapshotIndexPath = std::string("SnapshotIndex");
+	if (fLegacy)
+	{
+		m_strSnapshotPath = std::string("Snapshot");
+		m_strSnapshotIndexPath = std::string("SnapshotIndex");
+	}
+	else
+	{
+		m_strSnapshotPath = std::string("SnapshotDelta");
+		m_strSnapshotIndexPath = std::string("SnapshotDeltaIndex");
+	}
 
 	m_strSnapshotPath += strFileNum;
 	m_strSnapshotIndexPath += strFileNum;
@@ -3596,7 +3817,7 @@ bool CConsensusAccountPool::splitSnapshotFile()
 		uint64_t nSnapshotNum = u64FileSizeIndex / m_u64SnapshotIndexSize;
 		if (nSnapshotNum <= (SNAPSHOTLENGTH+1))
 		{
-			setSnapshotFilePath(SPLITEDSNAPSHOTFILENOMBER);
+			setSnapshotFilePath(SPLITEDSNAPSHOTFILENOMBER, true);
 			boost::filesystem::path pathSnapshotIndex = curTargetDir / m_strSnapshotDir / m_strSnapshotIndexPath;
 			boost::filesystem::path pathSnapshot = curTargetDir / m_strSnapshotDir / m_strSnapshotPath;
 			boost::filesystem::copy_file(pathSnapshotIndexOld, pathSnapshotIndex);
@@ -3691,6 +3912,112 @@ bool CConsensusAccountPool::splitSnapshotFile()
 	return true;
 }
 
+bool CConsensusAccountPool::convertLegacySnapshotFiles()
+{
+	boost::filesystem::path curTargetDir = GetDataDir();
+
+	int nFileNum = 0;
+	for (;; ++nFileNum)
+	{
+		setSnapshotFilePath(nFileNum, true);
+		std::string strLegacyPath = m_strSnapshotPath;
+		std::string strLegacyIndexPath = m_strSnapshotIndexPath;
+		boost::filesystem::path pathLegacy = curTargetDir / m_strSnapshotDir / strLegacyPath;
+		boost::filesystem::path pathLegacyIndex = curTargetDir / m_strSnapshotDir / strLegacyIndexPath;
+		if (!boost::filesystem::exists(pathLegacy) || !boost::filesystem::exists(pathLegacyIndex))
+			break;
+
+		LogPrintf("[CConsensusAccountPool::convertLegacySnapshotFiles] convert Snapshot file num = %d\n", nFileNum);
+
+		//Start over if an earlier conversion of this file was interrupted
+		setSnapshotFilePath(nFileNum);
+		boost::filesystem::path pathSnapshot = curTargetDir / m_strSnapshotDir / m_strSnapshotPath;
+		boost::filesystem::path pathIndex = curTargetDir / m_strSnapshotDir / m_strSnapshotIndexPath;
+		boost::filesystem::remove(pathSnapshot);
+		boost::filesystem::remove(pathIndex);
+
+		FILE *fileSnapshot = fopen(pathSnapshot.string().c_str(), "ab+");
+		if (fileSnapshot == NULL)
+		{
+			LogPrintf("[CConsensusAccountPool::convertLegacySnapshotFiles] fileSnapshot is NULL\n");
+			return false;
+		}
+		CAutoFile fileout(fileSnapshot, SER_DISK, CLIENT_VERSION);
+
+		FILE *fileIndex = fopen(pathIndex.string().c_str(), "ab+");
+		if (fileIndex == NULL)
+		{
+			LogPrintf("[CConsensusAccountPool::convertLegacySnapshotFiles] fileIndex is NULL\n");
+			return false;
+		}
+		CAutoFile fileoutIndex(fileIndex, SER_DISK, CLIENT_VERSION);
+
+		CMappedFileDpoc mappedLegacy;
+		CMappedFileDpoc mappedLegacyIndex;
+		if (!mappedLegacy.Open(pathLegacy) || !mappedLegacyIndex.Open(pathLegacyIndex))
+		{
+			LogPrintf("[CConsensusAccountPool::convertLegacySnapshotFiles] map Snapshot file num = %d failed\n", nFileNum);
+			return false;
+		}
+
+		uint64_t u64FileSizeLegacy = mappedLegacy.size();
+		uint64_t fileSize = 0;
+		uint32_t nRecord = 0;
+		SnapshotClass lastSnapshot;
+		for (uint64_t nBegin = 0; nBegin + m_u64SnapshotIndexSize <= mappedLegacyIndex.size(); nBegin += m_u64SnapshotIndexSize)
+		{
+			CSnapshotIndex snapshotIndex;
+			SnapshotClass snapshot;
+			if (!mappedLegacyIndex.Read(snapshotIndex, nBegin) || !mappedLegacy.Read(snapshot, snapshotIndex.nOffset))
+				break;
+
+			//Keep a full snapshot every SNAPSHOTINSERT records like the batches written by PushSnapshot
+			CSnapshotDelta snapshotDelta(snapshot, (nRecord % SNAPSHOTINSERT) ? &lastSnapshot : NULL);
+			snapshotIndex.nOffset = fileSize;
+			try {
+				fileout << snapshotDelta;
+				fileoutIndex << snapshotIndex;
+			}
+			catch (const std::exception& e) {
+				LogPrintf("[CConsensusAccountPool::convertLegacySnapshotFiles] write failed by %s \n", e.what());
+				return false;
+			}
+			fileSize += GetSerializeSize(snapshotDelta, SER_DISK, CLIENT_VERSION);
+			lastSnapshot = snapshot;
+			++nRecord;
+		}
+
+		FileCommit(fileout.Get());
+		FileCommit(fileoutIndex.Get());
+		fileout.fclose();
+		fileoutIndex.fclose();
+		mappedLegacy.Close();
+		mappedLegacyIndex.Close();
+
+		boost::filesystem::remove(pathLegacy);
+		boost::filesystem::remove(pathLegacyIndex);
+		LogPrintf("[CConsensusAccountPool::convertLegacySnapshotFiles] Snapshot file num = %d, %d snapshots, %d -> %d bytes\n",
+			nFileNum, nRecord, u64FileSizeLegacy, fileSize);
+	}
+
+	return nFileNum > 0;
+}
+
+size_t CConsensusAccountPool::getSnapshotListMemoryUsage()
+{
+	readLock rdlock(rwmutex);
+
+	std::set<const void*> setCounted;
+	size_t nUsage = memusage::DynamicUsage(snapshotlist) + memusage::DynamicUsage(m_mapSnapshotIndex);
+	std::map<uint32_t, SnapshotRef>::const_iterator iter;
+	for (iter = snapshotlist.begin(); iter != snapshotlist.end(); ++iter)
+	{
+		nUsage += memusage::DynamicUsage(iter->second);
+		nUsage += iter->second->DynamicMemoryUsage(setCounted);
+	}
+	return nUsage;
+}
+
 void CConsensusAccountPool::getSplitedSnapshotAndIndexFileSize(const std::string strSnapshotIndexPath,const uint64_t nIndex,
 	uint64_t & nOldSnapshotFileOffset, uint64_t & nOldSnapshotIndexFileOffset,
 	uint64_t & nSnapshotNewFileSize, uint64_t & nSnapshotIndexNewFileSize)
@@ -3798,13 +4125,19 @@ bool CConsensusAccountPool::createSplitedSnapshotIndexFile(std::string strSnapsh
 
 	boost::filesystem::path pathTmpIndex = curTargetDir / m_strSnapshotDir / strSnapshotIndexTempPath;
 	
-	uint64_t u64FileSizeIndex = boost::filesystem::file_size(pathTmpIndex);
+	CMappedFileDpoc mappedTmpIndex;
+	if (!mappedTmpIndex.Open(pathTmpIndex))
+	{
+		LogPrintf("[CConsensusAccountPool::createSnapshotIndexFile] map %s failed\n", strSnapshotIndexTempPath);
+		fclose(fileIndex);
+		return false;
+	}
+	uint64_t u64FileSizeIndex = mappedTmpIndex.size();
 	uint64_t nTemp = 0;
 	for (uint64_t nBegin = 0; nBegin <= u64FileSizeIndex - m_u64SnapshotIndexSize; nBegin += m_u64SnapshotIndexSize)
 	{	
-		CSerializeDpoc<CSnapshotIndex> serializeIndex;
 		CSnapshotIndex  snapshotIndex;
-		serializeIndex.ReadFromDiskS(snapshotIndex, nBegin, strSnapshotIndexTempPath);
+		mappedTmpIndex.Read(snapshotIndex, nBegin);
 		if (nBegin == 0)
 		{
 			nTemp = snapshotIndex.nOffset;
@@ -3846,6 +4179,7 @@ bool CConsensusAccountPool::createSplitedSnapshotIndexFile(std::string strSnapsh
 
 	fileIndex = NULL;
 
+	mappedTmpIndex.Close();
 	boost::filesystem::remove(pathTmpIndex);
 	
 	return true;
@@ -3859,7 +4193,7 @@ bool CConsensusAccountPool::createSplitedSnapshotAndIndexFile(const int nFileNum
 		return false;
 	}
 
-	setSnapshotFilePath(nFileNum);
+	setSnapshotFilePath(nFileNum, true);
 	if (!createSplitedFile(m_strSnapshotPath, nSnapshotNewFileSize, fileSnapshotOld))
 	{
 		LogPrintf("[CConsensusAccountPool::splitSnapshotFile] create SplitedSnapshotFile return false \n");
@@ -3878,7 +4212,8 @@ void CConsensusAccountPool::printshopsize()
 {
 	unsigned int nSnapshotSize = snapshotlist.size();
 	unsigned int nSnapshotIndexSize = m_mapSnapshotIndex.size();
-	std::cout << "snapshotlist --" << nSnapshotSize << " |m_mapSnapshotIndex -- " << nSnapshotIndexSize << std::endl;
+	std::cout << "snapshotlist --" << nSnapshotSize << " |m_mapSnapshotIndex -- " << nSnapshotIndexSize 
+		<< " |memory usage -- " << getSnapshotListMemoryUsage() << std::endl;
 
 	return;
 }
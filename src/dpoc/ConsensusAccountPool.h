@@ -1,12 +1,16 @@
 ﻿#ifndef	   _IPCCHAIN_CONSENSUSACCOUNTPOOL_H_201708111059_
 #define    _IPCCHAIN_CONSENSUSACCOUNTPOOL_H_201708111059_
 
+#include <deque>
+#include <limits>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <map>
 #include <set>
 #include <utility>
 #include "ConsensusAccount.h"
+#include "CowContainer.h"
 
 /** Cache block length */
 static const int CACHED_BLOCK_COUNT = 10;
@@ -20,6 +24,7 @@ static const int MAX_PERIOD_COUNT = 100;	//The amount of the deposit will reach
 //Cache block length retained in memory
 #define SNAPSHOTLENGTH  20000//50  //20000
 #define SNAPSHOTINSERT  1000//25  //000
+#define MAXSNAPSHOTLOADTHREADS  8
 #define SPLITEDSNAPSHOTFILENOMBER 0
 
 
@@ -32,27 +37,28 @@ public:
 	uint64_t meetingstoptime;		
 	uint32_t blockTime;				//Record the actual packaging time of the corresponding block
 
-	std::set<uint16_t> curCandidateIndexList;			//Current round candidate list (index value, accountlist)
-	std::set<uint16_t> curSeriousPunishIndexAdded;		//Current round of additional severe punishment (index value, not accumulated)
-	std::map<uint16_t, int> curTimeoutIndexRecord;		//Current round update timeout record (index, consecutive no block times)
-	std::set<uint16_t> curRefundIndexList;				//Current round new demand for refund (index value, not accumulated)
-	std::set<uint16_t> curTimeoutPunishList;			//Current round new demand for overtime penalty (index value, not cumulative)
-	std::set<uint16_t> curBanList;						//Current wheel blacklist (index value, not cumulative)
+	//The containers are copy-on-write: a snapshot built from the previous one shares every container it does not change
+	CCowContainer<std::set<uint16_t>> curCandidateIndexList;			//Current round candidate list (index value, accountlist)
+	CCowContainer<std::set<uint16_t>> curSeriousPunishIndexAdded;		//Current round of additional severe punishment (index value, not accumulated)
+	CCowContainer<std::map<uint16_t, int>> curTimeoutIndexRecord;		//Current round update timeout record (index, consecutive no block times)
+	CCowContainer<std::set<uint16_t>> curRefundIndexList;				//Current round new demand for refund (index value, not accumulated)
+	CCowContainer<std::set<uint16_t>> curTimeoutPunishList;			//Current round new demand for overtime penalty (index value, not cumulative)
+	CCowContainer<std::set<uint16_t>> curBanList;						//Current wheel blacklist (index value, not cumulative)
 
 	//From the cur list before the N round and the last one, 
 	//and the transactions included in the received block, 
 	//the refund index needed to be packaged/checked for the next block is calculated
-	std::set<uint16_t> cachedIndexsToRefund;
+	CCowContainer<std::set<uint16_t>> cachedIndexsToRefund;
 
 	//from the previous round of status, 
 	//and the transactions included in the received block, 
 	//the refund index needed to be packaged/checked for the next block is calculated
-	std::set<uint16_t> cachedTimeoutPunishToRun;
+	CCowContainer<std::set<uint16_t>> cachedTimeoutPunishToRun;
 
 	// cache when the front runner list (based on the list of candidates to be calculated by push)
-	std::vector<std::pair<uint16_t, int64_t>> cachedMeetingAccounts;	
+	CCowContainer<std::vector<std::pair<uint16_t, int64_t>>> cachedMeetingAccounts;	
 	//Current round blacklist(index value, cumulative, never empty)
-	std::set<uint16_t> cachedBanList;
+	CCowContainer<std::set<uint16_t>> cachedBanList;
 
 	SnapshotClass();
 	SnapshotClass(const SnapshotClass& in);
@@ -82,7 +88,7 @@ public:
 		READWRITE(cachedBanList);
 	}
 
-	bool operator==( const SnapshotClass& other)
+	bool operator==( const SnapshotClass& other) const
 	{
 		return (curCandidateIndexList == other.curCandidateIndexList &&
 			curSeriousPunishIndexAdded == other.curSeriousPunishIndexAdded &&
@@ -109,8 +115,83 @@ public:
 		cachedMeetingAccounts.clear();
 		cachedBanList.clear();
 	};
+
+	//Heap memory held by the containers, counting each container that is not in setCounted and adding it there
+	size_t DynamicMemoryUsage(std::set<const void*> &setCounted) const;
 };
 
+//On-disk form of a snapshot in the Snapshots files.
+//Containers equal to those of the snapshot at nBaseHeight are left out and shared with it again on load.
+class CSnapshotDelta {
+public:
+	enum {
+		SHARE_CANDIDATE				= (1 << 0),
+		SHARE_SERIOUSPUNISHADDED	= (1 << 1),
+		SHARE_TIMEOUTRECORD			= (1 << 2),
+		SHARE_REFUND				= (1 << 3),
+		SHARE_TIMEOUTPUNISH			= (1 << 4),
+		SHARE_BAN					= (1 << 5),
+		SHARE_CACHEDREFUND			= (1 << 6),
+		SHARE_CACHEDTIMEOUTPUNISH	= (1 << 7),
+		SHARE_CACHEDMEETING			= (1 << 8),
+		SHARE_CACHEDBAN				= (1 << 9),
+	};
+	//Base height of a snapshot that is written in full
+	static const uint32_t NO_BASE = std::numeric_limits<uint32_t>::max();
+
+	uint32_t nBaseHeight;
+	uint16_t nShareMask;
+	SnapshotClass snapshot;
+
+	CSnapshotDelta() : nBaseHeight(NO_BASE), nShareMask(0) {}
+	//pbase is NULL to write the snapshot in full
+	CSnapshotDelta(const SnapshotClass &snapshotIn, const SnapshotClass *pbase);
+
+	//Fill in the containers that were left out from the base snapshot, false if pbase is not the recorded base
+	bool Resolve(const SnapshotClass *pbase);
+
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(nBaseHeight);
+		READWRITE(nShareMask);
+
+		READWRITE(snapshot.pkHashIndex);
+		READWRITE(snapshot.blockHeight);
+		READWRITE(snapshot.timestamp);
+		READWRITE(snapshot.meetingstarttime);
+		READWRITE(snapshot.meetingstoptime);
+		READWRITE(snapshot.blockTime);
+
+		if (!(nShareMask & SHARE_CANDIDATE))
+			READWRITE(snapshot.curCandidateIndexList);
+		if (!(nShareMask & SHARE_SERIOUSPUNISHADDED))
+			READWRITE(snapshot.curSeriousPunishIndexAdded);
+		if (!(nShareMask & SHARE_TIMEOUTRECORD))
+			READWRITE(snapshot.curTimeoutIndexRecord);
+		if (!(nShareMask & SHARE_REFUND))
+			READWRITE(snapshot.curRefundIndexList);
+		if (!(nShareMask & SHARE_TIMEOUTPUNISH))
+			READWRITE(snapshot.curTimeoutPunishList);
+		if (!(nShareMask & SHARE_BAN))
+			READWRITE(snapshot.curBanList);
+
+		if (!(nShareMask & SHARE_CACHEDREFUND))
+			READWRITE(snapshot.cachedIndexsToRefund);
+		if (!(nShareMask & SHARE_CACHEDTIMEOUTPUNISH))
+			READWRITE(snapshot.cachedTimeoutPunishToRun);
+		if (!(nShareMask & SHARE_CACHEDMEETING))
+			READWRITE(snapshot.cachedMeetingAccounts);
+		if (!(nShareMask & SHARE_CACHEDBAN))
+			READWRITE(snapshot.cachedBanList);
+	}
+};
+
+//Snapshots in the list are immutable once pushed, lookups hand out shared handles instead of copies
+typedef std::shared_ptr<const SnapshotClass> SnapshotRef;
+template <typename Snapshot> static inline SnapshotRef MakeSnapshotRef(Snapshot&& snapshotIn) { return std::make_shared<const SnapshotClass>(std::forward<Snapshot>(snapshotIn)); }
+
 enum DPOC_errtype {
 	EXIT_PUBKEY_NOT_EXIST_IN_LIST = 0,
 	EXIT_UNKNOWN_PUBKEY,
@@ -146,26 +227,28 @@ public:
 	bool getPublicKeyFromBlock(const CBlock *pblock, CPubKey& outPubkey, std::vector<unsigned char>& outRecvSign);
 	bool getPublicKeyFromSignstring(const std::string signstr, CPubKey& outPubkey, std::vector<unsigned char>& outRecvSign);
 	bool ContainPK(uint160 pk, uint16_t& index);
-	bool contain(std::vector<std::pair<uint16_t, int64_t>> list, uint16_t indexIn);
-	bool getCreditFromSnapshotByIndex(SnapshotClass snapshot, const uint16_t indexIn, int64_t &credit);
+	bool contain(const std::vector<std::pair<uint16_t, int64_t>> &list, uint16_t indexIn);
+	bool getCreditFromSnapshotByIndex(const SnapshotClass &snapshot, const uint16_t indexIn, int64_t &credit);
 	//Determine whether the deposit that applies to the consensus is thawed
 	bool IsAviableUTXO(const uint256 hash);
 	CAmount GetDepositBypkhash(uint160 pkhash);
 	uint256 GetTXhashBypkhash(uint160 pkhash);
 	//Snapshot related read and write operations
-	bool GetSnapshotByTime(SnapshotClass &snapshot, uint64_t readtime);
-	bool GetSnapshotByHeight(SnapshotClass &snapshot, uint32_t height);
-	bool GetSnapshotsByHeight(std::vector<SnapshotClass> &snapshots, uint32_t lowest, uint32_t highest = 0);
+	bool GetSnapshotByTime(SnapshotRef &snapshot, uint64_t readtime);
+	bool GetSnapshotByHeight(SnapshotRef &snapshot, uint32_t height);
+	bool GetSnapshotsByHeight(std::vector<SnapshotRef> &snapshots, uint32_t lowest, uint32_t highest = 0);
 	//Gets the snapshot at the end of the current snapshot list
-	bool GetLastSnapshot(SnapshotClass &snapshot);
+	bool GetLastSnapshot(SnapshotRef &snapshot);
 	//Add the snapshot to the end of the snapshot list
-	bool PushSnapshot(SnapshotClass snapshot);
+	bool PushSnapshot(const SnapshotRef &snapshot);
 	bool getPKIndexBySortedIndex(uint16_t &pkIndex, uint160 &pkhash, std::list<std::shared_ptr<CConsensusAccount >> consensusList, int sortedIndex);
-	bool GetTimeoutIndexs(const std::shared_ptr<const CBlock> pblock, SnapshotClass lastsnapshot, std::map<uint16_t, int>& timeoutindexs);
+	bool GetTimeoutIndexs(const std::shared_ptr<const CBlock> pblock, const SnapshotClass &lastsnapshot, std::map<uint16_t, int>& timeoutindexs);
 	CAmount GetCurDepositAdjust(uint160 pkhash,uint32_t blockheight);
 	bool SetConsensusStatus(const std::string &strStatus, const std::string &strHash);
 	uint64_t getCSnapshotIndexSize();
-	uint64_t getSnapshotSize(SnapshotClass &snapshot);
+	uint64_t getSnapshotSize(const SnapshotClass &snapshot);
+	//Heap memory held by the snapshot list, containers shared between snapshots are counted once
+	size_t getSnapshotListMemoryUsage();
 	void writeCandidatelistToFileByHeight(uint32_t nHeight);
 	bool writeCandidatelistToFile(const CConsensusAccount &account);
 	bool readCandidatelistFromFile();
@@ -197,16 +280,29 @@ public:
 	bool verifyPkIsTrustNode(CKeyID  &pubicKey160hash);
 	bool getCreditbyPkhash(uint160 pkhash, int64_t &n64Credit);
 	
+	//Decode the given (snapshot, index) files on a worker pool and merge them into the list, returns the number of snapshots loaded
+	int loadSnapshotFiles(const std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>> &vSnapshotFiles);
+	//Index of the first of the nFiles snapshot files loaded at startup, only the last two are needed
+	static int getFirstSnapshotFileToLoad(int nFiles);
+
 	static  CConsensusAccountPool&  Instance();
+	//The node shares Instance(), tests build pools of their own
+	CConsensusAccountPool();
 	~CConsensusAccountPool();
 
 private:
-	void printsnapshots(std::vector<SnapshotClass> list);
-	void printsets(std::set<uint16_t> list);
-	bool setSnapshotFilePath(int nNum);
+	void printsnapshots(const std::vector<SnapshotRef> &list);
+	void printsets(const std::set<uint16_t> &list);
+	//Insert into snapshotlist and the time index, dropping the oldest snapshot once SNAPSHOTLENGTH is exceeded
+	void insertSnapshot(const SnapshotRef &snapshot);
+	void rebuildSnapshotTimeIndex();
+	//fLegacy selects the names of the files written before snapshots were delta encoded
+	bool setSnapshotFilePath(int nNum, bool fLegacy = false);
 	bool truncateSnapshotFile(uint32_t u32OldHeight, uint32_t u32NowHeight);
 
 	bool splitSnapshotFile();
+	//Rewrite the split files of full snapshots as delta encoded files
+	bool convertLegacySnapshotFiles();
 	void getSplitedSnapshotAndIndexFileSize(const std::string strSnapshotIndexPath, const uint64_t nIndex,
 		uint64_t & nOldSnapshotFileOffset, uint64_t & nOldSnapshotIndexFileOffset,
 		uint64_t & nSnapshotNewFileSize, uint64_t & nSnapshotIndexNewFileSize);
@@ -216,7 +312,6 @@ private:
 	bool createSplitedSnapshotAndIndexFile(const int nFileNum, const uint64_t nSnapshotNewFileSize, const uint64_t nSnapshotIndexNewFileSize,
 		                               FILE *fileSnapshotOld, FILE *fileSnapshotIndexOld);
 private:
-	CConsensusAccountPool();
 	static void CreateInstance();
 	static CConsensusAccountPool* _instance;
 	static std::once_flag init_flag;
@@ -231,7 +326,10 @@ private:
 	typedef boost::shared_lock<boost::shared_mutex> readLock;
 	typedef boost::unique_lock<boost::shared_mutex> writeLock;
 	boost::shared_mutex rwmutex;
-	std::map<uint32_t, SnapshotClass> snapshotlist; //key is block Height
+	std::map<uint32_t, SnapshotRef> snapshotlist; //key is block Height
+	//Monotonic (timestamp, height) index over snapshotlist, strictly increasing in both,
+	//a snapshot is dropped from it once a higher snapshot has a timestamp not greater than its own
+	std::deque<std::pair<uint64_t, uint32_t>> m_dequeSnapshotTime;
 	std::map<uint32_t, uint64_t> m_mapSnapshotIndex;
 	std::string m_strSnapshotPath;
 	std::string m_strSnapshotDir;
@@ -0,0 +1,112 @@
+#ifndef IPCHAIN_DPOC_COWCONTAINER_H
+#define IPCHAIN_DPOC_COWCONTAINER_H
+
+#include <memory>
+#include <utility>
+
+#include "../memusage.h"
+#include "../serialize.h"
+
+/**
+ * Copy-on-write holder for the containers of a SnapshotClass.
+ * Copying shares the underlying container; the first mutation through one of
+ * the non-const members below detaches it. Consecutive snapshots therefore only
+ * pay for the containers that actually changed between two blocks.
+ * Mutators that would leave the content unchanged do not detach.
+ */
+template<typename T>
+class CCowContainer
+{
+public:
+	typedef typename T::value_type value_type;
+	typedef typename T::size_type size_type;
+	typedef typename T::const_iterator const_iterator;
+
+	CCowContainer() : ptr(Empty()) {}
+	CCowContainer(const T& in) : ptr(std::make_shared<T>(in)) {}
+
+	CCowContainer& operator=(const T& in)
+	{
+		ptr = std::make_shared<T>(in);
+		return *this;
+	}
+
+	const T& get() const { return *ptr; }
+	operator const T&() const { return *ptr; }
+
+	const_iterator begin() const { return ptr->begin(); }
+	const_iterator end() const { return ptr->end(); }
+	size_type size() const { return ptr->size(); }
+	bool empty() const { return ptr->empty(); }
+	template<typename K> size_type count(const K& key) const { return ptr->count(key); }
+	template<typename K> const_iterator find(const K& key) const { return ptr->find(key); }
+	template<typename K, typename C = T> const typename C::mapped_type& at(const K& key) const { return ptr->at(key); }
+
+	/** Writable access to the container, detaching it from any other holder first */
+	T& modify()
+	{
+		if (ptr.use_count() > 1)
+			ptr = std::make_shared<T>(*ptr);
+		return *ptr;
+	}
+
+	void insert(const value_type& value)
+	{
+		if (!ptr->count(value))
+			modify().insert(value);
+	}
+
+	template<typename K> size_type erase(const K& key)
+	{
+		if (!ptr->count(key))
+			return 0;
+		return modify().erase(key);
+	}
+
+	void clear()
+	{
+		if (!ptr->empty())
+			ptr = Empty();
+	}
+
+	void push_back(const value_type& value) { modify().push_back(value); }
+
+	template<typename K, typename C = T> typename C::mapped_type& operator[](const K& key) { return modify()[key]; }
+
+	/** True if both hold the very same container, i.e. no copy was ever made between them */
+	bool SharesWith(const CCowContainer& other) const { return ptr == other.ptr; }
+
+	bool operator==(const CCowContainer& other) const { return SharesWith(other) || *ptr == *other.ptr; }
+	bool operator!=(const CCowContainer& other) const { return !(*this == other); }
+
+	/** Identity of the shared container, for counting it once across holders */
+	const void* Id() const { return ptr.get(); }
+
+	/** Heap usage of the shared container, to be counted once for all holders */
+	size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(ptr) + memusage::DynamicUsage(*ptr); }
+
+	template<typename Stream>
+	void Serialize(Stream& s) const
+	{
+		::Serialize(s, *ptr);
+	}
+
+	template<typename Stream>
+	void Unserialize(Stream& s)
+	{
+		std::shared_ptr<T> tmp = std::make_shared<T>();
+		::Unserialize(s, *tmp);
+		ptr = tmp;
+	}
+
+private:
+	static const std::shared_ptr<T>& Empty()
+	{
+		static const std::shared_ptr<T> empty = std::make_shared<T>();
+		return empty;
+	}
+
+	std::shared_ptr<T> ptr;
+};
+
+#endif // IPCHAIN_DPOC_COWCONTAINER_H
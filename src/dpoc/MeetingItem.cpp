@@ -205,15 +205,20 @@ int CMeetingItem::compare(std::shared_ptr<CConsensusAccount> &a1, std::shared_pt
 
 uint256 CMeetingItem::getNewHash(const int64_t nTime, std::shared_ptr<CConsensusAccount> &account)
 {
-	std::stringstream ss;
-	std::string strTime;
-	ss << nTime;
-	ss >> strTime;
-	uint160 accout160 =  account->getPubicKey160hash();
-	std::string strHash160 = accout160.GetHex();
-	strHash160 += strTime;
-	
-	uint256 u256 = Hash(strHash160.begin(), strHash160.end());
+	//The sort key hashes the hex of the public key hash followed by the decimal time,
+	//written into a buffer here rather than through strings
+	static const char hexdigits[] = "0123456789abcdef";
+	unsigned char vch[40 + 21];
+	uint160 accout160 = account->getPubicKey160hash();
+	const unsigned char* p = accout160.begin();
+	for (int i = 0; i < 20; i++)
+	{
+		vch[2 * i] = hexdigits[p[19 - i] >> 4];
+		vch[2 * i + 1] = hexdigits[p[19 - i] & 0x0f];
+	}
+	int nLen = snprintf((char*)vch + 40, 21, "%lld", (long long)nTime);
+
+	uint256 u256 = Hash(vch, vch + 40 + nLen);
 	return Hash(u256.begin(), u256.end());
 }
 
@@ -4,6 +4,8 @@
 
 #include "../serialize.h"
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include "../util.h"
 #include "../streams.h"
 #include "../chainparams.h"
@@ -184,6 +186,117 @@ public:
 	}
 };
 
+//Read-only stream over a block of memory, used to deserialize records straight out of a mapped file
+class CMappedStream
+{
+public:
+	CMappedStream(const char *pbeginIn, const char *pendIn, int nTypeIn, int nVersionIn) :
+		pbegin(pbeginIn), pend(pendIn), pcur(pbeginIn), nType(nTypeIn), nVersion(nVersionIn)
+	{
+	}
+
+	int GetType() const { return nType; }
+	int GetVersion() const { return nVersion; }
+	uint64_t Consumed() const { return pcur - pbegin; }
+
+	void read(char *pch, size_t nSize)
+	{
+		if (nSize > (size_t)(pend - pcur))
+			throw std::ios_base::failure("CMappedStream::read(): end of data");
+		memcpy(pch, pcur, nSize);
+		pcur += nSize;
+	}
+
+	template<typename T>
+	CMappedStream& operator>>(T &obj)
+	{
+		::Unserialize(*this, obj);
+		return *this;
+	}
+
+private:
+	const char *pbegin;
+	const char *pend;
+	const char *pcur;
+	const int nType;
+	const int nVersion;
+};
+
+//A dpoc data file mapped into memory once, so that a whole file of records is read without a syscall per record
+class CMappedFileDpoc
+{
+public:
+	CMappedFileDpoc() : pbegin(NULL), nSize(0)
+	{
+	}
+
+	bool Open(const boost::filesystem::path &path)
+	{
+		Close();
+		try {
+			if (!boost::filesystem::exists(path))
+				return false;
+			//An empty file cannot be mapped but is a valid file without records
+			if (boost::filesystem::file_size(path) == 0)
+				return true;
+
+			boost::interprocess::file_mapping mappingTmp(path.string().c_str(), boost::interprocess::read_only);
+			boost::interprocess::mapped_region regionTmp(mappingTmp, boost::interprocess::read_only);
+			regionTmp.advise(boost::interprocess::mapped_region::advice_sequential);
+			mapping.swap(mappingTmp);
+			region.swap(regionTmp);
+		}
+		catch (const std::exception& e) {
+			LogPrintf("CMappedFileDpoc::Open %s return false by %s \n", path.string(), e.what());
+			Close();
+			return false;
+		}
+
+		pbegin = static_cast<const char*>(region.get_address());
+		nSize = region.get_size();
+		return true;
+	}
+
+	void Close()
+	{
+		boost::interprocess::mapped_region regionEmpty;
+		boost::interprocess::file_mapping mappingEmpty;
+		region.swap(regionEmpty);
+		mapping.swap(mappingEmpty);
+		pbegin = NULL;
+		nSize = 0;
+	}
+
+	uint64_t size() const { return nSize; }
+
+	//Deserialize the record at nOffset, pnRead receives the number of bytes it took
+	template<typename T>
+	bool Read(T &item, const uint64_t nOffset, uint64_t *pnRead = NULL) const
+	{
+		if (nOffset >= nSize)
+			return false;
+
+		CMappedStream stream(pbegin + nOffset, pbegin + nSize, SER_DISK, CLIENT_VERSION);
+		try {
+			stream >> item;
+		}
+		catch (const std::exception& e) {
+			LogPrintf("CMappedFileDpoc::Read return false by %s \n", e.what());
+			return false;
+		}
+
+		if (pnRead)
+			*pnRead = stream.Consumed();
+		return true;
+	}
+
+private:
+	boost::interprocess::file_mapping mapping;
+	boost::interprocess::mapped_region region;
+	const char *pbegin;
+	uint64_t nSize;
+};
+
 class CSnapshotIndex
 {
 public:
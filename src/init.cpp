@@ -72,7 +72,7 @@
 #include "zmq/zmqnotificationinterface.h"
 #endif
 #include <thread>
-extern CDBWrapper *g_pDBVote;
+extern CCommitCertificateDB *g_pDBVote;
 
 bool fFeeEstimatesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
@@ -240,13 +240,19 @@ void Shutdown()
             LogPrintf("%s: Failed to write fee estimates to %s\n", __func__, est_path.string());
         fFeeEstimatesInitialized = false;
     }
-    LogPrintf("Shutdown(): before if (pIPCCheckMaps != NULL)\n");
+    LogPrintf("Shutdown(): before if (pIPCUniqueDB != NULL)\n");
     {
-		if (pIPCCheckMaps != NULL)
+		if (pIPCUniqueDB != NULL)
 		{
-			delete(pIPCCheckMaps);
+			delete(pIPCUniqueDB);
 		}
-		pIPCCheckMaps = NULL;
+		pIPCUniqueDB = NULL;
+
+		if (pTokenRegistry != NULL)
+		{
+			delete(pTokenRegistry);
+		}
+		pTokenRegistry = NULL;
 
 		
 		if (pTxDB != NULL)
@@ -1234,7 +1240,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 		boost::filesystem::create_directories (GetDataDir() / "block" / "Vote");
 	 }
 
-	 g_pDBVote = new CDBWrapper (GetDataDir() / "block" / "Vote", 1024);
+	 g_pDBVote = new CCommitCertificateDB (1024);
 
 
 #ifndef WIN32
@@ -1257,11 +1263,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i automatic connections (%i file descriptors available)\n", nMaxConnections, nFD);
 
     InitSignatureCache();
+    InitVoteSignatureCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadVoteCheck);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1515,13 +1524,30 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
 				
-				delete pIPCCheckMaps;
-				pIPCCheckMaps = new IPCCheckMaps();
+				delete pIPCUniqueDB;
+				pIPCUniqueDB = new CIPCUniqueDB();
+				if (!pIPCUniqueDB->Init(fReindex || fReindexChainState)) {
+					strLoadError = _("Error opening IPC unique index database");
+					break;
+				}
+
+				delete pTokenRegistry;
+				pTokenRegistry = new CTokenRegistry();
+				if (!pTokenRegistry->Init(fReindex || fReindexChainState)) {
+					strLoadError = _("Error opening token registry database");
+					break;
+				}
 
 				delete pTxDB;
 				pTxDB = new TxDBProcess();
-				if (fAddressIndex)
-					pTxDB->Init();
+				if (fAddressIndex && !pTxDB->Init(fReindex || fReindexChainState)) {
+					strLoadError = _("Error opening address index database");
+					break;
+				}
+				if (fAddressIndex && !pblocktree->UpgradeAddressUnspentIndex()) {
+					strLoadError = _("Error upgrading address unspent index");
+					break;
+				}
 
                 if (fReindex) {
                     pblocktree->WriteReindexing(true);
@@ -1625,7 +1651,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
 				LogPrintf("[INIT] CVerifyDB().LoadICMFromDisk\n");
 				//Change to read local disk data into memory
-				tokenDataMap.clear(); 
 				CVerifyDB().LoadICMFromDisk();
 			
 
@@ -500,6 +500,7 @@ HEADERS += \
     dpoc/CarditConsensusMeeting.h \
     dpoc/ConsensusAccount.h \
     dpoc/ConsensusAccountPool.h \
+    dpoc/CowContainer.h \
     dpoc/DpocInfo.h \
     dpoc/DpocMining.h \
     dpoc/MeetingItem.h \
@@ -11,6 +11,7 @@
 
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -81,6 +82,15 @@ struct stl_shared_counter
     size_t weak_count;
 };
 
+static inline size_t DynamicUsage(const std::string& s)
+{
+    // Short strings are stored inside the string object itself
+    const char* p = s.data();
+    if (p >= reinterpret_cast<const char*>(&s) && p < reinterpret_cast<const char*>(&s + 1))
+        return 0;
+    return MallocUsage(s.capacity() + 1);
+}
+
 template<typename X>
 static inline size_t DynamicUsage(const std::vector<X>& v)
 {
@@ -117,6 +127,12 @@ static inline size_t IncrementalDynamicUsage(const std::map<X, Y, Z>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >));
 }
 
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const std::multimap<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >)) * m.size();
+}
+
 // indirectmap has underlying map with pointer as key
 
 template<typename X, typename Y>
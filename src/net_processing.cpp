@@ -23,6 +23,7 @@
 #include "primitives/transaction.h"
 #include "random.h"
 #include "tinyformat.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -38,7 +39,7 @@
 #endif
 
 extern boost::mutex g_vote_mutex;
-extern CDBWrapper *g_pDBVote;
+extern CCommitCertificateDB *g_pDBVote;
 
 std::atomic<int64_t> nTimeBestReceived(0); // Used only to inform the wallet of when we last received a block
 
@@ -52,6 +53,13 @@ std::set<uint256> have_broadcast_votes2;
 MessageCache have_broadcast_msg(500);
 MessageCache have_broadcast_block(500);
 
+/** Maximum number of compact proposals waiting for their transactions */
+static const unsigned int MAX_PENDING_PROPOSALS = 16;
+/** Seconds after which a compact proposal of another peer may take over a pending one */
+static const int64_t PENDING_PROPOSAL_TIMEOUT = 2;
+/** Compact proposals waiting for the transactions requested from their sender, guarded by cs_main */
+static CPendingProposals pendingProposals(MAX_PENDING_PROPOSALS, PENDING_PROPOSAL_TIMEOUT);
+
 struct IteratorComparator
 {
     template<typename I>
@@ -300,10 +308,13 @@ void FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTime) {
         fUpdateConnectionTime = true;
     }
 
+    EraseUnverifiedCertificates(nodeid);
+
     BOOST_FOREACH(const QueuedBlock& entry, state->vBlocksInFlight) {
         mapBlocksInFlight.erase(entry.hash);
     }
     EraseOrphansFor(nodeid);
+    pendingProposals.EraseNode(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
     nPeersWithValidatedDownloads -= (state->nBlocksInFlightValidHeaders != 0);
     assert(nPeersWithValidatedDownloads >= 0);
@@ -793,6 +804,19 @@ static std::shared_ptr<const CBlock> most_recent_block;
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block;
 static uint256 most_recent_block_hash;
 
+// Send the commit votes of block ahead of it, as its certificate or as the set of votes to older peers
+static void PushCommitVotes(CNode* pnode, const CBlock& block, const CCommitCertificate& cert, CConnman& connman)
+{
+    const CNetMsgMaker msgMaker(pnode->GetSendVersion());
+    if (pnode->nVersion >= COMMIT_CERTIFICATE_VERSION) {
+        connman.PushMessage(pnode, msgMaker.Make(NetMsgType::PUT_COMMIT, cert));
+        return;
+    }
+    CVoteSet vote2s;
+    if (GetCommitVotes(block, vote2s))
+        connman.PushMessage(pnode, msgMaker.Make(NetMsgType::PUT_VOTE, vote2s));
+}
+
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true);
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
@@ -814,7 +838,11 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         most_recent_compact_block = pcmpctblock;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    // Read once for all the peers the block is announced to
+    CCommitCertificate cert;
+    bool fHaveCertificate = GetCommitCertificate(*pblock, cert);
+
+    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock, &pblock, &cert, fHaveCertificate](CNode* pnode) {
         // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
@@ -828,19 +856,9 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
             LogPrint("net", "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->id);
 
+			if (fHaveCertificate)
 			{
-     		 	std::set<CVote> vote2s;
-				bool have_vote = g_pDBVote->Read (hashBlock, vote2s);
-
-				if (have_vote)
-				{
-					std::cout << "NewPoWValidBlock-----nnn\n";
-					connman->PushMessage(pnode, msgMaker.Make(NetMsgType::PUT_VOTE, vote2s));
-				}
-				else
-				{
-					std::cout << "0-----nnn\n";
-				}
+				PushCommitVotes(pnode, *pblock, cert, *connman);
 			}
 
             connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock)); //mgwang
@@ -1073,8 +1091,6 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 {
                     // Send block from disk
                     CBlock block;
-					     std::set<CVote> vote2s;
-						  bool have_vote;
 
                     if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
 						  {
@@ -1083,18 +1099,10 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
 					if (IsTendermintConsensusWork())
 					{
+						CCommitCertificate cert;
+						if (GetCommitCertificate(block, cert))
 						{
-							boost::lock_guard<boost::mutex> lock{ g_vote_mutex };
-							have_vote = g_pDBVote->Read(block.GetHash(), vote2s);
-						}
-
-						if (have_vote)
-						{
-							connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::PUT_VOTE, vote2s));
-						}
-						else
-						{
-							std::cout << "NNNNN\n";
+							PushCommitVotes(pfrom, block, cert, connman);
 						}
 					}
 
@@ -1256,22 +1264,137 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
 
 	 if(IsTendermintConsensusWork ())
 	{
-      std::set<CVote> vote2s;
-		bool have_vote = g_pDBVote->Read (block.GetHash(), vote2s);
-
-		if (have_vote)
-		{
-			connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::PUT_VOTE, vote2s));
-		}
-		else
+		CCommitCertificate cert;
+		if (GetCommitCertificate(block, cert))
 		{
-			std::cout << "-----nnn\n";
+			PushCommitVotes(pfrom, block, cert, connman);
 		}
 	}
 
     connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCKTXN, resp));
 }
 
+ProposalAction CPendingProposals::ReceiveCompact(const CBlockHeaderAndShortTxIDs& cmpctblock, bool fHeaderOk, NodeId nodeid, int64_t nNow, CTxMemPool* pool,
+                                                 const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn, CBlock& block, BlockTransactionsRequest& req)
+{
+    const uint256 hash = cmpctblock.header.GetHash();
+
+    // Another peer is already sending us the transactions we miss
+    std::map<uint256, PendingProposal>::iterator itPending = mapPending.find(hash);
+    if (fHeaderOk && itPending != mapPending.end()) {
+        if (itPending->second.nodeid == nodeid || itPending->second.nTime > nNow - nTimeout)
+            return PROPOSAL_IGNORE;
+        mapPending.erase(itPending);
+    }
+
+    std::unique_ptr<PartiallyDownloadedBlock> partialBlock(new PartiallyDownloadedBlock(pool));
+    ReadStatus status = partialBlock->InitData(cmpctblock, extra_txn);
+    if (status == READ_STATUS_INVALID)
+        return PROPOSAL_MISBEHAVING;
+    if (status == READ_STATUS_FAILED) // Duplicate txindexes, ask for the full proposal
+        return PROPOSAL_GETBLOCK;
+
+    req.indexes.clear();
+    for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+        if (!partialBlock->IsTxAvailable(i))
+            req.indexes.push_back(i);
+    }
+    if (req.indexes.empty()) {
+        // Our mempool had every transaction, no round trip needed
+        status = partialBlock->FillBlock(block, std::vector<CTransactionRef>());
+        return status == READ_STATUS_OK || status == READ_STATUS_CHECKBLOCK_FAILED ? PROPOSAL_PROCESS : PROPOSAL_GETBLOCK;
+    }
+    // No pending slot, the full proposal goes through put_block like any other
+    if (!fHeaderOk)
+        return PROPOSAL_GETBLOCK;
+
+    if (mapPending.size() >= nMaxPending) {
+        std::map<uint256, PendingProposal>::iterator itOldest = mapPending.begin();
+        for (std::map<uint256, PendingProposal>::iterator it = mapPending.begin(); it != mapPending.end(); it++) {
+            if (it->second.nTime < itOldest->second.nTime)
+                itOldest = it;
+        }
+        mapPending.erase(itOldest);
+    }
+    PendingProposal& pending = mapPending[hash];
+    pending.nodeid = nodeid;
+    pending.nTime = nNow;
+    pending.partialBlock = std::move(partialBlock);
+
+    req.blockhash = hash;
+    return PROPOSAL_GETBLOCKTXN;
+}
+
+ProposalAction CPendingProposals::ReceiveTransactions(const BlockTransactions& resp, NodeId nodeid, CBlock& block)
+{
+    std::map<uint256, PendingProposal>::iterator it = mapPending.find(resp.blockhash);
+    if (it == mapPending.end() || it->second.nodeid != nodeid)
+        return PROPOSAL_IGNORE;
+
+    ReadStatus status = it->second.partialBlock->FillBlock(block, resp.txn);
+    mapPending.erase(it);
+    if (status == READ_STATUS_INVALID)
+        return PROPOSAL_MISBEHAVING;
+    if (status == READ_STATUS_FAILED) // Might have collided, fall back to the full proposal
+        return PROPOSAL_GETBLOCK;
+    // A proposal failing CheckBlock still goes to the vote, which votes against it
+    return PROPOSAL_PROCESS;
+}
+
+NodeId CPendingProposals::GetNode(const uint256& hash) const
+{
+    std::map<uint256, PendingProposal>::const_iterator it = mapPending.find(hash);
+    return it == mapPending.end() ? -1 : it->second.nodeid;
+}
+
+void CPendingProposals::EraseNode(NodeId nodeid)
+{
+    for (std::map<uint256, PendingProposal>::iterator it = mapPending.begin(); it != mapPending.end();) {
+        if (it->second.nodeid == nodeid)
+            mapPending.erase(it++);
+        else
+            it++;
+    }
+}
+
+bool CheckProposalHeader(const CBlockHeader& header, const Consensus::Params& consensusParams, CValidationState& state)
+{
+    AssertLockHeld(cs_main);
+    if (mapBlockIndex.find(header.hashPrevBlock) == mapBlockIndex.end())
+        return state.Invalid(false, REJECT_INVALID, "prev-blk-not-found", "proposal on unknown block " + header.hashPrevBlock.ToString());
+    return CheckBlockHeader(header, state, consensusParams, false);
+}
+
+bool CheckProposal(const CBlock& block, const Consensus::Params& consensusParams)
+{
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        if (!CheckProposalHeader(block, consensusParams, state)) {
+            LogPrint("net", "Voting against proposal %s: %s\n", block.GetHash().ToString(), FormatStateMessage(state));
+            return false;
+        }
+    }
+    return CheckBlock(block, state, consensusParams, false, true);
+}
+
+// Check a proposal received in full or rebuilt from its compact form and hand it to the vote,
+// which relays it and votes against it if CheckProposal fails.
+// Must not hold cs_main, ProcessBlock takes the vote lock.
+static void ProcessProposal(std::shared_ptr<CBlock> p_block, const CChainParams& chainparams)
+{
+    if (have_broadcast_block.Exist (p_block->GetHash()))
+        return;
+    have_broadcast_block.Insert (p_block->GetHash());
+    {
+        // A proposal received in full no longer needs its compact form rebuilt
+        LOCK(cs_main);
+        pendingProposals.Erase(p_block->GetHash());
+    }
+
+    ProcessBlock (p_block, CheckProposal(*p_block, chainparams.GetConsensus()));
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
@@ -2783,18 +2906,113 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
 		 vRecv >> *p_block;
 
-		 if (false == have_broadcast_block.Exist (p_block->GetHash()))
-		 {
-		  	bool if_ok;
-		 	CValidationState state;
+		 ProcessProposal (p_block, chainparams);
+	 }
 
-			have_broadcast_block.Insert (p_block->GetHash());
+    else if (strCommand == NetMsgType::PUT_CMPCTBLOCK)
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
 
-			if_ok = CheckBlock(*p_block, state, chainparams.GetConsensus(), false, true);
-		 	ProcessBlock (p_block, if_ok);
-		 }
+        const uint256 hash = cmpctblock.header.GetHash();
+        std::shared_ptr<CBlock> p_block = std::make_shared<CBlock>();
+        bool fHeaderOk = true;
+        ProposalAction action;
+        {
+            LOCK(cs_main);
 
-	 }
+            if (have_broadcast_block.Exist (hash)) {
+                pendingProposals.Erase(hash);
+                return true;
+            }
+
+            // Only a proposal on a block we know with a valid header may take a pending slot,
+            // the others still go to the vote, which checks them again and votes against them
+            CValidationState state;
+            if (!CheckProposalHeader(cmpctblock.header, chainparams.GetConsensus(), state)) {
+                LogPrint("net", "Peer %d sent us a compact proposal with a bad header: %s\n", pfrom->id, FormatStateMessage(state));
+                fHeaderOk = false;
+            }
+
+            BlockTransactionsRequest req;
+            action = pendingProposals.ReceiveCompact(cmpctblock, fHeaderOk, pfrom->GetId(), GetTime(), &mempool, vExtraTxnForCompact, *p_block, req);
+            if (action == PROPOSAL_MISBEHAVING) {
+                Misbehaving(pfrom->GetId(), 100);
+                LogPrintf("Peer %d sent us invalid compact proposal\n", pfrom->id);
+            } else if (action == PROPOSAL_GETBLOCK) {
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::PUT_GETBLOCK, hash));
+            } else if (action == PROPOSAL_GETBLOCKTXN) {
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::PUT_GETBLOCKTXN, req));
+            }
+        } // Don't hold cs_main when we call into ProcessBlock
+
+        if (action == PROPOSAL_PROCESS)
+            ProcessProposal(p_block, chainparams);
+    }
+
+    else if (strCommand == NetMsgType::PUT_GETBLOCKTXN)
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        std::shared_ptr<const CBlock> pblock = GetRecentProposal(req.blockhash);
+        if (!pblock) {
+            LogPrint("net", "Peer %d sent us a put_getbtxn for a proposal we don't have\n", pfrom->id);
+            return true;
+        }
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++) {
+            if (req.indexes[i] >= pblock->vtx.size()) {
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), 100);
+                LogPrintf("Peer %d sent us a put_getbtxn with out-of-bounds tx indices\n", pfrom->id);
+                return true;
+            }
+            resp.txn[i] = pblock->vtx[req.indexes[i]];
+        }
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::PUT_BLOCKTXN, resp));
+    }
+
+    else if (strCommand == NetMsgType::PUT_BLOCKTXN)
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        std::shared_ptr<CBlock> p_block = std::make_shared<CBlock>();
+        ProposalAction action;
+        {
+            LOCK(cs_main);
+
+            if (have_broadcast_block.Exist (resp.blockhash)) {
+                pendingProposals.Erase(resp.blockhash);
+                return true;
+            }
+
+            action = pendingProposals.ReceiveTransactions(resp, pfrom->GetId(), *p_block);
+            if (action == PROPOSAL_IGNORE) {
+                LogPrint("net", "Peer %d sent us transactions for a proposal we weren't expecting\n", pfrom->id);
+            } else if (action == PROPOSAL_MISBEHAVING) {
+                Misbehaving(pfrom->GetId(), 100);
+                LogPrintf("Peer %d sent us non-matching proposal transactions\n", pfrom->id);
+            } else if (action == PROPOSAL_GETBLOCK) {
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::PUT_GETBLOCK, resp.blockhash));
+            }
+        } // Don't hold cs_main when we call into ProcessBlock
+
+        if (action == PROPOSAL_PROCESS)
+            ProcessProposal(p_block, chainparams);
+    }
+
+    else if (strCommand == NetMsgType::PUT_GETBLOCK)
+    {
+        uint256 hash;
+        vRecv >> hash;
+
+        std::shared_ptr<const CBlock> pblock = GetRecentProposal(hash);
+        if (pblock)
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::PUT_BLOCK, *pblock));
+    }
 
 	/*
     else if (strCommand == NetMsgType::BROADCAST_VOTE)
@@ -2836,19 +3054,38 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
 	else if (strCommand == NetMsgType::PUT_VOTE)
 	{
-		std::set<CVote>  vote2s;
+		CVoteSet  vote2s;
 
 		boost::lock_guard<boost::mutex> lock{ g_vote_mutex };
 
 		vRecv >> vote2s;
 
+		if (vote2s.empty())
+			return true;
+
 		auto tmp = vote2s.begin();
 		bool ret_vv;
 
-		ret_vv = g_pDBVote->Write(tmp->block_hash, vote2s);
+		// Converted to a certificate once its block is known
+		ret_vv = g_pDBVote->WriteLegacyVotes(tmp->block_hash, vote2s);
 
 		std::cout << "[NetMsgType::PUT_VOTE] " << tmp->block_hash.GetHex() << " : " << vote2s.size() << "\n";
 	 }
+
+	else if (strCommand == NetMsgType::PUT_COMMIT)
+	{
+		CCommitCertificate cert;
+
+		vRecv >> cert;
+
+		// Checked now if we have the block, otherwise once CheckBlockVote2 gets it
+		if (!AddUnverifiedCertificate(cert, pfrom->GetId()))
+		{
+			LOCK(cs_main);
+			Misbehaving(pfrom->GetId(), 100);
+			LogPrintf("Peer %d sent us an invalid commit certificate for block %s\n", pfrom->id, cert.block_hash.ToString());
+		}
+	}
     else if (strCommand == NetMsgType::NOTFOUND) {
         // We do not care about the NOTFOUND message, but logging an Unknown Command
         // message would be undesirable as we transmit it ourselves.
@@ -3233,26 +3470,14 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
 
                     int nSendFlags = state.fWantsCmpctWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
 
-					     {
-  				  		    std::set<CVote> vote2s;
-					      bool have_vote = g_pDBVote->Read (most_recent_block_hash, vote2s);
-
-					      if (have_vote)
-      					{
-							  std::cout << "Line3244-----PUT_VOTE nnn\n";
-					         connman.PushMessage(pto, msgMaker.Make(NetMsgType::PUT_VOTE, vote2s));
-      					}
-					      else
-      					{
-					         std::cout << "2-----nnn\n";
-      					}
-   				}
-
                     bool fGotBlockFromCache = false;
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) //mgwang
 								{
+                            CCommitCertificate cert;
+                            if (GetCommitCertificate(*most_recent_block, cert))
+                                PushCommitVotes(pto, *most_recent_block, cert, connman);
                             if (state.fWantsCmpctWitness)
                                 connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
                             else {
@@ -3267,6 +3492,9 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
                         CBlock block;
                         bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
                         assert(ret);
+                        CCommitCertificate cert;
+                        if (GetCommitCertificate(block, cert))
+                            PushCommitVotes(pto, block, cert, connman);
                         CBlockHeaderAndShortTxIDs cmpctblock(block, state.fWantsCmpctWitness);
                         connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
                     }
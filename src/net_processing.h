@@ -6,9 +6,15 @@
 #ifndef BITCOIN_NET_PROCESSING_H
 #define BITCOIN_NET_PROCESSING_H
 
+#include "blockencodings.h"
 #include "net.h"
 #include "validationinterface.h"
 
+#include <map>
+
+class CValidationState;
+namespace Consensus { struct Params; };
+
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** Expiration time for orphan transactions in seconds */
@@ -48,6 +54,58 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
 
+/** What to do with a compact proposal, or with the transactions sent for one */
+enum ProposalAction {
+    PROPOSAL_IGNORE,        //!< Nothing, the proposal is pending with another peer or was not asked for
+    PROPOSAL_MISBEHAVING,   //!< Punish the sender, the data does not match the proposal
+    PROPOSAL_GETBLOCK,      //!< Ask the sender for the full proposal with put_getblock
+    PROPOSAL_GETBLOCKTXN,   //!< Ask the sender for the missing transactions with put_getbtxn
+    PROPOSAL_PROCESS,       //!< The proposal is rebuilt, hand it to the vote
+};
+
+/**
+ * Compact proposals waiting for the transactions requested from their sender.
+ * Only a proposal with a valid header takes a slot. Its sender keeps it for
+ * nTimeout seconds, after that the compact proposal of another peer takes it
+ * over. When all slots are taken the oldest one is dropped.
+ * The caller locks cs_main.
+ */
+class CPendingProposals
+{
+private:
+    struct PendingProposal {
+        NodeId nodeid;
+        int64_t nTime;
+        std::unique_ptr<PartiallyDownloadedBlock> partialBlock;
+    };
+    std::map<uint256, PendingProposal> mapPending;
+    size_t nMaxPending;
+    int64_t nTimeout;
+
+public:
+    CPendingProposals(size_t nMaxPendingIn, int64_t nTimeoutIn) : nMaxPending(nMaxPendingIn), nTimeout(nTimeoutIn) {}
+
+    /**
+     * Rebuild a compact proposal from nodeid with the transactions of pool.
+     * block is set for PROPOSAL_PROCESS, req for PROPOSAL_GETBLOCKTXN.
+     */
+    ProposalAction ReceiveCompact(const CBlockHeaderAndShortTxIDs& cmpctblock, bool fHeaderOk, NodeId nodeid, int64_t nNow, CTxMemPool* pool,
+                                  const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn, CBlock& block, BlockTransactionsRequest& req);
+    /** Finish the proposal pending with nodeid with the transactions it sent, block is set for PROPOSAL_PROCESS */
+    ProposalAction ReceiveTransactions(const BlockTransactions& resp, NodeId nodeid, CBlock& block);
+
+    /** The peer a proposal is pending with, -1 if it is not pending */
+    NodeId GetNode(const uint256& hash) const;
+    size_t Size() const { return mapPending.size(); }
+    void Erase(const uint256& hash) { mapPending.erase(hash); }
+    void EraseNode(NodeId nodeid);
+};
+
+/** Whether a proposal builds on a block we know and has a valid header, requires cs_main */
+bool CheckProposalHeader(const CBlockHeader& header, const Consensus::Params& consensusParams, CValidationState& state);
+/** Whether the vote is for a proposal, however it reached us: against one with a bad header or failing CheckBlock */
+bool CheckProposal(const CBlock& block, const Consensus::Params& consensusParams);
+
 /** Process protocol messages received from a given node */
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interrupt);
 /**
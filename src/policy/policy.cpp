@@ -40,7 +40,6 @@
      *   DUP CHECKSIG DROP ... repeated 100 times... OP_1
      */
 
-extern CTxMemPool mempool;
 bool IsStandard(const CScript& scriptPubKey, txnouttype& whichType, const bool witnessEnabled)
 {
     std::vector<std::vector<unsigned char> > vSolutions;
@@ -166,7 +165,7 @@ bool AreInputsStandard(const CTransaction& tx, const CCoinsViewCache& mapInputs)
 
 //Check the subfunctions of the model type constraints of the output trading model
 bool IsValidIPCModelCheck(const CTransaction& tx, std::map<uint128, IPCLabel>& InOwnerRecord, std::map<uint128, std::pair<CScript, IPCLabel> >& InAuthorRecord,
-	std::map<uint128, IPCLabel>& OutOwnerRecord, std::map<uint128, IPCLabel>& OutUniqueRecord, std::multimap<uint128, std::pair<CScript, IPCLabel> >& OutAuthorRecord, CValidationState& state)
+	std::map<uint128, IPCLabel>& OutOwnerRecord, std::map<uint128, IPCLabel>& OutUniqueRecord, std::multimap<uint128, std::pair<CScript, IPCLabel> >& OutAuthorRecord, const CIPCUniqueView& uniques, CValidationState& state)
 {
 	std::map<uint128, IPCLabel>::iterator ipcTxIteator;
 	std::map<uint128, std::pair<CScript, IPCLabel> >::iterator ipcInAuthorIteator;
@@ -258,8 +257,8 @@ bool IsValidIPCModelCheck(const CTransaction& tx, std::map<uint128, IPCLabel>& I
 			InOwnerRecord.count(ipcTxIteator->first) == 0)
 		{
 			//For ownership registration transactions, there is no duplication of registration, and txid has different hash values for this transaction
-			if (pIPCCheckMaps->IPCHashMap.count(ipcTxIteator->first) &&
-				pIPCCheckMaps->IPCHashMap[ipcTxIteator->first].first != tx.GetHash())
+			uint256 owner;
+			if (uniques.GetOwner(CIPCUniqueKey::IPCHash(ipcTxIteator->first), owner) && owner != tx.GetHash())
 			{
 				return state.DoS(100, false, REJECT_INVALID, "bad-IPC-IPChash-repeat");
 			}
@@ -547,54 +546,42 @@ bool addTokenClassCompare(const AddTokenLabel& token1, const AddTokenLabel& toke
 	}
 	return true;
 }
+//Accuracy the chain gives to symbol, 0 if no transaction created it yet
+static uint8_t GetTokenAccuracy(const CTokenView& tokens, const std::string& symbol)
+{
+	CTokenRecord record;
+	if (!tokens.GetToken(symbol, record))
+		return 0;
+	return record.getAccuracy();
+}
+
 bool manualIssuancStandard(const CTxOut& txout, CValidationState &state,
-	uint64_t& currentTotalAmount, std::map<std::string,TokenReg>& tokenDataMaptemp,
-	std::string txid, int32_t voutIndex, std::string address, bool &txHaveChecked)
+	uint64_t& currentTotalAmount, const CTokenView& tokens,
+	const COutPoint& out, std::string address, bool &txHaveChecked)
 {
-	auto itor = tokenDataMaptemp.find(txout.addTokenLabel.getTokenSymbol());
-	std::cout << "manualIssuancStandard getTokenSymbol:" << txout.addTokenLabel.getTokenSymbol() << std::endl;
-	if (itor != tokenDataMaptemp.end()){
-		std::cout << "manualIssuancStandard in" << std::endl;
-		if (itor->second.m_tokentype == 4){
-			return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenDataMap-repeat");
-		}
-		else if (itor->second.m_tokentype == TXOUT_ADDTOKEN){
-			if (itor->second.m_addTokenLabel.size() > 0){
-				AddTokenReg &addTokenLabel0 = itor->second.m_addTokenLabel[0];
-				if (!addTokenClassCompare(addTokenLabel0.m_addTokenLabel, txout.addTokenLabel)){
-					return state.DoS(100, false, REJECT_INVALID, "bad-Token-addTokenClassCompare");
-				}
-				if (addTokenLabel0.m_txid == txid &&addTokenLabel0.m_vout == voutIndex){
-					txHaveChecked = true;
-					return true;
-					//return state.DoS(100, false, REJECT_INVALID, "bad-Token-txvout-repeat");
-				}
-				if (addTokenLabel0.address != address){
-					return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenregaddress-notsame");
-				}
-				
-				std::cout << "m_addTokenLabel in" << std::endl;
-				auto temp=itor->second.m_addTokenLabel.begin();
-				while (temp != itor->second.m_addTokenLabel.end())
-				{
-					std::cout << "m_addTokenLabel ++" << temp->m_addTokenLabel.currentCount << std::endl;
-					currentTotalAmount += temp->m_addTokenLabel.currentCount;
-					temp++;
-				}
-			}
-			else
-				return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenDataMap-error");
-		}
-		else{
-			std::cout << " tokentype : " << itor->second.m_tokentype << std::endl;
-			return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenDataMap-tokentype");
-		}
+	CTokenRecord record;
+	if (!tokens.GetToken(txout.GetAddTokenLabel().getTokenSymbol(), record))
+		return true;
+	if (record.nType == TXOUT_TOKENREG)
+		return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenDataMap-repeat");
+	if (record.nType != TXOUT_ADDTOKEN)
+		return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenDataMap-tokentype");
+
+	if (!addTokenClassCompare(record.firstIssue.m_addTokenLabel, txout.GetAddTokenLabel()))
+		return state.DoS(100, false, REJECT_INVALID, "bad-Token-addTokenClassCompare");
+	//An issuance the chain already counted is not checked against the total again
+	if (tokens.HaveIssue(out)){
+		txHaveChecked = true;
+		return true;
 	}
-	std::cout << "manualIssuancStandard end" << std::endl;
+	if (record.firstIssue.address != address)
+		return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenregaddress-notsame");
+
+	currentTotalAmount = record.nIssued;
 	return true;
 }
 
-bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
+bool AreIPCStandard(const CTransaction& tx, CValidationState &state, const CCoinsViewCache& inputs, const CIPCUniqueView& uniques, const CTokenView& tokens)
 {
 
 	if (tx.IsCoinBase())
@@ -606,7 +593,7 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 	txnouttype type;
 	std::vector<CTxDestination> txoutdestes;
 	int nRequired;
-	std::vector<std::string> txindestes;
+	std::vector<CTxDestination> txindestes;
 	BOOST_FOREACH(const CTxOut& txout, tx.vout) {
 		//Parse the output address of txout
 		if (!ExtractDestinations(txout.scriptPubKey, type, txoutdestes, nRequired))
@@ -614,7 +601,7 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 
 		if (txout.txType != TXOUT_CAMPAIGN){
 			BOOST_FOREACH(CTxDestination &dest, txoutdestes){
-				if (Params().system_account_address == CBitcoinAddress(dest).ToString())
+				if (Params().IsSystemAccount(dest))
 					return state.DoS(100, false, REJECT_INVALID, "send-to-system-address-forbidden");
 			}
 		}
@@ -627,8 +614,8 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 	std::map<uint128, IPCLabel> ipcInOwnerRecord; //The ipc hash tag is the keyword, recording the type of ownership in the input, and the label.
 	std::map<uint128, std::pair<CScript, IPCLabel> > ipcInAuthorRecord; //With ipc hash tag as the keyword, record the authorization type in the input with its tag.
 
-	CTransactionRef prevTx;
-	uint256 hashBlock;
+	//The outputs spent by tx, resolved once from the caller's view and reused by the output checks
+	std::vector<const CTxOut*> vPrevOuts(tx.vin.size());
 
 	bool token4 = false;
 	bool token6 = false;
@@ -637,49 +624,21 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 	int tokeninCount = 0;
 	CAmount totalvintvalues = 0;
 	uint8_t fatheruraccy = 10; //The legal value can't be 10
-	CCoinsView dummy;
-	CCoinsViewCache view(&dummy);
-
 
 	for (unsigned int i = 0; i < tx.vin.size(); i++)
 	{	
-		{
-			LOCK(mempool.cs);
-			CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
-			view.SetBackend(viewMemPool);
+		const CCoins* coins = inputs.AccessCoins(tx.vin[i].prevout.hash);
+		if (!coins || !coins->IsAvailable(tx.vin[i].prevout.n))
+			return state.DoS(100, false, REJECT_INVALID, "bad-no-input");
 
-		}
-		CTxOut prev;
-		const CCoins* coins = view.AccessCoins(tx.vin[i].prevout.hash);
-		if (coins && coins->IsAvailable(tx.vin[i].prevout.n))
-		{
-			const CTxOut &prevv = coins->vout[tx.vin[i].prevout.n];
-			prev = prevv;
-			if (prev.txType == TXOUT_TOKENREG)//Tokens to register
-				fatheruraccy = prev.tokenRegLabel.accuracy;
-			else if (prev.txType == TXOUT_ADDTOKEN)//Tokens to register
-				fatheruraccy = prev.addTokenLabel.accuracy;
-
-			totalvintvalues += prev.nValue;
-		}
-		else{
-			if (!GetTransaction(tx.vin[i].prevout.hash, prevTx, Params().GetConsensus(), hashBlock, true))
-			{
-				//If the parent trades in the same block
-				if (!GetCachedChainTransaction(tx.vin[i].prevout.hash, prevTx))
-				{
-					return state.DoS(100, false, REJECT_INVALID, "bad-no-input");
-				}
-			}
-			const CTxOut &prevv = prevTx->vout[tx.vin[i].prevout.n];
-			prev = prevv;
-			if (prev.txType == TXOUT_TOKENREG)//Tokens to register
-				fatheruraccy = prev.tokenRegLabel.accuracy;
-			else if (prev.txType == TXOUT_ADDTOKEN)//Tokens to register
-				fatheruraccy = prev.addTokenLabel.accuracy;
-
-			totalvintvalues += prev.nValue;
-		}
+		const CTxOut &prev = coins->vout[tx.vin[i].prevout.n];
+		vPrevOuts[i] = &prev;
+		if (prev.txType == TXOUT_TOKENREG)//Tokens to register
+			fatheruraccy = prev.GetTokenRegLabel().accuracy;
+		else if (prev.txType == TXOUT_ADDTOKEN)//Tokens to register
+			fatheruraccy = prev.GetAddTokenLabel().accuracy;
+
+		totalvintvalues += prev.nValue;
 
 
 	
@@ -688,9 +647,9 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			return state.DoS(100, false, REJECT_INVALID, "txin-address-unextracted,type=" + type);
 
 		BOOST_FOREACH(CTxDestination &dest, txoutdestes){
-			if (Params().system_account_address == CBitcoinAddress(dest).ToString())
+			if (Params().IsSystemAccount(dest))
 				return state.DoS(100, false, REJECT_INVALID, "cost-from-systemaccount-forbidden");
-			txindestes.push_back(CBitcoinAddress(dest).ToString());
+			txindestes.push_back(dest);
 		}
 		if (prev.txLabelLen > TXLABLE_MAX_LENGTH - 1)  //More than 511, txLabelLen shows the incorrect length
 			return state.DoS(100, false, REJECT_INVALID, "Vin-txLabelLen-erro");
@@ -701,19 +660,11 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 		switch (prev.txType)
 		{
 		case 1:	
-			if (prev.devoteLabel.ExtendType != TYPE_CONSENSUS_REGISTER)
+			if (prev.GetDevoteLabel().ExtendType != TYPE_CONSENSUS_REGISTER)
 			{
 				return state.DoS(100, false, REJECT_INVALID, "bad-campaign-input");
 			}
-			if (!GetTransaction(tx.vin[i].prevout.hash, prevTx, Params().GetConsensus(), hashBlock, true))
-			{
-				//If the parent trades in the same block
-				if (!GetCachedChainTransaction(tx.vin[i].prevout.hash, prevTx))
-				{
-					return state.DoS(100, false, REJECT_INVALID, "bad-no-input");
-				}
-			}
-			if (!CConsensusAccountPool::Instance().IsAviableUTXO(prevTx->GetHash()))    //After the application to join utxo (deposit), then determine whether this txid is defrosted.
+			if (!CConsensusAccountPool::Instance().IsAviableUTXO(tx.vin[i].prevout.hash))    //After the application to join utxo (deposit), then determine whether this txid is defrosted.
 			{
 				LogPrintf("txhash :%s  , vin[%d] ---bad-campaign-input,UTXO-is-unusable.\n",tx.GetHash().ToString(),i);
 				return false;
@@ -727,19 +678,19 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			
 			if (prev.labelLen > 255)
 				return state.DoS(100, false, REJECT_INVALID, "Vin2-IPCLabel-length-out-of-bounds");
-			if (prev.ipcLabel.size() != prev.labelLen)
+			if (prev.GetIPCLabel().size() != prev.labelLen)
 				return state.DoS(100, false, REJECT_INVALID, "Vin2-IPCLabel-length-not-feet-labelLen");
 			
-			if (prev.ipcLabel.startTime != 0 && prev.ipcLabel.startTime > chainActive.Tip()->GetBlockTime())
+			if (prev.GetIPCLabel().startTime != 0 && prev.GetIPCLabel().startTime > chainActive.Tip()->GetBlockTime())
 				return state.DoS(100, false, REJECT_INVALID, "IPC-owner-starttime-is-up-yet");
 			
-			if (ipcInOwnerRecord.count(prev.ipcLabel.hash) > 0)
+			if (ipcInOwnerRecord.count(prev.GetIPCLabel().hash) > 0)
 				return state.DoS(100, false, REJECT_INVALID, "multi-IPC-ownership-in-with-same-hash");
 			
-			if (ipcInAuthorRecord.count(prev.ipcLabel.hash) > 0)
+			if (ipcInAuthorRecord.count(prev.GetIPCLabel().hash) > 0)
 				return state.DoS(100, false, REJECT_INVALID, "multi-IPC-authorization-and-ownership-in-with-same-hash");
 
-			ipcInOwnerRecord[prev.ipcLabel.hash] = prev.ipcLabel; 
+			ipcInOwnerRecord[prev.GetIPCLabel().hash] = prev.GetIPCLabel(); 
 			IPCinCount++;
 			break;
 
@@ -750,19 +701,19 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			
 			if (prev.labelLen > 255)
 				return state.DoS(100, false, REJECT_INVALID, "Vin3-IPCLabel-length-out-of-bounds");
-			if (prev.ipcLabel.size() != prev.labelLen)
+			if (prev.GetIPCLabel().size() != prev.labelLen)
 				return state.DoS(100, false, REJECT_INVALID, "Vin3-IPCLabel-length-not-feet-labelLen");
 			
-			if (prev.ipcLabel.startTime != 0 && prev.ipcLabel.startTime > chainActive.Tip()->GetBlockTime())
+			if (prev.GetIPCLabel().startTime != 0 && prev.GetIPCLabel().startTime > chainActive.Tip()->GetBlockTime())
 				return state.DoS(100, false, REJECT_INVALID, "IPC-Author-starttime-is-up-yet");
 			
-			if (ipcInOwnerRecord.count(prev.ipcLabel.hash) > 0)
+			if (ipcInOwnerRecord.count(prev.GetIPCLabel().hash) > 0)
 				return state.DoS(100, false, REJECT_INVALID, "multi-IPC-ownership-in-with-same-hash");
 			
-			if (ipcInAuthorRecord.count(prev.ipcLabel.hash) > 0)
+			if (ipcInAuthorRecord.count(prev.GetIPCLabel().hash) > 0)
 				return state.DoS(100, false, REJECT_INVALID, "multi-IPC-authorization-and-ownership-in-with-same-hash");
 
-			ipcInAuthorRecord[prev.ipcLabel.hash] = std::make_pair(prev.scriptPubKey, prev.ipcLabel);
+			ipcInAuthorRecord[prev.GetIPCLabel().hash] = std::make_pair(prev.scriptPubKey, prev.GetIPCLabel());
 			IPCinCount++;
 			break;
 
@@ -771,18 +722,18 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (prev.nValue != 0)
 				return state.DoS(100, false, REJECT_INVALID, "Vin4-IPC-nValue-must-be-zero");
 			
-			if (tokenInRegRecord.count(prev.tokenRegLabel.getTokenSymbol()) > 0)
+			if (tokenInRegRecord.count(prev.GetTokenRegLabel().getTokenSymbol()) > 0)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Symbol-repeat");
 			
-			if (prev.tokenRegLabel.issueDate != 0 && prev.tokenRegLabel.issueDate > chainActive.Tip()->GetBlockTime())
+			if (prev.GetTokenRegLabel().issueDate != 0 && prev.GetTokenRegLabel().issueDate > chainActive.Tip()->GetBlockTime())
 				return state.DoS(100, false, REJECT_INVALID, "Token-reg-starttime-is-up-yet");
 			
-			if (prev.tokenRegLabel.accuracy != tokenDataMap[prev.tokenRegLabel.getTokenSymbol()].getAccuracy() && fatheruraccy != prev.tokenRegLabel.accuracy)
+			if (prev.GetTokenRegLabel().accuracy != GetTokenAccuracy(tokens, prev.GetTokenRegLabel().getTokenSymbol()) && fatheruraccy != prev.GetTokenRegLabel().accuracy)
 			{
 				return state.DoS(100, false, REJECT_INVALID, "Vin-Token-accuracy-error");
 			}
 				
-			tokenInRegRecord[prev.tokenRegLabel.getTokenSymbol()] = prev.tokenRegLabel.totalCount;
+			tokenInRegRecord[prev.GetTokenRegLabel().getTokenSymbol()] = prev.GetTokenRegLabel().totalCount;
 			tokeninCount++;
 			token4 = true;
 			break;
@@ -792,18 +743,18 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (prev.nValue != 0)
 				return state.DoS(100, false, REJECT_INVALID, "Vin5-IPC-nValue-must-be-zero");
 		
-			if (prev.tokenLabel.accuracy != tokenDataMap[prev.tokenLabel.getTokenSymbol()].getAccuracy())
+			if (prev.GetTokenLabel().accuracy != GetTokenAccuracy(tokens, prev.GetTokenLabel().getTokenSymbol()))
 				return state.DoS(100, false, REJECT_INVALID, "Vin-Token-accuracy-error");
 
-			if (tokenInRecord.count(prev.tokenLabel.getTokenSymbol()) > 0)
+			if (tokenInRecord.count(prev.GetTokenLabel().getTokenSymbol()) > 0)
 			{
-				tokenTxInputTotalValue = tokenInRecord[prev.tokenLabel.getTokenSymbol()];
-				tokenTxInputTotalValue += prev.tokenLabel.value;
-				tokenInRecord[prev.tokenLabel.getTokenSymbol()] = tokenTxInputTotalValue;
+				tokenTxInputTotalValue = tokenInRecord[prev.GetTokenLabel().getTokenSymbol()];
+				tokenTxInputTotalValue += prev.GetTokenLabel().value;
+				tokenInRecord[prev.GetTokenLabel().getTokenSymbol()] = tokenTxInputTotalValue;
 			}
 			else
 			{
-				tokenInRecord[prev.tokenLabel.getTokenSymbol()] = prev.tokenLabel.value;
+				tokenInRecord[prev.GetTokenLabel().getTokenSymbol()] = prev.GetTokenLabel().value;
 			}
 
 			tokeninCount++;
@@ -813,30 +764,30 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (prev.nValue != 0)
 				return state.DoS(100, false, REJECT_INVALID, "Vin6-IPC-nValue-must-be-zero");
 
-		//	if (tokenInRegRecord.count(prev.addTokenLabel.getTokenSymbol()) > 0)
+		//	if (tokenInRegRecord.count(prev.GetAddTokenLabel().getTokenSymbol()) > 0)
 		//		return state.DoS(100, false, REJECT_INVALID, "bad-Token-Symbol-repeat");
 
-			if (prev.addTokenLabel.issueDate != 0 && prev.addTokenLabel.issueDate > chainActive.Tip()->GetBlockTime())
+			if (prev.GetAddTokenLabel().issueDate != 0 && prev.GetAddTokenLabel().issueDate > chainActive.Tip()->GetBlockTime())
 				return state.DoS(100, false, REJECT_INVALID, "Token-reg-starttime-is-up-yet");
-			if (prev.addTokenLabel.height > chainActive.Height())
+			if (prev.GetAddTokenLabel().height > chainActive.Height())
 				return state.DoS(100, false, REJECT_INVALID, "Token-reg-height-is-up-yet");
 
-			if (prev.addTokenLabel.accuracy != tokenDataMap[prev.addTokenLabel.getTokenSymbol()].getAccuracy() && fatheruraccy != prev.addTokenLabel.accuracy)
+			if (prev.GetAddTokenLabel().accuracy != GetTokenAccuracy(tokens, prev.GetAddTokenLabel().getTokenSymbol()) && fatheruraccy != prev.GetAddTokenLabel().accuracy)
 			{
 				return state.DoS(100, false, REJECT_INVALID, "Vin-Token-accuracy-error");
 			}
 
-			//tokenInRegRecord[prev.addTokenLabel.getTokenSymbol()] = prev.addTokenLabel.currentCount;
+			//tokenInRegRecord[prev.GetAddTokenLabel().getTokenSymbol()] = prev.GetAddTokenLabel().currentCount;
 
-			if (tokenInRegRecord.count(prev.addTokenLabel.getTokenSymbol()) > 0)
+			if (tokenInRegRecord.count(prev.GetAddTokenLabel().getTokenSymbol()) > 0)
 			{
-				uint64_t tokenTxInputTotalValue = tokenInRegRecord[prev.addTokenLabel.getTokenSymbol()];
-				tokenTxInputTotalValue += prev.addTokenLabel.currentCount;
-				tokenInRegRecord[prev.addTokenLabel.getTokenSymbol()] = tokenTxInputTotalValue;
+				uint64_t tokenTxInputTotalValue = tokenInRegRecord[prev.GetAddTokenLabel().getTokenSymbol()];
+				tokenTxInputTotalValue += prev.GetAddTokenLabel().currentCount;
+				tokenInRegRecord[prev.GetAddTokenLabel().getTokenSymbol()] = tokenTxInputTotalValue;
 			}
 			else
 			{
-				tokenInRegRecord[prev.addTokenLabel.getTokenSymbol()] = prev.addTokenLabel.currentCount;
+				tokenInRegRecord[prev.GetAddTokenLabel().getTokenSymbol()] = prev.GetAddTokenLabel().currentCount;
 			}
 
 			token6 = true;
@@ -862,13 +813,9 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 	std::map<uint128, IPCLabel> ipcOutUniqueRecord; //A MAP that records exclusive authorization.
 	std::multimap<uint128, std::pair<CScript,IPCLabel>> ipcOutAuthorRecord; //Multiple authorization outputs are allowed, and many different situations and values are required for each authorization output, so you need to bring an output public key address to distinguish multiple authorized outputs.
 
-	CBitcoinAddress address(Params().system_account_address);
-	CScript scriptSystem = GetScriptForDestination(address.Get());
 	CScript tmpscript;
 	uint160 devoterhash;
 
-	CTxOut prev;
-
 	int IPCoutCount = 0;
 	int devoteoutCount = 0;
 	int tokenoutCount = 0;
@@ -877,7 +824,8 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 	
 	int addtokenmodel = -1;
 	std::vector<CTxDestination> prevdestes;
-	std::string curaddress;
+	CTxDestination curdest;
+	uint256 owner; //Transaction that registered a token symbol or hash
 	CAmount totalvoutvalues = 0;
 	for (uint32_t voutIndex = 0; voutIndex < tx.vout.size(); voutIndex++) {
 		const CTxOut& txout = tx.vout[voutIndex];
@@ -891,31 +839,24 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 		{
 		case 1:
 
-			if (txout.devoteLabel.ExtendType == TYPE_CONSENSUS_QUITE)
+			if (txout.GetDevoteLabel().ExtendType == TYPE_CONSENSUS_QUITE)
 			{
 
 				bool founded = false;
 				for (unsigned int i = 0; i < tx.vin.size(); i++)
 				{
 					founded = false;
-					if (!GetTransaction(tx.vin[i].prevout.hash, prevTx, Params().GetConsensus(), hashBlock, true))
-					{
-						if (!GetCachedChainTransaction(tx.vin[i].prevout.hash, prevTx))
-						{
-							return state.DoS(100, false, REJECT_INVALID, "bad-no-input");
-						}
-					}
-					prev = prevTx->vout[tx.vin[i].prevout.n];
-					devoterhash = txout.devoteLabel.hash;
+					const CTxOut &prev = *vPrevOuts[i];
+					devoterhash = txout.GetDevoteLabel().hash;
 
 					//Gets the address from the current hash value
-					curaddress = CBitcoinAddress(CKeyID(devoterhash)).ToString();
+					curdest = CKeyID(devoterhash);
 					//Restore CTXDestination from the prevout script
 					if (!ExtractDestinations(prev.scriptPubKey, type, prevdestes, nRequired))
 						return state.DoS(100, false, REJECT_INVALID, "exit-campaign-prevout-Unextracted,type=" + type);
 
 					BOOST_FOREACH(CTxDestination &prevdest, prevdestes){
-						if (curaddress == CBitcoinAddress(prevdest).ToString())
+						if (curdest == prevdest)
 						{
 							founded = true;
 							break;
@@ -929,7 +870,7 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 
 
 			}
-			else if (txout.devoteLabel.ExtendType != TYPE_CONSENSUS_REGISTER && txout.devoteLabel.ExtendType != TYPE_CONSENSUS_SEVERE_PUNISHMENT_REQUEST)
+			else if (txout.GetDevoteLabel().ExtendType != TYPE_CONSENSUS_REGISTER && txout.GetDevoteLabel().ExtendType != TYPE_CONSENSUS_SEVERE_PUNISHMENT_REQUEST)
 				return state.DoS(100, false, REJECT_INVALID, "construct-other-campaign-tx-forbidden");
 
 			devoteoutCount++;
@@ -941,37 +882,37 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (txout.labelLen > 255)
 				return state.DoS(100, false, REJECT_INVALID, "Vout2-IPCLabel-length-out-of-bounds");
 
-			if (txout.ipcLabel.size() != txout.labelLen)
+			if (txout.GetIPCLabel().size() != txout.labelLen)
 				return state.DoS(100, false, REJECT_INVALID, "Vout2-IPCLabel-length-not-feet-labelLen");
 
-			if (txout.ipcLabel.hash.GetHex().length() != 32)
+			if (txout.GetIPCLabel().hash.GetHex().length() != 32)
 				return state.DoS(100, false, REJECT_INVALID, "Vout2-IPCHash-length-must-be-32");
 
-			if (ipcOutOwnerRecord.count(txout.ipcLabel.hash) > 0)
+			if (ipcOutOwnerRecord.count(txout.GetIPCLabel().hash) > 0)
 				return state.DoS(100, false, REJECT_INVALID, "multi-IPC-ownership-output");
 
-			if (txout.ipcLabel.hash.IsNull())
+			if (txout.GetIPCLabel().hash.IsNull())
 				return state.DoS(100, false, REJECT_INVALID, "IPC-ownership-hash-can't-be-NULL");
-			if (txout.ipcLabel.stopTime != 0 && txout.ipcLabel.startTime >= txout.ipcLabel.stopTime)
+			if (txout.GetIPCLabel().stopTime != 0 && txout.GetIPCLabel().startTime >= txout.GetIPCLabel().stopTime)
 				return state.DoS(100, false, REJECT_INVALID, "IPC-ownership-starttime-can't-larger-than-stoptime");
 
-			if ((txout.ipcLabel.reAuthorize != 0 && txout.ipcLabel.reAuthorize != 1) ||
-				(txout.ipcLabel.uniqueAuthorize != 0 && txout.ipcLabel.uniqueAuthorize != 1))
+			if ((txout.GetIPCLabel().reAuthorize != 0 && txout.GetIPCLabel().reAuthorize != 1) ||
+				(txout.GetIPCLabel().uniqueAuthorize != 0 && txout.GetIPCLabel().uniqueAuthorize != 1))
 				return state.DoS(100, false, REJECT_INVALID, "IPCLabel-reAuthorize-or-uniqueAuthorize-out-of-bounds");
 
-			if (ipcInOwnerRecord.count(txout.ipcLabel.hash) > 0)
+			if (ipcInOwnerRecord.count(txout.GetIPCLabel().hash) > 0)
 			{
-				if (ipcInOwnerRecord[txout.ipcLabel.hash].hash != txout.ipcLabel.hash ||
-					ipcInOwnerRecord[txout.ipcLabel.hash].ExtendType != txout.ipcLabel.ExtendType ||
-					ipcInOwnerRecord[txout.ipcLabel.hash].labelTitle != txout.ipcLabel.labelTitle)
+				if (ipcInOwnerRecord[txout.GetIPCLabel().hash].hash != txout.GetIPCLabel().hash ||
+					ipcInOwnerRecord[txout.GetIPCLabel().hash].ExtendType != txout.GetIPCLabel().ExtendType ||
+					ipcInOwnerRecord[txout.GetIPCLabel().hash].labelTitle != txout.GetIPCLabel().labelTitle)
 					return state.DoS(100, false, REJECT_INVALID, "bad-IPC-send-or-rethorize-output(hash/ExtendType/labelTitle)");
 
 
-				if (ipcInOwnerRecord[txout.ipcLabel.hash].reAuthorize != txout.ipcLabel.reAuthorize)
+				if (ipcInOwnerRecord[txout.GetIPCLabel().hash].reAuthorize != txout.GetIPCLabel().reAuthorize)
 					return state.DoS(100, false, REJECT_INVALID, "bad-IPC-send-or-rethorize-output(reAuthorize)");
 
 			}
-			ipcOutOwnerRecord[txout.ipcLabel.hash] = txout.ipcLabel;
+			ipcOutOwnerRecord[txout.GetIPCLabel().hash] = txout.GetIPCLabel();
 			IPCoutCount++;
 			break;
 
@@ -982,41 +923,41 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (txout.labelLen > 255)
 				return state.DoS(100, false, REJECT_INVALID, "Vout3-IPCLabel-length-out-of-bounds");
 
-			if (txout.ipcLabel.size() != txout.labelLen)
+			if (txout.GetIPCLabel().size() != txout.labelLen)
 				return state.DoS(100, false, REJECT_INVALID, "Vout3-IPCLabel-length-not-feet-labelLen");
 
-			if (txout.ipcLabel.hash.GetHex().length() != 32)
+			if (txout.GetIPCLabel().hash.GetHex().length() != 32)
 				return state.DoS(100, false, REJECT_INVALID, "Vout3-IPCHash-length-must-be-32");
 
-			if (txout.ipcLabel.startTime == 0 || txout.ipcLabel.stopTime == 0)
+			if (txout.GetIPCLabel().startTime == 0 || txout.GetIPCLabel().stopTime == 0)
 				return state.DoS(100, false, REJECT_INVALID, "bad-IPC-author-time");
 
 
-			if ((txout.ipcLabel.reAuthorize != 0 && txout.ipcLabel.reAuthorize != 1) ||
-				(txout.ipcLabel.uniqueAuthorize != 0 && txout.ipcLabel.uniqueAuthorize != 1))
+			if ((txout.GetIPCLabel().reAuthorize != 0 && txout.GetIPCLabel().reAuthorize != 1) ||
+				(txout.GetIPCLabel().uniqueAuthorize != 0 && txout.GetIPCLabel().uniqueAuthorize != 1))
 				return state.DoS(100, false, REJECT_INVALID, "IPCLabel-reAuthorize-or-uniqueAuthorize-out-of-bounds");
 
-			if (ipcInOwnerRecord.count(txout.ipcLabel.hash) > 0)
+			if (ipcInOwnerRecord.count(txout.GetIPCLabel().hash) > 0)
 			{
-				if (ipcInOwnerRecord[txout.ipcLabel.hash].hash != txout.ipcLabel.hash ||
-					ipcInOwnerRecord[txout.ipcLabel.hash].ExtendType != txout.ipcLabel.ExtendType ||
-					ipcInOwnerRecord[txout.ipcLabel.hash].labelTitle != txout.ipcLabel.labelTitle)
+				if (ipcInOwnerRecord[txout.GetIPCLabel().hash].hash != txout.GetIPCLabel().hash ||
+					ipcInOwnerRecord[txout.GetIPCLabel().hash].ExtendType != txout.GetIPCLabel().ExtendType ||
+					ipcInOwnerRecord[txout.GetIPCLabel().hash].labelTitle != txout.GetIPCLabel().labelTitle)
 					return state.DoS(100, false, REJECT_INVALID, "bad-IPC-Authorize-output(hash/ExtendType/labelTitle)");
 			}
 
 
-			if (txout.ipcLabel.uniqueAuthorize == 1)
+			if (txout.GetIPCLabel().uniqueAuthorize == 1)
 			{
 				//moddify by xxy 20171216  Exclusive license notes
 				// 				//There can only be one exclusive authorized output in the same transaction
-				// 				if (ipcOutUniqueRecord.count(txout.ipcLabel.hash) > 0)
+				// 				if (ipcOutUniqueRecord.count(txout.GetIPCLabel().hash) > 0)
 				// 					return state.DoS(100, false, REJECT_INVALID, "bad-IPC-multi-uniqueAuthor-output");
 				// 
-				// 				ipcOutUniqueRecord[txout.ipcLabel.hash] = txout.ipcLabel;
+				// 				ipcOutUniqueRecord[txout.GetIPCLabel().hash] = txout.GetIPCLabel();
 				//end moddify
 			}
 			else
-				ipcOutAuthorRecord.insert(std::make_pair(txout.ipcLabel.hash, std::make_pair(txout.scriptPubKey, txout.ipcLabel)));
+				ipcOutAuthorRecord.insert(std::make_pair(txout.GetIPCLabel().hash, std::make_pair(txout.scriptPubKey, txout.GetIPCLabel())));
 
 			IPCoutCount++;
 			break;
@@ -1026,42 +967,40 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (txout.nValue != 0)
 				return state.DoS(100, false, REJECT_INVALID, "Vout4-Token-nValue-must-be-zero");
 
-			checkStr = txout.tokenRegLabel.getTokenSymbol();
+			checkStr = txout.GetTokenRegLabel().getTokenSymbol();
 			boost::to_upper(checkStr);
 			if (checkStr.find("IPC") != std::string::npos || checkStr.find("RMB") != std::string::npos
 				|| checkStr.find("USD") != std::string::npos || checkStr.find("EUR") != std::string::npos)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Symbol-contain-errvalue");
-			checkStr = txout.tokenRegLabel.getTokenLabel();
+			checkStr = txout.GetTokenRegLabel().getTokenLabel();
 			boost::to_upper(checkStr);
 			if (checkStr.find("IPC") != std::string::npos || checkStr.find("RMB") != std::string::npos
 				|| checkStr.find("USD") != std::string::npos || checkStr.find("EUR") != std::string::npos)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Label-contain-errvalue");
 
-			if (txout.tokenRegLabel.hash.GetHex().length() != 32)
+			if (txout.GetTokenRegLabel().hash.GetHex().length() != 32)
 				return state.DoS(100, false, REJECT_INVALID, "Vout4-Hash-length-must-be-32");
 
-			if (txout.tokenRegLabel.issueDate < TOKEN_REGTIME_BOUNDARY)
+			if (txout.GetTokenRegLabel().issueDate < TOKEN_REGTIME_BOUNDARY)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-issueDate(Regtime)");
 
-			if (txout.tokenRegLabel.accuracy < 0 || txout.tokenRegLabel.accuracy > 8)
+			if (txout.GetTokenRegLabel().accuracy < 0 || txout.GetTokenRegLabel().accuracy > 8)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-accuracy(must be 0-8)");
 
-			if (txout.tokenRegLabel.totalCount > TOKEN_MAX_VALUE)
+			if (txout.GetTokenRegLabel().totalCount > TOKEN_MAX_VALUE)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-totalCount");
 
-			if (pIPCCheckMaps->TokenSymbolMap.count(txout.tokenRegLabel.getTokenSymbol()) > 0 &&
-				pIPCCheckMaps->TokenSymbolMap[txout.tokenRegLabel.getTokenSymbol()].first != tx.GetHash())
+			if (uniques.GetOwner(CIPCUniqueKey::TokenSymbol(txout.GetTokenRegLabel().getTokenSymbol()), owner) && owner != tx.GetHash())
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokensymbol-repeat");
 
-			if (pIPCCheckMaps->TokenHashMap.count(txout.tokenRegLabel.hash) > 0 &&
-				pIPCCheckMaps->TokenHashMap[txout.tokenRegLabel.hash].first != tx.GetHash())
+			if (uniques.GetOwner(CIPCUniqueKey::TokenHash(txout.GetTokenRegLabel().hash), owner) && owner != tx.GetHash())
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenhash-repeat");
 
 
-			if (tokenOutRegRecord.count(txout.tokenRegLabel.getTokenSymbol()) > 0)
+			if (tokenOutRegRecord.count(txout.GetTokenRegLabel().getTokenSymbol()) > 0)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokensymbol-repeat");
 
-			tokenOutRegRecord[txout.tokenRegLabel.getTokenSymbol()] = txout.tokenRegLabel.totalCount;
+			tokenOutRegRecord[txout.GetTokenRegLabel().getTokenSymbol()] = txout.GetTokenRegLabel().totalCount;
 			token4 = true;
 			tokenoutCount++;
 			break;
@@ -1071,13 +1010,13 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (txout.nValue != 0)
 				return state.DoS(100, false, REJECT_INVALID, "Vout5-Token-nValue-must-be-zero");
 
-			if (txout.tokenLabel.accuracy < 0 || txout.tokenLabel.accuracy > 8)
+			if (txout.GetTokenLabel().accuracy < 0 || txout.GetTokenLabel().accuracy > 8)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-accuracy(must be 0-8)");
 
-			if (txout.tokenLabel.accuracy != tokenDataMap[txout.tokenLabel.getTokenSymbol()].getAccuracy() && fatheruraccy != txout.tokenLabel.accuracy)
+			if (txout.GetTokenLabel().accuracy != GetTokenAccuracy(tokens, txout.GetTokenLabel().getTokenSymbol()) && fatheruraccy != txout.GetTokenLabel().accuracy)
 				return state.DoS(100, false, REJECT_INVALID, "Vout-Token-accuracy-error");
 
-			checkStr = txout.tokenLabel.getTokenSymbol();
+			checkStr = txout.GetTokenLabel().getTokenSymbol();
 			boost::to_upper(checkStr);
 			if (checkStr.find("IPC") != std::string::npos)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Symbol-contain-errvalue");
@@ -1085,26 +1024,26 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if ((Params().NetworkIDString() == CBaseChainParams::MAIN) ||
 				((Params().NetworkIDString() == CBaseChainParams::TESTNET) && ((int)chainActive.Height() > 788900)))
 			{
-				if (tokenInRecord.count(txout.tokenLabel.getTokenSymbol()) > 0){
-					if (txout.tokenLabel.value > tokenInRecord[txout.tokenLabel.getTokenSymbol()])
+				if (tokenInRecord.count(txout.GetTokenLabel().getTokenSymbol()) > 0){
+					if (txout.GetTokenLabel().value > tokenInRecord[txout.GetTokenLabel().getTokenSymbol()])
 						return state.DoS(100, false, REJECT_INVALID, "bad-Token-value-errvalue");
 				}
-				else if (tokenInRegRecord.count(txout.tokenLabel.getTokenSymbol()) > 0)
+				else if (tokenInRegRecord.count(txout.GetTokenLabel().getTokenSymbol()) > 0)
 				{
-					if (txout.tokenLabel.value > tokenInRegRecord[txout.tokenLabel.getTokenSymbol()])
+					if (txout.GetTokenLabel().value > tokenInRegRecord[txout.GetTokenLabel().getTokenSymbol()])
 						return state.DoS(100, false, REJECT_INVALID, "bad-Token-value-errvalue");
 				}
 
 			}
 
-			if (tokenOutRecord.count(txout.tokenLabel.getTokenSymbol()) > 0)
+			if (tokenOutRecord.count(txout.GetTokenLabel().getTokenSymbol()) > 0)
 			{
-				tokenTxOutputTotalValue = tokenOutRecord[txout.tokenLabel.getTokenSymbol()];
-				tokenTxOutputTotalValue += txout.tokenLabel.value;
-				tokenOutRecord[txout.tokenLabel.getTokenSymbol()] = tokenTxOutputTotalValue;
+				tokenTxOutputTotalValue = tokenOutRecord[txout.GetTokenLabel().getTokenSymbol()];
+				tokenTxOutputTotalValue += txout.GetTokenLabel().value;
+				tokenOutRecord[txout.GetTokenLabel().getTokenSymbol()] = tokenTxOutputTotalValue;
 			}
 			else
-				tokenOutRecord[txout.tokenLabel.getTokenSymbol()] = txout.tokenLabel.value;
+				tokenOutRecord[txout.GetTokenLabel().getTokenSymbol()] = txout.GetTokenLabel().value;
 
 			tokenoutCount++;
 			break;
@@ -1113,14 +1052,14 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (txout.nValue != 0)
 				return state.DoS(100, false, REJECT_INVALID, "Vout6-Token-nValue-must-be-zero");
 
-			checkStr = txout.addTokenLabel.getTokenSymbol();
+			checkStr = txout.GetAddTokenLabel().getTokenSymbol();
 			boost::to_upper(checkStr);
 			if (checkStr.find("IPC") != std::string::npos || checkStr.find("RMB") != std::string::npos
 				|| checkStr.find("USD") != std::string::npos || checkStr.find("EUR") != std::string::npos)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Symbol-contain-errvalue");
 			if (checkStr.empty())
 				return state.DoS(100, false, REJECT_INVALID, "Vout6-Token-Symbol-empty");
-			checkStr = txout.addTokenLabel.getTokenLabel();
+			checkStr = txout.GetAddTokenLabel().getTokenLabel();
 			boost::to_upper(checkStr);
 			if (checkStr.find("IPC") != std::string::npos || checkStr.find("RMB") != std::string::npos
 				|| checkStr.find("USD") != std::string::npos || checkStr.find("EUR") != std::string::npos)
@@ -1128,49 +1067,49 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			if (checkStr.empty())
 				return state.DoS(100, false, REJECT_INVALID, "Vout6-Token-Label-empty");
 
-			if (txout.addTokenLabel.hash.GetHex().length() != 32)
+			if (txout.GetAddTokenLabel().hash.GetHex().length() != 32)
 				return state.DoS(100, false, REJECT_INVALID, "Vout6-Hash-length-must-be-32");
 
-			if (txout.addTokenLabel.extendinfo.size() > 187)
+			if (txout.GetAddTokenLabel().extendinfo.size() > 187)
 				return state.DoS(100, false, REJECT_INVALID, "Vout6-extendinfo-length-must-less-187");
 
 			if (txout.labelLen > 255)
 				return state.DoS(100, false, REJECT_INVALID, "Vout6-addTokenLabel-length-out-of-bounds");
 
-			if (txout.addTokenLabel.size() != txout.labelLen)
+			if (txout.GetAddTokenLabel().size() != txout.labelLen)
 				return state.DoS(100, false, REJECT_INVALID, "Vout6-addTokenLabel-length-not-feet-labelLen");
 
 
-			if (txout.addTokenLabel.issueDate < TOKEN_REGTIME_BOUNDARY)
+			if (txout.GetAddTokenLabel().issueDate < TOKEN_REGTIME_BOUNDARY)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-issueDate(Regtime)");
 
-			if (txout.addTokenLabel.accuracy < 0 || txout.addTokenLabel.accuracy > 8)
+			if (txout.GetAddTokenLabel().accuracy < 0 || txout.GetAddTokenLabel().accuracy > 8)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-accuracy(must be 0-8)");
 
-			if (txout.addTokenLabel.totalCount > TOKEN_MAX_VALUE ||
-				txout.addTokenLabel.totalCount <= 0)
+			if (txout.GetAddTokenLabel().totalCount > TOKEN_MAX_VALUE ||
+				txout.GetAddTokenLabel().totalCount <= 0)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-totalCount");
 			if (addtotalcount == 0){
-				addtotalcount = txout.addTokenLabel.totalCount;
+				addtotalcount = txout.GetAddTokenLabel().totalCount;
 				verifytotalcount = addtotalcount;
 			}
-			else if (addtotalcount != txout.addTokenLabel.totalCount)
+			else if (addtotalcount != txout.GetAddTokenLabel().totalCount)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-totalCount");
 
 			if (addtokenmodel == -1){
-				addtokenmodel = (int)txout.addTokenLabel.addmode;
+				addtokenmodel = (int)txout.GetAddTokenLabel().addmode;
 			}
-			else if (addtokenmodel != (int)txout.addTokenLabel.addmode){
+			else if (addtokenmodel != (int)txout.GetAddTokenLabel().addmode){
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-addmode");
 			}
 
-			if (txout.addTokenLabel.currentCount > TOKEN_MAX_VALUE ||
-				txout.addTokenLabel.currentCount <= 0 ||
-				txout.addTokenLabel.currentCount > txout.addTokenLabel.totalCount)
+			if (txout.GetAddTokenLabel().currentCount > TOKEN_MAX_VALUE ||
+				txout.GetAddTokenLabel().currentCount <= 0 ||
+				txout.GetAddTokenLabel().currentCount > txout.GetAddTokenLabel().totalCount)
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-currentCount");
-			verifytotalcount -= txout.addTokenLabel.currentCount;
+			verifytotalcount -= txout.GetAddTokenLabel().currentCount;
 
-			//int addmode = (int)txout.addTokenLabel.addmode;
+			//int addmode = (int)txout.GetAddTokenLabel().addmode;
 			if (addtokenmodel != 1 && addtokenmodel != 0){
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-addmode");
 			}
@@ -1182,8 +1121,7 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			//	return state.DoS(100, false, REJECT_INVALID, "bad-Token-Reg-addmode");
 			bool modetokensymbol = false;
 			bool modetokenhash = false;
-			if (pIPCCheckMaps->TokenSymbolMap.count(txout.addTokenLabel.getTokenSymbol()) > 0 &&
-				pIPCCheckMaps->TokenSymbolMap[txout.addTokenLabel.getTokenSymbol()].first != tx.GetHash()){
+			if (uniques.GetOwner(CIPCUniqueKey::TokenSymbol(txout.GetAddTokenLabel().getTokenSymbol()), owner) && owner != tx.GetHash()){
 				if (addtokenmodel == 0){
 					return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokensymbol-repeat");
 				}
@@ -1191,8 +1129,7 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 					modetokensymbol = true;
 				}
 			}
-			if (pIPCCheckMaps->TokenHashMap.count(txout.addTokenLabel.hash) > 0 &&
-				pIPCCheckMaps->TokenHashMap[txout.addTokenLabel.hash].first != tx.GetHash()){
+			if (uniques.GetOwner(CIPCUniqueKey::TokenHash(txout.GetAddTokenLabel().hash), owner) && owner != tx.GetHash()){
 				if (addtokenmodel == 0){
 					return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenhash-repeat");
 				}
@@ -1211,65 +1148,60 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 			txnouttype typeRet;
 			std::vector<CTxDestination> prevdestes;
 			int nRequiredRet;
-			std::string address;
+			CTxDestination regdest;
 			bool fValidAddress = ExtractDestinations(script, typeRet, prevdestes, nRequiredRet);
-			if (fValidAddress){
-				BOOST_FOREACH(CTxDestination &prevdest, prevdestes){
-					CBitcoinAddress add(prevdest);
-					address = CBitcoinAddress(prevdest).ToString();
-					break;
-				}
-			}
-			if (address.empty())
+			if (fValidAddress && !prevdestes.empty())
+				regdest = prevdestes[0];
+			if (boost::get<CNoDestination>(&regdest))
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-voutaddress-error");
-			auto result = find(txindestes.begin(), txindestes.end(), address);
-			if (result == txindestes.end()){
-				BOOST_FOREACH(auto &txindestesaddress, txindestes)
-					std::cout << " txindestes address : " << txindestesaddress << std::endl;
-				std::cout << " reg address : " << address << std::endl;
+			auto result = find(txindestes.begin(), txindestes.end(), regdest);
+			if (result == txindestes.end()){
+				BOOST_FOREACH(auto &txindestesaddress, txindestes)
+					std::cout << " txindestes address : " << CBitcoinAddress(txindestesaddress).ToString() << std::endl;
+				std::cout << " reg address : " << CBitcoinAddress(regdest).ToString() << std::endl;
 				return state.DoS(100, false, REJECT_INVALID, "bad-Token-tokenregaddress-notmine");
 			}
 
 			if (addtokenmodel == 1 && modetokensymbol && modetokenhash){
+				//Only manual issuance records the address, so encode it for that case alone
+				std::string address = CBitcoinAddress(regdest).ToString();
 				uint64_t currentTotalAmount = 0;
 				bool txHaveChecked = false;
-				if (!manualIssuancStandard(txout, state, currentTotalAmount, tokenDataMap, tx.GetHash().ToString(), voutIndex, address, txHaveChecked)){
-					//	||!manualIssuancStandard(txout, state, currentTotalAmount, newTokenDataMap, tx.GetHash().ToString(), voutIndex)){
+				if (!manualIssuancStandard(txout, state, currentTotalAmount, tokens, COutPoint(tx.GetHash(), voutIndex), address, txHaveChecked))
 					return false;
-				}
 				if (txHaveChecked)
 				{
 					return true;
 				}
-				if (txout.addTokenLabel.currentCount > txout.addTokenLabel.totalCount - currentTotalAmount)
+				if (txout.GetAddTokenLabel().currentCount > txout.GetAddTokenLabel().totalCount - currentTotalAmount)
 					return state.DoS(100, false, REJECT_INVALID, "bad-Token-currentCount-beyond");
 			}
 			
 
 			if (!paddTokenLabel.IsNull()){
-				if (!addTokenClassCompare(paddTokenLabel, txout.addTokenLabel)){
+				if (!addTokenClassCompare(paddTokenLabel, txout.GetAddTokenLabel())){
 					return state.DoS(100, false, REJECT_INVALID, "bad-Token-vouts-Incompatible");
 				}
 				if (1 == addtokenmodel)
 					return state.DoS(100, false, REJECT_INVALID, "bad-Token-vouts-number");
 			}
 			else{
-				paddTokenLabel = txout.addTokenLabel;
+				paddTokenLabel = txout.GetAddTokenLabel();
 			}
 
-		//	if (addtokenmodel == 1 && tokenOutRegRecord.count(txout.addTokenLabel.getTokenSymbol()) > 0)
+		//	if (addtokenmodel == 1 && tokenOutRegRecord.count(txout.GetAddTokenLabel().getTokenSymbol()) > 0)
 		//		return state.DoS(100, false, REJECT_INVALID, "bad-Token-manualIssuanc-repeat");
-			//if (tokenOutRegRecord.count(txout.addTokenLabel.getTokenSymbol()) == 0)
-			//	tokenOutRegRecord[txout.addTokenLabel.getTokenSymbol()] = txout.addTokenLabel.totalCount;
+			//if (tokenOutRegRecord.count(txout.GetAddTokenLabel().getTokenSymbol()) == 0)
+			//	tokenOutRegRecord[txout.GetAddTokenLabel().getTokenSymbol()] = txout.GetAddTokenLabel().totalCount;
 
-			if (tokenOutRegRecord.count(txout.addTokenLabel.getTokenSymbol()) > 0)
+			if (tokenOutRegRecord.count(txout.GetAddTokenLabel().getTokenSymbol()) > 0)
 			{
-				uint64_t value = tokenOutRegRecord[txout.addTokenLabel.getTokenSymbol()];
-				value += txout.addTokenLabel.currentCount;
-				tokenOutRegRecord[txout.addTokenLabel.getTokenSymbol()] = value;
+				uint64_t value = tokenOutRegRecord[txout.GetAddTokenLabel().getTokenSymbol()];
+				value += txout.GetAddTokenLabel().currentCount;
+				tokenOutRegRecord[txout.GetAddTokenLabel().getTokenSymbol()] = value;
 			}
 			else
-				tokenOutRegRecord[txout.addTokenLabel.getTokenSymbol()] = txout.addTokenLabel.currentCount;
+				tokenOutRegRecord[txout.GetAddTokenLabel().getTokenSymbol()] = txout.GetAddTokenLabel().currentCount;
 
 			token6 = true;
 			tokenoutCount++;
@@ -1292,7 +1224,8 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 		(IPCoutCount > 0 && devoteoutCount > 0) ||
 		(devoteoutCount > 0 && tokenoutCount > 0))
 		return state.DoS(100, false, REJECT_INVALID, "multi-txType-output-forbidden");
-	if (addtokenmodel != -1 || (tokenOutRecord.size()>0 && tokenDataMap.count(tokenOutRecord.begin()->first)>0 && tokenDataMap[tokenOutRecord.begin()->first].m_tokentype == TXOUT_ADDTOKEN)){
+	CTokenRecord outRecord;
+	if (addtokenmodel != -1 || (tokenOutRecord.size()>0 && tokens.GetToken(tokenOutRecord.begin()->first, outRecord) && outRecord.nType == TXOUT_ADDTOKEN)){
 		if (!IsValidTokenModelCheckForAdd(tokenInRegRecord, tokenInRecord, tokenOutRegRecord, tokenOutRecord, state, addtokenmodel))
 			return false;
 	} 
@@ -1302,7 +1235,7 @@ bool AreIPCStandard(const CTransaction& tx, CValidationState &state)
 	}
 	
 
-	if (!IsValidIPCModelCheck(tx, ipcInOwnerRecord, ipcInAuthorRecord, ipcOutOwnerRecord, ipcOutUniqueRecord, ipcOutAuthorRecord, state))
+	if (!IsValidIPCModelCheck(tx, ipcInOwnerRecord, ipcInAuthorRecord, ipcOutOwnerRecord, ipcOutUniqueRecord, ipcOutAuthorRecord, uniques, state))
 		return false;
 	//Increase the rate of check transactions
 	const CTransaction& txver = tx;
@@ -10,6 +10,7 @@
 #include "consensus/validation.h"
 #include "script/interpreter.h"
 #include "script/standard.h"
+#include "tokenregistry.h"
 
 #include <string>
 
@@ -105,8 +106,11 @@ bool IsWitnessStandard(const CTransaction& tx, const CCoinsViewCache& mapInputs)
 	/**
 	* Check if the IPC transaction is over standard transaction logic limit:
 	* These limits are adequate for limit the IPC transaction,
+	* inputs must already hold every coin spent by tx, uniques answers who
+	* registered the IPC hashes and token symbols and hashes tx uses, tokens
+	* holds the symbols and issuances the spent and created tokens are checked against.
 	*/
-bool AreIPCStandard(const CTransaction& tx, CValidationState &state);
+bool AreIPCStandard(const CTransaction& tx, CValidationState &state, const CCoinsViewCache& inputs, const CIPCUniqueView& uniques, const CTokenView& tokens);
 
 
 extern CFeeRate incrementalRelayFee;
@@ -33,6 +33,58 @@ std::string CBlock::ToString() const
     return s.str();
 }
 
+bool CCommitCertificate::AddVote(size_t nIndex, const CVote& vote)
+{
+    // The vote keeps the round in signed fields, compare in its types
+    if (vote.type != CVote::Commit || vote.block_hash != block_hash || vote.nPeriodStartTime != (int64_t)nPeriodStartTime ||
+            vote.nTimePeriod != (int32_t)nTimePeriod)
+        return false;
+    // Signatures follow the bitmap order
+    for (size_t i = nIndex; i < vSigners.size() * 8; i++) {
+        if (vSigners[i / 8] & (1 << (i % 8)))
+            return false;
+    }
+
+    unsigned char sig[SIGNATURE_SIZE];
+    if (!CPubKey::SignatureToCompact(vote.vchSig, sig))
+        return false;
+
+    vSigners.resize(nIndex / 8 + 1);
+    vSigners[nIndex / 8] |= 1 << (nIndex % 8);
+    vPubKeys.push_back(vote.vchPubKeyOut);
+    vchSigs.insert(vchSigs.end(), sig, sig + SIGNATURE_SIZE);
+    return true;
+}
+
+bool CCommitCertificate::GetVotes(const std::vector<uint160>& vMembers, CVoteSet& votes) const
+{
+    if (vchSigs.size() != vPubKeys.size() * SIGNATURE_SIZE || vSigners.size() > (vMembers.size() + 7) / 8)
+        return false;
+
+    size_t nSigner = 0;
+    for (size_t i = 0; i < vSigners.size() * 8; i++) {
+        if (!(vSigners[i / 8] & (1 << (i % 8))))
+            continue;
+        // The public key is part of the signed data, it must belong to the member
+        if (i >= vMembers.size() || nSigner >= vPubKeys.size() || vPubKeys[nSigner].GetID() != vMembers[i])
+            return false;
+
+        CVote vote;
+        vote.type = CVote::Commit;
+        vote.block_hash = block_hash;
+        vote.owner_hash = vMembers[i];
+        vote.nPeriodStartTime = (int64_t)nPeriodStartTime;
+        vote.nTimePeriod = (int32_t)nTimePeriod;
+        vote.vchPubKeyOut = vPubKeys[nSigner];
+        if (!CPubKey::SignatureFromCompact(&vchSigs[nSigner * SIGNATURE_SIZE], vote.vchSig))
+            return false;
+        vote.UpdateHash();
+        votes.insert(vote);
+        nSigner++;
+    }
+    return nSigner == vPubKeys.size();
+}
+
 int64_t GetBlockWeight(const CBlock& block)
 {
     // This implements the weight = (stripped_size * 4) + witness_size formula,
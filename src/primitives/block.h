@@ -13,6 +13,9 @@
 #include "pubkey.h"
 #include "key.h"
 
+#include <algorithm>
+#include <unordered_set>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -186,6 +189,10 @@ struct CBlockLocator
 };
 
 
+/**
+ * A Tendermint vote. The hash is computed on first use and cached: fill in
+ * the fields, then Sign(); do not change a vote after that.
+ */
 class CVote
 {
 public:
@@ -195,8 +202,18 @@ public:
 		return (this->GetHash() < x.GetHash());
 	}
 
+	bool operator == (const CVote &x) const
+	{
+		return (this->GetHash() == x.GetHash());
+	}
+
 	typedef enum {Propose=0, Precommit=1, Commit=2} VoteType;
 
+	CVote() : type(Propose), nPeriodStartTime(0), nTimePeriod(0)
+	{
+		UpdateHash();
+	}
+
 	int                         type; 
 	uint256                     block_hash;
 	uint160                     owner_hash;
@@ -220,11 +237,19 @@ public:
 		READWRITE(nTimePeriod);
 		READWRITE(vchPubKeyOut);
 		READWRITE(vchSig);
+		if (ser_action.ForRead())
+			UpdateHash();
 	}
 
-	uint256 GetHash () const
+	const uint256& GetHash () const
 	{
-		return SerializeHash(*this);
+		return hash;
+	}
+
+	/** Recompute the hash, needed after the fields are set other than by Sign() or deserialization */
+	void UpdateHash ()
+	{
+		hash = SerializeHash(*this);
 	}
 
 	bool Sign (CKey &pPrivKey)
@@ -240,10 +265,12 @@ public:
 		hashoperator.Write ((unsigned char*)vchPubKeyOut.begin(), vchPubKeyOut.size());
       hashoperator.Finalize(hash.begin());
 
-		return pPrivKey.Sign(hash, vchSig);
+		bool fSigned = pPrivKey.Sign(hash, vchSig);
+		UpdateHash();
+		return fSigned;
 	}
 
-	bool SignVerify ()
+	bool SignVerify () const
 	{
 		CHash256 hashoperator;
       uint256 hash;
@@ -260,6 +287,102 @@ public:
 
 	}
 
+private:
+	//! Hash of the fields, set on construction, Sign(), deserialization and UpdateHash()
+	uint256                     hash;
+};
+
+struct CVoteHasher
+{
+	size_t operator()(const CVote& vote) const { return vote.GetHash().GetCheapHash(); }
+};
+
+/**
+ * Votes keyed by their cached hash. Serialized exactly like the
+ * std::set<CVote> it replaces, i.e. in hash order, so the wire and the vote
+ * database are unaffected.
+ */
+class CVoteSet : public std::unordered_set<CVote, CVoteHasher>
+{
+public:
+	template<typename Stream>
+	void Serialize(Stream& s) const
+	{
+		std::vector<const CVote*> vSorted;
+		vSorted.reserve(size());
+		for (const_iterator it = begin(); it != end(); ++it)
+			vSorted.push_back(&*it);
+		std::sort(vSorted.begin(), vSorted.end(), [](const CVote* a, const CVote* b) { return *a < *b; });
+		WriteCompactSize(s, vSorted.size());
+		for (const CVote* pvote : vSorted)
+			::Serialize(s, *pvote);
+	}
+
+	template<typename Stream>
+	void Unserialize(Stream& s)
+	{
+		clear();
+		unsigned int nSize = ReadCompactSize(s);
+		for (unsigned int i = 0; i < nSize; i++)
+		{
+			CVote vote;
+			::Unserialize(s, vote);
+			insert(vote);
+		}
+	}
+};
+
+/**
+ * Commit votes of a block in compact form. The block hash and the round are
+ * stored once, the signers as a bitmap over the consensus list of the block,
+ * and for each signer in bitmap order its public key and 64 byte signature.
+ */
+class CCommitCertificate
+{
+public:
+	static const size_t SIGNATURE_SIZE = 64;
+
+	uint256                     block_hash;
+	uint64_t                    nPeriodStartTime;  // Same types as the block header
+	uint32_t                    nTimePeriod;
+
+	std::vector<unsigned char>  vSigners;
+	std::vector<CPubKey>        vPubKeys;
+	std::vector<unsigned char>  vchSigs;
+
+	CCommitCertificate() : nPeriodStartTime(0), nTimePeriod(0) {}
+
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action)
+	{
+		READWRITE(block_hash);
+		READWRITE(nPeriodStartTime);
+		READWRITE(nTimePeriod);
+		READWRITE(vSigners);
+		READWRITE(vPubKeys);
+		READWRITE(vchSigs);
+	}
+
+	uint256 GetHash () const
+	{
+		return SerializeHash(*this);
+	}
+
+	size_t GetSignerCount () const
+	{
+		return vPubKeys.size();
+	}
+
+	/** Add the commit vote of the nIndex-th member of the consensus list. Members must be added in list order. */
+	bool AddVote (size_t nIndex, const CVote& vote);
+
+	/**
+	 * Rebuild the commit votes. vMembers are the key hashes of the consensus
+	 * list; false if the certificate does not match it.
+	 */
+	bool GetVotes (const std::vector<uint160>& vMembers, CVoteSet& votes) const;
 };
 
 
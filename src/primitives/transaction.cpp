@@ -59,6 +59,82 @@ CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn)
 		txLabelLen = txLabel.length();
 	}
 }
+bool CTxOutLabel::IsInline() const
+{
+	switch (nKind)
+	{
+	case CTxOutLabelTraits<DevoteLabel>::KIND:
+		return CTxOutLabelTraits<DevoteLabel>::INLINE;
+	case CTxOutLabelTraits<TokenLabel>::KIND:
+		return CTxOutLabelTraits<TokenLabel>::INLINE;
+	case CTxOutLabelTraits<IPCLabel>::KIND:
+		return CTxOutLabelTraits<IPCLabel>::INLINE;
+	case CTxOutLabelTraits<TokenRegLabel>::KIND:
+		return CTxOutLabelTraits<TokenRegLabel>::INLINE;
+	case CTxOutLabelTraits<AddTokenLabel>::KIND:
+		return CTxOutLabelTraits<AddTokenLabel>::INLINE;
+	}
+	return true;
+}
+
+void CTxOutLabel::Clear()
+{
+	switch (nKind)
+	{
+	case CTxOutLabelTraits<IPCLabel>::KIND:
+		Destroy<IPCLabel>();
+		break;
+	case CTxOutLabelTraits<DevoteLabel>::KIND:
+		Destroy<DevoteLabel>();
+		break;
+	case CTxOutLabelTraits<TokenRegLabel>::KIND:
+		Destroy<TokenRegLabel>();
+		break;
+	case CTxOutLabelTraits<TokenLabel>::KIND:
+		Destroy<TokenLabel>();
+		break;
+	case CTxOutLabelTraits<AddTokenLabel>::KIND:
+		Destroy<AddTokenLabel>();
+		break;
+	}
+	nKind = KIND_NONE;
+}
+
+void CTxOutLabel::CopyFrom(const CTxOutLabel& other)
+{
+	switch (other.nKind)
+	{
+	case CTxOutLabelTraits<IPCLabel>::KIND:
+		Construct(other.Get<IPCLabel>());
+		break;
+	case CTxOutLabelTraits<DevoteLabel>::KIND:
+		Construct(other.Get<DevoteLabel>());
+		break;
+	case CTxOutLabelTraits<TokenRegLabel>::KIND:
+		Construct(other.Get<TokenRegLabel>());
+		break;
+	case CTxOutLabelTraits<TokenLabel>::KIND:
+		Construct(other.Get<TokenLabel>());
+		break;
+	case CTxOutLabelTraits<AddTokenLabel>::KIND:
+		Construct(other.Get<AddTokenLabel>());
+		break;
+	}
+}
+
+void CTxOutLabel::MoveFrom(CTxOutLabel& other) noexcept
+{
+	if (other.IsInline())
+	{
+		CopyFrom(other);
+		return;
+	}
+	// Take over the heap allocated label
+	std::memcpy(&storage, &other.storage, sizeof(void*));
+	nKind = other.nKind;
+	other.nKind = KIND_NONE;
+}
+
 //Ordinary transaction constructor（Just called by CoinBase）
 CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, std::string coinbaseScriptIn)
 {
@@ -74,7 +150,7 @@ CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, DevoteLabel& dev
 	SetNull();
 	nValue = nValueIn;
 	txType = TXOUT_CAMPAIGN;
-	devoteLabel = devoteLableIn;
+	ModifyDevoteLabel() = devoteLableIn;
 	scriptPubKey = scriptPubKeyIn;
 }
 //Apply to exit the transaction output constructor
@@ -83,8 +159,8 @@ CTxOut::CTxOut(const CAmount& nValueIn, DevoteLabel& devoteLableIn)
 	SetNull();
 	nValue = nValueIn;
 	txType = TXOUT_CAMPAIGN;
-	devoteLabel = devoteLableIn;
-	scriptPubKey = GetScriptForDestination(CBitcoinAddress(Params().system_account_address).Get());
+	ModifyDevoteLabel() = devoteLableIn;
+	scriptPubKey = Params().SystemAccountScript();
 }
 
 // the normal penalty transaction output constructor
@@ -96,9 +172,9 @@ CTxOut::CTxOut(CampaignType_t campaignType, uint160 campaignPubkeyHash)
 	if (campaignType == TYPE_CONSENSUS_ORDINARY_PUSNISHMENT || campaignType == TYPE_CONSENSUS_SEVERE_PUNISHMENT)
 	{
 		txType = TXOUT_CAMPAIGN;
-		devoteLabel.ExtendType = (uint8_t)campaignType;
-		devoteLabel.hash = campaignPubkeyHash;
-		scriptPubKey = GetScriptForDestination(CBitcoinAddress(Params().system_account_address).Get());
+		ModifyDevoteLabel().ExtendType = (uint8_t)campaignType;
+		ModifyDevoteLabel().hash = campaignPubkeyHash;
+		scriptPubKey = Params().SystemAccountScript();
 	}
 }
 // severe penalties for the application of trade constructors
@@ -107,9 +183,9 @@ CTxOut::CTxOut(uint160 campaignPubkeyHash, const std::string evidence)
 	SetNull();
 	nValue = 0;
 	txType = TXOUT_CAMPAIGN;
-	devoteLabel.ExtendType = (uint8_t)TYPE_CONSENSUS_SEVERE_PUNISHMENT_REQUEST;
-	devoteLabel.hash = campaignPubkeyHash;
-	scriptPubKey = GetScriptForDestination(CBitcoinAddress(Params().system_account_address).Get());
+	ModifyDevoteLabel().ExtendType = (uint8_t)TYPE_CONSENSUS_SEVERE_PUNISHMENT_REQUEST;
+	ModifyDevoteLabel().hash = campaignPubkeyHash;
+	scriptPubKey = Params().SystemAccountScript();
 	LogPrintf("[CTxOut::CTxOut Severe punishment application] evidence=%s\n", evidence.c_str());
 	txLabel = evidence;
 }
@@ -121,8 +197,8 @@ CTxOut::CTxOut(const CAmount& refund, uint160 campaignPubkeyHash)
 	SetNull();
 	nValue = refund;
 	txType = TXOUT_CAMPAIGN;
-	devoteLabel.ExtendType = 4;
-	devoteLabel.hash = campaignPubkeyHash;
+	ModifyDevoteLabel().ExtendType = 4;
+	ModifyDevoteLabel().hash = campaignPubkeyHash;
 	scriptPubKey = GetScriptForDestination(CKeyID(campaignPubkeyHash));
 }
 
@@ -133,8 +209,8 @@ CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, TransactionOutTy
 	nValue = nValueIn;
 	scriptPubKey = scriptPubKeyIn;
 	txType = txTypeIn;
-	labelLen = ipcLabel.size();
-	ipcLabel = labelIn;
+	labelLen = GetIPCLabel().size();
+	ModifyIPCLabel() = labelIn;
 	txLabel = voutLabel;
 }
 //Ownership structure
@@ -144,10 +220,9 @@ CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, TransactionOutTy
 	nValue = nValueIn;
 	scriptPubKey = scriptPubKeyIn;
 	txType = txTypeIn;
-	labelLen = ipcLabel.size();
-	ipcLabel = labelIn;
+	labelLen = GetIPCLabel().size();
+	ModifyIPCLabel() = labelIn;
 	txLabel = voutLabel;
-	ipcLabelinfo = ipcinfo;
 }
 //The construction function of scrip registration transaction
 CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, TokenRegLabel& labelIn, std::string voutLabel)
@@ -156,7 +231,7 @@ CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, TokenRegLabel& l
 	nValue = nValueIn;
 	scriptPubKey = scriptPubKeyIn;
 	txType = TXOUT_TOKENREG;
-	tokenRegLabel = labelIn;
+	ModifyTokenRegLabel() = labelIn;
 	txLabel = voutLabel;
 }
 
@@ -166,7 +241,7 @@ CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, AddTokenLabel& l
 	nValue = nValueIn;
 	scriptPubKey = scriptPubKeyIn;
 	txType = TXOUT_ADDTOKEN;
-	addTokenLabel = labelIn;
+	ModifyAddTokenLabel() = labelIn;
 	txLabel = voutLabel;
 }
 
@@ -177,7 +252,7 @@ CTxOut::CTxOut(const CAmount& nValueIn, CScript scriptPubKeyIn, TokenLabel& labe
 	nValue = nValueIn;
 	scriptPubKey = scriptPubKeyIn;
 	txType = TXOUT_TOKEN;
-	tokenLabel = labelIn;
+	ModifyTokenLabel() = labelIn;
 	txLabel = voutLabel;
 }
 
@@ -188,7 +263,7 @@ CampaignType_t CTxOut::GetCampaignType() const
 	if (txType != 1)
 		return TYPE_CONSENSUS_NULL;
 	
-	return (CampaignType_t)devoteLabel.ExtendType;
+	return (CampaignType_t)GetDevoteLabel().ExtendType;
 }
 
 
@@ -200,15 +275,15 @@ std::string CTxOut::ToString() const
 uint64_t CTxOut::GetTokenvalue() const{
     if (txType == TXOUT_TOKENREG)
     {
-        return tokenRegLabel.totalCount;
+        return GetTokenRegLabel().totalCount;
     }
     else if (txType == TXOUT_TOKEN)
     {
-        return tokenLabel.value;
+        return GetTokenLabel().value;
     }
     else if (txType == TXOUT_ADDTOKEN)
 	{
-		return addTokenLabel.currentCount;
+		return GetAddTokenLabel().currentCount;
 	}  
     return uint64_t(0);}
 
@@ -216,15 +291,15 @@ uint8_t CTxOut::getTokenaccuracy() const
 {
 	if (txType == TXOUT_TOKENREG)
 	{
-		return tokenRegLabel.accuracy;
+		return GetTokenRegLabel().accuracy;
 	}
 	else if (txType == TXOUT_TOKEN)
 	{
-		return tokenLabel.accuracy;
+		return GetTokenLabel().accuracy;
 	}
 	else if (txType == TXOUT_ADDTOKEN)
 	{
-		return addTokenLabel.accuracy;
+		return GetAddTokenLabel().accuracy;
 	}
 	return uint8_t(0);
 }
@@ -298,7 +373,7 @@ uint160 CTransaction::GetCampaignPublickey() const
 	for (uint32_t i = 0; i < vout.size(); i++)
 	{
 		if (vout[i].txType == TXOUT_CAMPAIGN)
-			return vout[i].devoteLabel.hash;
+			return vout[i].GetDevoteLabel().hash;
 	}
 	return uint160();
 
@@ -310,7 +385,7 @@ CAmount CTransaction::GetRegisterIPC() const
 
 	for (uint32_t i = 0; i < vout.size(); i++)
 	{
-		if (vout[i].txType == TXOUT_CAMPAIGN && vout[i].devoteLabel.ExtendType == TYPE_CONSENSUS_REGISTER)
+		if (vout[i].txType == TXOUT_CAMPAIGN && vout[i].GetDevoteLabel().ExtendType == TYPE_CONSENSUS_REGISTER)
 			return vout[i].nValue;
 	}
 	return TYPE_CONSENSUS_NULL;
@@ -320,7 +395,7 @@ std::string CTransaction::GetCampaignEvidence() const
 {
 	for (uint32_t i = 0; i < vout.size(); i++)
 	{
-		if (vout[i].txType == TXOUT_CAMPAIGN && vout[i].devoteLabel.ExtendType == TYPE_CONSENSUS_SEVERE_PUNISHMENT_REQUEST)
+		if (vout[i].txType == TXOUT_CAMPAIGN && vout[i].GetDevoteLabel().ExtendType == TYPE_CONSENSUS_SEVERE_PUNISHMENT_REQUEST)
 			return vout[i].txLabel;
 	}
 	return "";
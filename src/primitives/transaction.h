@@ -11,6 +11,8 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <type_traits>
+
 static const int SERIALIZE_TRANSACTION_NO_WITNESS = 0x40000000;
 
 static const int WITNESS_SCALE_FACTOR = 4;
@@ -377,169 +379,6 @@ public:
 	int32_t size(){ return m_txid.size()+1 + sizeof(uint32_t)+address.size()+1 + m_addTokenLabel.size(); }
 	void SetNull() { m_addTokenLabel.SetNull(); m_vout = 0; }
 };
-class TokenReg
-{
-public:
-	int m_tokentype;
-	//std::map<string ,AddTokenReg> ; //string(txid voutnum)
-	//AddTokenLabel m_addTokenLabel;
-	std::vector<AddTokenReg> m_addTokenLabel;
-	TokenRegLabel* m_tokenRegLabel;
-	TokenReg(){ m_tokenRegLabel = NULL; }
-	TokenReg(const TokenRegLabel& nValueIn){
-		m_tokenRegLabel = NULL;
-		m_tokentype = 4;
-		m_tokenRegLabel = new TokenRegLabel();
-		memcpy(m_tokenRegLabel->TokenSymbol, nValueIn.TokenSymbol, 9 * sizeof(uint8_t));
-		memcpy(m_tokenRegLabel->label, nValueIn.label, 17 * sizeof(uint8_t));
-		m_tokenRegLabel->value = nValueIn.value;
-		m_tokenRegLabel->hash = nValueIn.hash;
-		m_tokenRegLabel->issueDate = nValueIn.issueDate;
-		m_tokenRegLabel->totalCount = nValueIn.totalCount;
-		m_tokenRegLabel->accuracy = nValueIn.accuracy;
-	}
-	//TokenReg(const AddTokenLabel& nValueIn)m_addTokenLabel(NULL){ m_tokentype = TXOUT_ADDTOKEN;  m_addTokenLabel = nValueIn; }
-	TokenReg(const AddTokenLabel& nValueIn, std::string m_txid, int m_vout, std::string address){
-		m_tokenRegLabel = NULL;
-		AddTokenReg addTokenLabel;
-		addTokenLabel.address = address;
-		addTokenLabel.m_txid = m_txid;
-		addTokenLabel.m_vout = m_vout;
-		addTokenLabel.m_addTokenLabel = nValueIn;
-		m_tokentype = TXOUT_ADDTOKEN;
-		m_addTokenLabel.push_back(addTokenLabel);
-	}
-
-	int getTokenType(){ return m_tokentype; }
-	std::string getTokenSymbol() const { 
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return "";
-			return std::string((char*)m_addTokenLabel[0].m_addTokenLabel.TokenSymbol);
-		}
-		else{
-			if (m_tokenRegLabel)
-				return std::string((char*)m_tokenRegLabel->TokenSymbol);
-			else
-				return "";
-		}
-	};
-	std::string getTokenLabel() const { 
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return "";
-			return std::string((char*)m_addTokenLabel[0].m_addTokenLabel.label);
-		}
-		else{
-			if (m_tokenRegLabel)
-				return std::string((char*)m_tokenRegLabel->label);
-			else
-				return "";
-		}
-	};
-	uint8_t getAccuracy(){
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return 0;
-			return m_addTokenLabel[0].m_addTokenLabel.accuracy;
-		}
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->accuracy;
-			else
-				return 0;
-		}
-	}
-	uint128 getHash(){
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return uint128();
-			return m_addTokenLabel[0].m_addTokenLabel.hash;
-		}
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->hash;
-			else
-				return uint128();
-		}
-	}
-	uint32_t getIssueDate(){
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return 0;
-			return m_addTokenLabel[0].m_addTokenLabel.issueDate;
-		}
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->issueDate;
-			else
-				return 0;
-		}
-	}
-	uint64_t getCurrentDate(){
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return 0;
-			return m_addTokenLabel[0].m_addTokenLabel.currentCount;
-		}
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->totalCount;
-			else
-				return 0;
-		}
-	}
-	uint64_t getTotalCount(){
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return 0;
-			return m_addTokenLabel[0].m_addTokenLabel.totalCount;
-		}
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->totalCount;
-			else
-				return 0;
-		}
-	}
-	uint64_t getValue(){
-		if (m_tokentype == TXOUT_ADDTOKEN)
-			return 0;
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->value;
-			else
-				return 0;
-		}
-	}
-	uint8_t* getLabel(){
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return 0;
-			return m_addTokenLabel[0].m_addTokenLabel.label;
-		}
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->label;
-			else
-				return 0;
-		}
-	}
-	uint32_t size() {
-		if (m_tokentype == TXOUT_ADDTOKEN){
-			if (m_addTokenLabel.size() <= 0)
-				return 0;
-			return m_addTokenLabel[0].m_addTokenLabel.size();
-		}
-		else{
-			if (m_tokenRegLabel)
-				return m_tokenRegLabel->size();
-			else
-				return 0;
-		}
-	}
-
-};
 //IPC output structure of the token class
 class TokenLabel
 {
@@ -576,6 +415,149 @@ public:
 
 };
 
+template <typename T> struct CTxOutLabelTraits;
+template <> struct CTxOutLabelTraits<IPCLabel>      { enum { KIND = 1, INLINE = 0 }; };
+template <> struct CTxOutLabelTraits<DevoteLabel>   { enum { KIND = 2, INLINE = 1 }; };
+template <> struct CTxOutLabelTraits<TokenRegLabel> { enum { KIND = 3, INLINE = 0 }; };
+template <> struct CTxOutLabelTraits<TokenLabel>    { enum { KIND = 4, INLINE = 1 }; };
+template <> struct CTxOutLabelTraits<AddTokenLabel> { enum { KIND = 5, INLINE = 0 }; };
+
+/**
+ * The label of a transaction output. A label of a single type is held at a
+ * time: the small ones inline, the others on the heap, so an output without
+ * a label does not carry the storage of every label type.
+ * Reading a label of a type that is not held gives a null label.
+ */
+class CTxOutLabel
+{
+public:
+	CTxOutLabel() : nKind(KIND_NONE) {}
+	CTxOutLabel(const CTxOutLabel& other) : nKind(KIND_NONE) { CopyFrom(other); }
+	CTxOutLabel(CTxOutLabel&& other) noexcept : nKind(KIND_NONE) { MoveFrom(other); }
+	~CTxOutLabel() { Clear(); }
+
+	CTxOutLabel& operator=(const CTxOutLabel& other)
+	{
+		if (this != &other) {
+			Clear();
+			CopyFrom(other);
+		}
+		return *this;
+	}
+
+	CTxOutLabel& operator=(CTxOutLabel&& other) noexcept
+	{
+		if (this != &other) {
+			Clear();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	/** The label of type T, or a null one if a label of another type is held */
+	template <typename T>
+	const T& Get() const
+	{
+		if (nKind != CTxOutLabelTraits<T>::KIND) {
+			static const T null;
+			return null;
+		}
+		return *Ptr<T>();
+	}
+
+	/** Writable label of type T. A label of another type is replaced by a null label of type T. */
+	template <typename T>
+	T& Modify()
+	{
+		if (nKind != CTxOutLabelTraits<T>::KIND) {
+			Clear();
+			Construct<T>(T());
+		}
+		return *Ptr<T>();
+	}
+
+	/** Whether a label of type T is held */
+	template <typename T>
+	bool Holds() const
+	{
+		return nKind == CTxOutLabelTraits<T>::KIND;
+	}
+
+	void Clear();
+
+private:
+	enum { KIND_NONE = 0 };
+	static const size_t INLINE_SIZE = sizeof(TokenLabel) > sizeof(DevoteLabel) ? sizeof(TokenLabel) : sizeof(DevoteLabel);
+	static_assert(INLINE_SIZE >= sizeof(void*), "label storage must fit a pointer");
+
+	uint8_t nKind;
+	std::aligned_storage<INLINE_SIZE>::type storage;
+
+	//! Selects the inline or the heap variant of the storage helpers at compile time
+	template <typename T>
+	using IsInlineLabel = std::integral_constant<bool, CTxOutLabelTraits<T>::INLINE>;
+
+	bool IsInline() const;
+	void CopyFrom(const CTxOutLabel& other);
+	void MoveFrom(CTxOutLabel& other) noexcept;
+
+	template <typename T>
+	T* Ptr() const
+	{
+		return Ptr<T>(IsInlineLabel<T>());
+	}
+
+	template <typename T>
+	T* Ptr(std::true_type) const
+	{
+		return static_cast<T*>(const_cast<void*>(static_cast<const void*>(&storage)));
+	}
+
+	template <typename T>
+	T* Ptr(std::false_type) const
+	{
+		return *static_cast<T* const*>(static_cast<const void*>(&storage));
+	}
+
+	template <typename T>
+	void Construct(const T& label)
+	{
+		Construct(label, IsInlineLabel<T>());
+		nKind = CTxOutLabelTraits<T>::KIND;
+	}
+
+	template <typename T>
+	void Construct(const T& label, std::true_type)
+	{
+		static_assert(sizeof(T) <= INLINE_SIZE, "inline label does not fit");
+		new (&storage) T(label);
+	}
+
+	template <typename T>
+	void Construct(const T& label, std::false_type)
+	{
+		*reinterpret_cast<T**>(&storage) = new T(label);
+	}
+
+	template <typename T>
+	void Destroy()
+	{
+		Destroy<T>(IsInlineLabel<T>());
+	}
+
+	template <typename T>
+	void Destroy(std::true_type)
+	{
+		Ptr<T>()->~T();
+	}
+
+	template <typename T>
+	void Destroy(std::false_type)
+	{
+		delete Ptr<T>();
+	}
+};
+
 /** An output of a transaction.  It contains the public key that the next input
  * must be able to sign with to claim it.
  */
@@ -586,17 +568,27 @@ public:
 	uint8_t txType; //Output UTXO type
 	std::string coinbaseScript = "";//This field is used only by the CoinBase output mining bonus and is considered a common transaction
 	uint8_t labelLen; //Length of product labels (used when serializing output)
-	IPCLabel ipcLabel; //Knowledge of labelling content
-	DevoteLabel devoteLabel; //Campaign label content
-	TokenRegLabel tokenRegLabel; //Scrip registration label content
-	TokenLabel tokenLabel; //Token content of tokens
-	AddTokenLabel addTokenLabel;//TXOUT_ADDTOKEN
+	CTxOutLabel label; //Label content of the IPC, campaign and token outputs
     CScript scriptPubKey;
 	uint16_t txLabelLen = 0; //Label/escape length
 	std::string txLabel; //Label/escape
-	std::string ipcLabelinfo; 
 
-	
+	//Knowledge of labelling content
+	const IPCLabel& GetIPCLabel() const { return label.Get<IPCLabel>(); }
+	IPCLabel& ModifyIPCLabel() { return label.Modify<IPCLabel>(); }
+	//Campaign label content
+	const DevoteLabel& GetDevoteLabel() const { return label.Get<DevoteLabel>(); }
+	DevoteLabel& ModifyDevoteLabel() { return label.Modify<DevoteLabel>(); }
+	//Scrip registration label content
+	const TokenRegLabel& GetTokenRegLabel() const { return label.Get<TokenRegLabel>(); }
+	TokenRegLabel& ModifyTokenRegLabel() { return label.Modify<TokenRegLabel>(); }
+	//Token content of tokens
+	const TokenLabel& GetTokenLabel() const { return label.Get<TokenLabel>(); }
+	TokenLabel& ModifyTokenLabel() { return label.Modify<TokenLabel>(); }
+	//TXOUT_ADDTOKEN
+	const AddTokenLabel& GetAddTokenLabel() const { return label.Get<AddTokenLabel>(); }
+	AddTokenLabel& ModifyAddTokenLabel() { return label.Modify<AddTokenLabel>(); }
+
 
     CTxOut()
     {
@@ -649,53 +641,23 @@ public:
 		{
 
 		case 1:
-			labelLen = devoteLabel.size();
-			READWRITE(labelLen);
-			if (labelLen > 0)
-			{
-				READWRITE(devoteLabel);
-			}
-
+			SerializeLabel<DevoteLabel>(s, ser_action);
 			break;
 
 		case 2:
 		case 3:
-			labelLen = ipcLabel.size();
-			READWRITE(labelLen);
-			if (labelLen > 0)
-			{
-				READWRITE(ipcLabel);
-			}
-
+			SerializeLabel<IPCLabel>(s, ser_action);
 			break;
 
 		case 4:
-			labelLen = tokenRegLabel.size();
-			READWRITE(labelLen);
-			if (labelLen > 0)
-			{
-				READWRITE(tokenRegLabel);
-			}
-
+			SerializeLabel<TokenRegLabel>(s, ser_action);
 			break;
 
 		case 5:
-			labelLen = tokenLabel.size();
-			READWRITE(labelLen);
-			if (labelLen > 0)
-			{
-				READWRITE(tokenLabel);
-			}
-
+			SerializeLabel<TokenLabel>(s, ser_action);
 			break;
        case TXOUT_ADDTOKEN:
-			labelLen = addTokenLabel.size();
-			READWRITE(labelLen);
-			if (labelLen > 0)
-			{
-				READWRITE(addTokenLabel);
-			}
-
+			SerializeLabel<AddTokenLabel>(s, ser_action);
 			break;
     	case 0:
 			READWRITE(coinbaseScript);
@@ -711,15 +673,39 @@ public:
 	
     }
 
+	//Label length followed by the label of type T when the length is not zero
+	template <typename T, typename Stream>
+	void SerializeLabel(Stream& s, CSerActionSerialize ser_action)
+	{
+		const T& labelT = label.Get<T>();
+		labelLen = labelT.size();
+		READWRITE(labelLen);
+		if (labelLen > 0)
+		{
+			::Serialize(s, labelT);
+		}
+	}
+
+	template <typename T, typename Stream>
+	void SerializeLabel(Stream& s, CSerActionUnserialize ser_action)
+	{
+		label.Clear();
+		READWRITE(labelLen);
+		if (labelLen > 0)
+		{
+			::Unserialize(s, label.Modify<T>());
+		}
+	}
+
     void SetNull()
     {
         nValue = -1;
 		txType = TXOUT_INVALID;
 		labelLen = 0;
+		label.Clear();
         scriptPubKey.clear();
 		txLabel.clear();
 		coinbaseScript.clear();
-		ipcLabelinfo.clear();
     }
 
     bool IsNull() const
@@ -730,7 +716,7 @@ public:
 	//Get the transaction subtype of the campaign
 	CampaignType_t GetCampaignType() const;
 	std::string GetCheckBlockContent() const{ return coinbaseScript; };
-	uint160 GetCampaignHash() const{ return devoteLabel.hash; };
+	uint160 GetCampaignHash() const{ return GetDevoteLabel().hash; };
 
     CAmount GetDustThreshold(const CFeeRate &minRelayTxFee) const
     {
@@ -788,13 +774,13 @@ public:
     std::string getTokenSymbol() const
     {
         if(txType==TXOUT_TOKENREG){
-            return tokenRegLabel.getTokenSymbol();
+            return GetTokenRegLabel().getTokenSymbol();
         }else if(txType==TXOUT_TOKEN){
-            return tokenLabel.getTokenSymbol();
+            return GetTokenLabel().getTokenSymbol();
      	}
 		else if (txType == TXOUT_ADDTOKEN)
 		{
-			return addTokenLabel.getTokenSymbol();
+			return GetAddTokenLabel().getTokenSymbol();
 		}
 		else{
 			return "";
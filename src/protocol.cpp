@@ -42,6 +42,11 @@ const char *BLOCKTXN="blocktxn";
 const char *VOTE="vote_message";
 const char *PUT_BLOCK="put_block";
 const char *PUT_VOTE="put_vote";
+const char *PUT_CMPCTBLOCK="put_cmpctblk";
+const char *PUT_GETBLOCKTXN="put_getbtxn";
+const char *PUT_BLOCKTXN="put_blocktxn";
+const char *PUT_GETBLOCK="put_getblock";
+const char *PUT_COMMIT="put_commit";
 //const char *BROADCAST_VOTE="111_vote";
 };
 
@@ -250,6 +250,37 @@ extern const char *PUT_BLOCK;
 
 extern const char *PUT_VOTE;
 
+/**
+ * Contains a CBlockHeaderAndShortTxIDs of a Tendermint proposal.
+ * Sent instead of "put_block" to peers that support it.
+ * @since protocol version 70016
+ */
+extern const char *PUT_CMPCTBLOCK;
+/**
+ * Contains a BlockTransactionsRequest.
+ * Peer should respond with "put_blocktxn" message.
+ * @since protocol version 70016
+ */
+extern const char *PUT_GETBLOCKTXN;
+/**
+ * Contains a BlockTransactions.
+ * Sent in response to a "put_getbtxn" message.
+ * @since protocol version 70016
+ */
+extern const char *PUT_BLOCKTXN;
+/**
+ * Contains the hash of a proposal that could not be rebuilt from its
+ * compact form. Peer should respond with "put_block" message.
+ * @since protocol version 70016
+ */
+extern const char *PUT_GETBLOCK;
+/**
+ * Contains the CCommitCertificate of a block, sent ahead of the block.
+ * Replaces "put_vote" for peers that support it.
+ * @since protocol version 70017
+ */
+extern const char *PUT_COMMIT;
+
 //extern const char *BROADCAST_VOTE;
 };
 
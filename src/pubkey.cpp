@@ -280,6 +280,26 @@ bool CExtPubKey::Derive(CExtPubKey &out, unsigned int _nChild) const {
     return (!secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, NULL, &sig));
 }
 
+/* static */ bool CPubKey::SignatureToCompact(const std::vector<unsigned char>& vchSig, unsigned char* sig64) {
+    secp256k1_ecdsa_signature sig;
+    if (vchSig.empty() || !ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, &vchSig[0], vchSig.size())) {
+        return false;
+    }
+    return secp256k1_ecdsa_signature_serialize_compact(secp256k1_context_verify, sig64, &sig);
+}
+
+/* static */ bool CPubKey::SignatureFromCompact(const unsigned char* sig64, std::vector<unsigned char>& vchSig) {
+    secp256k1_ecdsa_signature sig;
+    if (!secp256k1_ecdsa_signature_parse_compact(secp256k1_context_verify, &sig, sig64)) {
+        return false;
+    }
+    vchSig.resize(72);
+    size_t siglen = vchSig.size();
+    secp256k1_ecdsa_signature_serialize_der(secp256k1_context_verify, &vchSig[0], &siglen, &sig);
+    vchSig.resize(siglen);
+    return true;
+}
+
 /* static */ int ECCVerifyHandle::refcount = 0;
 
 ECCVerifyHandle::ECCVerifyHandle()
@@ -180,6 +180,12 @@ public:
      */
     static bool CheckLowS(const std::vector<unsigned char>& vchSig);
 
+    //! Convert a DER signature to its 64 byte (r, s) form.
+    static bool SignatureToCompact(const std::vector<unsigned char>& vchSig, unsigned char* sig64);
+
+    //! Convert a 64 byte (r, s) signature back to DER.
+    static bool SignatureFromCompact(const unsigned char* sig64, std::vector<unsigned char>& vchSig);
+
     //! Recover a public key from a compact signature.
     bool RecoverCompact(const uint256& hash, const std::vector<unsigned char>& vchSig);
 
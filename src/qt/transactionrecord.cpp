@@ -216,7 +216,7 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                     {
                         //   sub.type = TransactionRecord::RecvCoin;
                     }
-                    else if(1== txout.txType && 4 == txout.devoteLabel.ExtendType)
+                    else if(1== txout.txType && 4 == txout.GetDevoteLabel().ExtendType)
                     {
 
                         CAmount markbill;
@@ -319,7 +319,7 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                     std::string add;
                     if (ExtractDestination(txout.scriptPubKey, address))
                         add= CBitcoinAddress(address).ToString();
-                    int typenum = txout.ipcLabel.ExtendType;
+                    int typenum = txout.GetIPCLabel().ExtendType;
                     int ipcType;
 
                     ipcType = typenum;
@@ -330,7 +330,7 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         AuthType =QObject::tr("ownership");
                     else
                         AuthType = QObject::tr("Use right");
-                    if(1 == txout.ipcLabel.reAuthorize)                   //if(1== txout.ipcLabel.uniqueAuthorize)//5
+                    if(1 == txout.GetIPCLabel().reAuthorize)                   //if(1== txout.GetIPCLabel().uniqueAuthorize)//5
                     {
                         AuthLimit = QObject::tr("can authorization");
                     }
@@ -339,8 +339,8 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         AuthLimit = QObject::tr("cannot authorization");
                     }
 
-                    uint32_t start = txout.ipcLabel.startTime;
-                    uint32_t stop = txout.ipcLabel.stopTime;
+                    uint32_t start = txout.GetIPCLabel().startTime;
+                    uint32_t stop = txout.GetIPCLabel().stopTime;
 
 
                     QString starttime=IntTimeToQStringTime(start);//2
@@ -365,7 +365,7 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                     QString m_strtime =FormatTxTime(wtx);
                     CAmount m_fee = nDebit - wtx.tx->GetValueOut();
                     parts.append(TransactionRecord(hash, nTime, TransactionRecord::RecvIPC,add,
-                                                   -(nDebit - nChange), nCredit - nChange,txout.ipcLabel.labelTitle,ipcType,AuthType,AuthLimit,AuthTime,m_status,m_strtime,m_fee));
+                                                   -(nDebit - nChange), nCredit - nChange,txout.GetIPCLabel().labelTitle,ipcType,AuthType,AuthLimit,AuthTime,m_status,m_strtime,m_fee));
                     parts.last().involvesWatchAddress = involvesWatchAddress;// maybe pass to TransactionRecord as constructor argument
                     isSpecileTran = true;
                     break;
@@ -384,21 +384,21 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                     std::string y;
                     QString num;
                     if(4  == txout.txType){
-                        y =(char*)(txout.tokenRegLabel.TokenSymbol);
-                        num=QString::number(txout.tokenRegLabel.totalCount);//444
-                        int vacc = txout.tokenRegLabel.accuracy;
+                        y =(char*)(txout.GetTokenRegLabel().TokenSymbol);
+                        num=QString::number(txout.GetTokenRegLabel().totalCount);//444
+                        int vacc = txout.GetTokenRegLabel().accuracy;
                         num = getAccuracyNum(vacc,num);
                        }
 					else if (TXOUT_ADDTOKEN == txout.txType){
-						y = (char*)(txout.addTokenLabel.TokenSymbol);
-						num = QString::number(txout.addTokenLabel.totalCount);//444
-						int vacc = txout.addTokenLabel.accuracy;
+						y = (char*)(txout.GetAddTokenLabel().TokenSymbol);
+						num = QString::number(txout.GetAddTokenLabel().totalCount);//444
+						int vacc = txout.GetAddTokenLabel().accuracy;
 						num = getAccuracyNum(vacc, num);
 					}
                     else{
-                        y=(char*)(txout.tokenLabel.TokenSymbol);
-                        num=QString::number(txout.tokenLabel.value);//555
-                        int vacc = txout.tokenLabel.accuracy;
+                        y=(char*)(txout.GetTokenLabel().TokenSymbol);
+                        num=QString::number(txout.GetTokenLabel().value);//555
+                        int vacc = txout.GetTokenLabel().accuracy;
                         num = getAccuracyNum(vacc,num);
                     }
 
@@ -429,7 +429,7 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                     CAmount m_fee = nDebit - wtx.tx->GetValueOut();
 
                     parts.append(TransactionRecord(hash, nTime, TransactionRecord::Senddeposit,add,
-                                                   -(nDebit - nChange), nChange -  nCredit ,m_status,m_strtime,m_fee));//txout.ipcLabel.labelTitle,txout.ipcLabel.ExtendType,
+                                                   -(nDebit - nChange), nChange -  nCredit ,m_status,m_strtime,m_fee));//txout.GetIPCLabel().labelTitle,txout.GetIPCLabel().ExtendType,
 
                     parts.last().involvesWatchAddress = involvesWatchAddress;// maybe pass to TransactionRecord as constructor argument
 
@@ -478,7 +478,7 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         if(nOut == wtx.tx->vout.size()-2)
                         {
                             parts.append(TransactionRecord(hash, nTime, TransactionRecord::SendToSelf,add,
-                                                           -(nDebit - nChange), nChange -  nCredit ,m_status,m_strtime,m_fee));//txout.ipcLabel.labelTitle,txout.ipcLabel.ExtendType,
+                                                           -(nDebit - nChange), nChange -  nCredit ,m_status,m_strtime,m_fee));//txout.GetIPCLabel().labelTitle,txout.GetIPCLabel().ExtendType,
 
                             parts.last().involvesWatchAddress = involvesWatchAddress;// maybe pass to TransactionRecord as constructor argument
                         }
@@ -516,19 +516,19 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         ipcdialog::m_bNeedUpdateLater = true;
                         sub.type = TransactionRecord::SendIPC;
 
-                        sub.ipcTitle = txout.ipcLabel.labelTitle;
-                        int typenum = txout.ipcLabel.ExtendType;
+                        sub.ipcTitle = txout.GetIPCLabel().labelTitle;
+                        int typenum = txout.GetIPCLabel().ExtendType;
 
                         sub.ipcType = typenum;
-                        sub.authType = txout.ipcLabel.reAuthorize;
-                        sub.authLimit =txout.ipcLabel.uniqueAuthorize ;
+                        sub.authType = txout.GetIPCLabel().reAuthorize;
+                        sub.authLimit =txout.GetIPCLabel().uniqueAuthorize ;
 
 
                         if(2 == txout.txType)
                             sub.authType =QObject::tr("ownership");
                         else
                             sub.authType = QObject::tr("Use right");
-                        if(1 == txout.ipcLabel.reAuthorize)
+                        if(1 == txout.GetIPCLabel().reAuthorize)
                         {
                             sub.authLimit = QObject::tr("can authorization");
                         }
@@ -537,8 +537,8 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                             sub.authLimit = QObject::tr("cannot authorization");
                         }
 
-                        uint32_t start = txout.ipcLabel.startTime;
-                        uint32_t stop = txout.ipcLabel.stopTime;
+                        uint32_t start = txout.GetIPCLabel().startTime;
+                        uint32_t stop = txout.GetIPCLabel().stopTime;
 
 
                         QString starttime=IntTimeToQStringTime(start);//2
@@ -597,10 +597,10 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         sub.type = TransactionRecord::SendeCoin;
                         const CTxOut& txout = wtx.tx->vout[nOut];
 						std::string y = txout.getTokenSymbol();
-                        //sub.amount = txout.tokenRegLabel.totalCount;
+                        //sub.amount = txout.GetTokenRegLabel().totalCount;
                         sub.ecoinType = y;
 						sub.ecoinNum = QString::number(txout.GetTokenvalue());
-                        int vacc = txout.tokenLabel.accuracy;
+                        int vacc = txout.GetTokenLabel().accuracy;
                         sub.ecoinNum = getAccuracyNum(vacc,sub.ecoinNum);
                         sub.address = CBitcoinAddress(address).ToString();
                         CAmount nValue = txout.nValue;
@@ -744,7 +744,7 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         {
                             LOG_WRITE(LOG_INFO,"SENDMANY");
                             parts.append(TransactionRecord(hash, nTime, TransactionRecord::SendToSelf,add,
-                                                           0, nvalueplus_ ,m_status,m_strtime,m_fee));//txout.ipcLabel.labelTitle,txout.ipcLabel.ExtendType,
+                                                           0, nvalueplus_ ,m_status,m_strtime,m_fee));//txout.GetIPCLabel().labelTitle,txout.GetIPCLabel().ExtendType,
 
                             parts.last().involvesWatchAddress = involvesWatchAddress;// maybe pass to TransactionRecord as constructor argument
                         }
@@ -815,21 +815,21 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         sub.address = CBitcoinAddress(address).ToString();
                         CAmount nValue = txout.nValue;
                         sub.credit = nValue;
-                        std::string title = txout.ipcLabel.labelTitle;
-                        sub.ipcTitle=txout.ipcLabel.labelTitle;
+                        std::string title = txout.GetIPCLabel().labelTitle;
+                        sub.ipcTitle=txout.GetIPCLabel().labelTitle;
                         sub.strstatus=FormatTxStatus(wtx);
                         sub.strtime =FormatTxTime(wtx);
-                        int typenum = txout.ipcLabel.ExtendType;
+                        int typenum = txout.GetIPCLabel().ExtendType;
                         sub.ipcType = typenum;
-                        sub.authType = txout.ipcLabel.reAuthorize;
-                        sub.authLimit =txout.ipcLabel.uniqueAuthorize ;
+                        sub.authType = txout.GetIPCLabel().reAuthorize;
+                        sub.authLimit =txout.GetIPCLabel().uniqueAuthorize ;
 
 
                         if(2 == txout.txType)
                             sub.authType =QObject::tr("ownership");
                         else
                             sub.authType = QObject::tr("Use right");
-                        if(1 == txout.ipcLabel.reAuthorize)
+                        if(1 == txout.GetIPCLabel().reAuthorize)
                         {
                             sub.authLimit = QObject::tr("can authorization");
                         }
@@ -838,8 +838,8 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                             sub.authLimit = QObject::tr("cannot authorization");
                         }
 
-                        uint32_t start = txout.ipcLabel.startTime;
-                        uint32_t stop = txout.ipcLabel.stopTime;
+                        uint32_t start = txout.GetIPCLabel().startTime;
+                        uint32_t stop = txout.GetIPCLabel().stopTime;
 
 
                         QString starttime=IntTimeToQStringTime(start);//2
@@ -941,19 +941,19 @@ QList<TransactionRecord> TransactionRecord::decomposeTransaction(const CWallet *
                         std::string y;
                         int vacc=0;
                         if(4==txout.txType){
-                            y=(char*)(txout.tokenRegLabel.TokenSymbol);
-                            sub.ecoinNum =QString::number(txout.tokenRegLabel.totalCount);
-                            vacc = txout.tokenRegLabel.accuracy;
+                            y=(char*)(txout.GetTokenRegLabel().TokenSymbol);
+                            sub.ecoinNum =QString::number(txout.GetTokenRegLabel().totalCount);
+                            vacc = txout.GetTokenRegLabel().accuracy;
                         }
 						else if (TXOUT_ADDTOKEN == txout.txType){
-							y = (char*)(txout.addTokenLabel.TokenSymbol);
-							sub.ecoinNum = QString::number(txout.addTokenLabel.currentCount);
-							vacc = txout.addTokenLabel.accuracy;
+							y = (char*)(txout.GetAddTokenLabel().TokenSymbol);
+							sub.ecoinNum = QString::number(txout.GetAddTokenLabel().currentCount);
+							vacc = txout.GetAddTokenLabel().accuracy;
 						}
                         else{
-                            y=(char*)(txout.tokenLabel.TokenSymbol);
-                            sub.ecoinNum =QString::number(txout.tokenLabel.value);
-                            vacc = txout.tokenLabel.accuracy;
+                            y=(char*)(txout.GetTokenLabel().TokenSymbol);
+                            sub.ecoinNum =QString::number(txout.GetTokenLabel().value);
+                            vacc = txout.GetTokenLabel().accuracy;
                         }
                         sub.ecoinType =y;
                         sub.ecoinNum = getAccuracyNum(vacc,sub.ecoinNum);
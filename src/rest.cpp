@@ -21,6 +21,7 @@
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const long MAX_REST_ADDRESS_UTXOS = 10000; //most outputs /rest/addressutxos/ returns at once
 
 enum RetFormat {
     RF_UNDEF,
@@ -61,6 +62,8 @@ extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
+extern void ReadAddressUnspentJSON(const std::string& straddress, uint8_t txType, const std::string& symbol, int nStartHeight, int nEndHeight,
+	size_t nLimit, std::string& strCursor, boost::function<void(const UniValue&)> fn);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string message)
 {
@@ -349,6 +352,67 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_addressutxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fAddressIndex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Address index not enabled (use -addressindex)");
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    // <address>/<type>/<count>[/<tokensymbol>[/<start>[/<end>[/<cursor>]]]], empty segments take the defaults:
+    // all token symbols, heights from 0 and without upper limit, the first page
+    if (path.size() < 3 || path.size() > 7)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Use /rest/addressutxos/<address>/<type>/<count>[/<tokensymbol>[/<start>[/<end>[/<cursor>]]]].<ext>");
+    long type = strtol(path[1].c_str(), NULL, 10);
+    long count = strtol(path[2].c_str(), NULL, 10);
+    if (count < 1 || count > MAX_REST_ADDRESS_UTXOS)
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Output count out of range: %s", path[2]));
+    std::string symbol = path.size() > 3 ? path[3] : "";
+    int nStartHeight = 0;
+    if (path.size() > 4 && !path[4].empty() && (!ParseInt32(path[4], &nStartHeight) || nStartHeight < 0))
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Invalid start height: %s", path[4]));
+    int nEndHeight = std::numeric_limits<int>::max();
+    if (path.size() > 5 && !path[5].empty() && (!ParseInt32(path[5], &nEndHeight) || nEndHeight < 0))
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Invalid end height: %s", path[5]));
+    std::string cursor = path.size() > 6 ? path[6] : "";
+
+    switch (rf) {
+    case RF_JSON: {
+        // The page is buffered in strJSON and sent with one reply, count bounds its size
+        std::string strJSON = "{\"utxos\":[";
+        bool fFirst = true;
+        try {
+            ReadAddressUnspentJSON(path[0], (uint8_t)type, symbol, nStartHeight, nEndHeight, count, cursor,
+                [&strJSON, &fFirst](const UniValue& output) {
+                    if (!fFirst)
+                        strJSON += ",";
+                    strJSON += output.write();
+                    fFirst = false;
+                });
+        } catch (const UniValue& objError) {
+            return RESTERR(req, HTTP_BAD_REQUEST, find_value(objError, "message").get_str());
+        }
+        strJSON += "]";
+        if (!cursor.empty())
+            strJSON += ",\"cursor\":\"" + cursor + "\"";
+        strJSON += "}\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -612,6 +676,7 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/addressutxos/", rest_addressutxos},
 };
 
 bool StartREST()
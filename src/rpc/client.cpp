@@ -200,6 +200,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "uniongettxidsfromtxrecord", 2, "maxblocknum" },
     { "addmultiadd", 2, "relatedtome" },
 	{ "getaddressutxos", 1, "type" },
+	{ "getaddressutxos", 3, "options" },
 	{ "addtokenregtoaddress", 2, "addtokenreginfo" },
 	{ "TESTcreaterawtransaction", 0, "inputs" },
 	{ "TESTcreaterawtransaction", 1, "outputs" },
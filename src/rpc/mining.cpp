@@ -726,6 +726,12 @@ UniValue getmininginfo(const JSONRPCRequest& request)
             "  \"networkhashps\": nnn,      (numeric) The network hashes per second\n"
             "  \"pooledtx\": n              (numeric) The size of the mempool\n"
             "  \"chain\": \"xxxx\",           (string) current network name as defined in BIP70 (main, test, regtest)\n"
+            "  \"voteround\": {              (json object) The last vote round this node took part in, if any\n"
+            "     \"blockhash\": \"xxxx\",     (string) The proposed block\n"
+            "     \"precommitms\": nnn,      (numeric) Milliseconds from the proposal to the precommit quorum, -1 if not reached\n"
+            "     \"commitms\": nnn,         (numeric) Milliseconds from the proposal to the commit quorum, -1 if not reached\n"
+            "     \"commits\": nnn           (numeric) The number of commit votes collected\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmininginfo", "")
@@ -733,6 +739,10 @@ UniValue getmininginfo(const JSONRPCRequest& request)
         );
 
 
+    // Taken before cs_main: vote processing holds g_vote_mutex while connecting blocks
+    CVoteRoundStats stats;
+    bool fHaveVoteRound = GetLastVoteRoundStats(stats);
+
     LOCK(cs_main);
 
     UniValue obj(UniValue::VOBJ);
@@ -745,6 +755,15 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     obj.push_back(Pair("networkhashps",    getnetworkhashps(request)));
     obj.push_back(Pair("pooledtx",         (uint64_t)mempool.size()));
     obj.push_back(Pair("chain",            Params().NetworkIDString()));
+
+    if (fHaveVoteRound) {
+        UniValue round(UniValue::VOBJ);
+        round.push_back(Pair("blockhash",   stats.block_hash.GetHex()));
+        round.push_back(Pair("precommitms", stats.nPrecommitQuorumMillis));
+        round.push_back(Pair("commitms",    stats.nCommitQuorumMillis));
+        round.push_back(Pair("commits",     (uint64_t)stats.nCommits));
+        obj.push_back(Pair("voteround", round));
+    }
     return obj;
 }
 
@@ -5,6 +5,7 @@
 
 #include "base58.h"
 #include "clientversion.h"
+#include "core_memusage.h"
 #include "init.h"
 #include "validation.h"
 #include "net.h"
@@ -14,6 +15,8 @@
 #include "util.h"
 #include "utilstrencodings.h"
 #include "txdb.h"
+#include "txmempool.h"
+#include "dpoc/ConsensusAccountPool.h"
 
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
@@ -532,6 +535,111 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     return obj;
 }
 
+static std::string TxOutTypeName(uint8_t txType)
+{
+    switch (txType) {
+    case TXOUT_NORMAL: return "normal";
+    case TXOUT_CAMPAIGN: return "campaign";
+    case TXOUT_IPCOWNER: return "ipcowner";
+    case TXOUT_IPCAUTHORIZATION: return "ipcauthorization";
+    case TXOUT_TOKENREG: return "tokenreg";
+    case TXOUT_TOKEN: return "token";
+    case TXOUT_ADDTOKEN: return "addtoken";
+    case (uint8_t)TXOUT_INVALID: return "spent";
+    }
+    return "unknown";
+}
+
+static UniValue RPCMemoryUsage(size_t nTotal, const std::map<uint8_t, size_t>& mapOutputs)
+{
+    UniValue outputs(UniValue::VOBJ);
+    for (std::map<uint8_t, size_t>::const_iterator it = mapOutputs.begin(); it != mapOutputs.end(); ++it)
+        outputs.push_back(Pair(TxOutTypeName(it->first), uint64_t(it->second)));
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("total", uint64_t(nTotal)));
+    obj.push_back(Pair("outputs", outputs));
+    return obj;
+}
+
+UniValue getmemoryusage(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getmemoryusage\n"
+            "Returns the memory used by the in-memory chain state, split by subsystem.\n"
+            "The outputs of the coins cache, mempool and wallet are broken down by output type\n"
+            "(normal, campaign, ipcowner, ipcauthorization, tokenreg, token, addtoken, spent).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coinscache\": {           (json object) The UTXO cache, limited by -dbcache\n"
+            "    \"total\": xxxxx,         (numeric) Number of bytes used\n"
+            "    \"outputs\": {            (json object) Number of bytes used by the outputs, per output type\n"
+            "      \"type\": xxxxx,\n"
+            "      ...\n"
+            "    }\n"
+            "  },\n"
+            "  \"mempool\": { ... },        (json object) The memory pool, limited by -maxmempool, same fields as coinscache\n"
+            "  \"wallet\": { ... },         (json object) The wallet transactions, same fields as coinscache\n"
+            "  \"snapshots\": {            (json object) The consensus snapshot list\n"
+            "    \"total\": xxxxx          (numeric) Number of bytes used\n"
+            "  },\n"
+            "  \"tokens\": {               (json object) The registered tokens\n"
+            "    \"total\": xxxxx          (numeric) Number of bytes used\n"
+            "  },\n"
+            "  \"addressindex\": {         (json object) The pending writes and caches of the address index\n"
+            "    \"total\": xxxxx          (numeric) Number of bytes used\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmemoryusage", "")
+            + HelpExampleRpc("getmemoryusage", "")
+        );
+
+    UniValue obj(UniValue::VOBJ);
+
+    // These have their own locks, which are not taken after cs_main everywhere
+    size_t nSnapshotUsage = CConsensusAccountPool::Instance().getSnapshotListMemoryUsage();
+    size_t nAddressIndexUsage = pTxDB ? pTxDB->DynamicMemoryUsage() : 0;
+
+    LOCK(cs_main);
+
+    std::map<uint8_t, size_t> mapCoins;
+    pcoinsTip->GetMemoryUsageByType(mapCoins);
+    obj.push_back(Pair("coinscache", RPCMemoryUsage(pcoinsTip->DynamicMemoryUsage(), mapCoins)));
+
+    std::map<uint8_t, size_t> mapMempool;
+    mempool.GetMemoryUsageByType(mapMempool);
+    obj.push_back(Pair("mempool", RPCMemoryUsage(mempool.DynamicMemoryUsage(), mapMempool)));
+
+#ifdef ENABLE_WALLET
+    if (pwalletMain) {
+        LOCK(pwalletMain->cs_wallet);
+        std::map<uint8_t, size_t> mapWalletOutputs;
+        size_t nWalletUsage = memusage::DynamicUsage(pwalletMain->mapWallet);
+        for (std::map<uint256, CWalletTx>::const_iterator it = pwalletMain->mapWallet.begin(); it != pwalletMain->mapWallet.end(); ++it) {
+            const CWalletTx& wtx = it->second;
+            nWalletUsage += memusage::DynamicUsage(wtx.tx) + RecursiveDynamicUsage(*wtx.tx);
+            AddTxOutUsageByType(mapWalletOutputs, wtx.tx->vout);
+        }
+        obj.push_back(Pair("wallet", RPCMemoryUsage(nWalletUsage, mapWalletOutputs)));
+    }
+#endif
+
+    UniValue snapshots(UniValue::VOBJ);
+    snapshots.push_back(Pair("total", uint64_t(nSnapshotUsage)));
+    obj.push_back(Pair("snapshots", snapshots));
+
+    UniValue tokens(UniValue::VOBJ);
+    tokens.push_back(Pair("total", uint64_t(pTokenRegistry ? pTokenRegistry->DynamicMemoryUsage() : 0)));
+    obj.push_back(Pair("tokens", tokens));
+
+    UniValue addressindex(UniValue::VOBJ);
+    addressindex.push_back(Pair("total", uint64_t(nAddressIndexUsage)));
+    obj.push_back(Pair("addressindex", addressindex));
+
+    return obj;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -545,6 +653,34 @@ UniValue echo(const JSONRPCRequest& request)
     return request.params;
 }
 //add by xxy
+/**
+ * Newest first, at most nCount (0 for all) txids of entity: the ones of the
+ * mempool followed by the confirmed ones of txdb. If pfrom is given only
+ * txids older than it are returned, see TxDBProcess::Select.
+ */
+static bool SelectTxIndex(const CTxIndexEntity& entity, std::vector<uint256>& txids, long nCount, const uint256* pfrom = NULL)
+{
+	std::vector<uint256> vMempool;
+	mempool.GetTxIndexTxids(entity, vMempool);
+	std::vector<uint256>::const_iterator it = vMempool.begin();
+	if (pfrom)
+	{
+		it = std::find(vMempool.begin(), vMempool.end(), *pfrom);
+		if (it == vMempool.end())
+			return pTxDB->Select(entity, txids, nCount, pfrom);
+		++it;
+	}
+	for (; it != vMempool.end() && (nCount == 0 || (long)txids.size() < nCount); ++it)
+		txids.push_back(*it);
+	if (nCount != 0 && (long)txids.size() >= nCount)
+		return true;
+
+	std::vector<uint256> vConfirmed;
+	if (pTxDB->Select(entity, vConfirmed, nCount == 0 ? 0 : nCount - txids.size()))
+		txids.insert(txids.end(), vConfirmed.begin(), vConfirmed.end());
+	return !txids.empty();
+}
+
 UniValue getaddresstxids(const JSONRPCRequest& request)
 {
 	if (request.fHelp || request.params.size() <1 || request.params.size() >3)
@@ -583,18 +719,27 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
 	if (request.params.size() >2)
 		hash=request.params[2].get_str();
 
-	std::vector<std::string> txids;
+	uint160 hashBytes;
+	int type = 0;
+	if (!CBitcoinAddress(straddress).GetIndexKey(hashBytes, type))
+	{
+		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invailed address!");
+	}
+	CTxIndexEntity entity = CTxIndexEntity::Address(type, hashBytes);
+
+	std::vector<uint256> txids;
 	txids.clear();
 
 	if (hash == "")
 	{
-		if (!(pTxDB->Select(pTxDB->db, (char*)(straddress.c_str()), txids, nCount)))
+		if (!(SelectTxIndex(entity, txids, nCount)))
 		{
 			throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this address has no txids");
 		}
 	}
 	else{
-		if (!(pTxDB->Select(pTxDB->db, (char*)(straddress.c_str()), txids, nCount, (char*)(hash.c_str()))))
+		uint256 fromHash = uint256S(hash);
+		if (!(SelectTxIndex(entity, txids, nCount, &fromHash)))
 		{
 			throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this address has no txids");
 		}
@@ -602,7 +747,7 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
 
 	UniValue result(UniValue::VARR);
 	for (int i = 0; i < txids.size(); i++)
-		result.push_back(txids[i]);
+		result.push_back(txids[i].GetHex());
 
 	return result;
 }
@@ -634,6 +779,8 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
 	{
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invailed address!");
 	}
+	if (!pTxDB->HasCompleteBalances())
+		throw JSONRPCError(RPC_DATABASE_ERROR, "Address balances are incomplete, restart with -reindex to rebuild them");
 	CAmount balance = 0;
 	CAmount received = 0;
 	CAmount sended = 0;
@@ -686,15 +833,15 @@ UniValue getipchashtxids(const JSONRPCRequest& request)
 		throw JSONRPCError(RPC_TYPE_ERROR, "this ipchash was Wrongful ");
 	}
 
-	std::vector<std::string> txids;
+	std::vector<uint256> txids;
 	txids.clear();
-	if (!pTxDB->Select(pTxDB->db, (char*)(ipchash.c_str()),txids,0))
+	if (!SelectTxIndex(CTxIndexEntity::IPC(ipcHash), txids, 0))
 	{
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this ipchash has no txids");
 	}
 	UniValue result(UniValue::VARR);
 	for (int i = 0; i < txids.size(); i++)
-		result.push_back(txids[i]);
+		result.push_back(txids[i].GetHex());
 	return result;
 }
 
@@ -732,17 +879,24 @@ UniValue gettokensymboltxids(const JSONRPCRequest& request)
 	if (request.params.size() >2)
 		hash = request.params[2].get_str();
 
-	std::vector<std::string> txids;
+	if (tokensymbol.empty() || tokensymbol.size() > CTxIndexEntity::TOKEN_SYMBOL_WIDTH)
+	{
+		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this tokensymbol has no txids");
+	}
+	CTxIndexEntity entity = CTxIndexEntity::Token(tokensymbol);
+
+	std::vector<uint256> txids;
 	txids.clear();
 	if (hash == "")
 	{
-		if (!(pTxDB->Select(pTxDB->db, (char*)(tokensymbol.c_str()), txids,nCount)))
+		if (!(SelectTxIndex(entity, txids, nCount)))
 		{
 			throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this tokensymbol has no txids");
 		}
 	}
 	else{
-		if (!(pTxDB->Select(pTxDB->db, (char*)(tokensymbol.c_str()), txids, nCount, (char*)(hash.c_str()))))
+		uint256 fromHash = uint256S(hash);
+		if (!(SelectTxIndex(entity, txids, nCount, &fromHash)))
 		{
 			throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this tokensymbol has no txids");
 		}
@@ -750,7 +904,7 @@ UniValue gettokensymboltxids(const JSONRPCRequest& request)
 	
 	UniValue result(UniValue::VARR);
 	for (int i = 0; i < txids.size(); i++)
-		result.push_back(txids[i]);
+		result.push_back(txids[i].GetHex());
 
 	return result;
 }
@@ -778,15 +932,16 @@ UniValue gettokenlabelbysymbol(const JSONRPCRequest& request)
 		);
 	std::string tokensymbol = request.params[0].get_str();
 	UniValue result(UniValue::VOBJ);
-	if (!tokenDataMap.count(tokensymbol))
+	CTokenRecord record;
+	if (!GetTokenRecord(tokensymbol, record))
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this tokensymbol has no TokenReg");
 	
-	result.push_back(Pair("tokenSymbol", tokenDataMap[tokensymbol].getTokenSymbol()));
-	result.push_back(Pair("totalCount", ValueFromTCoins(tokenDataMap[tokensymbol].getTotalCount(), (int)tokenDataMap[tokensymbol].getAccuracy())));
-	result.push_back(Pair("accuracy", tokenDataMap[tokensymbol].getAccuracy()));
-	result.push_back(Pair("tokenhash", tokenDataMap[tokensymbol].getHash().GetHex()));
-	result.push_back(Pair("label", tokenDataMap[tokensymbol].getTokenLabel()));
-	result.push_back(Pair("regtime", tokenDataMap[tokensymbol].getIssueDate()));
+	result.push_back(Pair("tokenSymbol", record.getTokenSymbol()));
+	result.push_back(Pair("totalCount", ValueFromTCoins(record.getTotalCount(), (int)record.getAccuracy())));
+	result.push_back(Pair("accuracy", record.getAccuracy()));
+	result.push_back(Pair("tokenhash", record.getHash().GetHex()));
+	result.push_back(Pair("label", record.getTokenLabel()));
+	result.push_back(Pair("regtime", record.getIssueDate()));
 	
 	
 	return result;
@@ -805,22 +960,132 @@ bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &addr
 	}
 	return true;
 }
-bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
-	std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
-	return a.second.blockHeight < b.second.blockHeight;
+//An output of the address UTXO index as getaddressutxos shows it, false for outputs it leaves out
+static bool AddressUnspentToJSON(const CAddressUnspentKey& key, const CAddressUnspentValue& value, int nTipHeight, UniValue& output)
+{
+	std::string address;
+	if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+	}
+	output = UniValue(UniValue::VOBJ);
+	if (key.txType == 0)
+	{
+		if (value.unspentout.nValue == 0)   //coinbase  txtype=1  nvalue=0
+			return false;
+		output.push_back(Pair("address", address));
+		output.push_back(Pair("txid", key.txhash.GetHex()));
+		output.push_back(Pair("vout", (int)key.index));
+		output.push_back(Pair("scriptPubKey", HexStr(value.unspentout.scriptPubKey.begin(), value.unspentout.scriptPubKey.end())));
+		output.push_back(Pair("amount", ValueFromAmount(value.unspentout.nValue)));
+		output.push_back(Pair("height", value.blockHeight));
+		output.push_back(Pair("confirmations", nTipHeight - value.blockHeight + 1));
+		return true;
+	}
+	else if (key.txType == 1)
+	{
+		output.push_back(Pair("address", address));
+		output.push_back(Pair("txid", key.txhash.GetHex()));
+		output.push_back(Pair("vout", (int)key.index));
+		output.push_back(Pair("scriptPubKey", HexStr(value.unspentout.scriptPubKey.begin(), value.unspentout.scriptPubKey.end())));
+		output.push_back(Pair("TokenSymbol", value.unspentout.getTokenSymbol()));
+		output.push_back(Pair("tokenvalue", ValueFromTCoinsN(value.unspentout.GetTokenvalue(), (int)value.unspentout.getTokenaccuracy())));
+		output.push_back(Pair("TokenAccuracy", value.unspentout.getTokenaccuracy()));
+		output.push_back(Pair("height", value.blockHeight));
+		output.push_back(Pair("confirmations", nTipHeight - value.blockHeight + 1));
+		return true;
+	}
+	//now only  support ipc and token type
+	return false;
+}
+
+/**
+ * Hand the outputs of an address and output class in the address UTXO index
+ * to fn one by one, in the order of CBlockTreeDB::ReadAddressUnspentIndex.
+ * If strCursor is not empty the walk continues after the output it names.
+ * After nLimit outputs (0 for no limit) it stops and sets strCursor to
+ * continue from there, otherwise strCursor is cleared.
+ */
+void ReadAddressUnspentJSON(const std::string& straddress, uint8_t txType, const std::string& symbol, int nStartHeight, int nEndHeight,
+	size_t nLimit, std::string& strCursor, boost::function<void(const UniValue&)> fn)
+{
+	uint160 hashBytes;
+	int type = 0;
+	if (!CBitcoinAddress(straddress).GetIndexKey(hashBytes, type)) {
+		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+	}
+	if (txType != 0 && txType != 1)
+		throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid type of utxo");
+	if (symbol.size() > CAddressUnspentKey::SYMBOL_WIDTH)
+		throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid token symbol");
+
+	CAddressUnspentKey cursor;
+	bool fCursor = !strCursor.empty();
+	if (fCursor)
+	{
+		std::vector<unsigned char> vch = ParseHex(strCursor);
+		if (!IsHex(strCursor) || vch.size() != cursor.GetSerializeSize())
+			throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid cursor");
+		CDataStream ss(vch, SER_DISK, CLIENT_VERSION);
+		ss >> cursor;
+		if (cursor.type != (unsigned int)type || cursor.hashBytes != hashBytes || cursor.txType != txType ||
+			(!symbol.empty() && cursor.tokensymbol != symbol))
+			throw JSONRPCError(RPC_INVALID_PARAMS, "Cursor does not belong to this query");
+	}
+
+	int nTipHeight;
+	{
+		LOCK(cs_main);
+		nTipHeight = chainActive.Height();
+	}
+
+	size_t nCount = 0;
+	bool fMore = false;
+	CAddressUnspentKey last;
+	auto visit = [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+		UniValue output;
+		if (!AddressUnspentToJSON(key, value, nTipHeight, output))
+			return true;
+		if (nLimit != 0 && nCount == nLimit) {
+			fMore = true;
+			return false;
+		}
+		fn(output);
+		last = key;
+		nCount++;
+		return true;
+	};
+	if (!pblocktree->ReadAddressUnspentIndex(hashBytes, type, txType, symbol, nStartHeight, nEndHeight, fCursor ? &cursor : NULL, visit)) {
+		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+	}
+
+	strCursor.clear();
+	if (fMore)
+	{
+		CDataStream ss(SER_DISK, CLIENT_VERSION);
+		ss << last;
+		strCursor = HexStr(ss.begin(), ss.end());
+	}
 }
 
 UniValue getaddressutxos(const JSONRPCRequest&  request)
 {
-	if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
+	if (request.fHelp || request.params.size() < 2 || request.params.size() > 4)
 		throw runtime_error(
 		"getaddressutxos\n"
 		"\nReturns all unspent outputs for an address (requires addressindex to be enabled).\n"
+		"Outputs come by height. With options they are returned a page at a time, by token symbol and then by height.\n"
 		"\nArguments:\n"
 		"{\n"
 		"1.    \"address\"  (string) The base58check encoded address\n"
 		"2.    \"type\"	   (numeric)	The txType of utxo which you want to get.(0 ipc  1 token)\n"
-		"3.    \"tokensymbol\"	   (string)	The token symbol when type = 1.\n"
+		"3.    \"tokensymbol\"	   (string)	The token symbol when type = 1, \"\" for all.\n"
+		"4.    \"options\"	   (object, optional)\n"
+		"       {\n"
+		"         \"start\"  (numeric) The lowest height of the outputs, default 0\n"
+		"         \"end\"    (numeric) The highest height of the outputs, default no limit\n"
+		"         \"limit\"  (numeric) The most outputs to return, default 0 for no limit\n"
+		"         \"cursor\" (string) The cursor returned by the previous page\n"
+		"       }\n"
 		"}\n"
 		"\nResult\n"
 		"[\n"
@@ -835,8 +1100,14 @@ UniValue getaddressutxos(const JSONRPCRequest&  request)
 		"     ......"
 		"  }\n"
 		"]\n"
+		"\nResult with options\n"
+		"{\n"
+		"  \"utxos\": [ ... ],   (array) The outputs as above\n"
+		"  \"cursor\": \"hex\"     (string) Present if there are more outputs, pass it to get the next page\n"
+		"}\n"
 		"\nExamples:\n"
 		+ HelpExampleCli("getaddressutxos", "\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\", 4")
+		+ HelpExampleCli("getaddressutxos", "\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\" 1 \"\" '{\"limit\": 100}'")
 		+ HelpExampleRpc("getaddressutxos", "\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\", 4")
 		);
 
@@ -850,12 +1121,6 @@ UniValue getaddressutxos(const JSONRPCRequest&  request)
 	{
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invailed address!");
 	}
-	CBitcoinAddress address(straddress);
-	uint160 hashBytes;
-	int type = 0;
-	if (!address.GetIndexKey(hashBytes, type)) {
-		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-	}
 	if (request.params[1].get_int() != 0 && request.params[1].get_int() !=1 )
 		throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid type of utxo");
 	uint8_t uxtotype = (uint8_t)request.params[1].get_int();
@@ -865,63 +1130,57 @@ UniValue getaddressutxos(const JSONRPCRequest&  request)
 		strtokensymbol = request.params[2].get_str();
 	}
 
-	std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
-
-	if (!(pblocktree->ReadAddressUnspentIndex(hashBytes, type, uxtotype, unspentOutputs))) {
-		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+	int nStartHeight = 0;
+	int nEndHeight = std::numeric_limits<int>::max();
+	int64_t nLimit = 0;
+	std::string strCursor;
+	bool fOptions = request.params.size() > 3 && !request.params[3].isNull();
+	if (fOptions)
+	{
+		const UniValue& options = request.params[3].get_obj();
+		RPCTypeCheckObj(options,
+			{
+				{"start", UniValueType(UniValue::VNUM)},
+				{"end", UniValueType(UniValue::VNUM)},
+				{"limit", UniValueType(UniValue::VNUM)},
+				{"cursor", UniValueType(UniValue::VSTR)},
+			}, true, true);
+		if (options.exists("start"))
+			nStartHeight = options["start"].get_int();
+		if (options.exists("end"))
+			nEndHeight = options["end"].get_int();
+		if (options.exists("limit"))
+			nLimit = options["limit"].get_int64();
+		if (options.exists("cursor"))
+			strCursor = options["cursor"].get_str();
+		if (nStartHeight < 0 || nEndHeight < 0 || nLimit < 0)
+			throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid start, end or limit");
 	}
-	
-
-	std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
-
-	UniValue utxos(UniValue::VARR);
 
-	for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
-		UniValue output(UniValue::VOBJ);
-		std::string address;
-		if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-			throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-		}
-		if (uxtotype == 0 && uxtotype == it->first.txType)
-		{
-			if (it->second.unspentout.nValue == 0)   //coinbase  txtype=1  nvalue=0
-			   continue;
-			output.push_back(Pair("address", address));
-			output.push_back(Pair("txid", it->first.txhash.GetHex()));
-			output.push_back(Pair("vout", (int)it->first.index));
-			output.push_back(Pair("scriptPubKey", HexStr(it->second.unspentout.scriptPubKey.begin(), it->second.unspentout.scriptPubKey.end())));
-			output.push_back(Pair("amount", ValueFromAmount(it->second.unspentout.nValue)));
-			output.push_back(Pair("height", it->second.blockHeight));
-			output.push_back(Pair("confirmations", chainActive.Height() - it->second.blockHeight+1));
-			utxos.push_back(output);
-		}
-		else if (uxtotype == 1 && uxtotype == it->first.txType)
-		{
-			if (request.params.size() > 2)
-			{
-				if (strtokensymbol != it->second.unspentout.getTokenSymbol())
-					continue;
-			}
-			output.push_back(Pair("address", address));
-			output.push_back(Pair("txid", it->first.txhash.GetHex()));
-			output.push_back(Pair("vout", (int)it->first.index));
-			output.push_back(Pair("scriptPubKey", HexStr(it->second.unspentout.scriptPubKey.begin(), it->second.unspentout.scriptPubKey.end())));
-			output.push_back(Pair("TokenSymbol", it->second.unspentout.getTokenSymbol()));
-			output.push_back(Pair("tokenvalue", ValueFromTCoinsN(it->second.unspentout.GetTokenvalue(), (int)it->second.unspentout.getTokenaccuracy())));
-			output.push_back(Pair("TokenAccuracy", it->second.unspentout.getTokenaccuracy()));
-			output.push_back(Pair("height", it->second.blockHeight));
-			output.push_back(Pair("confirmations", chainActive.Height() - it->second.blockHeight + 1));
-			utxos.push_back(output);
-		}
-		else if (uxtotype == 2 && uxtotype == it->first.txType)
-		{
-			//now only  support ipc and token type
-		}
-	
+	if (!fOptions)
+	{
+		//The index keeps the outputs of each symbol apart, the whole set is returned by height
+		std::vector<std::pair<int, UniValue> > vOutputs;
+		ReadAddressUnspentJSON(straddress, uxtotype, strtokensymbol, nStartHeight, nEndHeight, nLimit, strCursor,
+			[&vOutputs](const UniValue& output) { vOutputs.push_back(std::make_pair(find_value(output, "height").get_int(), output)); });
+		std::stable_sort(vOutputs.begin(), vOutputs.end(),
+			[](const std::pair<int, UniValue>& a, const std::pair<int, UniValue>& b) { return a.first < b.first; });
+
+		UniValue utxos(UniValue::VARR);
+		for (const std::pair<int, UniValue>& output : vOutputs)
+			utxos.push_back(output.second);
+		return utxos;
 	}
 
+	UniValue utxos(UniValue::VARR);
+	ReadAddressUnspentJSON(straddress, uxtotype, strtokensymbol, nStartHeight, nEndHeight, nLimit, strCursor,
+		[&utxos](const UniValue& output) { utxos.push_back(output); });
 
-	return utxos;
+	UniValue result(UniValue::VOBJ);
+	result.push_back(Pair("utxos", utxos));
+	if (!strCursor.empty())
+		result.push_back(Pair("cursor", strCursor));
+	return result;
 
 }
 
@@ -952,8 +1211,11 @@ UniValue gettokenbalancebyaddress(const JSONRPCRequest& request)
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invailed address!");
 	}
 	std::string tokensymbol = request.params[1].get_str();
-	if (!tokenDataMap.count(tokensymbol))
+	CTokenRecord record;
+	if (!GetTokenRecord(tokensymbol, record))
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this tokensymbol has no TokenReg");
+	if (!pTxDB->HasCompleteBalances())
+		throw JSONRPCError(RPC_DATABASE_ERROR, "Address balances are incomplete, restart with -reindex to rebuild them");
 	CAmount balance = 0;
 	CAmount received = 0;
 	CAmount sended = 0;
@@ -966,7 +1228,7 @@ UniValue gettokenbalancebyaddress(const JSONRPCRequest& request)
 	UniValue result(UniValue::VOBJ);
 	result.push_back(Pair("address", straddress));
 	result.push_back(Pair("tokensymbol", tokensymbol));
-	result.push_back(Pair("tokenbalance", ValueFromTCoins(balance, (int)tokenDataMap[tokensymbol].getAccuracy())));
+	result.push_back(Pair("tokenbalance", ValueFromTCoins(balance, (int)record.getAccuracy())));
 	return result;
 }
 //end
@@ -977,6 +1239,7 @@ static const CRPCCommand commands[] =
     { "hide",			    "getIPCversion",		  &getipcversion,		   true, {} }, /* uses wallet if enabled */
     { "control",			"getipcversion",		  &getipcversion,		   true, {} },
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
+    { "control",            "getmemoryusage",         &getmemoryusage,         true,  {} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"address"} }, /* uses wallet if enabled */
 	{ "util", "verifymessage", &verifymessage, true, { "address", "signature", "message" } },
 	{ "util", "signmessagewithprivkey", &signmessagewithprivkey, true, { "privkey", "message" } },
@@ -989,7 +1252,7 @@ static const CRPCCommand commands[] =
 	{ "util",				"getipchashtxids",		  &getipchashtxids,			true,  { "ipchash" } },
 	{ "util",				"gettokensymboltxids",	  &gettokensymboltxids,		true,  { "tokensymbol" "nCount" "txid"} },
 	{ "util",				"gettokenlabelbysymbol",  &gettokenlabelbysymbol,	true, { "tokensymbol" } },
-	{ "util", "getaddressutxos", &getaddressutxos, false, {"address" "type"} },
+	{ "util", "getaddressutxos", &getaddressutxos, false, {"address","type","tokensymbol","options"} },
     /* Not shown in help */
 //    { "hidden",             "setmocktime",            &setmocktime,            true,  {"timestamp"}},
     { "hidden",             "echo",                   &echo,                   true,	{"arg0","arg1","arg2","arg3","arg4","arg5","arg6","arg7","arg8","arg9"}},
@@ -90,10 +90,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 			{
 				UniValue add(UniValue::VARR);
 				if (!GetTransaction(txin.prevout.hash, prevTx, Params().GetConsensus(), hashblock, true))
-				{
-					if (!GetCachedChainTransaction(tx.vin[i].prevout.hash, prevTx))
-						throw JSONRPCError(RPC_VERIFY_ERROR, "bad-input,Wrongful.");
-				}
+					throw JSONRPCError(RPC_VERIFY_ERROR, "bad-input,Wrongful.");
 				const CTxOut& prev = prevTx->vout[txin.prevout.n];
 				if (!ExtractDestinations(prev.scriptPubKey, type, txoutdestes, nRequired))
 					throw JSONRPCError(RPC_VERIFY_ERROR, "txin-address-unextracted.");
@@ -109,29 +106,29 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 				{
 					case 4:
 						{
-							  in.push_back(Pair("tokensymbol", prev.tokenRegLabel.getTokenSymbol()));
-							  UniValue tt = ValueFromTCoins(prev.tokenRegLabel.totalCount, (int)tokenDataMap[prev.tokenRegLabel.getTokenSymbol()].getAccuracy()).get_str();
+							  in.push_back(Pair("tokensymbol", prev.GetTokenRegLabel().getTokenSymbol()));
+							  UniValue tt = ValueFromTCoins(prev.GetTokenRegLabel().totalCount, (int)GetTokenAccuracy(prev.GetTokenRegLabel().getTokenSymbol())).get_str();
 							  std::string strvalue = tt.get_str();
 							  in.push_back(Pair("tokenvalue", strvalue));
-							  in.push_back(Pair("accuracy", prev.tokenRegLabel.accuracy));
+							  in.push_back(Pair("accuracy", prev.GetTokenRegLabel().accuracy));
 						}
 						break;
 					case 5:
 						{
-							  in.push_back(Pair("tokensymbol", prev.tokenLabel.getTokenSymbol()));
-							  UniValue tt = ValueFromTCoins(prev.tokenLabel.value, (int)tokenDataMap[prev.tokenLabel.getTokenSymbol()].getAccuracy());
+							  in.push_back(Pair("tokensymbol", prev.GetTokenLabel().getTokenSymbol()));
+							  UniValue tt = ValueFromTCoins(prev.GetTokenLabel().value, (int)GetTokenAccuracy(prev.GetTokenLabel().getTokenSymbol()));
 							  std::string strvalue = tt.get_str();
 							  in.push_back(Pair("tokenvalue", strvalue));
-							  in.push_back(Pair("accuracy", prev.tokenLabel.accuracy));
+							  in.push_back(Pair("accuracy", prev.GetTokenLabel().accuracy));
 						}
 						break;
 					case TXOUT_ADDTOKEN:
 					{
-							in.push_back(Pair("tokensymbol", prev.addTokenLabel.getTokenSymbol()));
-							UniValue totalCount = ValueFromTCoins(prev.addTokenLabel.totalCount, (int)(tokenDataMap[prev.addTokenLabel.getTokenSymbol()].getAccuracy()));
-							UniValue currentCount = ValueFromTCoins(prev.addTokenLabel.currentCount, (int)(tokenDataMap[prev.addTokenLabel.getTokenSymbol()].getAccuracy()));
-							in.push_back(Pair("automode", prev.addTokenLabel.addmode));
-							in.push_back(Pair("height", prev.addTokenLabel.height));
+							in.push_back(Pair("tokensymbol", prev.GetAddTokenLabel().getTokenSymbol()));
+							UniValue totalCount = ValueFromTCoins(prev.GetAddTokenLabel().totalCount, (int)(GetTokenAccuracy(prev.GetAddTokenLabel().getTokenSymbol())));
+							UniValue currentCount = ValueFromTCoins(prev.GetAddTokenLabel().currentCount, (int)(GetTokenAccuracy(prev.GetAddTokenLabel().getTokenSymbol())));
+							in.push_back(Pair("automode", prev.GetAddTokenLabel().addmode));
+							in.push_back(Pair("height", prev.GetAddTokenLabel().height));
 							in.push_back(Pair("totalCount", totalCount.get_str()));
 							in.push_back(Pair("currentCount", currentCount.get_str()));
 					}
@@ -170,31 +167,31 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 		switch (txout.txType)
 		{
 		case 1:
-			out.push_back(Pair("devotetype", txout.devoteLabel.ExtendType));
-			out.push_back(Pair("devotepubkeyhash160", txout.devoteLabel.hash.GetHex()));
+			out.push_back(Pair("devotetype", txout.GetDevoteLabel().ExtendType));
+			out.push_back(Pair("devotepubkeyhash160", txout.GetDevoteLabel().hash.GetHex()));
 			out.push_back(Pair("txLabelLen", txout.txLabelLen));
 			out.push_back(Pair("txLabel", txout.txLabel));
 			break;
 
 		case 4:
 			{
-				  out.push_back(Pair("TokenSymbol", txout.tokenRegLabel.getTokenSymbol()));
-				  out.push_back(Pair("TokenValue", uint64_t(0)/*txout.tokenRegLabel.value*/));
-				  out.push_back(Pair("TokenHash", txout.tokenRegLabel.hash.GetHex()));
-				  out.push_back(Pair("TokenLabel", txout.tokenRegLabel.getTokenLabel()));
-				  out.push_back(Pair("TokenIssue", txout.tokenRegLabel.issueDate));
+				  out.push_back(Pair("TokenSymbol", txout.GetTokenRegLabel().getTokenSymbol()));
+				  out.push_back(Pair("TokenValue", uint64_t(0)/*txout.GetTokenRegLabel().value*/));
+				  out.push_back(Pair("TokenHash", txout.GetTokenRegLabel().hash.GetHex()));
+				  out.push_back(Pair("TokenLabel", txout.GetTokenRegLabel().getTokenLabel()));
+				  out.push_back(Pair("TokenIssue", txout.GetTokenRegLabel().issueDate));
 				  UniValue tt;
 				  if (isForIsolation)
 				  {
-					  tt = ValueFromTCoins(txout.tokenRegLabel.totalCount, txout.tokenRegLabel.accuracy);
+					  tt = ValueFromTCoins(txout.GetTokenRegLabel().totalCount, txout.GetTokenRegLabel().accuracy);
 				  }
 				  else
 				  {
-					  tt = ValueFromTCoins(txout.tokenRegLabel.totalCount, (int)(tokenDataMap[txout.tokenRegLabel.getTokenSymbol()].getAccuracy()));
+					  tt = ValueFromTCoins(txout.GetTokenRegLabel().totalCount, (int)(GetTokenAccuracy(txout.GetTokenRegLabel().getTokenSymbol())));
 				  }
 				  std::string strvalue = tt.get_str();
 				  out.push_back(Pair("TokenTotalCount", strvalue));
-				  out.push_back(Pair("accuracy", txout.tokenRegLabel.accuracy));
+				  out.push_back(Pair("accuracy", txout.GetTokenRegLabel().accuracy));
 				  out.push_back(Pair("txLabelLen", txout.txLabelLen));
 				  out.push_back(Pair("txLabel", txout.txLabel));
 			}
@@ -203,19 +200,19 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 
 		case 5:
 			{
-				  out.push_back(Pair("TokenSymbol", txout.tokenLabel.getTokenSymbol()));
+				  out.push_back(Pair("TokenSymbol", txout.GetTokenLabel().getTokenSymbol()));
 				  UniValue tt;
 				  if (isForIsolation)
 				  {
-					  tt = ValueFromTCoins(txout.tokenLabel.value, txout.tokenLabel.accuracy);
+					  tt = ValueFromTCoins(txout.GetTokenLabel().value, txout.GetTokenLabel().accuracy);
 				  }
 				  else
 				  {
-					  tt = ValueFromTCoins(txout.tokenLabel.value, (int)tokenDataMap[txout.tokenLabel.getTokenSymbol()].getAccuracy());
+					  tt = ValueFromTCoins(txout.GetTokenLabel().value, (int)GetTokenAccuracy(txout.GetTokenLabel().getTokenSymbol()));
 				  }
  				  std::string strvalue = tt.get_str();
 				  out.push_back(Pair("TokenValue", strvalue));
-				  out.push_back(Pair("accuracy", txout.tokenLabel.accuracy));
+				  out.push_back(Pair("accuracy", txout.GetTokenLabel().accuracy));
 				  out.push_back(Pair("txLabelLen", txout.txLabelLen));
 				  out.push_back(Pair("txLabel", txout.txLabel));
 			}
@@ -224,48 +221,48 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 
 		case 2:
 		case 3:
-			out.push_back(Pair("extype", txout.ipcLabel.ExtendType));
-			out.push_back(Pair("starttime", txout.ipcLabel.startTime));
-			out.push_back(Pair("stoptime", txout.ipcLabel.stopTime));
-			out.push_back(Pair("reauthorize", txout.ipcLabel.reAuthorize));
-			out.push_back(Pair("uniqueauthorize", txout.ipcLabel.uniqueAuthorize));
-			out.push_back(Pair("hashLen", txout.ipcLabel.hashLen));
-			out.push_back(Pair("IPChash", txout.ipcLabel.hash.GetHex()));
-			out.push_back(Pair("IPCTitle", txout.ipcLabel.labelTitle));
+			out.push_back(Pair("extype", txout.GetIPCLabel().ExtendType));
+			out.push_back(Pair("starttime", txout.GetIPCLabel().startTime));
+			out.push_back(Pair("stoptime", txout.GetIPCLabel().stopTime));
+			out.push_back(Pair("reauthorize", txout.GetIPCLabel().reAuthorize));
+			out.push_back(Pair("uniqueauthorize", txout.GetIPCLabel().uniqueAuthorize));
+			out.push_back(Pair("hashLen", txout.GetIPCLabel().hashLen));
+			out.push_back(Pair("IPChash", txout.GetIPCLabel().hash.GetHex()));
+			out.push_back(Pair("IPCTitle", txout.GetIPCLabel().labelTitle));
 			out.push_back(Pair("txLabelLen", txout.txLabelLen));
 			out.push_back(Pair("txLabel",txout.txLabel)); 
 			break;
 		case TXOUT_ADDTOKEN:
 		{
-				  out.push_back(Pair("TokenSymbol", txout.addTokenLabel.getTokenSymbol()));
-				  out.push_back(Pair("TokenValue", uint64_t(0)/*txout.tokenRegLabel.value*/));
-				  out.push_back(Pair("TokenHash", txout.addTokenLabel.hash.GetHex()));
-				  out.push_back(Pair("TokenLabel", txout.addTokenLabel.getTokenLabel()));
-				  out.push_back(Pair("TokenIssue", txout.addTokenLabel.issueDate));
+				  out.push_back(Pair("TokenSymbol", txout.GetAddTokenLabel().getTokenSymbol()));
+				  out.push_back(Pair("TokenValue", uint64_t(0)/*txout.GetTokenRegLabel().value*/));
+				  out.push_back(Pair("TokenHash", txout.GetAddTokenLabel().hash.GetHex()));
+				  out.push_back(Pair("TokenLabel", txout.GetAddTokenLabel().getTokenLabel()));
+				  out.push_back(Pair("TokenIssue", txout.GetAddTokenLabel().issueDate));
 				  UniValue TokenTotalCount;
 				  if (isForIsolation)
 				  {
-					  TokenTotalCount = ValueFromTCoins(txout.addTokenLabel.totalCount, txout.addTokenLabel.accuracy);
+					  TokenTotalCount = ValueFromTCoins(txout.GetAddTokenLabel().totalCount, txout.GetAddTokenLabel().accuracy);
 				  }
 				  else
 				  {
-					  TokenTotalCount = ValueFromTCoins(txout.addTokenLabel.totalCount, (int)tokenDataMap[txout.addTokenLabel.getTokenSymbol()].getAccuracy()).get_str();
+					  TokenTotalCount = ValueFromTCoins(txout.GetAddTokenLabel().totalCount, (int)GetTokenAccuracy(txout.GetAddTokenLabel().getTokenSymbol())).get_str();
 				  }
 				  UniValue TokenCurrentCount;
 				  if (isForIsolation)
 				  {
-					  TokenCurrentCount = ValueFromTCoins(txout.addTokenLabel.currentCount, txout.addTokenLabel.accuracy);
+					  TokenCurrentCount = ValueFromTCoins(txout.GetAddTokenLabel().currentCount, txout.GetAddTokenLabel().accuracy);
 				  }
 				  else
 				  {
-					  TokenCurrentCount = ValueFromTCoins(txout.addTokenLabel.currentCount, (int)tokenDataMap[txout.addTokenLabel.getTokenSymbol()].getAccuracy()).get_str();
+					  TokenCurrentCount = ValueFromTCoins(txout.GetAddTokenLabel().currentCount, (int)GetTokenAccuracy(txout.GetAddTokenLabel().getTokenSymbol())).get_str();
 				  }
-				  out.push_back(Pair("automode", txout.addTokenLabel.addmode));
-				  out.push_back(Pair("height", txout.addTokenLabel.height));
+				  out.push_back(Pair("automode", txout.GetAddTokenLabel().addmode));
+				  out.push_back(Pair("height", txout.GetAddTokenLabel().height));
 				  out.push_back(Pair("TokenTotalCount", TokenTotalCount.get_str()));
 				  out.push_back(Pair("TokenCurrentCount", TokenCurrentCount.get_str()));
 
-				  out.push_back(Pair("accuracy", txout.addTokenLabel.accuracy));
+				  out.push_back(Pair("accuracy", txout.GetAddTokenLabel().accuracy));
 				  out.push_back(Pair("txLabelLen", txout.txLabelLen));
 				  out.push_back(Pair("txLabel", txout.txLabel));
 
@@ -1085,16 +1082,16 @@ UniValue createrawtransaction(const JSONRPCRequest& request)
 		{
 			strScripTokentnewout = preout.scriptPubKey;
 			isFindTokenchange = true;
-			tokenlabel = preout.tokenLabel;
-			strtokensymbol = preout.tokenLabel.getTokenSymbol();
+			tokenlabel = preout.GetTokenLabel();
+			strtokensymbol = preout.GetTokenLabel().getTokenSymbol();
 		}
 		if (utxotype == TXOUT_NORMAL)
 			nVinAllValue += preout.nValue;
 		if (utxotype == TXOUT_TOKEN)
 		{
-			if (strtokensymbol != preout.tokenLabel.getTokenSymbol())
+			if (strtokensymbol != preout.GetTokenLabel().getTokenSymbol())
 				throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, Multiple token types are not allowed in input ");
-			nVinAllTokenValue += preout.tokenLabel.value;
+			nVinAllTokenValue += preout.GetTokenLabel().value;
 		}
 		CTxIn in(COutPoint(txid, nOutput), CScript(), nSequence);
 		rawTx.vin.push_back(in);
@@ -266,6 +266,26 @@ BOOST_AUTO_TEST_CASE(base58_keys_invalid)
     }
 }
 
+// Goal: check that the decoded system account matches its base58 address
+BOOST_AUTO_TEST_CASE(base58_system_account)
+{
+    const std::string networks[] = {CBaseChainParams::MAIN, CBaseChainParams::TESTNET};
+    BOOST_FOREACH(const std::string& network, networks) {
+        SelectParams(network);
+        CBitcoinAddress addr(Params().system_account_address);
+        CKeyID keyID;
+        BOOST_CHECK(addr.GetKeyID(keyID));
+        BOOST_CHECK(keyID == Params().SystemAccountID());
+        BOOST_CHECK(Params().SystemAccountScript() == GetScriptForDestination(addr.Get()));
+        BOOST_CHECK(Params().IsSystemAccount(addr.Get()));
+        BOOST_CHECK(!Params().IsSystemAccount(CScriptID(keyID)));
+        BOOST_CHECK(!Params().IsSystemAccount(CNoDestination()));
+    }
+    SelectParams(CBaseChainParams::REGTEST);
+    BOOST_CHECK(!Params().IsSystemAccount(CKeyID()));
+    SelectParams(CBaseChainParams::MAIN);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
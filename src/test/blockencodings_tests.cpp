@@ -2,10 +2,16 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "blockencodings.h"
 #include "consensus/merkle.h"
+#include "consensus/validation.h"
 #include "chainparams.h"
+#include "hash.h"
+#include "key.h"
+#include "net_processing.h"
 #include "random.h"
+#include "validation.h"
 
 #include "test/test_bitcoin.h"
 
@@ -314,6 +320,259 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+// Sign a proposal the way its proposer does, in the first output of the coinbase
+static void SignProposal(CBlock& block) {
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+
+    CAmount nFee = block.vtx[0]->GetValueOut();
+    uint256 hash;
+    CHash256().Write((unsigned char*)&block.nPeriodStartTime, sizeof(block.nPeriodStartTime))
+              .Write((unsigned char*)&block.nPeriodCount, sizeof(block.nPeriodCount))
+              .Write((unsigned char*)&block.nTimePeriod, sizeof(block.nTimePeriod))
+              .Write((unsigned char*)&block.nTime, sizeof(block.nTime))
+              .Write((unsigned char*)&nFee, sizeof(nFee))
+              .Write(block.hashPrevBlock.begin(), 32)
+              .Finalize(hash.begin());
+    std::vector<unsigned char> vchSig;
+    BOOST_REQUIRE(key.Sign(hash, vchSig));
+
+    std::vector<unsigned char> vchSigSend;
+    vchSigSend.push_back((unsigned char)vchSig.size());
+    vchSigSend.insert(vchSigSend.end(), vchSig.begin(), vchSig.end());
+    vchSigSend.push_back((unsigned char)pubkey.size());
+    vchSigSend.insert(vchSigSend.end(), pubkey.begin(), pubkey.end());
+
+    CMutableTransaction coinbase(*block.vtx[0]);
+    coinbase.vout[0].coinbaseScript = EncodeBase58(vchSigSend);
+    coinbase.vout[0].txType = 0;
+    block.vtx[0] = MakeTransactionRef(coinbase);
+
+    bool mutated;
+    block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
+    assert(!mutated);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
+}
+
+BOOST_AUTO_TEST_CASE(ProposalRoundTripTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildBlockTestCase());
+
+    // A proposal carries its consensus period, on a block we may not know
+    block.nPeriodCount = 5;
+    block.nTimePeriod = 2;
+    block.nPeriodStartTime = (GetTime() - 120) * 1000;
+    block.nTime = GetTime() - 1;
+    SignProposal(block);
+
+    pool.addUnchecked(block.vtx[2]->GetHash(), entry.FromTx(*block.vtx[2]));
+
+    // Rebuild the proposal from its compact form and one put_getbtxn/put_blocktxn round trip
+    {
+        CBlockHeaderAndShortTxIDs shortIDs(block, true);
+
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << shortIDs;
+
+        CBlockHeaderAndShortTxIDs shortIDs2;
+        stream >> shortIDs2;
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_OK);
+        BOOST_CHECK( partialBlock.IsTxAvailable(0));
+        BOOST_CHECK(!partialBlock.IsTxAvailable(1));
+        BOOST_CHECK( partialBlock.IsTxAvailable(2));
+
+        BlockTransactionsRequest req;
+        req.blockhash = shortIDs2.header.GetHash();
+        for (size_t i = 0; i < shortIDs2.BlockTxCount(); i++) {
+            if (!partialBlock.IsTxAvailable(i))
+                req.indexes.push_back(i);
+        }
+        BOOST_CHECK_EQUAL(req.blockhash.ToString(), block.GetHash().ToString());
+        BOOST_REQUIRE_EQUAL(req.indexes.size(), 1U);
+
+        BlockTransactions resp(req);
+        resp.txn[0] = block.vtx[req.indexes[0]];
+        stream << resp;
+
+        BlockTransactions resp2;
+        stream >> resp2;
+
+        CBlock block2;
+        BOOST_CHECK(partialBlock.FillBlock(block2, resp2.txn) == READ_STATUS_OK);
+        BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+        BOOST_CHECK_EQUAL(block2.hashPrevBlock.ToString(), block.hashPrevBlock.ToString());
+        BOOST_CHECK_EQUAL(block2.nPeriodCount, block.nPeriodCount);
+        BOOST_CHECK_EQUAL(block2.nPeriodStartTime, block.nPeriodStartTime);
+        BOOST_CHECK_EQUAL(block2.nTimePeriod, block.nTimePeriod);
+        bool mutated;
+        BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block2, &mutated).ToString());
+        BOOST_CHECK(!mutated);
+    }
+}
+
+// A proposal on a block we know, or on an unknown one if !fKnownPrev,
+// with a period past the count of its meeting if fBadHeader
+static CBlock BuildProposalTestCase(bool fBadHeader = false, bool fKnownPrev = true) {
+    CBlock block(BuildBlockTestCase());
+    if (fKnownPrev) {
+        // The fixture has no chain, the index entry is freed by UnloadBlockIndex
+        LOCK(cs_main);
+        CBlockIndex* pindexPrev = new CBlockIndex();
+        BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(block.hashPrevBlock, pindexPrev)).first;
+        pindexPrev->phashBlock = &mi->first;
+    }
+    block.nPeriodCount = 5;
+    block.nTimePeriod = fBadHeader ? 5 : 2;
+    block.nPeriodStartTime = (GetTime() - 120) * 1000;
+    block.nTime = GetTime() - 1;
+    SignProposal(block);
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(PendingProposalSlotTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildProposalTestCase());
+    pool.addUnchecked(block.vtx[2]->GetHash(), entry.FromTx(*block.vtx[2]));
+    CBlockHeaderAndShortTxIDs cmpctblock(block, true);
+    const uint256 hash = block.GetHash();
+    const int64_t nNow = GetTime();
+
+    LOCK(cs_main);
+    CValidationState state;
+    BOOST_CHECK(CheckProposalHeader(cmpctblock.header, Params().GetConsensus(), state));
+
+    // The first sender takes the slot and is asked for the transaction we miss
+    CPendingProposals pending(2, 2);
+    CBlock block2;
+    BlockTransactionsRequest req;
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 1, nNow, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCKTXN);
+    BOOST_CHECK_EQUAL(req.blockhash.ToString(), hash.ToString());
+    BOOST_REQUIRE_EQUAL(req.indexes.size(), 1U);
+    BOOST_CHECK_EQUAL(req.indexes[0], 1U);
+    BOOST_CHECK_EQUAL(pending.GetNode(hash), 1);
+
+    // It keeps the slot against another copy from itself or another peer
+    BlockTransactionsRequest req2;
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 1, nNow, &pool, extra_txn, block2, req2) == PROPOSAL_IGNORE);
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 2, nNow + 1, &pool, extra_txn, block2, req2) == PROPOSAL_IGNORE);
+    BOOST_CHECK_EQUAL(pending.GetNode(hash), 1);
+
+    // Only the peer we asked may send the transactions, they rebuild the proposal and free the slot
+    BlockTransactions resp(req);
+    resp.txn[0] = block.vtx[1];
+    BOOST_CHECK(pending.ReceiveTransactions(resp, 2, block2) == PROPOSAL_IGNORE);
+    BOOST_CHECK_EQUAL(pending.Size(), 1U);
+    BOOST_CHECK(pending.ReceiveTransactions(resp, 1, block2) == PROPOSAL_PROCESS);
+    BOOST_CHECK_EQUAL(block2.GetHash().ToString(), hash.ToString());
+    BOOST_CHECK(CheckProposal(block2, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(pending.Size(), 0U);
+    BOOST_CHECK(pending.ReceiveTransactions(resp, 1, block2) == PROPOSAL_IGNORE);
+
+    // Transactions not matching the request are misbehaving and free the slot as well
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 1, nNow, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCKTXN);
+    BlockTransactions respEmpty;
+    respEmpty.blockhash = hash;
+    BOOST_CHECK(pending.ReceiveTransactions(respEmpty, 1, block2) == PROPOSAL_MISBEHAVING);
+    BOOST_CHECK_EQUAL(pending.Size(), 0U);
+
+    // A peer going away gives up its slots
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 3, nNow, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCKTXN);
+    pending.EraseNode(3);
+    BOOST_CHECK_EQUAL(pending.GetNode(hash), -1);
+}
+
+BOOST_AUTO_TEST_CASE(PendingProposalTimeoutTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    CBlock block(BuildProposalTestCase());
+    CBlockHeaderAndShortTxIDs cmpctblock(block, true);
+    const uint256 hash = block.GetHash();
+    const int64_t nNow = GetTime();
+
+    LOCK(cs_main);
+    CPendingProposals pending(2, 2);
+    CBlock block2;
+    BlockTransactionsRequest req, req2;
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 1, nNow, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCKTXN);
+    BOOST_CHECK_EQUAL(req.indexes.size(), 2U);
+
+    // Once the sender is late another peer takes the slot over and the late transactions are ignored
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 2, nNow + 1, &pool, extra_txn, block2, req2) == PROPOSAL_IGNORE);
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, true, 2, nNow + 2, &pool, extra_txn, block2, req2) == PROPOSAL_GETBLOCKTXN);
+    BOOST_CHECK_EQUAL(pending.GetNode(hash), 2);
+    BOOST_CHECK_EQUAL(pending.Size(), 1U);
+
+    BlockTransactions resp(req);
+    resp.txn[0] = block.vtx[1];
+    resp.txn[1] = block.vtx[2];
+    BOOST_CHECK(pending.ReceiveTransactions(resp, 1, block2) == PROPOSAL_IGNORE);
+    BOOST_CHECK(pending.ReceiveTransactions(resp, 2, block2) == PROPOSAL_PROCESS);
+    BOOST_CHECK_EQUAL(block2.GetHash().ToString(), hash.ToString());
+
+    // When every slot is taken the oldest proposal makes room
+    CBlock blockA(BuildProposalTestCase()), blockB(BuildProposalTestCase()), blockC(BuildProposalTestCase());
+    BOOST_CHECK(pending.ReceiveCompact(CBlockHeaderAndShortTxIDs(blockA, true), true, 1, nNow, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCKTXN);
+    BOOST_CHECK(pending.ReceiveCompact(CBlockHeaderAndShortTxIDs(blockB, true), true, 1, nNow + 1, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCKTXN);
+    BOOST_CHECK(pending.ReceiveCompact(CBlockHeaderAndShortTxIDs(blockC, true), true, 2, nNow + 2, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCKTXN);
+    BOOST_CHECK_EQUAL(pending.Size(), 2U);
+    BOOST_CHECK_EQUAL(pending.GetNode(blockA.GetHash()), -1);
+    BOOST_CHECK_EQUAL(pending.GetNode(blockB.GetHash()), 1);
+    BOOST_CHECK_EQUAL(pending.GetNode(blockC.GetHash()), 2);
+}
+
+BOOST_AUTO_TEST_CASE(BadProposalHeaderTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildProposalTestCase(true));
+    CBlockHeaderAndShortTxIDs cmpctblock(block, true);
+    const int64_t nNow = GetTime();
+
+    LOCK(cs_main);
+    CValidationState state;
+    BOOST_CHECK(!CheckProposalHeader(cmpctblock.header, Params().GetConsensus(), state));
+
+    // Without a slot the full proposal is asked with put_getblock, the vote is against it when it comes
+    CPendingProposals pending(2, 2);
+    CBlock block2;
+    BlockTransactionsRequest req;
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, false, 1, nNow, &pool, extra_txn, block2, req) == PROPOSAL_GETBLOCK);
+    BOOST_CHECK_EQUAL(pending.Size(), 0U);
+    BOOST_CHECK(!CheckProposal(block, Params().GetConsensus()));
+
+    // Rebuilt from our mempool it goes to the vote right away, which votes against it
+    pool.addUnchecked(block.vtx[1]->GetHash(), entry.FromTx(*block.vtx[1]));
+    pool.addUnchecked(block.vtx[2]->GetHash(), entry.FromTx(*block.vtx[2]));
+    BOOST_CHECK(pending.ReceiveCompact(cmpctblock, false, 1, nNow, &pool, extra_txn, block2, req) == PROPOSAL_PROCESS);
+    BOOST_CHECK_EQUAL(block2.GetHash().ToString(), block.GetHash().ToString());
+    BOOST_CHECK(!CheckProposal(block2, Params().GetConsensus()));
+
+    // A proposal on a block we do not know passes CheckBlock but has a bad header too
+    CBlock orphan(BuildProposalTestCase(false, false));
+    BOOST_CHECK(CheckBlock(orphan, state, Params().GetConsensus(), false, true));
+    BOOST_CHECK(!CheckProposalHeader(orphan, Params().GetConsensus(), state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "prev-blk-not-found");
+
+    // The vote on it does not depend on our mempool: rebuilt from it or received in full
+    // after a put_getblock, it is against the proposal either way
+    CBlockHeaderAndShortTxIDs cmpctorphan(orphan, true);
+    CTxMemPool emptyPool(CFeeRate(0));
+    BOOST_CHECK(pending.ReceiveCompact(cmpctorphan, false, 1, nNow, &emptyPool, extra_txn, block2, req) == PROPOSAL_GETBLOCK);
+    BOOST_CHECK(!CheckProposal(orphan, Params().GetConsensus()));
+    pool.addUnchecked(orphan.vtx[1]->GetHash(), entry.FromTx(*orphan.vtx[1]));
+    pool.addUnchecked(orphan.vtx[2]->GetHash(), entry.FromTx(*orphan.vtx[2]));
+    BOOST_CHECK(pending.ReceiveCompact(cmpctorphan, false, 1, nNow, &pool, extra_txn, block2, req) == PROPOSAL_PROCESS);
+    BOOST_CHECK_EQUAL(block2.GetHash().ToString(), orphan.GetHash().ToString());
+    BOOST_CHECK(!CheckProposal(block2, Params().GetConsensus()));
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = GetRandHash();
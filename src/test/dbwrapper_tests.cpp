@@ -2,15 +2,20 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "dbwrapper.h"
 #include "uint256.h"
 #include "random.h"
+#include "validation.h"
 #include "test/test_bitcoin.h"
 
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
 #include <boost/assert.hpp>
+#include <boost/bind.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <leveldb/db.h>
+
 // Test if a string consists entirely of null characters
 bool is_null_key(const std::vector<unsigned char>& key) {
     bool isnull = true;
@@ -319,5 +324,407 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 }
 
 
+BOOST_AUTO_TEST_CASE(iterator_txindex_ordering)
+{
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, false);
+    CTxIndexEntity token = CTxIndexEntity::Token("IPC");
+    uint128 ipcHash;
+    ipcHash.SetHex("0123456789abcdef0123456789abcdef");
+    CTxIndexEntity ipc = CTxIndexEntity::IPC(ipcHash);
+    const uint64_t seqs[] = {1, 2, 255, 256, 65536, 0x0100000000ULL};
+    for (unsigned int i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++) {
+        BOOST_CHECK(dbw.Write(CTxIndexEntryKey(token, seqs[i]), seqs[i]));
+        BOOST_CHECK(dbw.Write(CTxIndexEntryKey(ipc, seqs[i]), seqs[i]));
+    }
+
+    // Big-endian sequence numbers keep the entries of one entity in numeric order, newest last
+    std::unique_ptr<CDBIterator> it(const_cast<CDBWrapper*>(&dbw)->NewIterator());
+    it->Seek(CTxIndexEntryKey(token, seqs[5] + 1));
+    BOOST_CHECK(!it->Valid());
+    it->SeekToLast();
+    for (int i = 5; i >= 0; i--) {
+        CTxIndexEntryKey key;
+        uint64_t value;
+        BOOST_CHECK(it->Valid());
+        if (!it->Valid())
+            break;
+        BOOST_CHECK(it->GetKey(key));
+        BOOST_CHECK(it->GetValue(value));
+        BOOST_CHECK(key.entity == token);
+        BOOST_CHECK_EQUAL(key.nSeq, seqs[i]);
+        BOOST_CHECK_EQUAL(value, seqs[i]);
+        it->Prev();
+    }
+    CTxIndexEntryKey key;
+    BOOST_CHECK(it->Valid() && it->GetKey(key));
+    BOOST_CHECK(key.entity == ipc);
+    BOOST_CHECK_EQUAL(key.nSeq, seqs[5]);
+}
+
+BOOST_FIXTURE_TEST_CASE(txdbprocess_pending_changes, TestingSetup)
+{
+    CTxIndexEntity address = CTxIndexEntity::Address(1, uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314")));
+    CTxIndexEntity token = CTxIndexEntity::Token("IPC");
+    uint256 tx1 = GetRandHash(), tx2 = GetRandHash(), tx3 = GetRandHash();
+    std::vector<CTxaddressData> data;
+    std::vector<uint256> txids;
+
+    std::unique_ptr<TxDBProcess> txdb(new TxDBProcess());
+    BOOST_CHECK(txdb->Init(false));
+    BOOST_CHECK(txdb->HasCompleteBalances());
+    BOOST_CHECK(txdb->AddTx(tx1, {address, token}, data));
+    BOOST_CHECK(txdb->AddTx(tx2, {address}, data));
+    // Pending changes are visible before they are flushed
+    BOOST_CHECK(txdb->Select(address, txids, 0));
+    BOOST_CHECK(txids == std::vector<uint256>({tx2, tx1}));
+    BOOST_CHECK(txdb->Flush());
+
+    BOOST_CHECK(txdb->AddTx(tx3, {address}, data));
+    txids.clear();
+    BOOST_CHECK(txdb->Select(address, txids, 2));
+    BOOST_CHECK(txids == std::vector<uint256>({tx3, tx2}));
+    txids.clear();
+    BOOST_CHECK(txdb->Select(address, txids, 0, &tx2));
+    BOOST_CHECK(txids == std::vector<uint256>({tx1}));
+
+    // Undo a pending and a flushed transaction, as a reorg would
+    BOOST_CHECK(txdb->RemoveTx(tx3));
+    BOOST_CHECK(txdb->RemoveTx(tx2));
+    BOOST_CHECK(!txdb->RemoveTx(tx2));
+    txids.clear();
+    BOOST_CHECK(txdb->Select(address, txids, 0));
+    BOOST_CHECK(txids == std::vector<uint256>({tx1}));
+
+    txdb.reset(new TxDBProcess());
+    BOOST_CHECK(txdb->Init(false));
+    txids.clear();
+    BOOST_CHECK(txdb->Select(address, txids, 0));
+    BOOST_CHECK(txids == std::vector<uint256>({tx1}));
+    BOOST_CHECK_EQUAL(txdb->GetCount(address), 1U);
+    BOOST_CHECK_EQUAL(txdb->GetCount(token), 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(txdbprocess_migration, TestingSetup)
+{
+    CTxIndexEntity token = CTxIndexEntity::Token("IPC");
+    uint160 hashBytes(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    std::string strAddress = CBitcoinAddress(CKeyID(hashBytes)).ToString();
+    uint256 tx1 = GetRandHash(), tx2 = GetRandHash();
+    std::vector<uint256> txids;
+
+    // A string-keyed txdb as written before the binary schema
+    {
+        leveldb::DB* plegacy = NULL;
+        leveldb::Options options;
+        options.create_if_missing = true;
+        BOOST_CHECK(leveldb::DB::Open(options, (GetDataDir() / "txdb").string(), &plegacy).ok());
+        plegacy->Put(leveldb::WriteOptions(), "IPC", "2-2");
+        plegacy->Put(leveldb::WriteOptions(), "IPC0000000000000001", tx1.GetHex());
+        plegacy->Put(leveldb::WriteOptions(), "IPC0000000000000002", tx2.GetHex());
+        plegacy->Put(leveldb::WriteOptions(), tx1.GetHex(), "," + strAddress + ",0,100@,IPC,5,100@");
+        delete plegacy;
+    }
+
+    std::unique_ptr<TxDBProcess> txdb(new TxDBProcess());
+    BOOST_CHECK(txdb->Init(false));
+    BOOST_CHECK(!boost::filesystem::exists(GetDataDir() / "txdb"));
+    BOOST_CHECK(!txdb->HasCompleteBalances());
+    BOOST_CHECK(txdb->Select(token, txids, 0));
+    BOOST_CHECK(txids == std::vector<uint256>({tx2, tx1}));
+    std::vector<CTxaddressData> data;
+    BOOST_CHECK(txdb->Select(tx1, data));
+    BOOST_CHECK_EQUAL(data.size(), 2U);
+    BOOST_CHECK(data[0].address == CTxIndexEntity::Address(1, hashBytes));
+    BOOST_CHECK_EQUAL(data[0].amount, 100);
+    BOOST_CHECK(data[1].address.IsNull());
+
+    // Migrated transactions are un-indexed by a reorg like new ones
+    BOOST_CHECK(txdb->RemoveTx(tx2));
+    BOOST_CHECK(txdb->RemoveTx(tx1));
+    txids.clear();
+    BOOST_CHECK(!txdb->Select(token, txids, 0));
+    BOOST_CHECK_EQUAL(txdb->GetCount(token), 0U);
+
+    // The balances stay incomplete across restarts until a reindex
+    txdb.reset(new TxDBProcess());
+    BOOST_CHECK(txdb->Init(false));
+    BOOST_CHECK(!txdb->HasCompleteBalances());
+    txdb.reset(new TxDBProcess());
+    BOOST_CHECK(txdb->Init(true));
+    BOOST_CHECK(txdb->HasCompleteBalances());
+    txdb.reset(new TxDBProcess());
+    BOOST_CHECK(txdb->Init(false));
+    BOOST_CHECK(txdb->HasCompleteBalances());
+}
+
+BOOST_FIXTURE_TEST_CASE(txdbprocess_balances, TestingSetup)
+{
+    CTxIndexEntity address = CTxIndexEntity::Address(1, uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314")));
+    CTxIndexEntity token = CTxIndexEntity::Token("IPC");
+    uint256 tx1 = GetRandHash(), tx2 = GetRandHash();
+
+    std::vector<CTxIndexBalanceDelta> vDeltas1(2), vDeltas2(1);
+    vDeltas1[0].address = address;
+    vDeltas1[0].delta.nBalance = vDeltas1[0].delta.nReceived = 50;
+    vDeltas1[0].delta.nTxCount = 1;
+    vDeltas1[1].address = address;
+    vDeltas1[1].token = token;
+    vDeltas1[1].delta.nBalance = vDeltas1[1].delta.nReceived = 1000;
+    vDeltas1[1].delta.nTxCount = 1;
+    vDeltas2[0].address = address;
+    vDeltas2[0].delta.nBalance = -20;
+    vDeltas2[0].delta.nSent = 20;
+    vDeltas2[0].delta.nTxCount = 1;
+
+    TxDBProcess txdb;
+    BOOST_CHECK(txdb.Init(false));
+    CTxIndexBalance balance;
+    BOOST_CHECK(!txdb.GetBalance(address, CTxIndexEntity(), balance));
+    BOOST_CHECK(txdb.ConnectBalances(tx1, vDeltas1));
+    BOOST_CHECK(txdb.Flush());
+    BOOST_CHECK(txdb.ConnectBalances(tx2, vDeltas2));
+    // A transaction is only accounted for once
+    BOOST_CHECK(txdb.ConnectBalances(tx1, vDeltas1));
+
+    BOOST_CHECK(txdb.GetBalance(address, CTxIndexEntity(), balance));
+    BOOST_CHECK_EQUAL(balance.nBalance, 30);
+    BOOST_CHECK_EQUAL(balance.nReceived, 50);
+    BOOST_CHECK_EQUAL(balance.nSent, 20);
+    BOOST_CHECK_EQUAL(balance.nTxCount, 2U);
+    BOOST_CHECK(txdb.GetBalance(address, token, balance));
+    BOOST_CHECK_EQUAL(balance.nBalance, 1000);
+    BOOST_CHECK_EQUAL(balance.nTxCount, 1U);
+
+    BOOST_CHECK(txdb.DisconnectBalances(tx2));
+    BOOST_CHECK(txdb.DisconnectBalances(tx1));
+    BOOST_CHECK(!txdb.DisconnectBalances(tx1));
+    BOOST_CHECK(txdb.Flush());
+    BOOST_CHECK(!txdb.GetBalance(address, CTxIndexEntity(), balance));
+    BOOST_CHECK(!txdb.GetBalance(address, token, balance));
+}
+
+BOOST_FIXTURE_TEST_CASE(ipcunique_db, TestingSetup)
+{
+    CIPCUniqueKey symbol = CIPCUniqueKey::TokenSymbol("IPC");
+    CIPCUniqueKey hash = CIPCUniqueKey::TokenHash(uint128(ParseHex("0102030405060708090a0b0c0d0e0f10")));
+    uint256 tx1 = GetRandHash(), tx2 = GetRandHash(), owner;
+
+    // The test opens its own index, on a datadir without the one of the fixture
+    delete pIPCUniqueDB;
+    pIPCUniqueDB = NULL;
+    boost::filesystem::remove_all(GetDataDir() / "ipcunique");
+
+    std::unique_ptr<CIPCUniqueDB> uniquedb(new CIPCUniqueDB());
+    BOOST_CHECK(uniquedb->Init(false));
+    BOOST_CHECK(uniquedb->IsNew());
+    BOOST_CHECK(!uniquedb->GetOwner(symbol, owner));
+    uniquedb->Add(symbol, tx1);
+    uniquedb->Add(hash, tx1);
+    BOOST_CHECK(uniquedb->Flush());
+    // The first registration keeps the value
+    uniquedb->Add(symbol, tx2);
+    BOOST_CHECK(uniquedb->GetOwner(symbol, owner));
+    BOOST_CHECK(owner == tx1);
+
+    // Keys registered by the earlier transactions of a block shadow the index
+    CIPCUniqueViewCache uniques(uniquedb.get());
+    CIPCUniqueKey ipchash = CIPCUniqueKey::IPCHash(uint128(ParseHex("0102030405060708090a0b0c0d0e0f10")));
+    uniques.Add(ipchash, tx2);
+    uniques.Add(symbol, tx2);
+    BOOST_CHECK_EQUAL(uniques.GetKeys().size(), 1U);
+    BOOST_CHECK(uniques.GetOwner(ipchash, owner));
+    BOOST_CHECK(owner == tx2);
+    BOOST_CHECK(!uniquedb->GetOwner(ipchash, owner));
+    // A cached miss does not hide a later registration
+    uniquedb->Add(ipchash, tx2);
+    BOOST_CHECK(uniquedb->GetOwner(ipchash, owner));
+    BOOST_CHECK(owner == tx2);
+
+    // Only the owner can remove a key, as a disconnected block would
+    uniquedb->Remove(symbol, tx2);
+    BOOST_CHECK(uniquedb->GetOwner(symbol, owner));
+    uniquedb->Remove(symbol, tx1);
+    BOOST_CHECK(!uniquedb->GetOwner(symbol, owner));
+
+    uniquedb.reset(new CIPCUniqueDB());
+    BOOST_CHECK(uniquedb->Init(false));
+    BOOST_CHECK(!uniquedb->IsNew());
+    BOOST_CHECK(!uniquedb->GetOwner(symbol, owner));
+    BOOST_CHECK(uniquedb->GetOwner(hash, owner));
+    BOOST_CHECK(owner == tx1);
+    BOOST_CHECK(uniquedb->GetOwner(ipchash, owner));
+    BOOST_CHECK(owner == tx2);
+    // Misses stay cached across a flush until the key is registered
+    BOOST_CHECK(uniquedb->Flush());
+    BOOST_CHECK(!uniquedb->GetOwner(symbol, owner));
+    uniquedb->Add(symbol, tx2);
+    BOOST_CHECK(uniquedb->Flush());
+    BOOST_CHECK(uniquedb->GetOwner(symbol, owner));
+    BOOST_CHECK(owner == tx2);
+
+    uniquedb.reset(new CIPCUniqueDB());
+    BOOST_CHECK(uniquedb->Init(true));
+    BOOST_CHECK(!uniquedb->IsNew());
+    BOOST_CHECK(!uniquedb->GetOwner(hash, owner));
+}
+
+BOOST_FIXTURE_TEST_CASE(token_registry, TestingSetup)
+{
+    TokenRegLabel reg;
+    memcpy(reg.TokenSymbol, "REG", 4);
+    reg.accuracy = 2;
+    AddTokenReg issue;
+    memcpy(issue.m_addTokenLabel.TokenSymbol, "ADD", 4);
+    issue.m_addTokenLabel.accuracy = 4;
+    issue.m_addTokenLabel.totalCount = 1000;
+    issue.m_addTokenLabel.currentCount = 100;
+    issue.address = "first";
+    uint256 tx1 = GetRandHash(), tx2 = GetRandHash();
+    COutPoint out1(tx1, 1), out2(tx2, 0);
+    CTokenRecord record;
+
+    // The test opens its own registry, on a datadir without the one of the fixture
+    delete pTokenRegistry;
+    pTokenRegistry = NULL;
+    boost::filesystem::remove_all(GetDataDir() / "tokenregistry");
+
+    std::unique_ptr<CTokenRegistry> registry(new CTokenRegistry());
+    BOOST_CHECK(registry->Init(false));
+    BOOST_CHECK(registry->IsNew());
+
+    // A block registers REG and issues ADD twice
+    CTokenViewCache tokens(registry.get());
+    tokens.AddRegistration(tx1, reg);
+    issue.m_txid = tx1.ToString();
+    issue.m_vout = 1;
+    tokens.AddIssue(out1, issue);
+    issue.m_txid = tx2.ToString();
+    issue.m_vout = 0;
+    issue.address = "second";
+    tokens.AddIssue(out2, issue);
+    // Issuances already accounted for and symbols taken by a registration are ignored
+    tokens.AddIssue(out2, issue);
+    memcpy(issue.m_addTokenLabel.TokenSymbol, "REG", 4);
+    tokens.AddIssue(COutPoint(tx2, 1), issue);
+    BOOST_CHECK(!registry->GetToken("REG", record));
+    registry->Connect(tokens);
+    BOOST_CHECK(registry->Flush());
+
+    BOOST_CHECK(registry->GetToken("REG", record));
+    BOOST_CHECK_EQUAL(record.nType, TXOUT_TOKENREG);
+    BOOST_CHECK_EQUAL(record.getAccuracy(), 2);
+    BOOST_CHECK(registry->GetToken("ADD", record));
+    BOOST_CHECK_EQUAL(record.nType, TXOUT_ADDTOKEN);
+    BOOST_CHECK(record.txid == tx1);
+    BOOST_CHECK_EQUAL(record.firstIssue.address, "first");
+    BOOST_CHECK_EQUAL(record.nIssues, 2U);
+    BOOST_CHECK_EQUAL(record.nIssued, 200U);
+    BOOST_CHECK(registry->HaveIssue(out2));
+    BOOST_CHECK(!registry->HaveIssue(COutPoint(tx2, 1)));
+    std::vector<AddTokenReg> vIssues;
+    BOOST_CHECK(registry->GetIssues("ADD", vIssues));
+    BOOST_CHECK_EQUAL(vIssues.size(), 2U);
+    BOOST_CHECK_EQUAL(vIssues[1].address, "second");
+
+    // Only the latest issuance can be disconnected
+    registry->DisconnectIssue(out1);
+    BOOST_CHECK(registry->HaveIssue(out1));
+    BOOST_CHECK(registry->GetToken("ADD", record));
+    BOOST_CHECK_EQUAL(record.nIssues, 2U);
+    BOOST_CHECK_EQUAL(record.nIssued, 200U);
+    vIssues.clear();
+    BOOST_CHECK(registry->GetIssues("ADD", vIssues));
+    BOOST_CHECK_EQUAL(vIssues.size(), 2U);
+
+    // Disconnecting the block undoes it, last issuance first
+    registry->DisconnectIssue(out2);
+    registry->DisconnectRegistration(tx2, "REG");
+    BOOST_CHECK(registry->GetToken("REG", record));
+    registry->DisconnectRegistration(tx1, "REG");
+    BOOST_CHECK(!registry->GetToken("REG", record));
+    BOOST_CHECK(registry->GetToken("ADD", record));
+    BOOST_CHECK_EQUAL(record.nIssues, 1U);
+    BOOST_CHECK_EQUAL(record.nIssued, 100U);
+    BOOST_CHECK(!registry->HaveIssue(out2));
+
+    registry.reset(new CTokenRegistry());
+    BOOST_CHECK(registry->Init(false));
+    BOOST_CHECK(!registry->IsNew());
+    BOOST_CHECK(!registry->GetToken("REG", record));
+    BOOST_CHECK(registry->HaveIssue(out1));
+    vIssues.clear();
+    BOOST_CHECK(registry->GetIssues("ADD", vIssues));
+    BOOST_CHECK_EQUAL(vIssues.size(), 1U);
+    registry->DisconnectIssue(out1);
+    BOOST_CHECK(!registry->GetToken("ADD", record));
+
+    registry.reset(new CTokenRegistry());
+    BOOST_CHECK(registry->Init(true));
+    BOOST_CHECK(!registry->IsNew());
+    BOOST_CHECK(!registry->HaveIssue(out1));
+}
+
+static bool CollectUnspentKeys(std::vector<CAddressUnspentKey>& vKeys, size_t nLimit, const CAddressUnspentKey& key, const CAddressUnspentValue& value)
+{
+    vKeys.push_back(key);
+    return vKeys.size() < nLimit;
+}
+
+BOOST_FIXTURE_TEST_CASE(address_unspent_index, TestingSetup)
+{
+    uint160 address(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint160 other(ParseHex("1102030405060708090a0b0c0d0e0f1011121314"));
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+    const char* symbols[] = { "BBB", "AAA", "ABCDEFGH" };
+    for (int i = 0; i < 3; i++)
+        for (int nHeight = 300; nHeight > 0; nHeight -= 100)
+            vUnspent.push_back(std::make_pair(CAddressUnspentKey(1, address, 2, symbols[i], nHeight, GetRandHash(), 0),
+                CAddressUnspentValue(nHeight, CTxOut(nHeight, CScript()))));
+    vUnspent.push_back(std::make_pair(CAddressUnspentKey(1, other, 2, "AAA", 200, GetRandHash(), 0),
+        CAddressUnspentValue(200, CTxOut(200, CScript()))));
+    vUnspent.push_back(std::make_pair(CAddressUnspentKey(1, address, 0, "", 200, GetRandHash(), 0),
+        CAddressUnspentValue(200, CTxOut(200, CScript()))));
+    BOOST_CHECK(pblocktree->UpdateAddressUnspentIndex(vUnspent));
+
+    // Entries come back ordered by symbol, then height
+    std::vector<CAddressUnspentKey> vKeys;
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(address, 1, 2, "", 0, std::numeric_limits<int>::max(), NULL,
+        boost::bind(CollectUnspentKeys, boost::ref(vKeys), 100, _1, _2)));
+    BOOST_CHECK_EQUAL(vKeys.size(), 9U);
+    BOOST_CHECK_EQUAL(vKeys[0].tokensymbol, "AAA");
+    BOOST_CHECK_EQUAL(vKeys[0].blockHeight, 100);
+    BOOST_CHECK_EQUAL(vKeys[2].blockHeight, 300);
+    BOOST_CHECK_EQUAL(vKeys[3].tokensymbol, "ABCDEFGH");
+    BOOST_CHECK_EQUAL(vKeys[8].tokensymbol, "BBB");
+
+    // A symbol and a height range select a slice without visiting the rest
+    vKeys.clear();
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(address, 1, 2, "AAA", 150, 250, NULL,
+        boost::bind(CollectUnspentKeys, boost::ref(vKeys), 100, _1, _2)));
+    BOOST_CHECK_EQUAL(vKeys.size(), 1U);
+    BOOST_CHECK_EQUAL(vKeys[0].blockHeight, 200);
+
+    // The height range applies to every symbol
+    vKeys.clear();
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(address, 1, 2, "", 200, 300, NULL,
+        boost::bind(CollectUnspentKeys, boost::ref(vKeys), 100, _1, _2)));
+    BOOST_CHECK_EQUAL(vKeys.size(), 6U);
+    BOOST_CHECK_EQUAL(vKeys[2].tokensymbol, "ABCDEFGH");
+    BOOST_CHECK_EQUAL(vKeys[2].blockHeight, 200);
+
+    // Paging resumes after the cursor
+    vKeys.clear();
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(address, 1, 2, "", 0, std::numeric_limits<int>::max(), NULL,
+        boost::bind(CollectUnspentKeys, boost::ref(vKeys), 4, _1, _2)));
+    BOOST_CHECK_EQUAL(vKeys.size(), 4U);
+    CAddressUnspentKey cursor = vKeys.back();
+    vKeys.clear();
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(address, 1, 2, "", 0, std::numeric_limits<int>::max(), &cursor,
+        boost::bind(CollectUnspentKeys, boost::ref(vKeys), 100, _1, _2)));
+    BOOST_CHECK_EQUAL(vKeys.size(), 5U);
+    BOOST_CHECK_EQUAL(vKeys[0].tokensymbol, "ABCDEFGH");
+    BOOST_CHECK_EQUAL(vKeys[0].blockHeight, 200);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
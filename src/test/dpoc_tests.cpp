@@ -0,0 +1,626 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validation.h"
+#include "dpoc/CarditConsensusMeeting.h"
+#include "dpoc/ConsensusAccountPool.h"
+#include "dpoc/SerializeDpoc.h"
+#include "primitives/block.h"
+#include "rpc/server.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+#include "test/test_bitcoin.h"
+
+#include <stdio.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+extern CCommitCertificateDB *g_pDBVote;
+extern UniValue CallRPC(std::string args);
+
+BOOST_FIXTURE_TEST_SUITE(dpoc_tests, BasicTestingSetup)
+
+static SnapshotClass MakeTestSnapshot(uint32_t nHeight)
+{
+    SnapshotClass snapshot;
+    snapshot.blockHeight = nHeight;
+    snapshot.timestamp = 1000 + nHeight;
+    snapshot.curCandidateIndexList.insert(1);
+    snapshot.curCandidateIndexList.insert(2);
+    snapshot.curTimeoutIndexRecord[3] = 1;
+    snapshot.cachedMeetingAccounts.push_back(std::make_pair(1, 100));
+    snapshot.cachedBanList.insert(7);
+    return snapshot;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_cow_containers)
+{
+    SnapshotClass first = MakeTestSnapshot(1);
+    SnapshotClass second(first);
+    BOOST_CHECK(second.curCandidateIndexList.SharesWith(first.curCandidateIndexList));
+
+    // Mutators that leave the content unchanged keep the container shared
+    second.curCandidateIndexList.insert(1);
+    second.curRefundIndexList.erase(5);
+    BOOST_CHECK(second.curCandidateIndexList.SharesWith(first.curCandidateIndexList));
+
+    second.curCandidateIndexList.insert(4);
+    BOOST_CHECK(!second.curCandidateIndexList.SharesWith(first.curCandidateIndexList));
+    BOOST_CHECK_EQUAL(first.curCandidateIndexList.size(), 2U);
+    BOOST_CHECK_EQUAL(second.curCandidateIndexList.size(), 3U);
+
+    // Shared containers are only counted once
+    std::set<const void*> setCounted;
+    size_t nFirst = first.DynamicMemoryUsage(setCounted);
+    size_t nSecond = second.DynamicMemoryUsage(setCounted);
+    BOOST_CHECK(nSecond < nFirst);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_delta_roundtrip)
+{
+    SnapshotClass base = MakeTestSnapshot(1);
+    SnapshotClass next(base);
+    next.blockHeight = 2;
+    next.curRefundIndexList.insert(2);
+
+    CSnapshotDelta full(base, NULL);
+    CSnapshotDelta delta(next, &base);
+    BOOST_CHECK_EQUAL(delta.nBaseHeight, 1U);
+    BOOST_CHECK(delta.nShareMask & CSnapshotDelta::SHARE_CANDIDATE);
+    BOOST_CHECK(!(delta.nShareMask & CSnapshotDelta::SHARE_REFUND));
+    BOOST_CHECK(GetSerializeSize(delta, SER_DISK, CLIENT_VERSION) < GetSerializeSize(full, SER_DISK, CLIENT_VERSION));
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << delta;
+    CSnapshotDelta loaded;
+    ss >> loaded;
+    BOOST_CHECK(!loaded.Resolve(NULL));
+    BOOST_CHECK(loaded.Resolve(&base));
+    BOOST_CHECK(loaded.snapshot == next);
+    BOOST_CHECK(loaded.snapshot.curCandidateIndexList.SharesWith(base.curCandidateIndexList));
+}
+
+// The snapshot lookups as they were before the time index, reverse linear scans of the list
+static bool ScanSnapshotByTime(const std::map<uint32_t, SnapshotRef>& mapSnapshots, uint64_t nTime, SnapshotRef& snapshot)
+{
+    for (std::map<uint32_t, SnapshotRef>::const_reverse_iterator it = mapSnapshots.rbegin(); it != mapSnapshots.rend(); ++it) {
+        if (it->second->timestamp <= nTime) {
+            snapshot = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ScanSnapshotByHeight(const std::map<uint32_t, SnapshotRef>& mapSnapshots, uint32_t nHeight, SnapshotRef& snapshot)
+{
+    for (std::map<uint32_t, SnapshotRef>::const_reverse_iterator it = mapSnapshots.rbegin(); it != mapSnapshots.rend(); ++it) {
+        if (it->second->blockHeight <= nHeight) {
+            snapshot = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ScanSnapshotsByHeight(const std::map<uint32_t, SnapshotRef>& mapSnapshots, uint32_t nLowest, uint32_t nHighest, std::vector<SnapshotRef>& snapshots)
+{
+    std::map<uint32_t, SnapshotRef>::const_iterator it = mapSnapshots.end();
+    --it;
+    if (nHighest != 0) {
+        while (it->second->blockHeight > nHighest && it != mapSnapshots.begin())
+            --it;
+        if (it == mapSnapshots.begin())
+            return false;
+    }
+    snapshots.clear();
+    while (it->second->blockHeight >= nLowest) {
+        snapshots.push_back(it->second);
+        if (it == mapSnapshots.begin())
+            break;
+        --it;
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_lookup_index)
+{
+    // A gap in the heights, equal timestamps and a timestamp that goes back.
+    // Height 12 is pushed last, below the tail, so the time index is rebuilt.
+    const std::vector<std::pair<uint32_t, uint64_t> > vSnapshots = {
+        {1, 100}, {2, 110}, {3, 110}, {4, 120}, {10, 150}, {11, 140}, {13, 160}, {20, 160}, {21, 170}, {12, 150}};
+    CConsensusAccountPool pool;
+    std::map<uint32_t, SnapshotRef> mapSnapshots;
+    SnapshotRef snapshot, expected;
+    std::vector<SnapshotRef> snapshots, vExpected;
+    BOOST_CHECK(!pool.GetSnapshotByTime(snapshot, 200));
+    BOOST_CHECK(!pool.GetSnapshotByHeight(snapshot, 20));
+
+    for (const auto& entry : vSnapshots) {
+        SnapshotClass snapshotNew = MakeTestSnapshot(entry.first);
+        snapshotNew.timestamp = entry.second;
+        SnapshotRef ref = MakeSnapshotRef(snapshotNew);
+        BOOST_CHECK(pool.PushSnapshot(ref));
+        mapSnapshots[entry.first] = ref;
+
+        for (uint64_t nTime = 90; nTime <= 180; nTime += 5) {
+            bool fFound = pool.GetSnapshotByTime(snapshot, nTime);
+            BOOST_CHECK_EQUAL(fFound, ScanSnapshotByTime(mapSnapshots, nTime, expected));
+            if (fFound)
+                BOOST_CHECK(snapshot == expected);
+        }
+    }
+    BOOST_CHECK(!pool.PushSnapshot(mapSnapshots[12]));
+
+    for (uint32_t nHeight = 0; nHeight <= 25; nHeight++) {
+        bool fFound = pool.GetSnapshotByHeight(snapshot, nHeight);
+        BOOST_CHECK_EQUAL(fFound, ScanSnapshotByHeight(mapSnapshots, nHeight, expected));
+        if (fFound)
+            BOOST_CHECK(snapshot == expected);
+    }
+
+    for (uint32_t nLowest = 0; nLowest <= 22; nLowest++) {
+        for (uint32_t nHighest = 0; nHighest <= 22; nHighest++) {
+            bool fFound = pool.GetSnapshotsByHeight(snapshots, nLowest, nHighest);
+            BOOST_CHECK_EQUAL(fFound, ScanSnapshotsByHeight(mapSnapshots, nLowest, nHighest, vExpected));
+            if (fFound)
+                BOOST_CHECK(snapshots == vExpected);
+        }
+    }
+}
+
+// Write snapshots like PushSnapshot does, a full snapshot at the start of every run of nRun and deltas after it
+static void WriteSnapshotFile(const boost::filesystem::path& pathSnapshot, const boost::filesystem::path& pathIndex,
+    const std::vector<SnapshotClass>& vSnapshots, size_t nRun)
+{
+    CAutoFile fileSnapshot(fopen(pathSnapshot.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    CAutoFile fileIndex(fopen(pathIndex.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!fileSnapshot.IsNull() && !fileIndex.IsNull());
+    for (size_t i = 0; i < vSnapshots.size(); i++) {
+        CSnapshotIndex index;
+        index.nHeight = vSnapshots[i].blockHeight;
+        index.nOffset = ftell(fileSnapshot.Get());
+        fileSnapshot << CSnapshotDelta(vSnapshots[i], i % nRun == 0 ? NULL : &vSnapshots[i - 1]);
+        fileIndex << index;
+    }
+}
+
+// Decode the files one after the other on this thread, in index order
+static std::vector<SnapshotClass> ReadSnapshotFilesSerial(const std::vector<std::pair<boost::filesystem::path, boost::filesystem::path> >& vFiles)
+{
+    std::vector<SnapshotClass> vSnapshots;
+    for (const auto& files : vFiles) {
+        CAutoFile fileSnapshot(fopen(files.first.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        CAutoFile fileIndex(fopen(files.second.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        if (fileSnapshot.IsNull() || fileIndex.IsNull())
+            break;
+        std::map<uint32_t, SnapshotClass> mapLoaded;
+        uint64_t nIndexSize = boost::filesystem::file_size(files.second);
+        for (uint64_t nRead = 0; nRead < nIndexSize; nRead += ::GetSerializeSize(CSnapshotIndex(), SER_DISK, CLIENT_VERSION)) {
+            CSnapshotIndex index;
+            fileIndex >> index;
+            BOOST_REQUIRE_EQUAL(fseek(fileSnapshot.Get(), index.nOffset, SEEK_SET), 0);
+            CSnapshotDelta delta;
+            fileSnapshot >> delta;
+            std::map<uint32_t, SnapshotClass>::const_iterator baseit = mapLoaded.find(delta.nBaseHeight);
+            BOOST_REQUIRE(delta.Resolve(baseit == mapLoaded.end() ? NULL : &baseit->second));
+            mapLoaded.insert(std::make_pair(index.nHeight, delta.snapshot));
+            vSnapshots.push_back(delta.snapshot);
+        }
+    }
+    return vSnapshots;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_parallel_load)
+{
+    // Three files of 25 snapshots in runs of 10, so that every file is decoded in several parts
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(dir);
+    const int nFiles = 3;
+    std::vector<std::pair<boost::filesystem::path, boost::filesystem::path> > vAllFiles;
+    SnapshotClass snapshot = MakeTestSnapshot(0);
+    for (int nFile = 0; nFile < nFiles; nFile++) {
+        std::vector<SnapshotClass> vSnapshots;
+        for (int i = 0; i < 25; i++) {
+            snapshot.blockHeight++;
+            snapshot.timestamp += 10;
+            if (snapshot.blockHeight % 3 == 0)
+                snapshot.curRefundIndexList.insert(snapshot.blockHeight % 11);
+            if (snapshot.blockHeight % 4 == 0)
+                snapshot.curTimeoutIndexRecord[snapshot.blockHeight % 5] = snapshot.blockHeight;
+            vSnapshots.push_back(snapshot);
+        }
+        vAllFiles.push_back(std::make_pair(dir / strprintf("SnapshotDelta%d", nFile), dir / strprintf("SnapshotDeltaIndex%d", nFile)));
+        WriteSnapshotFile(vAllFiles.back().first, vAllFiles.back().second, vSnapshots, 10);
+    }
+
+    // Startup loads the last two files, from the same start index as before the worker pool
+    BOOST_CHECK_EQUAL(CConsensusAccountPool::getFirstSnapshotFileToLoad(nFiles), 1);
+    BOOST_CHECK_EQUAL(CConsensusAccountPool::getFirstSnapshotFileToLoad(2), 0);
+    std::vector<std::pair<boost::filesystem::path, boost::filesystem::path> > vFiles;
+    for (int nFile = CConsensusAccountPool::getFirstSnapshotFileToLoad(nFiles); nFile < nFiles; nFile++)
+        vFiles.push_back(vAllFiles[nFile]);
+    std::vector<SnapshotClass> vExpected = ReadSnapshotFilesSerial(vFiles);
+    BOOST_CHECK_EQUAL(vExpected.size(), 50U);
+
+    CConsensusAccountPool pool;
+    BOOST_CHECK_EQUAL(pool.loadSnapshotFiles(vFiles), 50);
+    std::vector<SnapshotRef> vLoaded;
+    BOOST_CHECK(pool.GetSnapshotsByHeight(vLoaded, 0));
+    BOOST_REQUIRE_EQUAL(vLoaded.size(), vExpected.size());
+    for (size_t i = 0; i < vExpected.size(); i++) {
+        // Newest first
+        const SnapshotClass& loaded = *vLoaded[vLoaded.size() - 1 - i];
+        BOOST_CHECK_EQUAL(loaded.blockHeight, vExpected[i].blockHeight);
+        BOOST_CHECK(loaded == vExpected[i]);
+    }
+
+    // With a single file the start index is -1, that file is missing and
+    // stops the load, as it stopped the serial loader
+    BOOST_CHECK_EQUAL(CConsensusAccountPool::getFirstSnapshotFileToLoad(1), -1);
+    vFiles.assign(1, std::make_pair(dir / "SnapshotDelta-1", dir / "SnapshotDeltaIndex-1"));
+    vFiles.push_back(vAllFiles[0]);
+    CConsensusAccountPool poolSingle;
+    BOOST_CHECK_EQUAL(poolSingle.loadSnapshotFiles(vFiles), 0);
+    BOOST_CHECK(ReadSnapshotFilesSerial(vFiles).empty());
+
+    boost::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_file_read)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    std::vector<CSnapshotIndex> vIndex(3);
+    {
+        CAutoFile fileout(fopen(path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(!fileout.IsNull());
+        for (unsigned int i = 0; i < vIndex.size(); i++) {
+            vIndex[i].nHeight = i;
+            vIndex[i].nOffset = i * 1000;
+            fileout << vIndex[i];
+        }
+    }
+
+    CMappedFileDpoc mapped;
+    BOOST_CHECK(mapped.Open(path));
+    uint64_t nSeek = 0;
+    for (unsigned int i = 0; i < vIndex.size(); i++) {
+        CSnapshotIndex index;
+        uint64_t nRead = 0;
+        BOOST_CHECK(mapped.Read(index, nSeek, &nRead));
+        BOOST_CHECK_EQUAL(index.nHeight, vIndex[i].nHeight);
+        BOOST_CHECK_EQUAL(index.nOffset, vIndex[i].nOffset);
+        nSeek += nRead;
+    }
+    BOOST_CHECK_EQUAL(nSeek, mapped.size());
+
+    // Reading past the end fails instead of returning garbage
+    CSnapshotIndex index;
+    BOOST_CHECK(!mapped.Read(index, nSeek));
+    BOOST_CHECK(!mapped.Read(index, nSeek - 1));
+
+    mapped.Close();
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(vote_hash_cache)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    std::set<CVote> setVotes;
+    CVoteSet voteSet;
+    for (int i = 0; i < 5; i++) {
+        CVote vote;
+        vote.type = CVote::Commit;
+        vote.block_hash = GetRandHash();
+        vote.owner_hash = key.GetPubKey().GetID();
+        vote.vchPubKeyOut = key.GetPubKey();
+        vote.UpdateHash();
+        uint256 hashUnsigned = vote.GetHash();
+        BOOST_CHECK(hashUnsigned == SerializeHash(vote));
+        BOOST_CHECK(vote.Sign(key));
+        // Signing changes the serialization, so the hash must follow
+        BOOST_CHECK(vote.GetHash() != hashUnsigned);
+        BOOST_CHECK(vote.GetHash() == SerializeHash(vote));
+        BOOST_CHECK(vote.SignVerify());
+        setVotes.insert(vote);
+        voteSet.insert(vote);
+    }
+    voteSet.insert(*setVotes.begin());
+    BOOST_CHECK_EQUAL(voteSet.size(), setVotes.size());
+
+    // Same bytes as the std::set<CVote> used on the wire and in the vote database
+    CDataStream ssSet(SER_NETWORK, PROTOCOL_VERSION), ssVoteSet(SER_NETWORK, PROTOCOL_VERSION);
+    ssSet << setVotes;
+    ssVoteSet << voteSet;
+    BOOST_CHECK(ssSet.str() == ssVoteSet.str());
+
+    CVoteSet loaded;
+    ssSet >> loaded;
+    BOOST_CHECK(loaded == voteSet);
+    for (const CVote& vote : loaded)
+        BOOST_CHECK(vote.GetHash() == SerializeHash(vote));
+}
+
+BOOST_AUTO_TEST_CASE(vote_signature_check)
+{
+    CVoteSet votes;
+    for (int i = 0; i < 4; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        CVote vote;
+        vote.type = CVote::Commit;
+        vote.block_hash = GetRandHash();
+        vote.owner_hash = key.GetPubKey().GetID();
+        vote.vchPubKeyOut = key.GetPubKey();
+        BOOST_CHECK(vote.Sign(key));
+        votes.insert(vote);
+    }
+    BOOST_CHECK(CheckVoteSignatures(votes, true));
+    // Cached votes are accepted again without being verified
+    BOOST_CHECK(CheckVoteSignatures(votes, true));
+
+    CKey key, otherKey;
+    key.MakeNewKey(true);
+    otherKey.MakeNewKey(true);
+    CVote bad;
+    bad.type = CVote::Commit;
+    bad.block_hash = GetRandHash();
+    bad.owner_hash = key.GetPubKey().GetID();
+    bad.vchPubKeyOut = key.GetPubKey();
+    BOOST_CHECK(bad.Sign(otherKey));
+    votes.insert(bad);
+    BOOST_CHECK(!CheckVoteSignatures(votes, true));
+    // A failed check is not cached
+    BOOST_CHECK(!CheckVoteSignatures(votes, true));
+}
+
+BOOST_FIXTURE_TEST_CASE(vote_signature_check_parallel, TestingSetup)
+{
+    // TestingSetup starts vote check threads, so the checks go through the queue
+    BOOST_CHECK(nScriptCheckThreads > 1);
+    CVoteSet votes;
+    for (int i = 0; i < 16; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        CVote vote;
+        vote.type = CVote::Commit;
+        vote.block_hash = GetRandHash();
+        vote.owner_hash = key.GetPubKey().GetID();
+        vote.vchPubKeyOut = key.GetPubKey();
+        BOOST_CHECK(vote.Sign(key));
+        votes.insert(vote);
+    }
+    BOOST_CHECK(CheckVoteSignatures(votes, false));
+
+    // One bad signature among many fails the whole set
+    CKey key, otherKey;
+    key.MakeNewKey(true);
+    otherKey.MakeNewKey(true);
+    CVote bad;
+    bad.type = CVote::Commit;
+    bad.block_hash = GetRandHash();
+    bad.owner_hash = key.GetPubKey().GetID();
+    bad.vchPubKeyOut = key.GetPubKey();
+    BOOST_CHECK(bad.Sign(otherKey));
+    votes.insert(bad);
+    BOOST_CHECK(!CheckVoteSignatures(votes, false));
+    votes.erase(bad);
+    BOOST_CHECK(CheckVoteSignatures(votes, true));
+}
+
+static CVote MakeCommitVote(const uint256& block_hash)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CVote vote;
+    vote.type = CVote::Commit;
+    vote.block_hash = block_hash;
+    vote.owner_hash = key.GetPubKey().GetID();
+    vote.vchPubKeyOut = key.GetPubKey();
+    BOOST_CHECK(vote.Sign(key));
+    return vote;
+}
+
+BOOST_FIXTURE_TEST_CASE(vote_quorum_wait, TestingSetup)
+{
+    // Three consensus accounts, so two commits make the quorum
+    std::set<uint160> savedAccounts = CMeetingItem::g_Account;
+    CMeetingItem::g_Account.clear();
+    for (int i = 0; i < 3; i++) {
+        uint160 account;
+        GetRandBytes(account.begin(), account.size());
+        CMeetingItem::g_Account.insert(account);
+    }
+    const uint160 owner = *CMeetingItem::g_Account.begin();
+
+    CBlock block;
+    block.nTime = GetTime();
+    StartVoteRound(owner, block.GetHash());
+    // A commit on another block is not counted
+    BOOST_CHECK(!AddCommitVote(MakeCommitVote(GetRandHash())));
+    BOOST_CHECK(!AddCommitVote(MakeCommitVote(block.GetHash())));
+
+    // The quorum is reached while the proposer waits, the wait ends long before its timeout
+    CVote last = MakeCommitVote(block.GetHash());
+    bool fQuorum = false;
+    boost::thread voter([&last, &fQuorum]{
+        MilliSleep(200);
+        fQuorum = AddCommitVote(last);
+    });
+    int64_t nStart = GetTimeMillis();
+    BOOST_CHECK(WaitingForVote(owner, block));
+    int64_t nWaited = GetTimeMillis() - nStart;
+    voter.join();
+    BOOST_CHECK(fQuorum);
+    BOOST_CHECK(nWaited >= 100 && nWaited < 5000);
+
+    CVoteRoundStats stats;
+    BOOST_CHECK(GetLastVoteRoundStats(stats));
+    BOOST_CHECK(stats.block_hash == block.GetHash());
+    BOOST_CHECK_EQUAL(stats.nCommits, 2U);
+    BOOST_CHECK_EQUAL(stats.nPrecommitQuorumMillis, -1);
+    BOOST_CHECK(stats.nCommitQuorumMillis >= 100 && stats.nCommitQuorumMillis < 5000);
+
+    // A quorum reached before the wait starts ends it at once
+    CBlock next = block;
+    next.nTime++;
+    StartVoteRound(owner, next.GetHash());
+    BOOST_CHECK(!AddCommitVote(MakeCommitVote(next.GetHash())));
+    BOOST_CHECK(AddCommitVote(MakeCommitVote(next.GetHash())));
+    nStart = GetTimeMillis();
+    BOOST_CHECK(WaitingForVote(owner, next));
+    BOOST_CHECK(GetTimeMillis() - nStart < 1000);
+
+    // getmininginfo reports the last round
+    UniValue round = find_value(CallRPC("getmininginfo").get_obj(), "voteround");
+    BOOST_CHECK_EQUAL(find_value(round, "blockhash").get_str(), next.GetHash().GetHex());
+    BOOST_CHECK_EQUAL(find_value(round, "precommitms").get_int64(), -1);
+    BOOST_CHECK(find_value(round, "commitms").get_int64() >= 0);
+    BOOST_CHECK_EQUAL(find_value(round, "commits").get_int(), 2);
+
+    CMeetingItem::g_Account = savedAccounts;
+}
+
+BOOST_AUTO_TEST_CASE(meeting_order_cache)
+{
+    const int64_t nStartTime = 1530000000000LL;
+    std::list<std::shared_ptr<CConsensusAccount>> candidates;
+    for (int i = 0; i < 6; i++) {
+        uint160 pkhash;
+        GetRandBytes(pkhash.begin(), pkhash.size());
+        candidates.push_back(std::make_shared<CConsensusAccount>(pkhash));
+    }
+
+    CCarditConsensusMeeting meeting;
+    std::list<std::shared_ptr<CConsensusAccount>> order = candidates;
+    BOOST_CHECK(meeting.GetMeetingList(nStartTime, order));
+    BOOST_CHECK_EQUAL(order.size(), candidates.size());
+    for (const std::shared_ptr<CConsensusAccount>& account : order) {
+        // The sort key is the hash of the hex public key hash followed by the decimal time
+        std::string strKey = account->getPubicKey160hash().GetHex() + strprintf("%d", nStartTime);
+        uint256 hash = Hash(strKey.begin(), strKey.end());
+        BOOST_CHECK(account->getSortValue() == Hash(hash.begin(), hash.end()));
+    }
+
+    // Asking again for the same candidates gives the same order
+    std::list<std::shared_ptr<CConsensusAccount>> cached = candidates;
+    BOOST_CHECK(meeting.GetMeetingList(nStartTime, cached));
+    BOOST_CHECK(cached == order);
+
+    // Another candidate list of the same period is sorted on its own
+    std::list<std::shared_ptr<CConsensusAccount>> fewer(++candidates.begin(), candidates.end());
+    BOOST_CHECK(meeting.GetMeetingList(nStartTime, fewer));
+    BOOST_CHECK_EQUAL(fewer.size(), candidates.size() - 1);
+}
+
+BOOST_AUTO_TEST_CASE(commit_certificate)
+{
+    const uint256 hashBlock = GetRandHash();
+    std::vector<uint160> vMembers;
+    CVoteSet votes;
+    for (int i = 0; i < 6; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        vMembers.push_back(key.GetPubKey().GetID());
+        // Members 1 and 4 did not vote
+        if (i == 1 || i == 4)
+            continue;
+        CVote vote;
+        vote.type = CVote::Commit;
+        vote.block_hash = hashBlock;
+        vote.owner_hash = key.GetPubKey().GetID();
+        vote.nPeriodStartTime = 1530000000000LL;
+        vote.nTimePeriod = 3;
+        vote.vchPubKeyOut = key.GetPubKey();
+        BOOST_CHECK(vote.Sign(key));
+        votes.insert(vote);
+    }
+
+    CCommitCertificate cert;
+    cert.block_hash = hashBlock;
+    cert.nPeriodStartTime = 1530000000000LL;
+    cert.nTimePeriod = 3;
+    for (size_t i = 0; i < vMembers.size(); i++) {
+        for (const CVote& vote : votes) {
+            if (vote.owner_hash == vMembers[i])
+                BOOST_CHECK(cert.AddVote(i, vote));
+        }
+    }
+    BOOST_CHECK_EQUAL(cert.GetSignerCount(), votes.size());
+    BOOST_CHECK_EQUAL(cert.vSigners.size(), 1U);
+    BOOST_CHECK_EQUAL(cert.vSigners[0], 0x2d);
+    // Signers are added in list order only
+    BOOST_CHECK(!cert.AddVote(1, *votes.begin()));
+    BOOST_CHECK(GetSerializeSize(cert, SER_NETWORK, PROTOCOL_VERSION) * 3 / 2 < GetSerializeSize(votes, SER_NETWORK, PROTOCOL_VERSION));
+
+    // The votes rebuilt from a stored certificate are the votes it was made of
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << cert;
+    CCommitCertificate loaded;
+    ss >> loaded;
+    BOOST_CHECK(loaded.GetHash() == cert.GetHash());
+    CVoteSet rebuilt;
+    BOOST_CHECK(loaded.GetVotes(vMembers, rebuilt));
+    BOOST_CHECK(rebuilt == votes);
+    BOOST_CHECK(CheckVoteSignatures(rebuilt, false));
+
+    // The keys must belong to the members the bitmap points at
+    std::swap(vMembers[0], vMembers[1]);
+    rebuilt.clear();
+    BOOST_CHECK(!loaded.GetVotes(vMembers, rebuilt));
+    vMembers.resize(3);
+    rebuilt.clear();
+    BOOST_CHECK(!loaded.GetVotes(vMembers, rebuilt));
+}
+
+BOOST_FIXTURE_TEST_CASE(unverified_commit_certificates, TestingSetup)
+{
+    boost::filesystem::create_directories(GetDataDir() / "block" / "Vote");
+    g_pDBVote = new CCommitCertificateDB(1 << 20);
+    uint256 hashBlock = GetRandHash();
+    CCommitCertificate cert1, cert2;
+    cert1.block_hash = cert2.block_hash = hashBlock;
+    cert1.nTimePeriod = 1;
+    cert2.nTimePeriod = 2;
+
+    // The block is unknown, so each peer gets one slot for it
+    BOOST_CHECK(AddUnverifiedCertificate(cert1, 1));
+    BOOST_CHECK(AddUnverifiedCertificate(cert1, 2));
+    BOOST_CHECK(AddUnverifiedCertificate(cert2, 1));
+    std::vector<std::pair<NodeId, CCommitCertificate> > vCertificates = GetUnverifiedCertificates(hashBlock);
+    BOOST_CHECK_EQUAL(vCertificates.size(), 2U);
+    BOOST_CHECK_EQUAL(vCertificates[0].first, 1);
+    BOOST_CHECK(vCertificates[0].second.GetHash() == cert2.GetHash());
+    BOOST_CHECK_EQUAL(vCertificates[1].first, 2);
+    BOOST_CHECK(vCertificates[1].second.GetHash() == cert1.GetHash());
+
+    // Certificates for made up blocks only push out those of the same peer
+    for (int i = 0; i < 8; i++) {
+        CCommitCertificate junk;
+        junk.block_hash = GetRandHash();
+        BOOST_CHECK(AddUnverifiedCertificate(junk, 1));
+    }
+    vCertificates = GetUnverifiedCertificates(hashBlock);
+    BOOST_CHECK_EQUAL(vCertificates.size(), 1U);
+    BOOST_CHECK_EQUAL(vCertificates[0].first, 2);
+
+    EraseUnverifiedCertificates((NodeId)2);
+    BOOST_CHECK(GetUnverifiedCertificates(hashBlock).empty());
+
+    // Nothing is kept for a block that already has a certificate
+    BOOST_CHECK(g_pDBVote->WriteCertificate(cert1));
+    BOOST_CHECK(AddUnverifiedCertificate(cert2, 3));
+    BOOST_CHECK(GetUnverifiedCertificates(hashBlock).empty());
+
+    EraseUnverifiedCertificates((NodeId)1);
+    delete g_pDBVote;
+    g_pDBVote = nullptr;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -584,4 +584,144 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolTxIndexTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CTxIndexEntity entity = CTxIndexEntity::Token("TEST");
+    CTxIndexEntity other = CTxIndexEntity::Token("OTHER");
+
+    CMutableTransaction tx1, tx2;
+    tx1.vin.resize(1);
+    tx1.vin[0].scriptSig = CScript() << OP_11;
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    tx2 = tx1;
+    tx2.vin[0].scriptSig = CScript() << OP_12;
+
+    // Only transactions in the mempool are filed
+    std::vector<CTxIndexEntity> vEntities(1, entity);
+    pool.addTxIndex(tx1.GetHash(), vEntities);
+    std::vector<uint256> txids;
+    pool.GetTxIndexTxids(entity, txids);
+    BOOST_CHECK(txids.empty());
+
+    pool.addUnchecked(tx1.GetHash(), entry.Time(1).FromTx(tx1));
+    pool.addTxIndex(tx1.GetHash(), vEntities);
+    vEntities.push_back(other);
+    pool.addUnchecked(tx2.GetHash(), entry.Time(2).FromTx(tx2));
+    pool.addTxIndex(tx2.GetHash(), vEntities);
+
+    pool.GetTxIndexTxids(entity, txids);
+    BOOST_CHECK_EQUAL(txids.size(), 2);
+    BOOST_CHECK(txids[0] == tx2.GetHash());
+    BOOST_CHECK(txids[1] == tx1.GetHash());
+
+    // Leaving the mempool unfiles a transaction
+    pool.removeRecursive(tx2);
+    txids.clear();
+    pool.GetTxIndexTxids(entity, txids);
+    BOOST_CHECK_EQUAL(txids.size(), 1);
+    BOOST_CHECK(txids[0] == tx1.GetHash());
+    txids.clear();
+    pool.GetTxIndexTxids(other, txids);
+    BOOST_CHECK(txids.empty());
+
+    pool.clear();
+    pool.GetTxIndexTxids(entity, txids);
+    BOOST_CHECK(txids.empty());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolIPCUniqueConflictTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CScript script = CScript() << OP_11 << OP_EQUAL;
+    IPCLabel ipcLabel;
+    ipcLabel.ExtendType = 1;
+    ipcLabel.hash.SetHex("0123456789abcdef0123456789abcdef");
+
+    // Two transactions registering the same IPC hash, one in the mempool with a child
+    CMutableTransaction txPool, txChild, txOther, txBlock;
+    txPool.vin.resize(1);
+    txPool.vin[0].scriptSig = CScript() << OP_11;
+    txPool.vout.push_back(CTxOut(0, script, TXOUT_IPCOWNER, ipcLabel));
+    txBlock = txPool;
+    txBlock.vin[0].scriptSig = CScript() << OP_12;
+    txChild.vin.resize(1);
+    txChild.vin[0].prevout = COutPoint(txPool.GetHash(), 0);
+    txChild.vout.push_back(CTxOut(0, script, TXOUT_IPCOWNER, ipcLabel));
+    txOther.vin.resize(1);
+    txOther.vin[0].scriptSig = CScript() << OP_13;
+    txOther.vout.push_back(CTxOut(10 * COIN, script));
+
+    pool.addUnchecked(txPool.GetHash(), entry.FromTx(txPool));
+    pool.addUnchecked(txChild.GetHash(), entry.FromTx(txChild));
+    pool.addUnchecked(txOther.GetHash(), entry.FromTx(txOther));
+    uint256 owner;
+    BOOST_CHECK(pool.GetIPCUniqueOwner(CIPCUniqueKey::IPCHash(ipcLabel.hash), owner));
+    BOOST_CHECK(owner == txPool.GetHash());
+
+    // The block takes the hash: the mempool registration and its child can't be mined any more
+    std::vector<CTransactionRef> vtx(1, MakeTransactionRef(txBlock));
+    pool.removeForBlock(vtx, 1);
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(pool.exists(txOther.GetHash()));
+    BOOST_CHECK(!pool.GetIPCUniqueOwner(CIPCUniqueKey::IPCHash(ipcLabel.hash), owner));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolTokenConflictTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CScript script = CScript() << OP_11 << OP_EQUAL;
+    TokenRegLabel reg;
+    memcpy(reg.TokenSymbol, "ABC", 4);
+    reg.hash.SetHex("0123456789abcdef0123456789abcdef");
+    reg.value = 100;
+    TokenRegLabel regPool = reg;
+    regPool.hash.SetHex("fedcba9876543210fedcba9876543210");
+    AddTokenLabel issue;
+    issue.version = 1;
+    issue.addmode = 1;
+    issue.height = issue.issueDate = 0;
+    issue.totalCount = issue.currentCount = 100;
+    issue.accuracy = 0;
+    memcpy(issue.TokenSymbol, "ABC", 4);
+    issue.hash = reg.hash;
+    AddTokenLabel issuePool = issue;
+    issuePool.hash = regPool.hash;
+
+    CMutableTransaction txBlock, txRegPool, txIssue, txIssuePool;
+    txBlock.vin.resize(1);
+    txBlock.vin[0].scriptSig = CScript() << OP_11;
+    txBlock.vout.push_back(CTxOut(0, script, reg));
+    txRegPool = txBlock;
+    txRegPool.vin[0].scriptSig = CScript() << OP_12;
+    txRegPool.vout[0] = CTxOut(0, script, regPool);
+    txIssue.vin.resize(1);
+    txIssue.vin[0].scriptSig = CScript() << OP_13;
+    txIssue.vout.push_back(CTxOut(0, script, issue));
+    txIssuePool = txIssue;
+    txIssuePool.vin[0].scriptSig = CScript() << OP_14;
+    txIssuePool.vout[0] = CTxOut(0, script, issuePool);
+
+    pool.addUnchecked(txRegPool.GetHash(), entry.FromTx(txRegPool));
+    pool.addUnchecked(txIssuePool.GetHash(), entry.FromTx(txIssuePool));
+    pool.addUnchecked(txIssue.GetHash(), entry.FromTx(txIssue));
+    std::vector<CTransactionRef> vtx;
+    pool.GetTokenTxs("ABC", vtx);
+    BOOST_CHECK_EQUAL(vtx.size(), 3);
+
+    // The block registers ABC: only the issuance of that registration can still be mined
+    vtx.assign(1, MakeTransactionRef(txBlock));
+    pool.removeForBlock(vtx, 1);
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(pool.exists(txIssue.GetHash()));
+    vtx.clear();
+    pool.GetTokenTxs("ABC", vtx);
+    BOOST_CHECK_EQUAL(vtx.size(), 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
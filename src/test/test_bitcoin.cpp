@@ -42,6 +42,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
         SetupEnvironment();
         SetupNetworking();
         InitSignatureCache();
+        InitVoteSignatureCache();
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(chainName);
@@ -69,6 +70,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         pblocktree = new CBlockTreeDB(1 << 20, true);
         pcoinsdbview = new CCoinsViewDB(1 << 23, true);
         pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+        pIPCUniqueDB = new CIPCUniqueDB();
+        BOOST_REQUIRE(pIPCUniqueDB->Init(true));
+        pTokenRegistry = new CTokenRegistry();
+        BOOST_REQUIRE(pTokenRegistry->Init(true));
         InitBlockIndex(chainparams);
         //{
         //    CValidationState state;
@@ -76,8 +81,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         //    BOOST_CHECK(ok);
         //}
         nScriptCheckThreads = 3;
-        for (int i=0; i < nScriptCheckThreads-1; i++)
+        for (int i=0; i < nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadVoteCheck);
+        }
         g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
         connman = g_connman.get();
         RegisterNodeSignals(GetNodeSignals());
@@ -89,6 +96,10 @@ TestingSetup::~TestingSetup()
         threadGroup.interrupt_all();
         threadGroup.join_all();
         UnloadBlockIndex();
+        delete pTokenRegistry;
+        pTokenRegistry = NULL;
+        delete pIPCUniqueDB;
+        pIPCUniqueDB = NULL;
         delete pcoinsTip;
         delete pcoinsdbview;
         delete pblocktree;
@@ -10,6 +10,7 @@
 #include "checkqueue.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "core_memusage.h"
 #include "key.h"
 #include "keystore.h"
 #include "validation.h" // For CheckTransaction
@@ -758,4 +759,53 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     BOOST_CHECK(!IsStandardTx(t, reason));
 }
 
+BOOST_AUTO_TEST_CASE(test_txout_label)
+{
+    CScript script = CScript() << OP_TRUE;
+    IPCLabel ipcLabel;
+    ipcLabel.ExtendType = 1;
+    ipcLabel.hash.SetHex("0123456789abcdef0123456789abcdef");
+    ipcLabel.labelTitle = "title";
+    CTxOut ipcOut(0, script, TXOUT_IPCOWNER, ipcLabel, "label");
+    BOOST_CHECK(ipcOut.GetIPCLabel() == ipcLabel);
+    // Labels of other types read as null
+    BOOST_CHECK(ipcOut.GetTokenLabel().IsNull());
+    BOOST_CHECK(ipcOut.GetDevoteLabel().IsNull());
+
+    TokenLabel tokenLabel;
+    memcpy(tokenLabel.TokenSymbol, "TEST", 4);
+    tokenLabel.value = 50;
+    CTxOut tokenOut(0, script, tokenLabel);
+
+    std::vector<CTxOut> vout;
+    vout.push_back(ipcOut);
+    vout.push_back(tokenOut);
+    vout.push_back(CTxOut(100, script));
+    for (const CTxOut& out : vout) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << out;
+        std::string strBytes = ss.str();
+        CTxOut loaded;
+        ss >> loaded;
+        BOOST_CHECK_EQUAL(loaded.GetTokenvalue(), out.GetTokenvalue());
+        BOOST_CHECK(loaded.GetIPCLabel() == out.GetIPCLabel());
+
+        CTxOut moved(std::move(loaded));
+        CDataStream ssMoved(SER_NETWORK, PROTOCOL_VERSION);
+        ssMoved << moved;
+        BOOST_CHECK(ssMoved.str() == strBytes);
+    }
+
+    // Heap allocated labels and long strings are accounted for
+    size_t nUsage = RecursiveDynamicUsage(ipcOut);
+    BOOST_CHECK(nUsage > RecursiveDynamicUsage(CTxOut(0, script)));
+    ipcOut.ModifyIPCLabel().labelTitle = std::string(100, 'x');
+    BOOST_CHECK(RecursiveDynamicUsage(ipcOut) > nUsage + 100);
+
+    // Writing a label of another type replaces the held one
+    ipcOut.ModifyTokenLabel().value = 7;
+    BOOST_CHECK(ipcOut.GetIPCLabel().IsNull());
+    BOOST_CHECK_EQUAL(ipcOut.GetTokenLabel().value, 7U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
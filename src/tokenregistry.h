@@ -0,0 +1,163 @@
+#ifndef BITCOIN_TOKENREGISTRY_H
+#define BITCOIN_TOKENREGISTRY_H
+
+#include "hash.h"
+#include "random.h"
+#include "uint256.h"
+#include "serialize.h"
+#include "primitives/transaction.h"
+
+#include <limits>
+#include <map>
+#include <string>
+
+#include <boost/unordered_map.hpp>
+
+/**
+ * What the chain knows about a token symbol: the registration (TXOUT_TOKENREG)
+ * that created it, or the first additional issuance (TXOUT_ADDTOKEN) that
+ * defined its class together with the running total of all its issuances.
+ */
+class CTokenRecord
+{
+public:
+	int nType;				//!< TXOUT_TOKENREG, TXOUT_ADDTOKEN, or 0 if null
+	uint256 txid;			//!< transaction that created the symbol
+	TokenRegLabel regLabel;	//!< the registration, for TXOUT_TOKENREG
+	AddTokenReg firstIssue;	//!< the first issuance, for TXOUT_ADDTOKEN
+	uint64_t nIssued;		//!< sum of currentCount over all issuances
+	uint32_t nIssues;		//!< number of issuances
+
+	CTokenRecord() { SetNull(); }
+
+	void SetNull()
+	{
+		nType = 0;
+		txid.SetNull();
+		regLabel = TokenRegLabel();
+		firstIssue = AddTokenReg();
+		firstIssue.SetNull();
+		nIssued = 0;
+		nIssues = 0;
+	}
+	bool IsNull() const { return nType == 0; }
+
+	std::string getTokenSymbol() const { return nType == TXOUT_ADDTOKEN ? firstIssue.m_addTokenLabel.getTokenSymbol() : regLabel.getTokenSymbol(); }
+	std::string getTokenLabel() const { return nType == TXOUT_ADDTOKEN ? firstIssue.m_addTokenLabel.getTokenLabel() : regLabel.getTokenLabel(); }
+	uint8_t getAccuracy() const { return nType == TXOUT_ADDTOKEN ? firstIssue.m_addTokenLabel.accuracy : regLabel.accuracy; }
+	uint128 getHash() const { return nType == TXOUT_ADDTOKEN ? firstIssue.m_addTokenLabel.hash : regLabel.hash; }
+	uint32_t getIssueDate() const { return nType == TXOUT_ADDTOKEN ? firstIssue.m_addTokenLabel.issueDate : regLabel.issueDate; }
+	uint64_t getTotalCount() const { return nType == TXOUT_ADDTOKEN ? firstIssue.m_addTokenLabel.totalCount : regLabel.totalCount; }
+
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(nType);
+		READWRITE(txid);
+		if (nType == TXOUT_ADDTOKEN)
+			READWRITE(firstIssue);
+		else
+			READWRITE(regLabel);
+		READWRITE(VARINT(nIssued));
+		READWRITE(VARINT(nIssues));
+	}
+};
+
+/** Salted hasher for token symbols, they are chosen by whoever registers them */
+class CTokenSymbolHasher
+{
+private:
+	const uint64_t k0, k1;
+
+public:
+	CTokenSymbolHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+	size_t operator()(const std::string& symbol) const {
+		return CSipHasher(k0, k1).Write((const unsigned char*)symbol.data(), symbol.size()).Finalize();
+	}
+};
+
+/** Lookup of the token symbols and additional issuances of the chain */
+class CTokenView
+{
+public:
+	/** Record of symbol, false if no transaction created it */
+	virtual bool GetToken(const std::string& symbol, CTokenRecord& record) const = 0;
+	/** Whether out is an additional issuance that is already accounted for */
+	virtual bool HaveIssue(const COutPoint& out) const = 0;
+	virtual ~CTokenView() {}
+};
+
+/**
+ * Registrations and issuances applied on top of a base view and not written
+ * anywhere, such as the ones of the earlier transactions of the block being
+ * connected.
+ */
+class CTokenViewCache : public CTokenView
+{
+public:
+	typedef boost::unordered_map<std::string, CTokenRecord, CTokenSymbolHasher> TokenMap;
+	//! New issuances with their position among the issuances of their symbol
+	typedef std::map<COutPoint, std::pair<uint32_t, AddTokenReg> > IssueMap;
+
+	CTokenViewCache(const CTokenView* baseIn) : base(baseIn) {}
+
+	bool GetToken(const std::string& symbol, CTokenRecord& record) const
+	{
+		TokenMap::const_iterator it = mapTokens.find(symbol);
+		if (it != mapTokens.end()) {
+			record = it->second;
+			return true;
+		}
+		return base->GetToken(symbol, record);
+	}
+
+	bool HaveIssue(const COutPoint& out) const
+	{
+		return mapIssues.count(out) || base->HaveIssue(out);
+	}
+
+	/** Create the symbol of label for txid unless it already exists */
+	void AddRegistration(const uint256& txid, const TokenRegLabel& label)
+	{
+		std::string symbol = label.getTokenSymbol();
+		CTokenRecord record;
+		if (GetToken(symbol, record))
+			return;
+		record.nType = TXOUT_TOKENREG;
+		record.txid = txid;
+		record.regLabel = label;
+		mapTokens[symbol] = record;
+	}
+
+	/** Account for the issuance at out, the first one of a symbol creates it */
+	void AddIssue(const COutPoint& out, const AddTokenReg& issue)
+	{
+		if (HaveIssue(out))
+			return;
+		std::string symbol = issue.m_addTokenLabel.getTokenSymbol();
+		CTokenRecord record;
+		if (!GetToken(symbol, record)) {
+			record.nType = TXOUT_ADDTOKEN;
+			record.txid = out.hash;
+			record.firstIssue = issue;
+		}
+		else if (record.nType != TXOUT_ADDTOKEN)
+			return;
+		mapIssues[out] = std::make_pair(record.nIssues, issue);
+		record.nIssued += issue.m_addTokenLabel.currentCount;
+		record.nIssues++;
+		mapTokens[symbol] = record;
+	}
+
+	const TokenMap& GetTokens() const { return mapTokens; }
+	const IssueMap& GetIssues() const { return mapIssues; }
+
+private:
+	const CTokenView* base;
+	TokenMap mapTokens;
+	IssueMap mapIssues;
+};
+
+#endif // BITCOIN_TOKENREGISTRY_H
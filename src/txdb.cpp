@@ -23,7 +23,11 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSUNSPENTINDEX = 'U';
+//! Address UTXO index keyed by address, class, txid and output index only
+static const char DB_LEGACY_ADDRESSUNSPENTINDEX = 'u';
+
+static const char DB_COMMIT_CERTIFICATE = 'c';
 
 
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
@@ -264,29 +268,141 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
 	return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, uint8_t txType, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect)
+bool CBlockTreeDB::ReadAddressUnspentIndex(const uint160& addressHash, int type, uint8_t txType, const std::string& symbol,
+	int nStartHeight, int nEndHeight, const CAddressUnspentKey* pcursor,
+	boost::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> fn)
 {
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+	boost::scoped_ptr<CDBIterator> pcursorDB(NewIterator());
 
-	pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash, txType)));
+	if (pcursor)
+		pcursorDB->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, *pcursor));
+	else
+		pcursorDB->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, addressHash, txType, symbol, nStartHeight, uint256(), 0)));
 
-	while (pcursor->Valid()) {
+	while (pcursorDB->Valid()) {
 		boost::this_thread::interruption_point();
 		std::pair<char, CAddressUnspentKey> key;
-		if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash && key.second.txType == txType) {
-			CAddressUnspentValue nValue;
-			if (pcursor->GetValue(nValue)) {
-				vect.push_back(std::make_pair(key.second, nValue));
-				pcursor->Next();
-			}
-			else {
-				return error("failed to get address unspent value");
-			}
-		}
-		else {
+		if (!pcursorDB->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != (unsigned int)type ||
+			key.second.hashBytes != addressHash || key.second.txType != txType)
+			break;
+		if (!symbol.empty() && key.second.tokensymbol != symbol)
 			break;
+		if (pcursor && key.second.tokensymbol == pcursor->tokensymbol && key.second.blockHeight == pcursor->blockHeight &&
+			key.second.txhash == pcursor->txhash && key.second.index == pcursor->index) {
+			pcursorDB->Next();
+			continue;
 		}
+		//Outside the height range: go on with the next symbol or jump to the range of this one
+		if (key.second.blockHeight > nEndHeight) {
+			if (!symbol.empty())
+				break;
+			pcursorDB->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, addressHash, txType, key.second.tokensymbol, -1, uint256(), 0)));
+			continue;
+		}
+		if (key.second.blockHeight < nStartHeight) {
+			pcursorDB->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, addressHash, txType, key.second.tokensymbol, nStartHeight, uint256(), 0)));
+			continue;
+		}
+		CAddressUnspentValue nValue;
+		if (!pcursorDB->GetValue(nValue))
+			return error("failed to get address unspent value");
+		if (!fn(key.second, nValue))
+			break;
+		pcursorDB->Next();
 	}
 
 	return true;
 }
+
+//Key of the address UTXO index before UpgradeAddressUnspentIndex
+struct CLegacyAddressUnspentKey {
+	unsigned int type;
+	uint160 hashBytes;
+	uint8_t txType;
+	uint256 txhash;
+	size_t index;
+
+	template<typename Stream>
+	void Serialize(Stream& s) const {
+		ser_writedata8(s, type);
+		hashBytes.Serialize(s);
+		ser_writedata8(s, txType);
+		txhash.Serialize(s);
+		ser_writedata32(s, index);
+	}
+	template<typename Stream>
+	void Unserialize(Stream& s) {
+		type = ser_readdata8(s);
+		hashBytes.Unserialize(s);
+		txType = ser_readdata8(s);
+		txhash.Unserialize(s);
+		index = ser_readdata32(s);
+	}
+};
+
+bool CBlockTreeDB::UpgradeAddressUnspentIndex()
+{
+	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+	pcursor->Seek(DB_LEGACY_ADDRESSUNSPENTINDEX);
+	if (!pcursor->Valid())
+		return true;
+
+	LogPrintf("Upgrading address unspent index...\n");
+	std::unique_ptr<CDBBatch> batch(new CDBBatch(*this));
+	size_t nCount = 0;
+	while (pcursor->Valid()) {
+		boost::this_thread::interruption_point();
+		std::pair<char, CLegacyAddressUnspentKey> key;
+		if (!pcursor->GetKey(key) || key.first != DB_LEGACY_ADDRESSUNSPENTINDEX)
+			break;
+		CAddressUnspentValue value;
+		if (!pcursor->GetValue(value))
+			return error("%s: failed to read address unspent value", __func__);
+		const CLegacyAddressUnspentKey& legacy = key.second;
+		std::string symbol = legacy.txType == 1 ? value.unspentout.getTokenSymbol() : std::string();
+		batch->Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(legacy.type, legacy.hashBytes, legacy.txType, symbol, value.blockHeight, legacy.txhash, legacy.index)), value);
+		batch->Erase(key);
+		if (++nCount % 100000 == 0) {
+			if (!WriteBatch(*batch))
+				return false;
+			batch.reset(new CDBBatch(*this));
+		}
+		pcursor->Next();
+	}
+	if (!WriteBatch(*batch))
+		return false;
+	LogPrintf("Upgraded %u address unspent index entries\n", nCount);
+	return true;
+}
+
+CCommitCertificateDB::CCommitCertificateDB(size_t nCacheSize) : CDBWrapper(GetDataDir() / "block" / "Vote", nCacheSize)
+{
+}
+
+bool CCommitCertificateDB::WriteCertificate(const CCommitCertificate& cert)
+{
+	return Write(std::make_pair(DB_COMMIT_CERTIFICATE, cert.block_hash), cert);
+}
+
+bool CCommitCertificateDB::ReadCertificate(const uint256& hash, CCommitCertificate& cert)
+{
+	return Read(std::make_pair(DB_COMMIT_CERTIFICATE, hash), cert);
+}
+
+bool CCommitCertificateDB::WriteLegacyVotes(const uint256& hash, const CVoteSet& votes)
+{
+	return Write(hash, votes);
+}
+
+bool CCommitCertificateDB::ReadLegacyVotes(const uint256& hash, CVoteSet& votes)
+{
+	return Read(hash, votes);
+}
+
+bool CCommitCertificateDB::ReplaceLegacyVotes(const CCommitCertificate& cert)
+{
+	CDBBatch batch(*this);
+	batch.Write(std::make_pair(DB_COMMIT_CERTIFICATE, cert.block_hash), cert);
+	batch.Erase(cert.block_hash);
+	return WriteBatch(batch);
+}
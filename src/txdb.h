@@ -127,8 +127,39 @@ public:
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 
 	bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
-	bool ReadAddressUnspentIndex(uint160 addressHash, int type,uint8_t txType,
-		std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+	/**
+	 * Call fn with the unspent outputs of an address and output class, by
+	 * token symbol and then by height, until it returns false. With a
+	 * non-empty symbol only its outputs are visited. Heights outside
+	 * [nStartHeight, nEndHeight] are skipped, and if pcursor is given the walk
+	 * starts right after it.
+	 */
+	bool ReadAddressUnspentIndex(const uint160& addressHash, int type, uint8_t txType, const std::string& symbol,
+		int nStartHeight, int nEndHeight, const CAddressUnspentKey* pcursor,
+		boost::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> fn);
+	/** Move entries of the address UTXO index written before it was keyed by symbol and height */
+	bool UpgradeAddressUnspentIndex();
+};
+
+/**
+ * Commit certificates of Tendermint blocks (block/Vote/), by block hash.
+ * Entries of the vote database it replaces, the CVoteSet of a block keyed
+ * by the bare block hash, are still read until they are converted.
+ */
+class CCommitCertificateDB : public CDBWrapper
+{
+public:
+	CCommitCertificateDB(size_t nCacheSize);
+private:
+	CCommitCertificateDB(const CCommitCertificateDB&);
+	void operator=(const CCommitCertificateDB&);
+public:
+	bool WriteCertificate(const CCommitCertificate& cert);
+	bool ReadCertificate(const uint256& hash, CCommitCertificate& cert);
+	bool WriteLegacyVotes(const uint256& hash, const CVoteSet& votes);
+	bool ReadLegacyVotes(const uint256& hash, CVoteSet& votes);
+	/** Store the certificate converted from the legacy votes of its block */
+	bool ReplaceLegacyVotes(const CCommitCertificate& cert);
 };
 
 #endif // BITCOIN_TXDB_H
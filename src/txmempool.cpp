@@ -391,6 +391,32 @@ void CTxMemPool::AddTransactionsUpdated(unsigned int n)
     nTransactionsUpdated += n;
 }
 
+// Symbols created or issued by the outputs of tx
+static void GetTokenSymbols(const CTransaction& tx, std::set<std::string>& setSymbols)
+{
+    BOOST_FOREACH(const CTxOut& txout, tx.vout) {
+        if (txout.txType == TXOUT_TOKENREG || txout.txType == TXOUT_ADDTOKEN)
+            setSymbols.insert(txout.getTokenSymbol());
+    }
+}
+
+// Unique values tx takes for itself: IPC hashes, and the token symbols and
+// hashes of registrations. Manual issuances reuse the values of their token.
+static void GetIPCUniqueClaims(const CTransaction& tx, std::vector<CIPCUniqueKey>& vKeys)
+{
+    BOOST_FOREACH(const CTxOut& txout, tx.vout) {
+        if (txout.txType == TXOUT_IPCOWNER) {
+            vKeys.push_back(CIPCUniqueKey::IPCHash(txout.GetIPCLabel().hash));
+        } else if (txout.txType == TXOUT_TOKENREG) {
+            vKeys.push_back(CIPCUniqueKey::TokenSymbol(txout.GetTokenRegLabel().getTokenSymbol()));
+            vKeys.push_back(CIPCUniqueKey::TokenHash(txout.GetTokenRegLabel().hash));
+        } else if (txout.txType == TXOUT_ADDTOKEN && txout.GetAddTokenLabel().addmode == 0) {
+            vKeys.push_back(CIPCUniqueKey::TokenSymbol(txout.GetAddTokenLabel().getTokenSymbol()));
+            vKeys.push_back(CIPCUniqueKey::TokenHash(txout.GetAddTokenLabel().hash));
+        }
+    }
+}
+
 bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, setEntries &setAncestors, bool validFeeEstimate)
 {
     NotifyEntryAdded(entry.GetSharedTx());
@@ -423,6 +449,14 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         mapNextTx.insert(std::make_pair(&tx.vin[i].prevout, &tx));
         setParentTransactions.insert(tx.vin[i].prevout.hash);
     }
+    std::vector<CIPCUniqueKey> vUniqueKeys;
+    GetIPCUniqueKeys(tx, vUniqueKeys);
+    BOOST_FOREACH(const CIPCUniqueKey& key, vUniqueKeys)
+        mapIPCUnique.insert(std::make_pair(key, hash));
+    std::set<std::string> setTokenSymbols;
+    GetTokenSymbols(tx, setTokenSymbols);
+    BOOST_FOREACH(const std::string& symbol, setTokenSymbols)
+        mapTokenTxs.insert(std::make_pair(symbol, hash));
     // Don't bother worrying about child transactions of this one.
     // Normal case of a new transaction arriving is that there can't be any
     // children, because such children would be orphans.
@@ -450,12 +484,55 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     return true;
 }
 
+void CTxMemPool::addTxIndex(const uint256& hash, const std::vector<CTxIndexEntity>& vEntities)
+{
+    LOCK(cs);
+    if (!mapTx.count(hash) || mapTxIndexEntities.count(hash))
+        return;
+    BOOST_FOREACH(const CTxIndexEntity& entity, vEntities)
+        mapTxIndex.insert(std::make_pair(entity, hash));
+    mapTxIndexEntities[hash] = vEntities;
+}
+
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     NotifyEntryRemoved(it->GetSharedTx(), reason);
     const uint256 hash = it->GetTx().GetHash();
     BOOST_FOREACH(const CTxIn& txin, it->GetTx().vin)
         mapNextTx.erase(txin.prevout);
+    std::vector<CIPCUniqueKey> vUniqueKeys;
+    GetIPCUniqueKeys(it->GetTx(), vUniqueKeys);
+    BOOST_FOREACH(const CIPCUniqueKey& key, vUniqueKeys) {
+        IPCUniqueMap::iterator itUnique = mapIPCUnique.find(key);
+        if (itUnique != mapIPCUnique.end() && itUnique->second == hash)
+            mapIPCUnique.erase(itUnique);
+    }
+    std::set<std::string> setTokenSymbols;
+    GetTokenSymbols(it->GetTx(), setTokenSymbols);
+    BOOST_FOREACH(const std::string& symbol, setTokenSymbols) {
+        typedef std::multimap<std::string, uint256>::iterator tokeniter;
+        std::pair<tokeniter, tokeniter> range = mapTokenTxs.equal_range(symbol);
+        for (tokeniter itToken = range.first; itToken != range.second; ++itToken) {
+            if (itToken->second == hash) {
+                mapTokenTxs.erase(itToken);
+                break;
+            }
+        }
+    }
+    std::map<uint256, std::vector<CTxIndexEntity> >::iterator itEntities = mapTxIndexEntities.find(hash);
+    if (itEntities != mapTxIndexEntities.end()) {
+        BOOST_FOREACH(const CTxIndexEntity& entity, itEntities->second) {
+            typedef std::multimap<CTxIndexEntity, uint256>::iterator indexiter;
+            std::pair<indexiter, indexiter> range = mapTxIndex.equal_range(entity);
+            for (indexiter itIndex = range.first; itIndex != range.second; ++itIndex) {
+                if (itIndex->second == hash) {
+                    mapTxIndex.erase(itIndex);
+                    break;
+                }
+            }
+        }
+        mapTxIndexEntities.erase(itEntities);
+    }
 
     if (vTxHashes.size() > 1) {
         vTxHashes[it->vTxHashesIdx] = std::move(vTxHashes.back());
@@ -590,6 +667,75 @@ void CTxMemPool::removeConflicts(const CTransaction &tx)
     }
 }
 
+/**
+ * Called when a block is connected, after its own transactions left the
+ * mempool. Removes the transactions that register an IPC hash, token symbol
+ * or token hash the block registered through another transaction, and the
+ * issuances of those symbols that do not follow the block's registration.
+ * They would fail AreIPCStandard in every block the miner builds.
+ */
+void CTxMemPool::removeUniqueConflicts(const std::vector<CTransactionRef>& vtx)
+{
+    LOCK(cs);
+    std::vector<CTransactionRef> vConflicts;
+    for (const auto& tx : vtx)
+    {
+        const uint256 hash = tx->GetHash();
+        std::vector<CIPCUniqueKey> vKeys;
+        GetIPCUniqueClaims(*tx, vKeys);
+        BOOST_FOREACH(const CIPCUniqueKey& key, vKeys) {
+            IPCUniqueMap::const_iterator itUnique = mapIPCUnique.find(key);
+            if (itUnique == mapIPCUnique.end() || itUnique->second == hash)
+                continue;
+            txiter it = mapTx.find(itUnique->second);
+            if (it == mapTx.end())
+                continue;
+            std::vector<CIPCUniqueKey> vOwnerKeys;
+            GetIPCUniqueClaims(it->GetTx(), vOwnerKeys);
+            if (std::find(vOwnerKeys.begin(), vOwnerKeys.end(), key) != vOwnerKeys.end())
+                vConflicts.push_back(it->GetSharedTx());
+        }
+
+        // Registrations and issuances of the symbols the block registered
+        BOOST_FOREACH(const CTxOut& txout, tx->vout) {
+            std::string symbol;
+            uint128 tokenhash;
+            if (txout.txType == TXOUT_TOKENREG) {
+                symbol = txout.GetTokenRegLabel().getTokenSymbol();
+                tokenhash = txout.GetTokenRegLabel().hash;
+            } else if (txout.txType == TXOUT_ADDTOKEN && txout.GetAddTokenLabel().addmode == 0) {
+                symbol = txout.GetAddTokenLabel().getTokenSymbol();
+                tokenhash = txout.GetAddTokenLabel().hash;
+            } else {
+                continue;
+            }
+            typedef std::multimap<std::string, uint256>::const_iterator tokeniter;
+            std::pair<tokeniter, tokeniter> range = mapTokenTxs.equal_range(symbol);
+            for (tokeniter itToken = range.first; itToken != range.second; ++itToken) {
+                txiter it = mapTx.find(itToken->second);
+                if (it == mapTx.end() || itToken->second == hash)
+                    continue;
+                BOOST_FOREACH(const CTxOut& out, it->GetTx().vout) {
+                    bool fConflict = false;
+                    if (out.txType == TXOUT_TOKENREG)
+                        fConflict = out.GetTokenRegLabel().getTokenSymbol() == symbol;
+                    else if (out.txType == TXOUT_ADDTOKEN)
+                        fConflict = out.GetAddTokenLabel().getTokenSymbol() == symbol &&
+                            (out.GetAddTokenLabel().addmode == 0 || out.GetAddTokenLabel().hash != tokenhash);
+                    if (fConflict) {
+                        vConflicts.push_back(it->GetSharedTx());
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    BOOST_FOREACH(const CTransactionRef& ptx, vConflicts) {
+        ClearPrioritisation(ptx->GetHash());
+        removeRecursive(*ptx, MemPoolRemovalReason::CONFLICT);
+    }
+}
+
 /**
  * Called when a block is connected. Removes from mempool and updates the miner fee estimator.
  */
@@ -618,6 +764,7 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
     }
+    removeUniqueConflicts(vtx);
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = true;
 }
@@ -627,6 +774,10 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapIPCUnique.clear();
+    mapTokenTxs.clear();
+    mapTxIndex.clear();
+    mapTxIndexEntities.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -856,6 +1007,44 @@ CTransactionRef CTxMemPool::get(const uint256& hash) const
     return i->GetSharedTx();
 }
 
+bool CTxMemPool::GetIPCUniqueOwner(const CIPCUniqueKey& key, uint256& txid) const
+{
+    LOCK(cs);
+    IPCUniqueMap::const_iterator it = mapIPCUnique.find(key);
+    if (it == mapIPCUnique.end())
+        return false;
+    txid = it->second;
+    return true;
+}
+
+void CTxMemPool::GetTokenTxs(const std::string& symbol, std::vector<CTransactionRef>& vtx) const
+{
+    LOCK(cs);
+    typedef std::multimap<std::string, uint256>::const_iterator tokeniter;
+    std::pair<tokeniter, tokeniter> range = mapTokenTxs.equal_range(symbol);
+    for (tokeniter it = range.first; it != range.second; ++it) {
+        indexed_transaction_set::const_iterator i = mapTx.find(it->second);
+        if (i != mapTx.end())
+            vtx.push_back(i->GetSharedTx());
+    }
+}
+
+void CTxMemPool::GetTxIndexTxids(const CTxIndexEntity& entity, std::vector<uint256>& txids) const
+{
+    LOCK(cs);
+    std::vector<std::pair<int64_t, uint256> > vSorted;
+    typedef std::multimap<CTxIndexEntity, uint256>::const_iterator indexiter;
+    std::pair<indexiter, indexiter> range = mapTxIndex.equal_range(entity);
+    for (indexiter it = range.first; it != range.second; ++it) {
+        indexed_transaction_set::const_iterator i = mapTx.find(it->second);
+        if (i != mapTx.end())
+            vSorted.push_back(std::make_pair(i->GetTime(), it->second));
+    }
+    std::sort(vSorted.begin(), vSorted.end());
+    for (std::vector<std::pair<int64_t, uint256> >::reverse_iterator it = vSorted.rbegin(); it != vSorted.rend(); ++it)
+        txids.push_back(it->second);
+}
+
 TxMempoolInfo CTxMemPool::info(const uint256& hash) const
 {
     LOCK(cs);
@@ -993,10 +1182,53 @@ bool CCoinsViewMemPool::HaveCoins(const uint256 &txid) const {
     return mempool.exists(txid) || base->HaveCoins(txid);
 }
 
+CIPCUniqueViewMemPool::CIPCUniqueViewMemPool(const CIPCUniqueView* baseIn, const CTxMemPool& mempoolIn) : base(baseIn), mempool(mempoolIn) { }
+
+bool CIPCUniqueViewMemPool::GetOwner(const CIPCUniqueKey& key, uint256& txid) const {
+    // A value registered in the chain always wins; removeForBlock evicts the
+    // mempool transactions that registered it too
+    return base->GetOwner(key, txid) || mempool.GetIPCUniqueOwner(key, txid);
+}
+
+CTokenViewMemPool::CTokenViewMemPool(const CTokenView* baseIn, const CTxMemPool& mempoolIn) : base(baseIn), mempool(mempoolIn) { }
+
+bool CTokenViewMemPool::GetToken(const std::string& symbol, CTokenRecord& record) const {
+    // Replay the few mempool transactions of this symbol on top of the chain
+    std::vector<CTransactionRef> vtx;
+    mempool.GetTokenTxs(symbol, vtx);
+    if (vtx.empty())
+        return base->GetToken(symbol, record);
+    CTokenViewCache tokens(base);
+    BOOST_FOREACH(const CTransactionRef& tx, vtx)
+        ConnectTokenOutputs(*tx, tokens);
+    return tokens.GetToken(symbol, record);
+}
+
+bool CTokenViewMemPool::HaveIssue(const COutPoint& out) const {
+    if (base->HaveIssue(out))
+        return true;
+    CTransactionRef tx = mempool.get(out.hash);
+    return tx && out.n < tx->vout.size() && tx->vout[out.n].txType == TXOUT_ADDTOKEN;
+}
+
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    size_t nUsage = memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + memusage::DynamicUsage(mapIPCUnique) + memusage::DynamicUsage(mapTokenTxs) + memusage::DynamicUsage(mapTxIndex) + memusage::DynamicUsage(mapTxIndexEntities) + cachedInnerUsage;
+    // Each entity also owns a small heap buffer
+    size_t nEntities = mapTxIndex.size();
+    for (std::map<uint256, std::vector<CTxIndexEntity> >::const_iterator it = mapTxIndexEntities.begin(); it != mapTxIndexEntities.end(); it++) {
+        nUsage += memusage::DynamicUsage(it->second);
+        nEntities += it->second.size();
+    }
+    return nUsage + nEntities * memusage::MallocUsage(CTxIndexEntity::Width(CTxIndexEntity::TYPE_ADDRESS));
+}
+
+void CTxMemPool::GetMemoryUsageByType(std::map<uint8_t, size_t>& mapUsage) const {
+    LOCK(cs);
+    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
+        AddTxOutUsageByType(mapUsage, it->GetTx().vout);
+    }
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -13,11 +13,14 @@
 #include <utility>
 #include <string>
 
+#include "addressindex.h"
 #include "amount.h"
 #include "coins.h"
+#include "consensus/validation.h"
 #include "indirectmap.h"
 #include "primitives/transaction.h"
 #include "sync.h"
+#include "tokenregistry.h"
 #include "random.h"
 
 #undef foreach
@@ -506,6 +509,15 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
+    //! Unique IPC and token values registered by mempool transactions, first one wins
+    typedef boost::unordered_map<CIPCUniqueKey, uint256, CIPCUniqueKeyHasher> IPCUniqueMap;
+    IPCUniqueMap mapIPCUnique;
+    //! Mempool transactions registering or issuing each token symbol, in the order they were added
+    std::multimap<std::string, uint256> mapTokenTxs;
+    //! Address, IPC hash and token symbol index of mempool transactions, the in-memory side of TxDBProcess
+    std::multimap<CTxIndexEntity, uint256> mapTxIndex;
+    std::map<uint256, std::vector<CTxIndexEntity> > mapTxIndexEntities;
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -535,10 +547,13 @@ public:
     // then invoke the second version.
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, bool validFeeEstimate = true);
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, setEntries &setAncestors, bool validFeeEstimate = true);
+    /** File the mempool transaction hash under vEntities until it leaves the mempool */
+    void addTxIndex(const uint256& hash, const std::vector<CTxIndexEntity>& vEntities);
 
 	void removeRecursive(const CTransaction &tx, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     void removeConflicts(const CTransaction &tx);
+    void removeUniqueConflicts(const std::vector<CTransactionRef>& vtx);
     void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight);
 
     void clear();
@@ -636,6 +651,12 @@ public:
     }
 
     CTransactionRef get(const uint256& hash) const;
+    /** Txid of the mempool transaction that registered key, false if there is none */
+    bool GetIPCUniqueOwner(const CIPCUniqueKey& key, uint256& txid) const;
+    /** Mempool transactions registering or issuing symbol, in the order they were added */
+    void GetTokenTxs(const std::string& symbol, std::vector<CTransactionRef>& vtx) const;
+    /** Mempool transactions filed under entity by addTxIndex, newest first */
+    void GetTxIndexTxids(const CTxIndexEntity& entity, std::vector<uint256>& txids) const;
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
@@ -663,6 +684,9 @@ public:
 
     size_t DynamicMemoryUsage() const;
 
+    /** Add the memory used by the outputs of the mempool transactions to the total of their output type */
+    void GetMemoryUsageByType(std::map<uint8_t, size_t>& mapUsage) const;
+
     boost::signals2::signal<void (CTransactionRef)> NotifyEntryAdded;
     boost::signals2::signal<void (CTransactionRef, MemPoolRemovalReason)> NotifyEntryRemoved;
 
@@ -720,6 +744,31 @@ public:
     bool HaveCoins(const uint256 &txid) const;
 };
 
+/** CIPCUniqueView that adds the values registered by mempool transactions */
+class CIPCUniqueViewMemPool : public CIPCUniqueView
+{
+protected:
+    const CIPCUniqueView* base;
+    const CTxMemPool& mempool;
+
+public:
+    CIPCUniqueViewMemPool(const CIPCUniqueView* baseIn, const CTxMemPool& mempoolIn);
+    bool GetOwner(const CIPCUniqueKey& key, uint256& txid) const;
+};
+
+/** CTokenView that adds the registrations and issuances of mempool transactions */
+class CTokenViewMemPool : public CTokenView
+{
+protected:
+    const CTokenView* base;
+    const CTxMemPool& mempool;
+
+public:
+    CTokenViewMemPool(const CTokenView* baseIn, const CTxMemPool& mempoolIn);
+    bool GetToken(const std::string& symbol, CTokenRecord& record) const;
+    bool HaveIssue(const COutPoint& out) const;
+};
+
 // We want to sort transactions by coin age priority
 typedef std::pair<double, CTxMemPool::txiter> TxCoinAgePriority;
 
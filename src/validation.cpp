@@ -6,12 +6,14 @@
 #include "validation.h"
 
 #include "arith_uint256.h"
+#include "blockencodings.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "cuckoocache.h"
 #include "hash.h"
 #include "init.h"
 #include "policy/fees.h"
@@ -68,15 +70,20 @@ struct VoteData
 	uint160                      owner_hash;
 	uint256                      block_hash;
 	std::shared_ptr<CBlock>      block;
-	std::set<CVote>              vote1s;
-	std::set<CVote>              vote2s;
+	CVoteSet                     vote1s;
+	CVoteSet                     vote2s;
+
+	// Round timing in milliseconds, 0 until the quorum is reached
+	int64_t                      nStartTime = GetTimeMillis();
+	int64_t                      nPrecommitQuorumTime = 0;
+	int64_t                      nCommitQuorumTime = 0;
 };
 
 /**
  * Global state
  */
 
-CDBWrapper *g_pDBVote = nullptr;
+CCommitCertificateDB *g_pDBVote = nullptr;
 
 extern CWallet* pwalletMain;
 
@@ -128,6 +135,72 @@ static std::shared_ptr<struct VoteData> g_vote;
 
 boost::mutex g_vote_mutex;
 
+/** Signalled with g_vote_mutex held when the current round reaches its commit quorum */
+static boost::condition_variable g_vote_quorum_cond;
+
+/** Timing of the last vote round, protected by g_vote_mutex */
+static CVoteRoundStats g_last_vote_round;
+
+static void RecordVoteRound (const VoteData& data)
+{
+	g_last_vote_round.block_hash = data.block_hash;
+	g_last_vote_round.nPrecommitQuorumMillis = data.nPrecommitQuorumTime ? data.nPrecommitQuorumTime - data.nStartTime : -1;
+	g_last_vote_round.nCommitQuorumMillis = data.nCommitQuorumTime ? data.nCommitQuorumTime - data.nStartTime : -1;
+	g_last_vote_round.nCommits = data.vote2s.size();
+	LogPrint("bench", "- Vote round %s: precommit quorum %dms, commit quorum %dms, %u commits\n",
+		g_last_vote_round.block_hash.ToString(), g_last_vote_round.nPrecommitQuorumMillis,
+		g_last_vote_round.nCommitQuorumMillis, g_last_vote_round.nCommits);
+}
+
+bool GetLastVoteRoundStats (CVoteRoundStats& stats)
+{
+	boost::lock_guard<boost::mutex> lock{g_vote_mutex};
+	if (g_last_vote_round.block_hash.IsNull())
+		return false;
+	stats = g_last_vote_round;
+	return true;
+}
+
+/** Start a round on the proposal of owner_hash, g_vote_mutex must be held */
+static void ResetVoteRound (const uint160& owner_hash, const uint256& block_hash)
+{
+	g_vote.reset(new VoteData());
+	g_vote->owner_hash = owner_hash;
+	g_vote->block_hash = block_hash;
+}
+
+/** Count a commit vote of the current round, g_vote_mutex must be held. True once the round has its commit quorum */
+static bool CountCommitVote (const CVote& vote)
+{
+	if (g_vote == nullptr || vote.block_hash != g_vote->block_hash)
+		return false;
+
+	g_vote->vote2s.insert (vote);
+
+	if (g_vote->vote2s.size ()*3 < CMeetingItem::g_Account.size()*2)
+		return false;
+
+	if (g_vote->nCommitQuorumTime == 0)
+	{
+		g_vote->nCommitQuorumTime = GetTimeMillis();
+		RecordVoteRound (*g_vote);
+		g_vote_quorum_cond.notify_all();
+	}
+	return true;
+}
+
+void StartVoteRound (const uint160& owner_hash, const uint256& block_hash)
+{
+	boost::lock_guard<boost::mutex> lock{g_vote_mutex};
+	ResetVoteRound (owner_hash, block_hash);
+}
+
+bool AddCommitVote (const CVote& vote)
+{
+	boost::lock_guard<boost::mutex> lock{g_vote_mutex};
+	return CountCommitVote (vote);
+}
+
 // Internal stuff
 namespace {
 
@@ -200,41 +273,10 @@ namespace {
  * ActivateBestChain around ActivateBestStep which in turn calls:
  * ConnectTip->removeForBlock->removeConflicts
  */
-struct CAddressData
-{
-public:
-	uint64_t blockIndex;	//block Index
-	int InOrOut;			// = 0txout = 1txin
-	int nIndex;				//Index
-	uint8_t txType;			//Transaction type
-	CAmount amount;			//The amount of  +out  -in
-	std::string  address;	
-	uint128 hash;			//IPC hash
-	std::string  strsymbol;	//Token symbol
-	uint64_t tokenvalue;     //tokenvalue  +out -:in
-	CAddressData(uint64_t blockIndexIn, int InOrOutIn, int n, uint8_t type, CAmount a, std::string& str){
-		//time = t;
-		blockIndex = blockIndexIn;
-		InOrOut = InOrOutIn;
-		nIndex = n;
-		txType = type;
-		amount = a;
-		address = str;
-		hash.SetNull();
-		strsymbol = ""; 
-		tokenvalue = 0;
-
-	}
-};
 //std::multimap<std::string, AddTokenReg> addTokenDataMap;//TXOUT_ADDTOKEN
-std::map<std::string, TokenReg> tokenDataMap;	//token map    key:symnbol   value:TokenRegLabel
-std::map<std::string, TokenReg> newTokenDataMap; //When connectblock, the current block needs to be added to the tokenDataMap data
+CTokenRegistry* pTokenRegistry = NULL;
 //std::multimap<std::string, AddTokenReg> newAddTokenDataMap;//TXOUT_ADDTOKEN
-//IPC related unique values for the use of MAP, and the pressing operation
-//Element meaning: the key value is TokenSymbol, string. Value is the corresponding txid and state bits. State =0 is a temporary, unconfirmed transaction in the pool. State =1 is permanent, is a transaction that has been booked into block.
-IPCCheckMaps* pIPCCheckMaps = NULL;
-IPCCheckMaps tmpIPCUniqueCheckMap;
-IPCCheckMaps newIPCCKMap;	
+CIPCUniqueDB* pIPCUniqueDB = NULL;
 
 class MemPoolConflictRemovalTracker
 {
@@ -288,264 +330,147 @@ std::string TokenHashCkFileName = std::string("THashck");
 std::string FileTokenDataName = std::string("TokenData");
 std::string FileAddTokenDataName = std::string("AddTokenData");
 
-//Write the Maps in memory to disk
-bool CVerifyDB:: FlushICMToDisk()
-{
-	//IPCCheckMaps ttCheckMaps;
-	CKSizeClass ttcksize;
-	ttcksize.setNull();
-
-	uint64_t nSeek = uint64_t(0);
-	std::map<std::string, std::pair<uint256, int>>::iterator TSit;
-	std::map<uint128, std::pair<uint256, int>>::iterator Hit;
-
-	CKTSMapDataClass ttTSMapData;
-	ttTSMapData.setNull();
-	CSerializeDpoc<CKTSMapDataClass> rwSerTSymbol;
-	IPCCheckMaps* pIPCCheck = &newIPCCKMap;
-	for (TSit = pIPCCheck->TokenSymbolMap.begin(); TSit != pIPCCheck->TokenSymbolMap.end(); TSit++)
-	{
-		ttTSMapData.setNull();
-		ttTSMapData.tokensymbol = TSit->first;
-		ttTSMapData.txid = TSit->second.first;
-		ttTSMapData.bstate = TSit->second.second;
-		if (!rwSerTSymbol.WriteToDisk(ttTSMapData, TokenSymCkFileName))
-		{
-			LogPrintf(" [FlushICMToDisk] : [WriteToDisk : %s] ,return erro! \n", TokenSymCkFileName);
-			return false;
-		}
-		
-	}
-	
-	CKHashMapDataClass ttTHMapData;
-	CSerializeDpoc<CKHashMapDataClass> rwSerTHash;
-
-	for (Hit = pIPCCheck->TokenHashMap.begin(); Hit != pIPCCheck->TokenHashMap.end(); Hit++)
-	{
-		ttTHMapData.setNull();
-		ttTHMapData.hash = Hit->first;
-		ttTHMapData.txid = Hit->second.first;
-		ttTHMapData.bstate = Hit->second.second;
-		if (!rwSerTHash.WriteToDisk(ttTHMapData, TokenHashCkFileName))
-		{
-			LogPrintf(" [FlushICMToDisk] : [WriteToDisk : %s]  ,return erro! \n", TokenHashCkFileName);
-			return false;
-		}
-		
-	}
-
-	
-	for (Hit = pIPCCheck->IPCHashMap.begin(); Hit != pIPCCheck->IPCHashMap.end(); Hit++)
-	{
-		
-		ttTHMapData.setNull();
-		ttTHMapData.hash.SetHex(Hit->first.ToString());
-		ttTHMapData.txid = Hit->second.first;
-		ttTHMapData.bstate = Hit->second.second;
-		if (!rwSerTHash.WriteToDisk(ttTHMapData, IPCHashCkFileName))
-		{
-			LogPrintf(" [FlushICMToDisk] : [WriteToDisk : %s]  ,return erro! \n", IPCHashCkFileName);
-			return false;
-		}
-		
-	}
-	
-	TokenRegLabel ttTokenRegData;
-	ttTokenRegData.SetNull();
-	 
-	AddTokenReg ttTokenRegDataadd;
-	ttTokenRegDataadd.SetNull();
-	CSerializeDpoc<TokenRegLabel> rwSerTokenData;
-	CSerializeDpoc<AddTokenReg> rwSerTokenDataAdd;
-	std::map<std::string, TokenReg>::iterator TDit;
-	std::cout << "WriteToDisk:newTokenDataMap:" << std::endl;
-	for (TDit = newTokenDataMap.begin(); TDit != newTokenDataMap.end(); TDit++)
-	{
-		if (TDit->second.getTokenType() == TXOUT_ADDTOKEN){
-			BOOST_FOREACH(AddTokenReg &addTokenLabel, TDit->second.m_addTokenLabel){
-				ttTokenRegDataadd.SetNull();
-				ttTokenRegDataadd.m_txid = addTokenLabel.m_txid;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap m_txid: %s] \n", ttTokenRegDataadd.m_txid);
-				ttTokenRegDataadd.m_vout = addTokenLabel.m_vout;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap m_vout: %d] \n", ttTokenRegDataadd.m_vout);
-				ttTokenRegDataadd.address = addTokenLabel.address;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap address: %s] \n", ttTokenRegDataadd.address);
-			    ttTokenRegDataadd.m_addTokenLabel.version = addTokenLabel.m_addTokenLabel.version;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap version: %d] \n", ttTokenRegDataadd.m_addTokenLabel.version);
-				ttTokenRegDataadd.m_addTokenLabel.addmode = addTokenLabel.m_addTokenLabel.addmode;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap addmode: %d] \n", ttTokenRegDataadd.m_addTokenLabel.addmode);
-				ttTokenRegDataadd.m_addTokenLabel.height = addTokenLabel.m_addTokenLabel.height;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap height: %d] \n", ttTokenRegDataadd.m_addTokenLabel.height);
-				memcpy((char*)(ttTokenRegDataadd.m_addTokenLabel.TokenSymbol), (char*)(addTokenLabel.m_addTokenLabel.TokenSymbol), sizeof(ttTokenRegDataadd.m_addTokenLabel.TokenSymbol));
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap TokenSymbol: %d] \n", ttTokenRegDataadd.m_addTokenLabel.getTokenSymbol());
-				ttTokenRegDataadd.m_addTokenLabel.hash = addTokenLabel.m_addTokenLabel.hash;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap hash: %d] \n", ttTokenRegDataadd.m_addTokenLabel.hash.ToString());
-				memcpy((char*)(ttTokenRegDataadd.m_addTokenLabel.label), (char*)(TDit->second.getLabel()), sizeof(ttTokenRegDataadd.m_addTokenLabel.label));
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap label: %d] \n", ttTokenRegDataadd.m_addTokenLabel.getTokenLabel());
-				ttTokenRegDataadd.m_addTokenLabel.issueDate = TDit->second.getIssueDate();
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap issueDate: %d] \n", ttTokenRegDataadd.m_addTokenLabel.issueDate);
-				ttTokenRegDataadd.m_addTokenLabel.totalCount = addTokenLabel.m_addTokenLabel.totalCount;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap totalCount: %d] \n", ttTokenRegDataadd.m_addTokenLabel.totalCount);
-				ttTokenRegDataadd.m_addTokenLabel.currentCount = addTokenLabel.m_addTokenLabel.currentCount;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap currentCount: %d] \n", ttTokenRegDataadd.m_addTokenLabel.currentCount);
-				ttTokenRegDataadd.m_addTokenLabel.accuracy = addTokenLabel.m_addTokenLabel.accuracy;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap accuracy: %d] \n", ttTokenRegDataadd.m_addTokenLabel.accuracy);
-				ttTokenRegDataadd.m_addTokenLabel.extendinfo = addTokenLabel.m_addTokenLabel.extendinfo;
-				LogPrintf(" [FlushICMToDisk] : [newTokenDataMap extendinfo: %s] \n", ttTokenRegDataadd.m_addTokenLabel.extendinfo);
-				std::cout << "WriteToDisk:currentCount:" << ttTokenRegDataadd.m_addTokenLabel.currentCount << std::endl;
-				if (!rwSerTokenDataAdd.WriteToDisk(ttTokenRegDataadd, FileAddTokenDataName)){
-					LogPrintf(" [FlushICMToDisk] : [WriteToDisk : %s] ,return erro! \n", FileAddTokenDataName);
-					return false;
-				}
-			}
-		}
-		else{
-			ttTokenRegData.SetNull();
-			memcpy((char*)(ttTokenRegData.TokenSymbol), (char*)(TDit->second.m_tokenRegLabel->TokenSymbol), sizeof(ttTokenRegData.TokenSymbol));
-			ttTokenRegData.value = TDit->second.getValue();
-			ttTokenRegData.hash = TDit->second.getHash();
-			memcpy((char*)(ttTokenRegData.label), (char*)(TDit->second.getLabel()), sizeof(ttTokenRegData.label));
-			ttTokenRegData.issueDate = TDit->second.getIssueDate();
-			ttTokenRegData.totalCount = TDit->second.getTotalCount();
-			ttTokenRegData.accuracy = TDit->second.getAccuracy();
-
-			if (!rwSerTokenData.WriteToDisk(ttTokenRegData, FileTokenDataName))
-			{
-				LogPrintf(" [FlushICMToDisk] : [WriteToDisk : %s] ,return erro! \n", FileTokenDataName);
-				return false;
-			}
-
-		}
-		
-
-	}
-	newIPCCKMap.clear(); //Save the empty
-	newTokenDataMap.clear();
-	//newAddTokenDataMap.clear();
-	LogPrintf("[CVerifyDB:: FlushICMToDisk by true]\n");
-	return true;
-}
 //Loads the Maps data from the disk to local memory
+//Each file is mapped once and its records are deserialized in order from memory
+//The unique value and token files of older versions are only read once, to fill a newly created unique index or token registry
 bool CVerifyDB::LoadICMFromDisk()
 {
 	
 	uint64_t nSeek = 0;
 	uint64_t filesize = 0;
+	uint64_t nRead = 0;
+	CMappedFileDpoc mappedFile;
+	bool fImportUnique = pIPCUniqueDB->IsNew();
 	boost::filesystem::path pathTmpTS = GetDataDir() / TokenSymCkFileName;
-	if (boost::filesystem::exists(pathTmpTS))
+	if (fImportUnique && boost::filesystem::exists(pathTmpTS))
 	{
-		filesize = boost::filesystem::file_size(pathTmpTS);
-		CSerializeDpoc<CKTSMapDataClass> rwSerTS;
+		LogPrintf(" [LoadICMFromDisk]::importing file %s into the unique index.\n", TokenSymCkFileName);
+		if (!mappedFile.Open(pathTmpTS))
+			return false;
+		filesize = mappedFile.size();
 		CKTSMapDataClass ttTSMapData;
 	
 		while (nSeek < filesize)
 		{
 			ttTSMapData.setNull();
-			if (!rwSerTS.ReadFromDisk(ttTSMapData, nSeek, TokenSymCkFileName))
+			if (!mappedFile.Read(ttTSMapData, nSeek, &nRead))
 			{
 				LogPrintf(" [LoadICMFromDisk]::[ReadFromDisk: %s ]  return false! \n", TokenSymCkFileName);
 				return false;
 			}
-			pIPCCheckMaps->TokenSymbolMap.insert(std::make_pair(ttTSMapData.tokensymbol, std::make_pair(ttTSMapData.txid, ttTSMapData.bstate)));
-			nSeek += getSize(ttTSMapData);
+			pIPCUniqueDB->Add(CIPCUniqueKey::TokenSymbol(ttTSMapData.tokensymbol), ttTSMapData.txid);
+			nSeek += nRead;
 		}
 	}
 	filesize = 0;
 	nSeek = 0;
 	boost::filesystem::path pathTmpTH = GetDataDir() / TokenHashCkFileName;    //TokenhashsMap
-	if (boost::filesystem::exists(pathTmpTH))
+	if (fImportUnique && boost::filesystem::exists(pathTmpTH))
 	{
-		filesize = boost::filesystem::file_size(pathTmpTH);
-		CSerializeDpoc<CKHashMapDataClass> rwSerTH;
+		LogPrintf(" [LoadICMFromDisk]::importing file %s into the unique index.\n", TokenHashCkFileName);
+		if (!mappedFile.Open(pathTmpTH))
+			return false;
+		filesize = mappedFile.size();
 		CKHashMapDataClass ttTHMapData;
 		
 		while (nSeek < filesize)
 		{
 			ttTHMapData.setNull();
-			if (!rwSerTH.ReadFromDisk(ttTHMapData, nSeek, TokenHashCkFileName))
+			if (!mappedFile.Read(ttTHMapData, nSeek, &nRead))
 			{
 				LogPrintf(" [LoadICMFromDisk]::[ReadFromDisk: %s ]  return false! \n", TokenHashCkFileName);
 				return false;
 			}
-			pIPCCheckMaps->TokenHashMap.insert(std::make_pair(ttTHMapData.hash, std::make_pair(ttTHMapData.txid, ttTHMapData.bstate)));
-			nSeek += getSize(ttTHMapData);
+			pIPCUniqueDB->Add(CIPCUniqueKey::TokenHash(ttTHMapData.hash), ttTHMapData.txid);
+			nSeek += nRead;
 		}
 	}
 	filesize = 0;
 	nSeek = 0;
 	boost::filesystem::path pathTmpIH = GetDataDir() / IPCHashCkFileName;    //IPChashsMap
-	if (boost::filesystem::exists(pathTmpIH))
+	if (fImportUnique && boost::filesystem::exists(pathTmpIH))
 	{
-		filesize = boost::filesystem::file_size(pathTmpIH);
-		CSerializeDpoc<CKHashMapDataClass> rwSerIH;
+		LogPrintf(" [LoadICMFromDisk]::importing file %s into the unique index.\n", IPCHashCkFileName);
+		if (!mappedFile.Open(pathTmpIH))
+			return false;
+		filesize = mappedFile.size();
 		CKHashMapDataClass ttIHMapData;
 		while (nSeek < filesize)
 		{
 			ttIHMapData.setNull();
-			if (!rwSerIH.ReadFromDisk(ttIHMapData, nSeek, IPCHashCkFileName))
+			if (!mappedFile.Read(ttIHMapData, nSeek, &nRead))
 			{
 				LogPrintf(" [LoadICMFromDisk]::[ReadFromDisk: %s ]  return false! \n", IPCHashCkFileName);
 				return false;
 			}
-			pIPCCheckMaps->IPCHashMap.insert(std::make_pair(ttIHMapData.hash, std::make_pair(ttIHMapData.txid, ttIHMapData.bstate)));
-			nSeek += getSize(ttIHMapData);
+			pIPCUniqueDB->Add(CIPCUniqueKey::IPCHash(ttIHMapData.hash), ttIHMapData.txid);
+			nSeek += nRead;
 		}
 	}
+	if (fImportUnique && !pIPCUniqueDB->Flush())
+		return false;
 	filesize = 0;
 	nSeek = 0;
+	bool fImportTokens = pTokenRegistry->IsNew();
+	CTokenViewCache tokens(pTokenRegistry);
 	boost::filesystem::path pathTmpTD = GetDataDir() / FileTokenDataName;    //TokenDataMap
-	if (boost::filesystem::exists(pathTmpTD))
+	if (fImportTokens && boost::filesystem::exists(pathTmpTD))
 	{
-		LogPrintf(" [LoadICMFromDisk]::loading file %s .\n", FileTokenDataName);
-		filesize = boost::filesystem::file_size(pathTmpTD);
-		CSerializeDpoc<TokenRegLabel> rwSerTD;
+		LogPrintf(" [LoadICMFromDisk]::importing file %s into the token registry.\n", FileTokenDataName);
+		if (!mappedFile.Open(pathTmpTD))
+			return false;
+		filesize = mappedFile.size();
 		TokenRegLabel ttTokenRegData;
 		while (nSeek < filesize)
 		{
 			ttTokenRegData.SetNull();
-			if (!rwSerTD.ReadFromDisk(ttTokenRegData, nSeek, FileTokenDataName))
+			if (!mappedFile.Read(ttTokenRegData, nSeek, &nRead))
 			{
 				LogPrintf(" [LoadICMFromDisk]::[ReadFromDisk: %s ]  return false! \n", FileTokenDataName);
 				return false;
 			}
-			tokenDataMap.insert(std::make_pair(ttTokenRegData.getTokenSymbol(), TokenReg(ttTokenRegData)));
-			nSeek += ttTokenRegData.size();
+			//The file does not record the registering transaction, the unique index does
+			uint256 owner;
+			if (!pIPCUniqueDB->GetOwner(CIPCUniqueKey::TokenSymbol(ttTokenRegData.getTokenSymbol()), owner) || owner.IsNull())
+			{
+				//Without its transaction the registration could never be disconnected
+				LogPrintf(" [LoadICMFromDisk]::no registering transaction for token %s, skipped \n", ttTokenRegData.getTokenSymbol());
+			}
+			else
+			{
+				tokens.AddRegistration(owner, ttTokenRegData);
+			}
+			nSeek += nRead;
 		}
 	}
 	filesize = 0;
 	nSeek = 0;
 	 pathTmpTD = GetDataDir() / FileAddTokenDataName;    //AddTokenDataMap
-	if (boost::filesystem::exists(pathTmpTD))
+	if (fImportTokens && boost::filesystem::exists(pathTmpTD))
 	{
-		LogPrintf(" [LoadICMFromDisk]::loading file %s .\n", FileAddTokenDataName);
-		filesize = boost::filesystem::file_size(pathTmpTD);
-		CSerializeDpoc<AddTokenReg> rwSerTD;
+		LogPrintf(" [LoadICMFromDisk]::importing file %s into the token registry.\n", FileAddTokenDataName);
+		if (!mappedFile.Open(pathTmpTD))
+			return false;
+		filesize = mappedFile.size();
 		AddTokenReg ttaddTokenRegData;
 		while (nSeek < filesize)
 		{
 			ttaddTokenRegData.SetNull();
-			if (!rwSerTD.ReadFromDisk(ttaddTokenRegData, nSeek, FileAddTokenDataName))
+			if (!mappedFile.Read(ttaddTokenRegData, nSeek, &nRead))
 			{
 				LogPrintf(" [LoadICMFromDisk]::[ReadFromDisk: %s ]  return false! \n", FileAddTokenDataName);
 				return false;
 			}
-			std::cout << "ReadFromDisk:getTokenSymbol:" << ttaddTokenRegData.m_addTokenLabel.getTokenSymbol() << std::endl;
-			auto tempaddTokenDataMap = tokenDataMap.find(ttaddTokenRegData.m_addTokenLabel.getTokenSymbol());
-			if (tempaddTokenDataMap == tokenDataMap.end()){
-				TokenReg tempTokenReg;
-				tempTokenReg.m_tokentype = TXOUT_ADDTOKEN;
-				tempTokenReg.m_addTokenLabel.push_back(ttaddTokenRegData);
-				tokenDataMap.insert(std::make_pair(ttaddTokenRegData.m_addTokenLabel.getTokenSymbol(), tempTokenReg));
-				
-			}
-			else{
-				(tempaddTokenDataMap->second.m_addTokenLabel).push_back(ttaddTokenRegData);
-			}
-			std::cout << "ReadFromDisk:currentCount:" << ttaddTokenRegData.m_addTokenLabel.currentCount << std::endl;
-			nSeek += ttaddTokenRegData.size();
-			std::cout << "nSeek:" << nSeek << " ttaddTokenRegData.size:" << ttaddTokenRegData.size() << " filesize:" << filesize << std::endl;
+			tokens.AddIssue(COutPoint(uint256S(ttaddTokenRegData.m_txid), ttaddTokenRegData.m_vout), ttaddTokenRegData);
+			nSeek += nRead;
 		}
 	}
+	if (fImportTokens)
+	{
+		pTokenRegistry->Connect(tokens);
+		if (!pTokenRegistry->Flush())
+			return false;
+	}
 	LogPrintf(" [LoadICMFromDisk]::load all! \n");
 	return true;
 }
@@ -569,138 +494,228 @@ bool AddVoteSign (CVote &p_vote)
 	return p_vote.Sign (vchPrivKeyOut);
 }
 
-void PushTxToIPCValuesToMap(const CTransaction& tx, IPCCheckMaps* pIPCCheckMaps)
+void GetIPCUniqueKeys(const CTransaction& tx, std::vector<CIPCUniqueKey>& vKeys)
 {
 	BOOST_FOREACH(const CTxOut& txout, tx.vout) {
 		switch (txout.txType)
 		{
 		case 2:
-			pIPCCheckMaps->IPCHashMap.insert(std::make_pair(txout.ipcLabel.hash, std::make_pair(tx.GetHash(), 0)));
+			vKeys.push_back(CIPCUniqueKey::IPCHash(txout.GetIPCLabel().hash));
 			break;
 
 		case 4:
-			pIPCCheckMaps->TokenSymbolMap.insert(std::make_pair(txout.tokenRegLabel.getTokenSymbol(), std::make_pair(tx.GetHash(), 0)));
-			pIPCCheckMaps->TokenHashMap.insert(std::make_pair(txout.tokenRegLabel.hash, std::make_pair(tx.GetHash(), 0)));
+			vKeys.push_back(CIPCUniqueKey::TokenSymbol(txout.GetTokenRegLabel().getTokenSymbol()));
+			vKeys.push_back(CIPCUniqueKey::TokenHash(txout.GetTokenRegLabel().hash));
 			break;
 		case TXOUT_ADDTOKEN:
-			pIPCCheckMaps->TokenSymbolMap.insert(std::make_pair(txout.addTokenLabel.getTokenSymbol(), std::make_pair(tx.GetHash(), 0)));
-			pIPCCheckMaps->TokenHashMap.insert(std::make_pair(txout.addTokenLabel.hash, std::make_pair(tx.GetHash(), 0)));
+			vKeys.push_back(CIPCUniqueKey::TokenSymbol(txout.GetAddTokenLabel().getTokenSymbol()));
+			vKeys.push_back(CIPCUniqueKey::TokenHash(txout.GetAddTokenLabel().hash));
 			break;
 		default:
 			break;
 		}
 	}
 }
-void PushTxToTokenDataMap(const CTransaction& tx, std::map<std::string, TokenReg>* pTokenDataMap)
+void ConnectTokenOutputs(const CTransaction& tx, CTokenViewCache& tokens)
 {
-	std::cout << "PushTxToTokenDataMap" << std::endl;
-	for (int i = 0; i < tx.vout.size(); i++) {
+	for (uint32_t i = 0; i < tx.vout.size(); i++) {
 		const CTxOut& txout = tx.vout[i];
-		if (txout.txType == 4){
-			pTokenDataMap->insert(std::make_pair(txout.tokenRegLabel.getTokenSymbol(), TokenReg(txout.tokenRegLabel)));
+		if (txout.txType == TXOUT_TOKENREG){
+			tokens.AddRegistration(tx.GetHash(), txout.GetTokenRegLabel());
 		}
 		else if (txout.txType == TXOUT_ADDTOKEN){
-			std::cout << "TXOUT_ADDTOKEN" << std::endl;
-				CScript script = txout.scriptPubKey;
-				txnouttype typeRet;
-				std::vector<CTxDestination> prevdestes;
-				int nRequiredRet;
-				std::string address;
-				bool fValidAddress = ExtractDestinations(script, typeRet, prevdestes, nRequiredRet);
-				if (fValidAddress){
-					BOOST_FOREACH(CTxDestination &prevdest, prevdestes)
-					{
-						CBitcoinAddress add(prevdest);
-						address = CBitcoinAddress(prevdest).ToString();
-						break;
-					}
-				}
-				if (!address.empty()){
-					std::string tokensymbol = txout.addTokenLabel.getTokenSymbol();
-					auto itor = pTokenDataMap->find(tokensymbol);
-					if (itor != pTokenDataMap->end()){
-						std::vector<AddTokenReg>&m_addTokenLabel = itor->second.m_addTokenLabel;
-						BOOST_FOREACH(AddTokenReg& m_addtokenreg, m_addTokenLabel){
-							if (m_addtokenreg.m_txid == tx.GetHash().ToString() && m_addtokenreg.m_vout == i)
-								return;
-						}
-						AddTokenReg addTokenLabel;
-						addTokenLabel.address = address;
-						addTokenLabel.m_txid = tx.GetHash().ToString();
-						addTokenLabel.m_vout = i;
-						addTokenLabel.m_addTokenLabel = txout.addTokenLabel;
-						m_addTokenLabel.push_back(addTokenLabel);
-						
-					}
-					else{
-						pTokenDataMap->insert(std::make_pair(tokensymbol, TokenReg(txout.addTokenLabel, tx.GetHash().ToString().c_str(), i, address)));
-					}
-					std::cout << "pTokenDataMap->insert" << std::endl;
-				}
+			//Issuances are recorded with the address they were issued to
+			txnouttype typeRet;
+			std::vector<CTxDestination> prevdestes;
+			int nRequiredRet;
+			if (!ExtractDestinations(txout.scriptPubKey, typeRet, prevdestes, nRequiredRet) || prevdestes.empty())
+				continue;
+			AddTokenReg issue;
+			issue.address = CBitcoinAddress(prevdestes[0]).ToString();
+			issue.m_txid = tx.GetHash().ToString();
+			issue.m_vout = i;
+			issue.m_addTokenLabel = txout.GetAddTokenLabel();
+			tokens.AddIssue(COutPoint(tx.GetHash(), i), issue);
 		}
 	}
 }
 
-void AddTx2MapbyAddress(const CTransaction &tx,int blockIndex = -1)
+//Undo ConnectTokenOutputs for a transaction of a disconnected block, last output first
+static void DisconnectTokenOutputs(const CTransaction& tx)
+{
+	for (int i = tx.vout.size() - 1; i >= 0; i--) {
+		const CTxOut& txout = tx.vout[i];
+		if (txout.txType == TXOUT_TOKENREG)
+			pTokenRegistry->DisconnectRegistration(tx.GetHash(), txout.GetTokenRegLabel().getTokenSymbol());
+		else if (txout.txType == TXOUT_ADDTOKEN)
+			pTokenRegistry->DisconnectIssue(COutPoint(tx.GetHash(), i));
+	}
+}
+
+bool GetTokenRecord(const std::string& symbol, CTokenRecord& record)
+{
+	LOCK(cs_main);
+	CTokenViewMemPool tokens(pTokenRegistry, mempool);
+	return tokens.GetToken(symbol, record);
+}
+
+uint8_t GetTokenAccuracy(const std::string& symbol)
+{
+	CTokenRecord record;
+	if (!GetTokenRecord(symbol, record))
+		return 0;
+	return record.getAccuracy();
+}
+
+static void AddTxIndexBalanceDelta(std::map<std::pair<CTxIndexEntity, CTxIndexEntity>, CTxIndexBalance>& mapDeltas,
+	const CTxIndexEntity& address, const CTxIndexEntity& token, CAmount nBalance, CAmount nReceived, CAmount nSent)
+{
+	CTxIndexBalance& delta = mapDeltas[std::make_pair(address, token)];
+	delta.nBalance += nBalance;
+	delta.nReceived += nReceived;
+	delta.nSent += nSent;
+	delta.nTxCount = 1;
+}
+
+//Append the index subjects of txout: its addresses, its IPC hash or its token symbol
+static void GetTxOutIndexEntities(const CTxOut& txout, std::vector<CTxIndexEntity>& vEntities)
+{
+	txnouttype type;
+	std::vector<CTxDestination> vDest;
+	int nRequired;
+	ExtractDestinations(txout.scriptPubKey, type, vDest, nRequired);
+	BOOST_FOREACH(const CTxDestination& dest, vDest)
+	{
+		uint160 hashBytes;
+		int addressType = 0;
+		if (CBitcoinAddress(dest).GetIndexKey(hashBytes, addressType))
+			vEntities.push_back(CTxIndexEntity::Address(addressType, hashBytes));
+	}
+	switch (txout.txType)
+	{
+	case TXOUT_IPCOWNER:
+	case TXOUT_IPCAUTHORIZATION:
+		vEntities.push_back(CTxIndexEntity::IPC(txout.GetIPCLabel().hash));
+		break;
+	case TXOUT_TOKENREG:
+		vEntities.push_back(CTxIndexEntity::Token(txout.GetTokenRegLabel().getTokenSymbol()));
+		break;
+	case TXOUT_TOKEN:
+		vEntities.push_back(CTxIndexEntity::Token(txout.GetTokenLabel().getTokenSymbol()));
+		break;
+	case TXOUT_ADDTOKEN:
+		vEntities.push_back(CTxIndexEntity::Token(txout.GetAddTokenLabel().getTokenSymbol()));
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Index subjects of a mempool transaction, each once: those of its outputs
+ * and of the outputs it spends, which must be in view.
+ */
+static void GetMempoolTxIndexEntities(const CTransaction& tx, const CCoinsViewCache& view, std::vector<CTxIndexEntity>& vEntities)
+{
+	std::vector<CTxIndexEntity> vAll;
+	BOOST_FOREACH(const CTxIn& txin, tx.vin)
+	{
+		const CCoins* coins = view.AccessCoins(txin.prevout.hash);
+		if (coins && coins->IsAvailable(txin.prevout.n))
+			GetTxOutIndexEntities(coins->vout[txin.prevout.n], vAll);
+	}
+	BOOST_FOREACH(const CTxOut& txout, tx.vout)
+		GetTxOutIndexEntities(txout, vAll);
+	std::set<CTxIndexEntity> setSeen;
+	BOOST_FOREACH(const CTxIndexEntity& entity, vAll)
+	{
+		if (setSeen.insert(entity).second)
+			vEntities.push_back(entity);
+	}
+}
+
+/**
+ * Index tx of the block connected at height blockIndex under its addresses,
+ * IPC hashes and token symbols, and update the balance totals of every
+ * address: coins and tokens it spends count as sent, outputs to it as
+ * received unless it is also one of the spenders (change). The spent
+ * outputs are read from txundo, which ConnectBlock fills in input order
+ * and which is null for the coinbase. Mempool transactions are indexed by
+ * CTxMemPool::addTxIndex instead.
+ */
+static void AddTx2MapbyAddress(const CTransaction &tx, const CTxUndo* ptxundo, int blockIndex)
 {
 	AssertLockHeld(cs_main);
-	AssertLockHeld(mempool.cs);
 	txnouttype type;
 	std::vector<CTxDestination> prevdestes;
 	int nRequired;
 	std::vector<CTxaddressData> Datavectors;
 	Datavectors.clear();
+	std::vector<CTxIndexEntity> vEntities;
+	std::set<CTxIndexEntity> setSpenders;
+	std::map<std::pair<CTxIndexEntity, CTxIndexEntity>, CTxIndexBalance> mapDeltas;
 	uint256 txhash = tx.GetHash();   //txid
-	uint64_t tokenbalance = 0;
 	if (!tx.IsCoinBase())
 	{
 		//vin[]
+		if (!ptxundo || ptxundo->vprevout.size() != tx.vin.size())
+			return;
 		for (unsigned int i = 0; i < tx.vin.size(); i++) {
-			CTransactionRef prevTx;
-			uint256 hashBlock;
-
-			if (!GetTransaction(tx.vin[i].prevout.hash, prevTx, Params().GetConsensus(), hashBlock, true))
-				return;
-
-			CTxOut prevout = prevTx->vout[tx.vin[i].prevout.n];
+			const CTxOut& prevout = ptxundo->vprevout[i].txout;
 			ExtractDestinations(prevout.scriptPubKey, type, prevdestes, nRequired);
 			BOOST_FOREACH(CTxDestination &prevdest, prevdestes){
-				std::string address = CBitcoinAddress(prevdest).ToString();
-				pTxDB->Insert(pTxDB->db, (char*)(address.c_str()), (char*)(txhash.GetHex().c_str()));
+				CBitcoinAddress bitcoinAddress(prevdest);
+				uint160 hashBytes;
+				int addressType = 0;
+				CTxIndexEntity addressEntity;
+				if (bitcoinAddress.GetIndexKey(hashBytes, addressType))
+				{
+					addressEntity = CTxIndexEntity::Address(addressType, hashBytes);
+					vEntities.push_back(addressEntity);
+				}
+				CAmount nTokenValue = 0;
+				uint128 ipcHash;
+				std::string strSymbol;
 
-				CAddressData data(blockIndex, 1,i,prevout.txType ,prevout.nValue*-1,address);
-				CTxaddressData txdata(address, 1, prevout.nValue*-1);
+				CTxaddressData txdata(addressEntity, 1, prevout.nValue*-1);
 				switch (prevout.txType)
 				{
 					case 2:
 					case 3:
-						data.hash = prevout.ipcLabel.hash;
+						ipcHash = prevout.GetIPCLabel().hash;
 						break;
 					case 4:
 						//Keep the symbol in token
-						data.strsymbol = prevout.tokenRegLabel.getTokenSymbol();
-						data.tokenvalue = prevout.tokenRegLabel.totalCount*-1;
+						strSymbol = prevout.GetTokenRegLabel().getTokenSymbol();
+						nTokenValue = prevout.GetTokenRegLabel().totalCount;
 						break;
 					case 5:
 						//Keep the symbol in token
-						data.strsymbol = prevout.tokenLabel.getTokenSymbol();
-						data.tokenvalue = prevout.tokenLabel.value*-1;
+						strSymbol = prevout.GetTokenLabel().getTokenSymbol();
+						nTokenValue = prevout.GetTokenLabel().value;
 						break;
 					case TXOUT_ADDTOKEN:
 						//Keep the symbol in token
-						data.strsymbol = prevout.addTokenLabel.getTokenSymbol();
-						data.tokenvalue = prevout.addTokenLabel.currentCount*-1;
+						strSymbol = prevout.GetAddTokenLabel().getTokenSymbol();
+						nTokenValue = prevout.GetAddTokenLabel().currentCount;
 						break;
 					default:
 						break;
 				}	
 				if ((prevout.txType == 2 || prevout.txType == 3 ))
 				{
-					pTxDB->Insert(pTxDB->db, (char*)(data.hash.GetHex().c_str()), (char*)(txhash.GetHex().c_str()));
+					vEntities.push_back(CTxIndexEntity::IPC(ipcHash));
 				}
 				if ((prevout.txType == 4 || prevout.txType == 5 || prevout.txType == TXOUT_ADDTOKEN))
 				{
-					pTxDB->Insert(pTxDB->db, (char*)(data.strsymbol.c_str()), (char*)(txhash.GetHex().c_str()));
+					vEntities.push_back(CTxIndexEntity::Token(strSymbol));
+				}
+				if (blockIndex >= 0 && !addressEntity.IsNull())
+				{
+					setSpenders.insert(addressEntity);
+					AddTxIndexBalanceDelta(mapDeltas, addressEntity, CTxIndexEntity(), -prevout.nValue, 0, prevout.nValue);
+					if (prevout.txType == 4 || prevout.txType == 5 || prevout.txType == TXOUT_ADDTOKEN)
+						AddTxIndexBalanceDelta(mapDeltas, addressEntity, CTxIndexEntity::Token(strSymbol), -nTokenValue, 0, nTokenValue);
 				}
 				Datavectors.push_back(txdata);
 			}
@@ -712,32 +727,40 @@ void AddTx2MapbyAddress(const CTransaction &tx,int blockIndex = -1)
 		{
 			ExtractDestinations(output.scriptPubKey, type, prevdestes, nRequired);
 			BOOST_FOREACH(CTxDestination &prevdest, prevdestes){
-				std::string address = CBitcoinAddress(prevdest).ToString();
-
-				pTxDB->Insert(pTxDB->db, (char*)(address.c_str()), (char*)(tx.GetHash().ToString().c_str()));
+				CBitcoinAddress bitcoinAddress(prevdest);
+				uint160 hashBytes;
+				int addressType = 0;
+				CTxIndexEntity addressEntity;
+				if (bitcoinAddress.GetIndexKey(hashBytes, addressType))
+				{
+					addressEntity = CTxIndexEntity::Address(addressType, hashBytes);
+					vEntities.push_back(addressEntity);
+				}
+				CAmount nTokenValue = 0;
+				uint128 ipcHash;
+				std::string strSymbol;
 
-				CAddressData data(blockIndex, 0, i, output.txType, output.nValue * 1, address);
-				CTxaddressData txdata(address, 0, output.nValue * 1);
+				CTxaddressData txdata(addressEntity, 0, output.nValue * 1);
 				switch (output.txType)
 				{
 				case 2:
 				case 3:
-					data.hash = output.ipcLabel.hash;
+					ipcHash = output.GetIPCLabel().hash;
 					break;
 				case 4:
 					//Keep the symbol in token
-					data.strsymbol = output.tokenRegLabel.getTokenSymbol();
-					data.tokenvalue = output.tokenRegLabel.totalCount;
+					strSymbol = output.GetTokenRegLabel().getTokenSymbol();
+					nTokenValue = output.GetTokenRegLabel().totalCount;
 					break;
 				case 5:
 					//Keep the symbol in token
-					data.strsymbol = output.tokenLabel.getTokenSymbol();
-					data.tokenvalue = output.tokenLabel.value;
+					strSymbol = output.GetTokenLabel().getTokenSymbol();
+					nTokenValue = output.GetTokenLabel().value;
 				break;
 				case TXOUT_ADDTOKEN:
 					//Keep the symbol in token
-					data.strsymbol = output.addTokenLabel.getTokenSymbol();
-					data.tokenvalue = output.addTokenLabel.currentCount;
+					strSymbol = output.GetAddTokenLabel().getTokenSymbol();
+					nTokenValue = output.GetAddTokenLabel().currentCount;
 					break;
 				
 				default:
@@ -745,144 +768,73 @@ void AddTx2MapbyAddress(const CTransaction &tx,int blockIndex = -1)
 				}
 				if ((output.txType == 2 || output.txType == 3))
 				{
-					pTxDB->Insert(pTxDB->db, (char*)(data.hash.GetHex().c_str()), (char*)(txhash.GetHex().c_str()));
+					vEntities.push_back(CTxIndexEntity::IPC(ipcHash));
 				}
 				if ((output.txType == 4 || output.txType == 5 || output.txType == TXOUT_ADDTOKEN))
 				{
-					pTxDB->Insert(pTxDB->db, (char*)(data.strsymbol.c_str()), (char*)(txhash.GetHex().c_str()));
+					vEntities.push_back(CTxIndexEntity::Token(strSymbol));
+				}
+				if (blockIndex >= 0 && !addressEntity.IsNull())
+				{
+					bool fChange = setSpenders.count(addressEntity) > 0;
+					AddTxIndexBalanceDelta(mapDeltas, addressEntity, CTxIndexEntity(), output.nValue, fChange ? 0 : output.nValue, 0);
+					if (output.txType == 4 || output.txType == 5 || output.txType == TXOUT_ADDTOKEN)
+						AddTxIndexBalanceDelta(mapDeltas, addressEntity, CTxIndexEntity::Token(strSymbol), nTokenValue, fChange ? 0 : nTokenValue, 0);
 				}
 				Datavectors.push_back(txdata);
 			}
 		}
 	}
 
-	pTxDB->Insert(pTxDB->db, (char*)(txhash.GetHex().c_str()), Datavectors);
-	
-}
-bool getAddressBalanceByTxlevel(std::string& address, CAmount& balance, CAmount& received, CAmount& sended, uint64_t& txidnum)
-{
-	AssertLockHeld(cs_main);
-	AssertLockHeld(mempool.cs);
-	std::vector<std::string> txids;
-	txids.clear();
-	CAmount nvalue = 0;
-	std::string strtxid = "";
-	
-	if (!pTxDB->Select(pTxDB->db,(char*)(address.c_str()),txids,0)) //Find out
-	{
-		return false;
-	}
-	txidnum = txids.size();
-	std::vector<CTxaddressData> txdatas;
-	for (int i = 0; i < txidnum; i++)
+	pTxDB->AddTx(txhash, vEntities, Datavectors);
+
+	if (blockIndex >= 0)
 	{
-		txdatas.clear(); 
-		strtxid = txids[i];
-		pTxDB->Select(pTxDB->db, (char*)(strtxid.c_str()), txdatas);
-		std::multimap<std::string, int> addressesin;
-		addressesin.clear();
-		for (int j = 0; j < txdatas.size(); j++)
+		std::vector<CTxIndexBalanceDelta> vDeltas;
+		vDeltas.reserve(mapDeltas.size());
+		for (std::map<std::pair<CTxIndexEntity, CTxIndexEntity>, CTxIndexBalance>::const_iterator it = mapDeltas.begin(); it != mapDeltas.end(); ++it)
 		{
-			std::string straddin = txdatas[j].address;
-			CAmount ntxdatavalue = txdatas[j].amount;
-			if (txdatas[j].ntype == 1 && ntxdatavalue <= 0)
-				addressesin.insert(std::make_pair(straddin, j));
-		}
-		for (int j = 0; j < txdatas.size();j++)
-		{
-			std::string stradd = txdatas[j].address;
-			nvalue = txdatas[j].amount;
-			if (address != stradd)
-				continue;
-			if (txdatas[j].ntype == 0 && nvalue >= 0 && !addressesin.count(stradd))
-			{
-				received += nvalue;		//Output sum
-			}
-			else if (txdatas[j].ntype == 1 && nvalue <= 0)
-			{
-				sended -= nvalue;			//Input sum
-			}
-				
-			balance += nvalue;				//Full balance
+			CTxIndexBalanceDelta delta;
+			delta.address = it->first.first;
+			delta.token = it->first.second;
+			delta.delta = it->second;
+			vDeltas.push_back(delta);
 		}
-		
+		pTxDB->ConnectBalances(txhash, vDeltas);
 	}
+}
+bool getAddressBalanceByTxlevel(std::string& address, CAmount& balance, CAmount& received, CAmount& sended, uint64_t& txidnum)
+{
+	uint160 hashBytes;
+	int addressType = 0;
+	if (!CBitcoinAddress(address).GetIndexKey(hashBytes, addressType))
+		return false;
 
+	CTxIndexBalance totals;
+	if (!pTxDB->GetBalance(CTxIndexEntity::Address(addressType, hashBytes), CTxIndexEntity(), totals))
+		return false;
+	balance = totals.nBalance;
+	received = totals.nReceived;
+	sended = totals.nSent;
+	txidnum = totals.nTxCount;
 	return true;
 }
 
 bool getTokenBalanceByAddress(std::string& address, std::string& tokensymbol,CAmount& balance, CAmount& received, CAmount& sended , uint64_t& txidnum)
 {
-    AssertLockHeld(cs_main);
-    AssertLockHeld(mempool.cs);
-    std::vector<std::string> txids;
-    txids.clear();
-    if (!pTxDB->Select(pTxDB->db, (char*)(address.c_str()), txids, 0)) //Find out
-        return false;
-    std::vector<CTransaction> vecTxs;
-    std::vector<CTransaction> regTxs;
-    for (auto& strtxid : txids)
-    {
-        CTransactionRef mtx;
-        uint256 hashBlock;
-        //std::cout << strtxid << std::endl;
-        if(!GetTransaction(uint256S(strtxid), mtx, Params().GetConsensus(), hashBlock, true))
-            return false;
-        //CMutableTransaction tx(*mtx);
-		if (mtx->vout[0].txType != 4 && mtx->vout[0].txType != 5 &&mtx->vout[0].txType != TXOUT_ADDTOKEN) continue;
-       
-		if (mtx->vout[0].tokenLabel.getTokenSymbol() == tokensymbol)
-            vecTxs.push_back(*mtx);
-        else if (mtx->vout[0].tokenRegLabel.getTokenSymbol() == tokensymbol)
-            regTxs.push_back(*mtx);
-		else if (mtx->vout[0].addTokenLabel.getTokenSymbol() == tokensymbol)
-			regTxs.push_back(*mtx);
-        else
-            continue;
-    }
-    CBitcoinAddress ipcAddress(address);
-    CScript curScript = GetScriptForDestination(ipcAddress.Get());
-    for (auto &tx: vecTxs)
-    {
-        for (auto &txIn : tx.vin)
-        {
-            CTransactionRef prevTx;
-            uint256 hashBlock;
-            if (!GetTransaction(txIn.prevout.hash, prevTx, Params().GetConsensus(), hashBlock, true))
-                return false;
-            if (curScript == prevTx->vout[txIn.prevout.n].scriptPubKey)
-            {
-                if(prevTx->vout[txIn.prevout.n].txType == 5)
-                    balance -= prevTx->vout[txIn.prevout.n].tokenLabel.value;
-                else if(prevTx->vout[txIn.prevout.n].txType == 4)
-                    balance -= prevTx->vout[txIn.prevout.n].tokenRegLabel.totalCount;
-				else if (prevTx->vout[txIn.prevout.n].txType == TXOUT_ADDTOKEN)
-					balance -= prevTx->vout[txIn.prevout.n].addTokenLabel.currentCount;
-            }
-        }
-        for (auto &txOut : tx.vout)
-        {
-            if (curScript == txOut.scriptPubKey)
-                balance += txOut.tokenLabel.value;
-        }
-    }
-    for (auto &tx : regTxs)
-    {
-        for (auto &txOut : tx.vout)
-        {
-            if (curScript == txOut.scriptPubKey&&txOut.tokenRegLabel.getTokenSymbol() == tokensymbol)
-            {
-                balance += txOut.tokenRegLabel.value;
-                balance += txOut.tokenRegLabel.totalCount;
-            }
-			else if (curScript == txOut.scriptPubKey&&txOut.addTokenLabel.getTokenSymbol() == tokensymbol)
-			{
-				balance += 0;
-				balance += txOut.addTokenLabel.currentCount;
-			}
-        }
-    }
-    return true;
+	uint160 hashBytes;
+	int addressType = 0;
+	if (!CBitcoinAddress(address).GetIndexKey(hashBytes, addressType))
+		return false;
+
+	CTxIndexBalance totals;
+	if (!pTxDB->GetBalance(CTxIndexEntity::Address(addressType, hashBytes), CTxIndexEntity::Token(tokensymbol), totals))
+		return false;
+	balance = totals.nBalance;
+	received = totals.nReceived;
+	sended = totals.nSent;
+	txidnum = totals.nTxCount;
+	return true;
 }
 uint64_t getTokenAllcoins(uint8_t accuracy)
 {
@@ -918,18 +870,6 @@ CAmount Getfeebytxid(const CTransaction tx)
 	return nValue;
 }
 
-//The temporary unique variable that will be saved is pressed into the global pool after the block checksum is completed
-void UpdateIPCUniqueMap()
-{
-	std::map<std::string, std::pair<uint256, int>>::iterator tokenSymbolIteator;
-	tokenSymbolIteator = tmpIPCUniqueCheckMap.TokenSymbolMap.begin();
-	while (tokenSymbolIteator != tmpIPCUniqueCheckMap.TokenSymbolMap.end())
-	{
-		pIPCCheckMaps->TokenSymbolMap.insert(std::make_pair(tokenSymbolIteator->first, tokenSymbolIteator->second));
-		tokenSymbolIteator++;
-	}
-}
-
 enum FlushStateMode {
     FLUSH_STATE_NONE,
     FLUSH_STATE_IF_NEEDED,
@@ -1010,10 +950,7 @@ bool CheckIPCFinalTx(const CTransaction &tx)
 		return true;
 	BOOST_FOREACH(const CTxIn& txin, tx.vin){
 		if (!GetTransaction(txin.prevout.hash, prevTx, Params().GetConsensus(), hashBlock, true))
-		{
-			if (!GetCachedChainTransaction(txin.prevout.hash, prevTx))
-				return false;
-		}
+			return false;
 
 		if (!IsFinalPrevTx(prevTx, nBlockHeight))
 		{
@@ -1372,10 +1309,6 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
     if (pool.exists(hash))
         return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-in-mempool");
 
-	// check IPC validations
-	if (!AreIPCStandard(tx, state))
-		return false;
-
 	//If this transaction is a campaign transaction (join or exit), then check that there is a campaign transaction that has the same PK Hash in the pool. If so, refuse
 	if (tx.GetTxType() == 1)
 	{
@@ -1545,6 +1478,12 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             return state.DoS(0, false, REJECT_NONSTANDARD, "non-BIP68-final");
         }
 
+        // check IPC validations, unique values and tokens may already be taken by the chain or the mempool
+        CIPCUniqueViewMemPool uniques(pIPCUniqueDB, pool);
+        CTokenViewMemPool tokens(pTokenRegistry, pool);
+        if (!AreIPCStandard(tx, state, view, uniques, tokens))
+            return false;
+
         // Check for non-standard pay-to-script-hash in inputs
         if (fRequireStandard && !AreInputsStandard(tx, view))
             return state.Invalid(false, REJECT_NONSTANDARD, "bad-txns-nonstandard-inputs");
@@ -1839,6 +1778,12 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry, setAncestors, validForFeeEstimation);
+        if (fAddressIndex) {
+            //Mempool transactions are only indexed in memory, ConnectBlock writes them to txdb
+            std::vector<CTxIndexEntity> vEntities;
+            GetMempoolTxIndexEntities(tx, view, vEntities);
+            pool.addTxIndex(hash, vEntities);
+        }
 
         // trim mempool and check if tx was trimmed
         if (!fOverrideMempoolLimit) {
@@ -1846,14 +1791,6 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             if (!pool.exists(hash))
                 return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
         }
-
-		//Now that the transaction has been added to the pool, the IPC related unique field needs to be added to the set
-		PushTxToIPCValuesToMap(tx, pIPCCheckMaps);
-		PushTxToTokenDataMap(tx,&tokenDataMap);
-		
-		if (fAddressIndex) {
-			AddTx2MapbyAddress(tx);
-		}
     }
 
 
@@ -1950,19 +1887,6 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
 
     return false;
 }
-std::vector<CTransactionRef> cachedChainTx;
-bool GetCachedChainTransaction(const uint256 &hash, CTransactionRef &tx)
-{
-	BOOST_FOREACH(const auto& ptx, cachedChainTx){
-		if (ptx->GetHash() == hash)
-		{
-			tx = ptx;
-			
-			return true;
-		}
-	}
-	return false;
-}
 
 //
 // CBlock and CBlockIndex
@@ -2534,12 +2458,19 @@ void static FlushBlockFile(bool fFinalize = false)
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CVoteCheck> votecheckqueue(16);
+static boost::mutex votecheckqueue_mutex;
 
 void ThreadScriptCheck() {
     RenameThread("ipchain-scriptch");
     scriptcheckqueue.Thread();
 }
 
+void ThreadVoteCheck() {
+    RenameThread("ipchain-votech");
+    votecheckqueue.Thread();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2796,10 +2727,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
 	}
 
-	//Before the transaction detection starts, the cache list needs to be cleared
-	cachedChainTx.clear();
-
 	std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+	CIPCUniqueViewCache uniques(pIPCUniqueDB);
+	CTokenViewCache tokens(pTokenRegistry);
+	std::vector<CIPCUniqueKey> vUniqueKeys;
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
 		const CTransaction &tx = *(block.vtx[i]);
@@ -2851,7 +2782,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 					if (fAddressIndex && addressType > 0) {
 
 						// remove address from unspent index
-						addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, utxotype, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+						std::string symbol = utxotype == 1 ? prevout.getTokenSymbol() : std::string();
+						int nPrevHeight = view.AccessCoins(input.prevout.hash)->nHeight;
+						addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, utxotype, symbol, nPrevHeight, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
 					}
 				}
 
@@ -2899,19 +2832,20 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 				{
 					utxotype = 2;
 				}
+				std::string symbol = utxotype == 1 ? out.getTokenSymbol() : std::string();
 				
 				if (out.scriptPubKey.IsPayToScriptHash()) {
 					std::vector<unsigned char> hashBytes(out.scriptPubKey.begin() + 2, out.scriptPubKey.begin() + 22);
 
 					// record unspent output
-					addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), utxotype, txhash, k), CAddressUnspentValue(pindex->nHeight, out)));
+					addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), utxotype, symbol, pindex->nHeight, txhash, k), CAddressUnspentValue(pindex->nHeight, out)));
 
 				}
 				else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
 					std::vector<unsigned char> hashBytes(out.scriptPubKey.begin() + 3, out.scriptPubKey.begin() + 23);
 
 					// record unspent output
-					addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), utxotype, txhash, k), CAddressUnspentValue(pindex->nHeight, out)));
+					addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), utxotype, symbol, pindex->nHeight, txhash, k), CAddressUnspentValue(pindex->nHeight, out)));
 
 				}
 				else {
@@ -2921,13 +2855,18 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 			}
 		}
 
-		// check IPC validations
-		if (!AreIPCStandard(tx, state))
+		// check IPC validations, against the unique values and tokens of the chain and of the earlier transactions of this block
+		if (!AreIPCStandard(tx, state, view, uniques, tokens))
 		{
 			std::cout << "ConnectBlock:  " << FormatStateMessage(state) << std::endl;
 			return error("ConnectBlock(): AreIPCStandard on %s failed with %s",
 				tx.GetHash().ToString(), FormatStateMessage(state));
 		}
+		vUniqueKeys.clear();
+		GetIPCUniqueKeys(tx, vUniqueKeys);
+		BOOST_FOREACH(const CIPCUniqueKey& key, vUniqueKeys)
+			uniques.Add(key, tx.GetHash());
+		ConnectTokenOutputs(tx, tokens);
 		
 
         CTxUndo undoDummy;
@@ -2936,15 +2875,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
 
-		//The tx will be checked into the temporary tx list, otherwise the transaction cannot be found
-	
-		cachedChainTx.push_back(block.vtx[i]);
-
         vPos.push_back(std::make_pair(tx.GetHash(), pos));
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
-	//All transactions are completed and the cache list needs to be cleared
-	cachedChainTx.clear();
 
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime3 - nTime2), 0.001 * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * 0.000001);
@@ -3010,17 +2943,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime6 - nTime5), nTimeCallbacks * 0.000001);
 
 	//Add tx in the block to the map list required by the browser interface to maintain a list of Unique constraint values
-	for (const auto& tx : block.vtx)
+	for (CIPCUniqueViewCache::KeyMap::const_iterator it = uniques.GetKeys().begin(); it != uniques.GetKeys().end(); ++it)
+		pIPCUniqueDB->Add(it->first, it->second);
+	pTokenRegistry->Connect(tokens);
+	if (fAddressIndex)
 	{
-		if (fAddressIndex)
-		{
-			AddTx2MapbyAddress(*tx, pindex->nHeight);
-		}
-			
-		PushTxToIPCValuesToMap(*tx, pIPCCheckMaps);
-		PushTxToIPCValuesToMap(*tx,&newIPCCKMap); 
-		PushTxToTokenDataMap(*tx, &tokenDataMap);
-		PushTxToTokenDataMap(*tx, &newTokenDataMap);		
+		for (unsigned int i = 0; i < block.vtx.size(); i++)
+			AddTx2MapbyAddress(*block.vtx[i], i == 0 ? NULL : &blockundo.vtxundo[i - 1], pindex->nHeight);
 	}
 	
 	if (pindex->nTime() - pindex->pprev->nTime() >20) //The adjacent block is greater than 20 seconds log file to write the height of the current block
@@ -3075,6 +3004,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
     }
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR;
+    if (pTxDB)
+        cacheSize += pTxDB->DynamicMemoryUsage();
+    if (pIPCUniqueDB)
+        cacheSize += pIPCUniqueDB->DynamicMemoryUsage();
+    if (pTokenRegistry)
+        cacheSize += pTokenRegistry->DynamicMemoryUsage();
     int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
     // The cache is large and we're within 10% and 200 MiB or 50% and 50MiB of the limit, but we have time now (not in the middle of a block processing).
     bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::min(std::max(nTotalSpace / 2, nTotalSpace - MIN_BLOCK_COINSDB_USAGE * 1024 * 1024),
@@ -3144,6 +3079,14 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
         if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
+        // Flush the address index first: blocks it already contains are
+        // simply skipped if the chainstate write below does not make it.
+        if (pTxDB && !pTxDB->Flush())
+            return AbortNode(state, "Failed to write to address index database");
+        if (pIPCUniqueDB && !pIPCUniqueDB->Flush())
+            return AbortNode(state, "Failed to write to IPC unique index database");
+        if (pTokenRegistry && !pTokenRegistry->Flush())
+            return AbortNode(state, "Failed to write to token registry database");
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
         nLastFlush = nNow;
@@ -3258,6 +3201,21 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
         bool flushed = view.Flush();
         assert(flushed);
     }
+    if (fAddressIndex && pTxDB) {
+        for (int i = block.vtx.size() - 1; i >= 0; i--) {
+            pTxDB->DisconnectBalances(block.vtx[i]->GetHash());
+            pTxDB->RemoveTx(block.vtx[i]->GetHash());
+        }
+    }
+    // Unique values point at the transaction that registered them, so dropping
+    // the ones owned by this block restores the state before it
+    for (int i = block.vtx.size() - 1; i >= 0; i--) {
+        std::vector<CIPCUniqueKey> vUniqueKeys;
+        GetIPCUniqueKeys(*block.vtx[i], vUniqueKeys);
+        BOOST_FOREACH(const CIPCUniqueKey& key, vUniqueKeys)
+            pIPCUniqueDB->Remove(key, block.vtx[i]->GetHash());
+        DisconnectTokenOutputs(*block.vtx[i]);
+    }
     LogPrint("bench", "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
@@ -3353,9 +3311,6 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
-	//****************************************************************************
-	CVerifyDB().FlushICMToDisk();
-	//end***************************************************************************
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
     LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
     // Remove conflicting transactions from the mempool.;
@@ -4160,36 +4115,36 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAdd
     return true;
 }
 
-static volatile bool g_vote_wait_lock; 
+static const int64_t VOTE_WAIT_TIMEOUT = 13000;
 
 bool WaitingForVote (uint160 owner_hash, const CBlock& block)
 {
-	int p_counter = 13000;
-
-	g_vote_wait_lock = true;
-
-
-	while (g_vote_wait_lock && p_counter >0)
-	{
-		MilliSleep (500);
-		p_counter -= 500;
-	}
-
 	if (CMeetingItem::g_Account.size() == 1)
 	{
 		return true;
 	}
 
-	if (p_counter > 0)
+	const uint256 block_hash = block.GetHash();
+	boost::unique_lock<boost::mutex> lock(g_vote_mutex);
+
+	// ProcessVote notifies as soon as the commit quorum is reached, and the
+	// predicate also catches a quorum reached before we started waiting
+	bool ret = g_vote_quorum_cond.wait_for(lock, boost::chrono::milliseconds(VOTE_WAIT_TIMEOUT),
+		[&block_hash]{ return g_vote && g_vote->block_hash == block_hash && g_vote->nCommitQuorumTime != 0; });
+
+	if (ret)
 	{
-		std::cout << " WaitingForVote ok:" << p_counter << std::endl;
-		std::cout << "################################\n\n" << std::endl;
+		LogPrint("bench", "- WaitingForVote %s: commit quorum after %dms\n", block_hash.ToString(),
+			g_vote->nCommitQuorumTime - g_vote->nStartTime);
 		return true;
 	}
 	else
 	{
-		std::cout <<  " WaitingForVote no:" << p_counter << std::endl;
-		std::cout << "################################\n\n" << std::endl;
+		if (g_vote && g_vote->block_hash == block_hash)
+		{
+			RecordVoteRound (*g_vote);
+		}
+		LogPrint("bench", "- WaitingForVote %s: no commit quorum after %dms\n", block_hash.ToString(), VOTE_WAIT_TIMEOUT);
 		return false;
 	}
 }
@@ -4253,11 +4208,9 @@ static void ProposerToVote (uint160 owner_hash, const CBlock& block)
 
 	AddVoteSign (p_vote);
 
-	g_vote.reset(new VoteData());
-	g_vote->owner_hash = owner_hash;
-	g_vote->block_hash = block.GetHash();
-	g_vote->vote1s.clear();
-	g_vote->vote2s.clear();
+	boost::lock_guard<boost::mutex> lock{g_vote_mutex};
+
+	ResetVoteRound (owner_hash, block.GetHash());
 
 	g_connman->ForEachNode
 	(
@@ -4270,15 +4223,52 @@ static void ProposerToVote (uint160 owner_hash, const CBlock& block)
 }
 
 
-static void PutBlockToVote (const CBlock& block)
+//Proposals we relayed lately, kept to answer the transaction requests of peers rebuilding them
+static CCriticalSection cs_recentProposals;
+static std::deque<std::shared_ptr<const CBlock> > vRecentProposals;
+static const unsigned int MAX_RECENT_PROPOSALS = 8;
+
+std::shared_ptr<const CBlock> GetRecentProposal (const uint256& hash)
 {
+	LOCK(cs_recentProposals);
+	for (const std::shared_ptr<const CBlock>& pblock : vRecentProposals)
+	{
+		if (pblock->GetHash() == hash)
+		{
+			return pblock;
+		}
+	}
+	return nullptr;
+}
+
+static void PutBlockToVote (const std::shared_ptr<const CBlock>& pblock)
+{
+	if (!GetRecentProposal (pblock->GetHash()))
+	{
+		LOCK(cs_recentProposals);
+		vRecentProposals.push_back (pblock);
+		if (vRecentProposals.size() > MAX_RECENT_PROPOSALS)
+		{
+			vRecentProposals.pop_front ();
+		}
+	}
+
 	const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+	//Peers rebuild the proposal from their mempool and only fetch the transactions they miss
+	const CBlockHeaderAndShortTxIDs cmpctblock(*pblock, true);
 
 	g_connman->ForEachNode
 	(
-		[&block, &msgMaker, &g_connman](CNode* pnode)
+		[&pblock, &cmpctblock, &msgMaker](CNode* pnode)
 		{
-			g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::PUT_BLOCK, block));
+			if (pnode->nVersion >= PUT_CMPCTBLOCK_VERSION)
+			{
+				g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::PUT_CMPCTBLOCK, cmpctblock));
+			}
+			else
+			{
+				g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::PUT_BLOCK, *pblock));
+			}
 		}
 	);
 
@@ -4383,7 +4373,6 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-multiple", false, "more than one coinbase");
 
     // Check transactions
-	tmpIPCUniqueCheckMap.clear();
     for (const auto& tx : block.vtx)
 	if (!CheckTransaction(*tx, state, false))
 	{
@@ -4391,8 +4380,6 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 		return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
 			strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
 	}
- 	else
- 		PushTxToIPCValuesToMap(*tx, &tmpIPCUniqueCheckMap);
 
     unsigned int nSigOps = 0;
     for (const auto& tx : block.vtx)
@@ -4439,8 +4426,6 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 		}
 		}*/
 	}
-	//When a block is completed, the IPC Unique value saved in the inspection process should be placed in the maintenance pool
-	UpdateIPCUniqueMap();
 	
 	
 		
@@ -4803,7 +4788,171 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
     return true;
 }
 
-static void SaveVotesToDB ()
+//Key hashes of the consensus list of block, in list order
+static bool GetConsensusMembers (const CBlock& block, std::vector<uint160>& vMembers)
+{
+	std::set<uint16_t> setAccounts;
+	std::list<std::shared_ptr<CConsensusAccount>> conList;
+
+	if (!CConsensusAccountPool::Instance().getConsensusListByBlock (block, setAccounts, conList))
+	{
+		return false;
+	}
+
+	vMembers.clear ();
+	for (auto it : conList)
+	{
+		vMembers.push_back (it->getPubicKey160hash ());
+	}
+	return true;
+}
+
+//Compact the commit votes of block; votes of other blocks, rounds or non-members are left out
+static bool MakeCommitCertificate (const CBlock& block, const CVoteSet& votes, CCommitCertificate& cert)
+{
+	std::vector<uint160> vMembers;
+
+	if (!GetConsensusMembers (block, vMembers))
+	{
+		return false;
+	}
+
+	cert = CCommitCertificate ();
+	cert.block_hash = block.GetHash ();
+	cert.nPeriodStartTime = block.nPeriodStartTime;
+	cert.nTimePeriod = block.nTimePeriod;
+
+	std::map<uint160, const CVote*> mapVotes;
+	for (const CVote& vote : votes)
+	{
+		mapVotes[vote.owner_hash] = &vote;
+	}
+	for (size_t i = 0; i < vMembers.size(); i++)
+	{
+		auto it = mapVotes.find (vMembers[i]);
+		if (it != mapVotes.end())
+		{
+			cert.AddVote (i, *it->second);
+		}
+	}
+	return true;
+}
+
+//Store the commit votes of a block we voted on; as they are if the consensus list is not known
+static bool WriteCommitCertificate (const CBlock& block, const CVoteSet& votes)
+{
+	CCommitCertificate cert;
+
+	if (!MakeCommitCertificate (block, votes, cert))
+	{
+		LogPrintf("[WriteCommitCertificate] no consensus list for block %s, storing its votes\n", block.GetHash().ToString());
+		return g_pDBVote->WriteLegacyVotes (block.GetHash(), votes);
+	}
+	return g_pDBVote->WriteCertificate (cert);
+}
+
+//Certificates received from peers for blocks not known yet, one per block and peer,
+//kept until CheckBlockVote2 accepts one for its block
+static CCriticalSection cs_unverifiedCertificates;
+static std::map<std::pair<uint256, NodeId>, CCommitCertificate> mapUnverifiedCertificates;
+static std::map<NodeId, std::deque<uint256> > mapUnverifiedCertificateOrder;
+static const unsigned int MAX_UNVERIFIED_CERTIFICATES_PER_PEER = 8;
+
+static void StoreUnverifiedCertificate (const CCommitCertificate& cert, NodeId nodeid)
+{
+	LOCK(cs_unverifiedCertificates);
+
+	//A peer only ever replaces its own certificates
+	const std::pair<uint256, NodeId> key (cert.block_hash, nodeid);
+	std::deque<uint256>& vOrder = mapUnverifiedCertificateOrder[nodeid];
+	if (mapUnverifiedCertificates.count (key) == 0)
+	{
+		if (vOrder.size() >= MAX_UNVERIFIED_CERTIFICATES_PER_PEER)
+		{
+			mapUnverifiedCertificates.erase (std::make_pair(vOrder.front(), nodeid));
+			vOrder.pop_front ();
+		}
+		vOrder.push_back (cert.block_hash);
+	}
+	mapUnverifiedCertificates[key] = cert;
+}
+
+std::vector<std::pair<NodeId, CCommitCertificate> > GetUnverifiedCertificates (const uint256& hash)
+{
+	LOCK(cs_unverifiedCertificates);
+
+	std::vector<std::pair<NodeId, CCommitCertificate> > vCertificates;
+	for (auto it = mapUnverifiedCertificates.lower_bound (std::make_pair(hash, std::numeric_limits<NodeId>::min()));
+		it != mapUnverifiedCertificates.end() && it->first.first == hash; ++it)
+	{
+		vCertificates.push_back (std::make_pair(it->first.second, it->second));
+	}
+	return vCertificates;
+}
+
+static void EraseUnverifiedCertificate (const uint256& hash, NodeId nodeid)
+{
+	LOCK(cs_unverifiedCertificates);
+
+	if (mapUnverifiedCertificates.erase (std::make_pair(hash, nodeid)))
+	{
+		std::deque<uint256>& vOrder = mapUnverifiedCertificateOrder[nodeid];
+		vOrder.erase (std::find (vOrder.begin(), vOrder.end(), hash));
+		if (vOrder.empty())
+		{
+			mapUnverifiedCertificateOrder.erase (nodeid);
+		}
+	}
+}
+
+static void EraseUnverifiedCertificates (const uint256& hash)
+{
+	for (const std::pair<NodeId, CCommitCertificate>& entry : GetUnverifiedCertificates (hash))
+	{
+		EraseUnverifiedCertificate (hash, entry.first);
+	}
+}
+
+void EraseUnverifiedCertificates (NodeId nodeid)
+{
+	LOCK(cs_unverifiedCertificates);
+
+	auto itOrder = mapUnverifiedCertificateOrder.find (nodeid);
+	if (itOrder == mapUnverifiedCertificateOrder.end())
+	{
+		return;
+	}
+	for (const uint256& hash : itOrder->second)
+	{
+		mapUnverifiedCertificates.erase (std::make_pair(hash, nodeid));
+	}
+	mapUnverifiedCertificateOrder.erase (itOrder);
+}
+
+bool GetCommitCertificate (const CBlock& block, CCommitCertificate& cert)
+{
+	const uint256 hash = block.GetHash ();
+
+	if (g_pDBVote->ReadCertificate (hash, cert))
+	{
+		return true;
+	}
+
+	//Votes stored before certificates are converted here, and replaced once CheckBlockVote2 accepts them
+	CVoteSet votes;
+	return g_pDBVote->ReadLegacyVotes (hash, votes) && MakeCommitCertificate (block, votes, cert);
+}
+
+bool GetCommitVotes (const CBlock& block, CVoteSet& votes)
+{
+	CCommitCertificate cert;
+	std::vector<uint160> vMembers;
+
+	votes.clear ();
+	return GetCommitCertificate (block, cert) && GetConsensusMembers (block, vMembers) && cert.GetVotes (vMembers, votes);
+}
+
+static void SaveVotesToDB (const CBlock& block)
 {
 	const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
 
@@ -4826,7 +4975,11 @@ static void SaveVotesToDB ()
 	{
 		std::cout << "SaveVotesToDB:" << g_vote->block_hash.GetHex() << "   :  " << g_vote->vote2s.size() << std::endl;
 		bool ret_val;
-		ret_val = g_pDBVote->Write (g_vote->block_hash, g_vote->vote2s);
+		ret_val = WriteCommitCertificate (block, g_vote->vote2s);
+		if (!ret_val)
+		{
+			LogPrintf("[SaveVotesToDB] failed to store the commit votes of block %s\n", block.GetHash().ToString());
+		}
 		std::cout << ret_val;
 		g_vote->owner_hash.SetNull();
 		//g_vote->block_hash.SetNull();
@@ -4872,7 +5025,7 @@ bool TendermintProcessNewBlock(uint160 &owner_hash, const CChainParams& chainpar
 			std::cout << "################################" << std::endl;
 			std::cout << "proposer to vote !" << std::endl;
 
-			PutBlockToVote (*pblock);
+			PutBlockToVote (pblock);
 			std::cout << "broadcast a block !" << std::endl;
 
 
@@ -4883,7 +5036,7 @@ bool TendermintProcessNewBlock(uint160 &owner_hash, const CChainParams& chainpar
 				return false;
 			}
 
-			SaveVotesToDB ();
+			SaveVotesToDB (*pblock);
 		}
 
 		CValidationState state;
@@ -4916,55 +5069,126 @@ bool TendermintProcessNewBlock(uint160 &owner_hash, const CChainParams& chainpar
 	return true;
 }
 
-bool CheckBlockVote2 (const std::shared_ptr<const CBlock> pblock)
+namespace {
+
+class VoteCacheHasher
 {
-	std::list<std::shared_ptr<CConsensusAccount>> conList;
-	CDpocMining &p_mining = CDpocMining::Instance ();
-	std::set<CVote> vote2s;
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select <8, "VoteCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin()+4*hash_select, 4);
+        return u;
+    }
+};
 
-	bool ret_val;
+/**
+ * Votes whose signature has been verified, so that a vote seen on the network
+ * is not verified again when the block it commits to is checked. Also holds
+ * the commit certificates that passed CheckBlockVote2.
+ * Entries are SHA256(nonce || vote or certificate hash).
+ */
+class CVoteSignatureCache
+{
+private:
+    static const size_t MAX_CACHE_BYTES = 1 << 20;
 
-	boost::lock_guard<boost::mutex> lock{g_vote_mutex};
+    uint256 nonce;
+    CuckooCache::cache<uint256, VoteCacheHasher> setValid;
+    boost::shared_mutex cs_votecache;
 
-	if (false == IsTendermintConsensusWork ())
-	{
-		std::cout <<"small than: " << g_ConsensusSwitchingHeight << std::endl;
-		return true;
-	}
+public:
+    //! Called from InitVoteSignatureCache, once the random number generator is ready
+    void Setup()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(MAX_CACHE_BYTES);
+    }
 
-	if (g_vote && pblock->GetHash() == g_vote->block_hash)
-	{
-		vote2s = g_vote->vote2s;
-	}
-	else
-	{
-		ret_val = g_pDBVote->Read (pblock->GetHash(), vote2s);
-		if (ret_val == false)
-		{
-			std::cout << "[CheckBlockVote2] db read =  false" << std::endl;
-			//return false;
-		}
+    void ComputeEntry(uint256& entry, const CVote& vote)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(vote.GetHash().begin(), 32).Finalize(entry.begin());
+    }
+
+    void ComputeEntry(uint256& entry, const CCommitCertificate& cert)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(cert.GetHash().begin(), 32).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_votecache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_votecache);
+        setValid.insert(entry);
+    }
+};
+
+static CVoteSignatureCache voteSignatureCache;
+static CVoteSignatureCache certificateCache;
+}
 
+void InitVoteSignatureCache()
+{
+    voteSignatureCache.Setup();
+    certificateCache.Setup();
+}
+
+bool CVoteCheck::operator()() {
+    if (!pvote->SignVerify())
+        return false;
+    if (cacheStore) {
+        uint256 entry;
+        voteSignatureCache.ComputeEntry(entry, *pvote);
+        voteSignatureCache.Set(entry);
+    }
+    return true;
+}
+
+static bool IsVoteSignatureCached (const CVote& vote)
+{
+	uint256 entry;
+	voteSignatureCache.ComputeEntry(entry, vote);
+	return voteSignatureCache.Get(entry);
+}
+
+bool CheckVoteSignatures (const CVoteSet& votes, bool cacheStore)
+{
+	// The hashes are computed here, before the checks are handed to other threads
+	std::vector<CVoteCheck> vChecks;
+	for (const CVote& vote : votes)
+	{
+		if (!IsVoteSignatureCached (vote))
+			vChecks.push_back (CVoteCheck (vote, cacheStore));
 	}
 
-	for (auto it: vote2s)
+	if (!nScriptCheckThreads || vChecks.size() <= 1)
 	{
-		if (it.SignVerify() == false)
+		for (CVoteCheck& check : vChecks)
 		{
-			std::cout << "it.SignVerify()" << std::endl;
-			return false;
+			if (!check())
+				return false;
 		}
+		return true;
 	}
 
-	std::set<uint16_t> setAccounts;
-
-	ret_val = CConsensusAccountPool::Instance().getConsensusListByBlock (*pblock, setAccounts, conList);
+	boost::lock_guard<boost::mutex> lock{votecheckqueue_mutex};
+	CCheckQueueControl<CVoteCheck> control(&votecheckqueue);
+	control.Add(vChecks);
+	return control.Wait();
+}
 
-	//ret_val = p_mining.GetMeetingList(pblock->nPeriodStartTime, conList);
-	if (ret_val == false)
+static bool CheckCommitVotes (const CVoteSet& vote2s, const std::list<std::shared_ptr<CConsensusAccount>>& conList)
+{
+	if (CheckVoteSignatures (vote2s, true) == false)
 	{
-		std::cout << "meeting list" << std::endl;
-		return false;
+		return error("%s: bad vote signature", __func__);
 	}
 
 	if (conList.size () == 1)
@@ -4997,11 +5221,174 @@ bool CheckBlockVote2 (const std::shared_ptr<const CBlock> pblock)
 		std::cout << " small 2/3" << std::endl;
 		return false;
 	}
+	return true;
+}
 
-	std::cout << "vote is ok!!" << std::endl;
+static bool CheckCommitCertificate (const CBlock& block, const CCommitCertificate& cert,
+	const std::list<std::shared_ptr<CConsensusAccount>>& conList)
+{
+	//A certificate is verified once, whatever the path the block comes by again
+	uint256 certEntry;
+	certificateCache.ComputeEntry (certEntry, cert);
+	if (certificateCache.Get (certEntry))
+	{
+		return true;
+	}
+
+	std::vector<uint160> vMembers;
+	for (auto it : conList)
+	{
+		vMembers.push_back (it->getPubicKey160hash ());
+	}
+
+	CVoteSet vote2s;
+	if (cert.block_hash != block.GetHash() || cert.nPeriodStartTime != block.nPeriodStartTime ||
+		cert.nTimePeriod != block.nTimePeriod || !cert.GetVotes (vMembers, vote2s))
+	{
+		LogPrintf("[CheckCommitCertificate] bad commit certificate for block %s\n", block.GetHash().ToString());
+		return false;
+	}
+	if (!CheckCommitVotes (vote2s, conList))
+	{
+		return false;
+	}
+
+	certificateCache.Set (certEntry);
 	return true;
 }
 
+//The block a certificate commits to, if it is a recent proposal or is stored
+static std::shared_ptr<const CBlock> GetCertificateBlock (const uint256& hash)
+{
+	std::shared_ptr<const CBlock> pblock = GetRecentProposal (hash);
+	if (pblock)
+	{
+		return pblock;
+	}
+
+	LOCK(cs_main);
+	BlockMap::iterator mi = mapBlockIndex.find (hash);
+	if (mi == mapBlockIndex.end() || !(mi->second->nStatus() & BLOCK_HAVE_DATA))
+	{
+		return nullptr;
+	}
+	std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+	if (!ReadBlockFromDisk (*pblockRead, mi->second, Params().GetConsensus()))
+	{
+		return nullptr;
+	}
+	return pblockRead;
+}
+
+bool AddUnverifiedCertificate (const CCommitCertificate& cert, NodeId nodeid)
+{
+	CCommitCertificate stored;
+	if (g_pDBVote->ReadCertificate (cert.block_hash, stored))
+	{
+		return true;
+	}
+
+	std::shared_ptr<const CBlock> pblock = GetCertificateBlock (cert.block_hash);
+	std::set<uint16_t> setAccounts;
+	std::list<std::shared_ptr<CConsensusAccount>> conList;
+	if (!pblock || !IsTendermintConsensusWork () ||
+		!CConsensusAccountPool::Instance().getConsensusListByBlock (*pblock, setAccounts, conList))
+	{
+		StoreUnverifiedCertificate (cert, nodeid);
+		return true;
+	}
+
+	//The block is known, the certificate is checked now
+	if (!CheckCommitCertificate (*pblock, cert, conList))
+	{
+		return false;
+	}
+	if (!g_pDBVote->WriteCertificate (cert))
+	{
+		LogPrintf("[AddUnverifiedCertificate] failed to store the commit certificate of block %s\n", cert.block_hash.ToString());
+	}
+	EraseUnverifiedCertificates (cert.block_hash);
+	return true;
+}
+
+bool CheckBlockVote2 (const std::shared_ptr<const CBlock> pblock)
+{
+	std::list<std::shared_ptr<CConsensusAccount>> conList;
+	CDpocMining &p_mining = CDpocMining::Instance ();
+	const uint256 hash = pblock->GetHash ();
+	CCommitCertificate cert;
+
+	bool ret_val;
+
+	boost::lock_guard<boost::mutex> lock{g_vote_mutex};
+
+	if (false == IsTendermintConsensusWork ())
+	{
+		std::cout <<"small than: " << g_ConsensusSwitchingHeight << std::endl;
+		return true;
+	}
+
+	std::set<uint16_t> setAccounts;
+
+	ret_val = CConsensusAccountPool::Instance().getConsensusListByBlock (*pblock, setAccounts, conList);
+
+	//ret_val = p_mining.GetMeetingList(pblock->nPeriodStartTime, conList);
+	if (ret_val == false)
+	{
+		std::cout << "meeting list" << std::endl;
+		return false;
+	}
+
+	if (g_vote && hash == g_vote->block_hash)
+	{
+		return CheckCommitVotes (g_vote->vote2s, conList);
+	}
+
+	//The stored certificate first, then the votes stored before certificates
+	if (g_pDBVote->ReadCertificate (hash, cert))
+	{
+		if (CheckCommitCertificate (*pblock, cert, conList))
+		{
+			EraseUnverifiedCertificates (hash);
+			return true;
+		}
+	}
+	else
+	{
+		CVoteSet votes;
+		if (g_pDBVote->ReadLegacyVotes (hash, votes) && MakeCommitCertificate (*pblock, votes, cert) &&
+			CheckCommitCertificate (*pblock, cert, conList))
+		{
+			//Only a certificate that passed replaces the legacy votes
+			if (!g_pDBVote->ReplaceLegacyVotes (cert))
+			{
+				LogPrintf("[CheckBlockVote2] failed to replace the legacy votes of block %s\n", hash.ToString());
+			}
+			return true;
+		}
+	}
+
+	//Certificates from peers are stored only once they pass, the others are dropped
+	for (const std::pair<NodeId, CCommitCertificate>& entry : GetUnverifiedCertificates (hash))
+	{
+		if (CheckCommitCertificate (*pblock, entry.second, conList))
+		{
+			if (!g_pDBVote->WriteCertificate (entry.second))
+			{
+				LogPrintf("[CheckBlockVote2] failed to store the commit certificate of block %s\n", hash.ToString());
+			}
+			EraseUnverifiedCertificates (hash);
+			std::cout << "vote is ok!!" << std::endl;
+			return true;
+		}
+		LogPrintf("[CheckBlockVote2] dropping the commit certificate of peer %d for block %s\n", entry.first, hash.ToString());
+		EraseUnverifiedCertificate (hash, entry.first);
+	}
+
+	std::cout << "[CheckBlockVote2] db read =  false" << std::endl;
+	return CheckCommitVotes (CVoteSet(), conList);
+}
+
 bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock> pblock, 
 							bool fForceProcessing, bool *fNewBlock)
 {
@@ -5764,7 +6151,7 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
 }
 
 
-static std::set<CVote>  g_uncertain_votes;
+static CVoteSet  g_uncertain_votes;
 
 void ProcessVote (CVote &vote, const CChainParams& chainparams)
 {
@@ -5801,7 +6188,7 @@ void ProcessVote (CVote &vote, const CChainParams& chainparams)
 
 	g_Reboot_Meeting_StartTime = vote.nPeriodStartTime;
 
-	if (vote.SignVerify () == false)
+	if (IsVoteSignatureCached (vote) == false && CVoteCheck (vote, true)() == false)
 	{
 		std::cout << "vote.SignVerify () ++++++++++++++++++!!!!!!!!!!!!!" << vote.type << std::endl;
 		return ;
@@ -5858,6 +6245,9 @@ void ProcessVote (CVote &vote, const CChainParams& chainparams)
 		g_vote->block_hash = vote.block_hash;
 		g_vote->vote1s.clear ();
 		g_vote->vote2s.clear ();
+		g_vote->nStartTime = GetTimeMillis();
+		g_vote->nPrecommitQuorumTime = 0;
+		g_vote->nCommitQuorumTime = 0;
 
 		for (auto p_it : g_uncertain_votes)
 		{
@@ -5896,6 +6286,11 @@ void ProcessVote (CVote &vote, const CChainParams& chainparams)
 		{
 			CVote vote2;
 
+			if (g_vote->nPrecommitQuorumTime == 0)
+			{
+				g_vote->nPrecommitQuorumTime = GetTimeMillis();
+			}
+
 			vote2.type = CVote::Commit;
 			vote2.block_hash =  g_vote->block_hash;
 			vote2.nTimePeriod =  vote.nTimePeriod;
@@ -5910,26 +6305,21 @@ void ProcessVote (CVote &vote, const CChainParams& chainparams)
 	}
 	else if (vote.type == CVote::Commit)
 	{
-		if (g_vote == nullptr || vote.block_hash != g_vote->block_hash )
-		{
-			return;
-		}
-
-		g_vote->vote2s.insert (vote);
-
-		if (g_vote->vote2s.size ()*3 >= CMeetingItem::g_Account.size()*2)
+		if (CountCommitVote (vote))
 		{
 			uint160  p_who;
 			p_mining.getAccount160Hash (p_who);
 
-			g_vote_wait_lock = false;
 			std::cout << "commit !!\n" << std::endl;
 
 			if (p_who != g_vote->owner_hash)
 			{
 				bool fNewBlock = true;
 
-				g_pDBVote->Write (g_vote->block_hash, g_vote->vote2s);
+				if (!WriteCommitCertificate (*g_vote->block, g_vote->vote2s))
+				{
+					LogPrintf("[ProcessVote] failed to store the commit votes of block %s\n", g_vote->block_hash.ToString());
+				}
 				ProcessNewBlock(chainparams, g_vote->block, true, &fNewBlock);
 				g_vote->owner_hash.SetNull();
 				g_vote->block_hash.SetNull();
@@ -5945,7 +6335,7 @@ void ProcessBlock (std::shared_ptr<CBlock> p_block, bool is_ok)
 
 	boost::lock_guard<boost::mutex> lock{g_vote_mutex};
 
-	PutBlockToVote (*p_block);	
+	PutBlockToVote (p_block);	
 
 	if (g_vote)
 	{
@@ -42,6 +42,7 @@ class CChainParams;
 class CInv;
 class CConnman;
 class CScriptCheck;
+class CVoteCheck;
 class CTxMemPool;
 class CValidationInterface;
 class CValidationState;
@@ -50,7 +51,10 @@ struct ChainTxData;
 struct PrecomputedTransactionData;
 struct LockPoints;
 
-class IPCCheckMaps;
+class CIPCUniqueDB;
+class CTokenRegistry;
+
+typedef int64_t NodeId;
 
 #define  PAYOFMINING 0.5 //IPC award, unit IPC
 #define  TXLABLE_MAX_LENGTH 0x0200
@@ -160,8 +164,10 @@ static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 static const int MAX_UNCONNECTING_HEADERS = 10;
 
 static const bool DEFAULT_PEERBLOOMFILTERS = true;
-extern std::map<std::string, TokenReg> tokenDataMap;	//Token map    key:symnbol   value:TokenRegLabel
-extern std::map<std::string, TokenReg> newTokenDataMap;
+/** Record of a token symbol created by the chain or by a mempool transaction */
+bool GetTokenRecord(const std::string& symbol, CTokenRecord& record);
+/** Accuracy of a token symbol, 0 if neither the chain nor the mempool created it */
+uint8_t GetTokenAccuracy(const std::string& symbol);
 bool getAddressBalanceByTxlevel(std::string& address, CAmount& balance, CAmount& received, CAmount& sended, uint64_t& txidnum);
 bool getTokenBalanceByAddress(std::string& address,std::string& tokensymbol,CAmount& balance, CAmount& received, CAmount& sended, uint64_t& txidnum);
 
@@ -292,6 +298,8 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the vote signature checking thread */
+void ThreadVoteCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -304,11 +312,6 @@ bool IsInitialBlockDownload();
 std::string GetWarnings(const std::string& strFor);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256 &hash, CTransactionRef &tx, const Consensus::Params& params, uint256 &hashBlock, bool fAllowSlow = false);
-/** Look for deals from the current temporary trading list
-A temporary trading list is a block of trading links
-Only the prevout information that needed to detect txin was sufficient to find the original transaction itself
-Thus, a list of transactions that have been detected is cached in the process as a basis for subsequent transactions */
-bool GetCachedChainTransaction(const uint256 &hash, CTransactionRef &tx);
 
 /** Find the best known block, and make it the tip of the block chain */
 bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock = std::shared_ptr<const CBlock>());
@@ -409,6 +412,12 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
 
+/** The unique IPC hashes and token symbols and hashes registered by the outputs of tx */
+void GetIPCUniqueKeys(const CTransaction& tx, std::vector<CIPCUniqueKey>& vKeys);
+
+/** Apply the token registrations and additional issuances of tx to tokens */
+void ConnectTokenOutputs(const CTransaction& tx, CTokenViewCache& tokens);
+
 /** Transaction validation functions */
 
 /** Context-independent validity checks */
@@ -507,6 +516,28 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing one vote signature verification
+ * Note that this stores a reference to the vote
+ */
+class CVoteCheck
+{
+private:
+    const CVote *pvote;
+    bool cacheStore;
+
+public:
+    CVoteCheck(): pvote(NULL), cacheStore(false) {}
+    CVoteCheck(const CVote& voteIn, bool cacheIn) : pvote(&voteIn), cacheStore(cacheIn) {}
+
+    bool operator()();
+
+    void swap(CVoteCheck &check) {
+        std::swap(pvote, check.pvote);
+        std::swap(cacheStore, check.cacheStore);
+    }
+};
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -558,7 +589,6 @@ public:
     CVerifyDB();
     ~CVerifyDB();
 	bool VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
-	bool FlushICMToDisk();
 	bool LoadICMFromDisk();
 };
 
@@ -583,8 +613,11 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
-/** Global variable that points to the IPC unique symbols*/
-extern IPCCheckMaps* pIPCCheckMaps;
+/** Global variable that points to the owners of the unique IPC and token values */
+extern CIPCUniqueDB* pIPCUniqueDB;
+
+/** Global variable that points to the token symbols and issuances of the active chain */
+extern CTokenRegistry* pTokenRegistry;
 
 
 extern TxDBProcess* pTxDB;
@@ -628,8 +661,62 @@ void ProcessVote (CVote &vote, const CChainParams& chainparams);
 
 void ProcessBlock (std::shared_ptr<CBlock> p_block, bool ifok);
 
+/** Find a proposal relayed lately, to send its transactions to a peer rebuilding it */
+std::shared_ptr<const CBlock> GetRecentProposal (const uint256& hash);
+
 bool CheckBlockVote2 (const std::shared_ptr<const CBlock> pblock);
 
+/**
+ * Handle a certificate received from a peer. If its block is known it is
+ * checked and stored now, and false is returned when it does not pass.
+ * Otherwise it is kept, one per block and peer, until CheckBlockVote2
+ * accepts one for its block.
+ */
+bool AddUnverifiedCertificate (const CCommitCertificate& cert, NodeId nodeid);
+
+/** Certificates kept for block, with the peers that sent them */
+std::vector<std::pair<NodeId, CCommitCertificate> > GetUnverifiedCertificates (const uint256& hash);
+
+/** Drop the certificates kept for a disconnected peer */
+void EraseUnverifiedCertificates (NodeId nodeid);
+
+/** Commit certificate of block, converting the votes stored for it before certificates if needed */
+bool GetCommitCertificate (const CBlock& block, CCommitCertificate& cert);
+
+/** Commit votes of block rebuilt from its certificate, for peers that predate certificates */
+bool GetCommitVotes (const CBlock& block, CVoteSet& votes);
+
+/**
+ * Verify the signatures of a set of votes. Votes whose signature was already
+ * verified are skipped, the others are checked on the vote check threads.
+ * If cacheStore is set, verified votes are remembered for later calls.
+ */
+bool CheckVoteSignatures (const CVoteSet& votes, bool cacheStore);
+
+/** Set up the caches of verified votes and commit certificates, after ECC_Start */
+void InitVoteSignatureCache();
+
 bool IsTendermintConsensusWork (void);
 
+/** Timing of a Tendermint vote round, measured from the proposal */
+struct CVoteRoundStats
+{
+	uint256       block_hash;
+	int64_t       nPrecommitQuorumMillis = -1;   // -1 if the quorum was not reached
+	int64_t       nCommitQuorumMillis = -1;
+	unsigned int  nCommits = 0;
+};
+
+/** Get the timing of the last vote round this node took part in */
+bool GetLastVoteRoundStats (CVoteRoundStats& stats);
+
+/** Start a vote round on the proposal of owner_hash, as the proposer does before WaitingForVote */
+void StartVoteRound (const uint160& owner_hash, const uint256& block_hash);
+
+/** Count a commit vote of the current round without the checks of ProcessVote, true once the round has its commit quorum */
+bool AddCommitVote (const CVote& vote);
+
+/** Wait until the round on block has its commit quorum, false after a timeout */
+bool WaitingForVote (uint160 owner_hash, const CBlock& block);
+
 #endif // BITCOIN_VALIDATION_H
@@ -714,10 +714,11 @@ UniValue unionsendtokenmany(const JSONRPCRequest& request)
     string tokensymbol = request.params[1].get_str();
     //LogPrintf("tokensymbol:%s\n",tokensymbol);
     std::cout<<"tokensymbol:"<<tokensymbol<<std::endl;
-    if (tokenDataMap.count(tokensymbol) == 0)
+    CTokenRecord tokenRecord;
+    if (!GetTokenRecord(tokensymbol, tokenRecord))
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Error: Can't found 'tokensymbol' of the Token");
 
-    int tokenaccuracy = tokenDataMap[tokensymbol].getAccuracy();
+    int tokenaccuracy = tokenRecord.getAccuracy();
     //LogPrintf("  tokenaccuracy:%d\n",tokenaccuracy);
     std::cout<<"  tokenaccuracy:"<<tokenaccuracy<<std::endl;
     if(tokenaccuracy<0||tokenaccuracy>10)
@@ -904,10 +905,11 @@ UniValue unionverifytokenvout(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid ipc address");
 
     string tokensymbol = request.params[1].get_str();
-    if (tokenDataMap.count(tokensymbol) == 0)
+    CTokenRecord tokenRecord;
+    if (!GetTokenRecord(tokensymbol, tokenRecord))
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Error: Can't found 'tokensymbol' of the Token");
 
-    int tokenaccuracy = tokenDataMap[tokensymbol].getAccuracy();
+    int tokenaccuracy = tokenRecord.getAccuracy();
     if(tokenaccuracy<0||tokenaccuracy>10)
     {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Error: Can't found 'tokenaccuracy' of the Token");
@@ -2216,7 +2218,7 @@ UniValue isdepositabled(const JSONRPCRequest& request)
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string(fTxIndex ? "No such mempool or blockchain transaction"
 		: "No such mempool transaction. Use -txindex to enable blockchain transaction queries") +
 		". Use gettransaction for wallet transactions.");
-	if (tx->vout[Index].txType != TXOUT_CAMPAIGN || tx->vout[Index].devoteLabel.ExtendType != TYPE_CONSENSUS_REGISTER) 
+	if (tx->vout[Index].txType != TXOUT_CAMPAIGN || tx->vout[Index].GetDevoteLabel().ExtendType != TYPE_CONSENSUS_REGISTER) 
 		throw  JSONRPCError(RPC_INVALID_PARAMETER, "This is not a deposit");
 	bool isAbled = CConsensusAccountPool::Instance().IsAviableUTXO(tx->GetHash());
 	UniValue results(UniValue::VARR);
@@ -2493,13 +2495,19 @@ UniValue getaddtokenreginfobysymbol(const JSONRPCRequest& request)
 		);
 	std::string tokensymbol = request.params[0].get_str();
 	UniValue resultarr(UniValue::VARR);
-	if (!tokenDataMap.count(tokensymbol))
+	CTokenRecord record;
+	if (!GetTokenRecord(tokensymbol, record))
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this tokensymbol has no TokenReg");
-	const TokenReg& tokenreg = tokenDataMap[tokensymbol];
-	if (tokenreg.m_tokentype != TXOUT_ADDTOKEN)
+	if (record.nType != TXOUT_ADDTOKEN)
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "this tokensymbol type is not addtokenreg");
-	
-	BOOST_FOREACH(const AddTokenReg& addtokenreg, tokenreg.m_addTokenLabel){
+
+	//Only the issuances already in the chain are listed
+	std::vector<AddTokenReg> vIssues;
+	{
+		LOCK(cs_main);
+		pTokenRegistry->GetIssues(tokensymbol, vIssues);
+	}
+	BOOST_FOREACH(const AddTokenReg& addtokenreg, vIssues){
 		UniValue result(UniValue::VOBJ);
 		AddTokenLabel m_addTokenLabel;
 		result.push_back(Pair("tokenSymbol", addtokenreg.m_addTokenLabel.getTokenSymbol()));
@@ -2714,7 +2722,7 @@ UniValue ipctokensendtoaddress(const JSONRPCRequest& request)
 	if (!address.IsValid())
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Ipchain address");
 
-	int nacc = (int)tokenDataMap[tokensymbol].getAccuracy();
+	int nacc = (int)GetTokenAccuracy(tokensymbol);
 	int64_t TokenValue = TCoinsFromValue(request.params[2], nacc);
 	if (TokenValue <= 0)
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Tokentransaction value");
@@ -2762,7 +2770,7 @@ UniValue ipctokensendtoaddressforcross(const JSONRPCRequest& request)
 	if (!address.IsValid())
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Ipchain address");
 
-	int nacc = (int)tokenDataMap[tokensymbol].getAccuracy();
+	int nacc = (int)GetTokenAccuracy(tokensymbol);
 	int64_t TokenValue = TCoinsFromValue(request.params[2], nacc);
 	if (TokenValue <= 0)
 		throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Tokentransaction value");
@@ -3469,10 +3477,11 @@ UniValue sendtokenmany(const JSONRPCRequest& request)
 
 	string strAccount = AccountFromValue(request.params[0]);
 	string tokensymbol = request.params[1].get_str();
-	if (tokenDataMap.count(tokensymbol) == 0)
+	CTokenRecord tokenRecord;
+	if (!GetTokenRecord(tokensymbol, tokenRecord))
 		throw JSONRPCError(RPC_INVALID_PARAMETER, "Error: Can't found 'accuracy' of the Token");
 
-	int tokenaccuracy = tokenDataMap[tokensymbol].getAccuracy();
+	int tokenaccuracy = tokenRecord.getAccuracy();
 	//std::cout << "tokenaccuracy =  " << tokenaccuracy  << std::endl;
 	UniValue sendTo = request.params[2].get_obj();
 	
@@ -3831,7 +3840,7 @@ UniValue getuniontokenbalance(const JSONRPCRequest& request)
     }
     uint64_t balance = 0;
     pwalletMain->GetSymbolbalance(tokensymbol,balance,strAddress);
-	return ValueFromTCoinsN(balance, (int)tokenDataMap[tokensymbol].getAccuracy());
+	return ValueFromTCoinsN(balance, (int)GetTokenAccuracy(tokensymbol));
 }
 UniValue getunioncoins(const JSONRPCRequest& request)
 {
@@ -6680,7 +6689,7 @@ UniValue listtokencoins(const JSONRPCRequest& request)
 		throw JSONRPCError(RPC_DATABASE_ERROR, string("Can't find the balance of the tokensymbol!"));
 	UniValue results(UniValue::VOBJ);
 	results.push_back(Pair("Tokensymbol", tokensymbol));
-	results.push_back(Pair("balance", ValueFromTCoinsN(balance, (int)tokenDataMap[tokensymbol].getAccuracy())));
+	results.push_back(Pair("balance", ValueFromTCoinsN(balance, (int)GetTokenAccuracy(tokensymbol))));
 
 	return results;
 }
@@ -6707,7 +6716,7 @@ UniValue gettokenbalance(const JSONRPCRequest& request)
 	if (!getbalanceYet)
 		throw JSONRPCError(RPC_DATABASE_ERROR, string("Can't find the balance of the tokensymbol!"));
 
-	return ValueFromTCoinsN(balance, (int)tokenDataMap[tokensymbol].getAccuracy());
+	return ValueFromTCoinsN(balance, (int)GetTokenAccuracy(tokensymbol));
 }
 
 UniValue listunspenttoken(const JSONRPCRequest& request)
@@ -9,6 +9,8 @@
 #include <utility>
 #include <vector>
 
+#include "chainparams.h"
+#include "random.h"
 #include "rpc/server.h"
 #include "test/test_bitcoin.h"
 #include "validation.h"
@@ -500,4 +502,291 @@ BOOST_FIXTURE_TEST_CASE(importwallet_rescan, TestChain100Setup)
     ::pwalletMain = pwalletMainBackup;
 }
 
+// Unspent outputs of the wallet found the way AvailableCoins did before the
+// output indexes: every output of every transaction in mapWallet, with its depth
+static std::map<COutPoint, int> ScanAvailableOutputs(const CWallet& wallet, bool fOnlyConfirmed)
+{
+    std::map<COutPoint, int> mapOutputs;
+    for (const auto& entry : wallet.mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        if (fOnlyConfirmed && !wtx.IsTrusted())
+            continue;
+        if (wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0)
+            continue;
+        int nDepth = wtx.GetDepthInMainChain();
+        if (nDepth < 0 || (nDepth == 0 && !wtx.InMempool()))
+            continue;
+        if (nDepth == 0 && fOnlyConfirmed && (wtx.mapValue.count("replaces_txid") || wtx.mapValue.count("replaced_by_txid")))
+            continue;
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+            if (!wallet.IsSpent(entry.first, i) && wallet.IsMine(wtx.tx->vout[i]) != ISMINE_NO && !wallet.IsLockedCoin(entry.first, i))
+                mapOutputs[COutPoint(entry.first, i)] = nDepth;
+        }
+    }
+    return mapOutputs;
+}
+
+static std::set<COutPoint> GetOutPoints(const std::vector<COutput>& vCoins)
+{
+    std::set<COutPoint> setOutPoints;
+    for (const COutput& out : vCoins)
+        setOutPoints.insert(COutPoint(out.tx->GetHash(), out.i));
+    BOOST_CHECK_EQUAL(setOutPoints.size(), vCoins.size());
+    return setOutPoints;
+}
+
+static const CTxOut& GetWalletOutput(const CWallet& wallet, const COutPoint& outpoint)
+{
+    return wallet.mapWallet.at(outpoint.hash).tx->vout[outpoint.n];
+}
+
+static void CheckAvailableCoins(CWallet& wallet)
+{
+    BOOST_CHECK(wallet.CheckOutputIndexes());
+
+    for (bool fOnlyConfirmed : {true, false}) {
+        std::set<COutPoint> setExpected;
+        for (const auto& entry : ScanAvailableOutputs(wallet, fOnlyConfirmed)) {
+            if (GetWalletOutput(wallet, entry.first).nValue > 0)
+                setExpected.insert(entry.first);
+        }
+        std::vector<COutput> vCoins;
+        wallet.AvailableCoins(vCoins, fOnlyConfirmed);
+        BOOST_CHECK(GetOutPoints(vCoins) == setExpected);
+    }
+
+    std::set<COutPoint> setExpected;
+    CAmount nBalance = 0;
+    for (const auto& entry : ScanAvailableOutputs(wallet, true)) {
+        const CTxOut& txout = GetWalletOutput(wallet, entry.first);
+        if (entry.second < nTxConfirmTarget)
+            continue;
+        if (txout.txType == TXOUT_NORMAL && txout.nValue > 0)
+            setExpected.insert(entry.first);
+        nBalance += wallet.GetCredit(txout, ISMINE_SPENDABLE);
+    }
+    std::vector<COutput> vCoins;
+    wallet.AvailableNormalCoins(vCoins);
+    BOOST_CHECK(GetOutPoints(vCoins) == setExpected);
+
+    // A wallet without a file fails every write, AddToWallet then returns
+    // before SyncTransaction breaks the credit caches of the spent transactions
+    wallet.MarkDirty();
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), nBalance);
+}
+
+static CMutableTransaction MakeSpend(const std::vector<COutPoint>& vPrevOuts, const std::vector<CTxOut>& vOutputs)
+{
+    CMutableTransaction tx;
+    for (const COutPoint& prevout : vPrevOuts)
+        tx.vin.push_back(CTxIn(prevout));
+    tx.vout = vOutputs;
+    return tx;
+}
+
+// Active chain of block index entries without block data, the fixture
+// frees them in UnloadBlockIndex
+static void BuildIndexChain(int nHeight)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexPrev = NULL;
+    for (int i = 0; i <= nHeight; i++) {
+        CBlockIndex* pindex = new CBlockIndex();
+        pindex->nHeight = i;
+        pindex->pprev = pindexPrev;
+        BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(GetRandHash(), pindex)).first;
+        pindex->phashBlock = &mi->first;
+        pindex->BuildSkip();
+        pindexPrev = pindex;
+    }
+    chainActive.SetTip(pindexPrev);
+}
+
+// The type and script indexes of the wallet outputs have to give the same
+// coins and balance as a scan of mapWallet while outputs are received,
+// spent, abandoned, conflicted and removed.
+BOOST_AUTO_TEST_CASE(output_index_add_spend_remove)
+{
+    BuildIndexChain(2 * nTxConfirmTarget);
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    CKey key;
+    key.MakeNewKey(true);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    CScript scriptMine = GetScriptForRawPubKey(key.GetPubKey());
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    CScript scriptOther = GetScriptForRawPubKey(otherKey.GetPubKey());
+
+    // Receive three outputs, deep enough to count in the balance, and one for somebody else
+    CMutableTransaction fund = MakeSpend({COutPoint(GetRandHash(), 0)},
+        {CTxOut(10 * COIN, scriptMine), CTxOut(20 * COIN, scriptMine), CTxOut(30 * COIN, scriptMine), CTxOut(40 * COIN, scriptOther)});
+    uint256 hashFund = fund.GetHash();
+    wallet.SyncTransaction(fund, chainActive[chainActive.Height() - nTxConfirmTarget], 0);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), 60 * COIN);
+    CheckAvailableCoins(wallet);
+
+    // Spend in the tip, the change is available but not in the balance yet
+    CMutableTransaction spend = MakeSpend({COutPoint(hashFund, 0)}, {CTxOut(5 * COIN, scriptOther), CTxOut(4 * COIN, scriptMine)});
+    wallet.SyncTransaction(spend, chainActive.Tip(), 1);
+    CheckAvailableCoins(wallet);
+
+    // Spend without a block or the mempool, then abandon the spend
+    CMutableTransaction abandoned = MakeSpend({COutPoint(hashFund, 1)}, {CTxOut(19 * COIN, scriptOther)});
+    wallet.SyncTransaction(abandoned, NULL, -1);
+    CheckAvailableCoins(wallet);
+    BOOST_CHECK(wallet.AbandonTransaction(abandoned.GetHash()));
+    CheckAvailableCoins(wallet);
+
+    // Spend two outputs, a block transaction spending one of them conflicts
+    // the spend and gives back the other
+    CMutableTransaction conflicted = MakeSpend({COutPoint(hashFund, 1), COutPoint(hashFund, 2)}, {CTxOut(49 * COIN, scriptOther)});
+    wallet.SyncTransaction(conflicted, NULL, -1);
+    CheckAvailableCoins(wallet);
+    CMutableTransaction conflicting = MakeSpend({COutPoint(hashFund, 2)}, {CTxOut(29 * COIN, scriptOther)});
+    wallet.SyncTransaction(conflicting, chainActive.Tip(), 2);
+    CheckAvailableCoins(wallet);
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK(GetOutPoints(vCoins).count(COutPoint(hashFund, 1)));
+    BOOST_CHECK(!GetOutPoints(vCoins).count(COutPoint(hashFund, 2)));
+
+    // Removing the spend in the tip gives back its input and drops its change
+    CWalletTx wtxSpend = wallet.mapWallet.at(spend.GetHash());
+    wallet.RemoveFromWallet(wtxSpend);
+    CheckAvailableCoins(wallet);
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK(GetOutPoints(vCoins).count(COutPoint(hashFund, 0)));
+    BOOST_CHECK(!GetOutPoints(vCoins).count(COutPoint(spend.GetHash(), 1)));
+}
+
+static CTxOut MakeTokenOutput(const std::string& strSymbol, uint64_t nValue, const CScript& scriptPubKey, bool fReg = false)
+{
+    if (fReg) {
+        TokenRegLabel label;
+        memcpy(label.TokenSymbol, strSymbol.c_str(), std::min<size_t>(strSymbol.size(), 8));
+        label.value = nValue;
+        label.totalCount = nValue;
+        return CTxOut(0, scriptPubKey, label);
+    }
+    TokenLabel label;
+    memcpy(label.TokenSymbol, strSymbol.c_str(), std::min<size_t>(strSymbol.size(), 8));
+    label.value = nValue;
+    return CTxOut(0, scriptPubKey, label);
+}
+
+static uint64_t GetTokenValue(const CTxOut& txout)
+{
+    return txout.txType == TXOUT_TOKENREG ? txout.GetTokenRegLabel().totalCount : txout.GetTokenLabel().value;
+}
+
+static void CheckTokenCoins(CWallet& wallet)
+{
+    BOOST_CHECK(wallet.CheckOutputIndexes());
+
+    // Token outputs of the scan, all of them and by symbol
+    std::set<COutPoint> setExpected;
+    std::map<std::string, std::set<COutPoint> > mapExpected;
+    std::map<std::string, uint64_t> mapBalance, mapConfirmedBalance;
+    for (const auto& entry : ScanAvailableOutputs(wallet, true)) {
+        const CTxOut& txout = GetWalletOutput(wallet, entry.first);
+        if (txout.txType != TXOUT_TOKEN && txout.txType != TXOUT_TOKENREG)
+            continue;
+        setExpected.insert(entry.first);
+        mapExpected[txout.getTokenSymbol()].insert(entry.first);
+        mapBalance[txout.getTokenSymbol()] += GetTokenValue(txout);
+        if (entry.second >= nTxConfirmTarget && (wallet.IsMine(txout) & ISMINE_SPENDABLE))
+            mapConfirmedBalance[txout.getTokenSymbol()] += GetTokenValue(txout);
+    }
+    std::vector<COutput> vCoins;
+    wallet.AvailableTokenCoins(vCoins);
+    BOOST_CHECK(GetOutPoints(vCoins) == setExpected);
+
+    std::set<COutPoint> setUnconfirmed;
+    for (const auto& entry : ScanAvailableOutputs(wallet, false)) {
+        uint8_t txType = GetWalletOutput(wallet, entry.first).txType;
+        if (txType == TXOUT_TOKEN || txType == TXOUT_TOKENREG)
+            setUnconfirmed.insert(entry.first);
+    }
+    wallet.AvailableTokenCoins(vCoins, false);
+    BOOST_CHECK(GetOutPoints(vCoins) == setUnconfirmed);
+
+    for (std::string strSymbol : {"TEST", "OTHER"}) {
+        wallet.AvailableTokenCoins(strSymbol, vCoins);
+        BOOST_CHECK(GetOutPoints(vCoins) == mapExpected[strSymbol]);
+        uint64_t nValue = 0;
+        BOOST_CHECK_EQUAL(wallet.GetSymbolbalance(strSymbol, nValue), mapConfirmedBalance.count(strSymbol) != 0);
+        BOOST_CHECK_EQUAL(nValue, mapConfirmedBalance[strSymbol]);
+    }
+
+    // Symbols the wallet held before stay listed with a zero balance
+    std::map<std::string, uint64_t> mapList;
+    wallet.ListTokenBalance(mapList);
+    for (const auto& entry : mapList)
+        BOOST_CHECK_EQUAL(entry.second, mapBalance[entry.first]);
+    for (const auto& entry : mapBalance)
+        BOOST_CHECK(mapList.count(entry.first));
+}
+
+// The token coins and per symbol balances found through the symbol index
+// have to match a scan of mapWallet while tokens are received, spent,
+// disconnected and abandoned, and conflicted.
+BOOST_AUTO_TEST_CASE(token_index_spend_reorg_abandon)
+{
+    BuildIndexChain(2 * nTxConfirmTarget);
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    CKey key;
+    key.MakeNewKey(true);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    CScript scriptMine = GetScriptForRawPubKey(key.GetPubKey());
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    CScript scriptOther = GetScriptForRawPubKey(otherKey.GetPubKey());
+
+    // Receive a registration and tokens of two symbols, deep enough to count in the balance
+    CMutableTransaction fund = MakeSpend({COutPoint(GetRandHash(), 0)},
+        {MakeTokenOutput("TEST", 1000, scriptMine, true), MakeTokenOutput("TEST", 300, scriptMine), MakeTokenOutput("OTHER", 50, scriptMine),
+         MakeTokenOutput("TEST", 70, scriptOther), CTxOut(1 * COIN, scriptMine)});
+    uint256 hashFund = fund.GetHash();
+    wallet.SyncTransaction(fund, chainActive[chainActive.Height() - nTxConfirmTarget], 0);
+    CheckTokenCoins(wallet);
+    std::string strSymbol = "TEST";
+    uint64_t nValue = 0;
+    BOOST_CHECK(wallet.GetSymbolbalance(strSymbol, nValue));
+    BOOST_CHECK_EQUAL(nValue, 1300U);
+
+    // Spend in the tip, the change is listed but not in the confirmed balance yet
+    CMutableTransaction spend = MakeSpend({COutPoint(hashFund, 1)}, {MakeTokenOutput("TEST", 100, scriptOther), MakeTokenOutput("TEST", 200, scriptMine)});
+    wallet.SyncTransaction(spend, chainActive.Tip(), 1);
+    CheckTokenCoins(wallet);
+    BOOST_CHECK(wallet.GetSymbolbalance(strSymbol, nValue));
+    BOOST_CHECK_EQUAL(nValue, 1000U);
+
+    // Disconnect the tip as DisconnectTip tells the wallet, the spend keeps
+    // its input until it is abandoned
+    CBlockIndex* pindexDelete = chainActive.Tip();
+    chainActive.SetTip(pindexDelete->pprev);
+    wallet.SyncTransaction(spend, pindexDelete->pprev, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+    BOOST_CHECK_EQUAL(wallet.mapWallet.at(spend.GetHash()).GetDepthInMainChain(), 0);
+    CheckTokenCoins(wallet);
+    BOOST_CHECK(wallet.AbandonTransaction(spend.GetHash()));
+    CheckTokenCoins(wallet);
+    BOOST_CHECK(wallet.GetSymbolbalance(strSymbol, nValue));
+    BOOST_CHECK_EQUAL(nValue, 1300U);
+
+    // A block transaction spending the other symbol conflicts a spend of
+    // both symbols and gives back the registration
+    CMutableTransaction conflicted = MakeSpend({COutPoint(hashFund, 0), COutPoint(hashFund, 2)}, {MakeTokenOutput("TEST", 1050, scriptOther)});
+    wallet.SyncTransaction(conflicted, NULL, -1);
+    CheckTokenCoins(wallet);
+    CMutableTransaction conflicting = MakeSpend({COutPoint(hashFund, 2)}, {MakeTokenOutput("OTHER", 50, scriptOther)});
+    wallet.SyncTransaction(conflicting, chainActive.Tip(), 1);
+    CheckTokenCoins(wallet);
+    BOOST_CHECK(wallet.GetSymbolbalance(strSymbol, nValue));
+    BOOST_CHECK_EQUAL(nValue, 1300U);
+    strSymbol = "OTHER";
+    BOOST_CHECK(!wallet.GetSymbolbalance(strSymbol, nValue));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -107,7 +107,7 @@ bool COutput::CanBeSentToOhter() const{
 bool COutput::CanBeAuthorizedToOther() const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return false;
-	return (tx->tx->vout[i].ipcLabel.reAuthorize == 1);
+	return (tx->tx->vout[i].GetIPCLabel().reAuthorize == 1);
 }
 
 bool COutput::CanBeUniqueAuthorizedToOther() const{
@@ -115,7 +115,7 @@ bool COutput::CanBeUniqueAuthorizedToOther() const{
 		return false;
 	if (tx->tx->vout[i].txType != TXOUT_IPCOWNER)
 		return false;
-	if (tx->tx->vout[i].ipcLabel.uniqueAuthorize == 0)
+	if (tx->tx->vout[i].GetIPCLabel().uniqueAuthorize == 0)
 		return true;
 }
 
@@ -128,43 +128,43 @@ int COutput::GetType() const{
 int COutput::GetIPCExtendType() const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return -1;
-	return tx->tx->vout[i].ipcLabel.ExtendType;
+	return tx->tx->vout[i].GetIPCLabel().ExtendType;
 }
 
 uint32_t COutput::GetIPCStartTime() const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return 0;
-	return tx->tx->vout[i].ipcLabel.startTime;
+	return tx->tx->vout[i].GetIPCLabel().startTime;
 }
 
 uint32_t COutput::GetIPCStopTime() const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return 0;
-	return tx->tx->vout[i].ipcLabel.stopTime;
+	return tx->tx->vout[i].GetIPCLabel().stopTime;
 }
 
 uint8_t  COutput::GetIPCreAuthorize() const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return -1;
-	return tx->tx->vout[i].ipcLabel.reAuthorize;
+	return tx->tx->vout[i].GetIPCLabel().reAuthorize;
 }
 
 uint8_t  COutput::GetIPCUniqAuthorize()const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return -1;
-	return tx->tx->vout[i].ipcLabel.uniqueAuthorize;
+	return tx->tx->vout[i].GetIPCLabel().uniqueAuthorize;
 }
 
 std::string COutput::GetIPCHash() const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return "";
-	return tx->tx->vout[i].ipcLabel.hash.GetHex();
+	return tx->tx->vout[i].GetIPCLabel().hash.GetHex();
 }
 
 std::string COutput::GetIPCTitle() const{
 	if (tx == NULL || tx->tx == NULL || i >= tx->tx->vout.size())
 		return "";
-	return tx->tx->vout[i].ipcLabel.labelTitle;
+	return tx->tx->vout[i].GetIPCLabel().labelTitle;
 }
 
 std::string COutput::GetIPCLabel() const{
@@ -179,15 +179,15 @@ std::string COutput::GetTokenSymbol() const{
 	int txtype = GetType();
 	if (txtype == TXOUT_TOKENREG)
 	{
-		return tx->tx->vout[i].tokenRegLabel.getTokenSymbol();
+		return tx->tx->vout[i].GetTokenRegLabel().getTokenSymbol();
 	}
 	else if (txtype == TXOUT_TOKEN)
 	{
-		return tx->tx->vout[i].tokenLabel.getTokenSymbol();
+		return tx->tx->vout[i].GetTokenLabel().getTokenSymbol();
 	}
 	else if (txtype == TXOUT_ADDTOKEN)
 	{
-		return tx->tx->vout[i].addTokenLabel.getTokenSymbol();
+		return tx->tx->vout[i].GetAddTokenLabel().getTokenSymbol();
 	}
 	return "";
 }
@@ -197,15 +197,15 @@ uint8_t  COutput::GetTokenAccuracy() const{
 	int txtype = GetType();
 	if (txtype == TXOUT_TOKENREG)
 	{
-		return tx->tx->vout[i].tokenRegLabel.accuracy;
+		return tx->tx->vout[i].GetTokenRegLabel().accuracy;
 	}
 	else if (txtype == TXOUT_TOKEN)
 	{
-		return tx->tx->vout[i].tokenLabel.accuracy;
+		return tx->tx->vout[i].GetTokenLabel().accuracy;
 	}
 	else if (txtype == TXOUT_ADDTOKEN)
 	{
-		return tx->tx->vout[i].addTokenLabel.accuracy;
+		return tx->tx->vout[i].GetAddTokenLabel().accuracy;
 	}
 	return 0;
 }
@@ -216,15 +216,15 @@ uint64_t COutput::GetTokenvalue() const{
 	int txtype = GetType();
 	if (txtype == TXOUT_TOKENREG)
 	{
-		return tx->tx->vout[i].tokenRegLabel.totalCount;
+		return tx->tx->vout[i].GetTokenRegLabel().totalCount;
 	}
 	else if (txtype == TXOUT_TOKEN)
 	{
-		return tx->tx->vout[i].tokenLabel.value;
+		return tx->tx->vout[i].GetTokenLabel().value;
 	}
 	else if (txtype == TXOUT_ADDTOKEN)
 	{
-		return tx->tx->vout[i].addTokenLabel.currentCount;
+		return tx->tx->vout[i].GetAddTokenLabel().currentCount;
 	}
 	return uint64_t(0);
 }
@@ -233,7 +233,7 @@ int64_t COutput::GetAssetEntryTime() const{
 		return 0;
 	int ntxtype = GetType();
 	std::string stripchash = GetIPCHash();
-	int64_t ipcstarttime = tx->tx->vout[i].ipcLabel.startTime;
+	int64_t ipcstarttime = tx->tx->vout[i].GetIPCLabel().startTime;
 	if (ntxtype != TXOUT_IPCOWNER && ntxtype != TXOUT_IPCAUTHORIZATION)
 	{
 		return tx->GetTimeOfTokenInChain()>ipcstarttime ? tx->GetTimeOfTokenInChain() : ipcstarttime;
@@ -264,9 +264,9 @@ int64_t COutput::GetAssetEntryTime() const{
 			CWalletTx& prev = pwalletMain->mapWallet[txin.prevout.hash];
 			if (NULL == prev.tx)
 				return 0;
-			if (prev.tx->vout[txin.prevout.n].txType == ntxtype && stripchash == prev.tx->vout[txin.prevout.n].ipcLabel.hash.GetHex())
+			if (prev.tx->vout[txin.prevout.n].txType == ntxtype && stripchash == prev.tx->vout[txin.prevout.n].GetIPCLabel().hash.GetHex())
 			{
-				ipcstarttime = prev.tx->vout[txin.prevout.n].ipcLabel.startTime;
+				ipcstarttime = prev.tx->vout[txin.prevout.n].GetIPCLabel().startTime;
 				curtx = prev;
 				curptx = curtx.tx;
 				break;
@@ -787,6 +787,9 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
     pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
     SyncMetaData(range);
+
+    if (IsOutputSpentByWallet(outpoint))
+        RemoveWalletOutput(outpoint);
 }
 
 
@@ -804,6 +807,7 @@ void CWallet::AddToSpends(const uint256& wtxid)
 void CWallet::RemoveFromSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
 	mapTxSpends.erase(outpoint);
+	AddWalletOutput(outpoint);
 }
 
 
@@ -819,6 +823,95 @@ void CWallet::RemoveFromSpends(const uint256& wtxid)
 		RemoveFromSpends(txin.prevout, wtxid);
 }
 
+bool CWallet::IsOutputSpentByWallet(const COutPoint& outpoint) const
+{
+	//Unlike IsSpent this needs no chain state: abandoned spenders do not count,
+	//neither do the ones MarkConflicted left with a block hash but no index
+	std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(outpoint);
+	for (TxSpends::const_iterator it = range.first; it != range.second; ++it)
+	{
+		std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+		if (mit == mapWallet.end() || mit->second.isAbandoned())
+			continue;
+		if (mit->second.nIndex == -1 && !mit->second.hashUnset())
+			continue;
+		return true;
+	}
+	return false;
+}
+
+void CWallet::AddWalletOutput(const COutPoint& outpoint)
+{
+	std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(outpoint.hash);
+	if (mit == mapWallet.end() || outpoint.n >= mit->second.tx->vout.size())
+		return;
+	if (IsOutputSpentByWallet(outpoint))
+		return;
+	const CTxOut& txout = mit->second.tx->vout[outpoint.n];
+	mapOutputsByType[txout.txType].insert(outpoint);
+	mapOutputsByScript[txout.scriptPubKey].insert(outpoint);
+	if (txout.txType == TXOUT_TOKENREG || txout.txType == TXOUT_TOKEN || txout.txType == TXOUT_ADDTOKEN)
+		mapTokenOutputs[txout.getTokenSymbol()].insert(outpoint);
+}
+
+void CWallet::AddWalletOutputs(const CWalletTx& wtx)
+{
+	for (unsigned int i = 0; i < wtx.tx->vout.size(); i++)
+		AddWalletOutput(COutPoint(wtx.GetHash(), i));
+}
+
+template <typename K>
+static void EraseIndexedOutput(std::map<K, std::set<COutPoint> >& mapOutputs, const K& key, const COutPoint& outpoint)
+{
+	typename std::map<K, std::set<COutPoint> >::iterator it = mapOutputs.find(key);
+	if (it == mapOutputs.end())
+		return;
+	it->second.erase(outpoint);
+	if (it->second.empty())
+		mapOutputs.erase(it);
+}
+
+void CWallet::RemoveWalletOutput(const COutPoint& outpoint)
+{
+	std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(outpoint.hash);
+	if (mit == mapWallet.end() || outpoint.n >= mit->second.tx->vout.size())
+		return;
+	const CTxOut& txout = mit->second.tx->vout[outpoint.n];
+	EraseIndexedOutput(mapOutputsByType, txout.txType, outpoint);
+	EraseIndexedOutput(mapOutputsByScript, txout.scriptPubKey, outpoint);
+	if (txout.txType == TXOUT_TOKENREG || txout.txType == TXOUT_TOKEN || txout.txType == TXOUT_ADDTOKEN)
+		EraseIndexedOutput(mapTokenOutputs, txout.getTokenSymbol(), outpoint);
+}
+
+template <typename K>
+static bool IsIndexedOutput(const std::map<K, std::set<COutPoint> >& mapOutputs, const K& key, const COutPoint& outpoint)
+{
+	typename std::map<K, std::set<COutPoint> >::const_iterator it = mapOutputs.find(key);
+	return it != mapOutputs.end() && it->second.count(outpoint);
+}
+
+bool CWallet::CheckOutputIndexes() const
+{
+	LOCK2(cs_main, cs_wallet);
+	for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+	{
+		for (unsigned int i = 0; i < it->second.tx->vout.size(); i++)
+		{
+			if (IsSpent(it->first, i))
+				continue;
+			const COutPoint outpoint(it->first, i);
+			const CTxOut& txout = it->second.tx->vout[i];
+			if (!IsIndexedOutput(mapOutputsByType, txout.txType, outpoint) ||
+				!IsIndexedOutput(mapOutputsByScript, txout.scriptPubKey, outpoint))
+				return false;
+			if ((txout.txType == TXOUT_TOKENREG || txout.txType == TXOUT_TOKEN || txout.txType == TXOUT_ADDTOKEN) &&
+				!IsIndexedOutput(mapTokenOutputs, txout.getTokenSymbol(), outpoint))
+				return false;
+		}
+	}
+	return true;
+}
+
 
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
@@ -1182,6 +1275,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
                          wtxIn.hashBlock.ToString());
         }
         AddToSpends(hash);
+        AddWalletOutputs(wtx);
     }
 
     bool fUpdated = false;
@@ -1250,6 +1344,8 @@ bool CWallet::RemoveFromWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 	uint256 hash = wtxIn.GetHash();
 
 	RemoveFromSpends(hash);  
+	for (unsigned int i = 0; i < wtxIn.tx->vout.size(); i++)
+		RemoveWalletOutput(COutPoint(hash, i));
 
 	bool fUpdated = false;
 	//// debug print
@@ -1285,6 +1381,7 @@ bool CWallet::LoadToWallet(const CWalletTx& wtxIn)
     wtx.BindWallet(this);
     wtxOrdered.insert(make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
     AddToSpends(hash);
+    AddWalletOutputs(wtx);
     BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin) {
         if (mapWallet.count(txin.prevout.hash)) {
             CWalletTx& prevtx = mapWallet[txin.prevout.hash];
@@ -1428,6 +1525,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             {
                 if (mapWallet.count(txin.prevout.hash))
                     mapWallet[txin.prevout.hash].MarkDirty();
+                AddWalletOutput(txin.prevout);
             }
         }
     }
@@ -1489,6 +1587,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             {
                 if (mapWallet.count(txin.prevout.hash))
                     mapWallet[txin.prevout.hash].MarkDirty();
+                AddWalletOutput(txin.prevout);
             }
         }
     }
@@ -1905,7 +2004,7 @@ void CWalletTx::GetAmountsIP(int IPtype, list<COutputEntryIP>& listReceived,
 	{
 		const CTxOut& txout = tx->vout[i];
 		uint8_t txtype = txout.txType;
-		uint8_t ipExtendType = txout.ipcLabel.ExtendType;
+		uint8_t ipExtendType = txout.GetIPCLabel().ExtendType;
 		if (txtype != txtp )
 			continue;
 		if (txtype != TXOUT_IPCOWNER && txtype != TXOUT_IPCAUTHORIZATION)
@@ -1936,8 +2035,8 @@ void CWalletTx::GetAmountsIP(int IPtype, list<COutputEntryIP>& listReceived,
 			address = CNoDestination();
 		}
 		uint8_t iptype = ipExtendType;
-		std::string iptitle = txout.ipcLabel.labelTitle;
-		std::string iphash = txout.ipcLabel.hash.GetHex();
+		std::string iptitle = txout.GetIPCLabel().labelTitle;
+		std::string iphash = txout.GetIPCLabel().hash.GetHex();
 		COutputEntryIP output = { address, txout.nValue, (int)i, txtype, iptype, iptitle, iphash };
 		// If we are debited by the transaction, add the output as a "sent" entry
 		if (nIpDebit > 0 )
@@ -2019,20 +2118,20 @@ void CWalletTx::GetAmountsToken(const std::string& strtokensymbol, list<COutputE
 		uint64_t tokenvalue = 0;
 		if (txtype == TXOUT_TOKENREG)
 		{
-			strsymbol = txout.tokenRegLabel.getTokenSymbol();
-			accuracy = txout.tokenRegLabel.accuracy;
-			tokenvalue = txout.tokenRegLabel.totalCount;
+			strsymbol = txout.GetTokenRegLabel().getTokenSymbol();
+			accuracy = txout.GetTokenRegLabel().accuracy;
+			tokenvalue = txout.GetTokenRegLabel().totalCount;
 		}
 		else if (txtype == TXOUT_TOKEN){
-			strsymbol = txout.tokenLabel.getTokenSymbol();
-			accuracy = txout.tokenLabel.accuracy;
-			tokenvalue = txout.tokenLabel.value;
+			strsymbol = txout.GetTokenLabel().getTokenSymbol();
+			accuracy = txout.GetTokenLabel().accuracy;
+			tokenvalue = txout.GetTokenLabel().value;
 		}
 		else if (txtype == TXOUT_ADDTOKEN)
 		{
-			strsymbol = txout.addTokenLabel.getTokenSymbol();
-			accuracy = txout.addTokenLabel.accuracy;
-			tokenvalue = txout.addTokenLabel.currentCount;
+			strsymbol = txout.GetAddTokenLabel().getTokenSymbol();
+			accuracy = txout.GetAddTokenLabel().accuracy;
+			tokenvalue = txout.GetAddTokenLabel().currentCount;
 		}
 		std::cout << "strsymbol:" << strsymbol << " strtokensymbol:" << strtokensymbol << std::endl;
 		if (strsymbol != strtokensymbol)
@@ -2118,20 +2217,20 @@ void CWalletTx::GetAmountsTokenForUnion(const std::string& strtokensymbol, list<
         uint64_t tokenvalue = 0;
         if (txtype == TXOUT_TOKENREG)
         {
-            strsymbol = txout.tokenRegLabel.getTokenSymbol();
-            accuracy = txout.tokenRegLabel.accuracy;
-            tokenvalue = txout.tokenRegLabel.totalCount;
+            strsymbol = txout.GetTokenRegLabel().getTokenSymbol();
+            accuracy = txout.GetTokenRegLabel().accuracy;
+            tokenvalue = txout.GetTokenRegLabel().totalCount;
         }
         else if (txtype == TXOUT_TOKEN){
-            strsymbol = txout.tokenLabel.getTokenSymbol();
-            accuracy = txout.tokenLabel.accuracy;
-            tokenvalue = txout.tokenLabel.value;
+            strsymbol = txout.GetTokenLabel().getTokenSymbol();
+            accuracy = txout.GetTokenLabel().accuracy;
+            tokenvalue = txout.GetTokenLabel().value;
         }
 		else if (txtype == TXOUT_ADDTOKEN)
 		{
-			strsymbol = txout.addTokenLabel.getTokenSymbol();
-			accuracy = txout.addTokenLabel.accuracy;
-			tokenvalue = txout.addTokenLabel.currentCount;
+			strsymbol = txout.GetAddTokenLabel().getTokenSymbol();
+			accuracy = txout.GetAddTokenLabel().accuracy;
+			tokenvalue = txout.GetAddTokenLabel().currentCount;
 		}
         if (strsymbol != strtokensymbol)
             continue;
@@ -2237,7 +2336,7 @@ void CWalletTx::GetAmountsIPForGetitx(list<COutputEntryIP>& listReceived,
 	{
 		const CTxOut& txout = tx->vout[i];
 		uint8_t txtype = txout.txType;
-		uint8_t ipExtendType = txout.ipcLabel.ExtendType;
+		uint8_t ipExtendType = txout.GetIPCLabel().ExtendType;
 
 		if (txtype != TXOUT_IPCOWNER && txtype != TXOUT_IPCAUTHORIZATION)
 			continue;
@@ -2263,8 +2362,8 @@ void CWalletTx::GetAmountsIPForGetitx(list<COutputEntryIP>& listReceived,
 			address = CNoDestination();
 		}
 		uint8_t iptype = ipExtendType;
-		std::string iptitle = txout.ipcLabel.labelTitle;
-		std::string iphash = txout.ipcLabel.hash.GetHex();
+		std::string iptitle = txout.GetIPCLabel().labelTitle;
+		std::string iphash = txout.GetIPCLabel().hash.GetHex();
 		COutputEntryIP output = { address, txout.nValue, (int)i, txtype, iptype, iptitle, iphash };
 		// If we are debited by the transaction, add the output as a "sent" entry
 		if (nIpDebit > 0 )
@@ -2331,20 +2430,20 @@ void CWalletTx::GetAmountsTokenForGetttx(list<COutputEntryToken>& listReceived,
 		uint64_t tokenvalue = 0;
 		if (txtype == TXOUT_TOKENREG)
 		{
-			strsymbol = txout.tokenRegLabel.getTokenSymbol();
-			accuracy = txout.tokenRegLabel.accuracy;
-			tokenvalue = txout.tokenRegLabel.totalCount;
+			strsymbol = txout.GetTokenRegLabel().getTokenSymbol();
+			accuracy = txout.GetTokenRegLabel().accuracy;
+			tokenvalue = txout.GetTokenRegLabel().totalCount;
 		}
 		else if (txtype == TXOUT_TOKEN){
-			strsymbol = txout.tokenLabel.getTokenSymbol();
-			accuracy = txout.tokenLabel.accuracy;
-			tokenvalue = txout.tokenLabel.value;
+			strsymbol = txout.GetTokenLabel().getTokenSymbol();
+			accuracy = txout.GetTokenLabel().accuracy;
+			tokenvalue = txout.GetTokenLabel().value;
 		}
 		else if (txtype == TXOUT_ADDTOKEN)
 		{
-			strsymbol = txout.addTokenLabel.getTokenSymbol();
-			accuracy = txout.addTokenLabel.accuracy;
-			tokenvalue = txout.addTokenLabel.currentCount;
+			strsymbol = txout.GetAddTokenLabel().getTokenSymbol();
+			accuracy = txout.GetAddTokenLabel().accuracy;
+			tokenvalue = txout.GetAddTokenLabel().currentCount;
 		}
 		
 		COutputEntryToken output = { address, txout.nValue, (int)i, txtype, strsymbol, accuracy, tokenvalue };
@@ -2689,7 +2788,7 @@ CAmount CWalletTx::GetAvailableCredit(bool fUseCache) const
 	             const CTxOut &txout = tx->vout[i];
 			//Remove the COINS that have been locked in. add by xxy 20171030
 			if (txout.txType == TXOUT_CAMPAIGN &&
-				txout.devoteLabel.ExtendType == TYPE_CONSENSUS_REGISTER)
+				txout.GetDevoteLabel().ExtendType == TYPE_CONSENSUS_REGISTER)
 			{
 				reAvailableCreditCached = true; //The utxo that applies to join the type in tx will need to be re-checked next time, and the state will change!
 				if (!CConsensusAccountPool::Instance().IsAviableUTXO(hashTx))
@@ -2734,7 +2833,7 @@ CAmount CWalletTx::GetLockCredit(bool fUseCache) const
 		{
 			const CTxOut &txout = tx->vout[i];
 			if (txout.txType == TXOUT_CAMPAIGN &&
-				txout.devoteLabel.ExtendType == TYPE_CONSENSUS_REGISTER)
+				txout.GetDevoteLabel().ExtendType == TYPE_CONSENSUS_REGISTER)
 			{
 				if (!CConsensusAccountPool::Instance().IsAviableUTXO(hashTx))
 				{
@@ -3041,149 +3140,137 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     return nTotal;
 }
 
-void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue) const
+bool CWallet::IsAvailableTx(const CWalletTx& wtx, bool fOnlyConfirmed, int& nDepth) const
 {
-    vCoins.clear();
+	if (fOnlyConfirmed && !wtx.IsTrusted())
+		return false;
 
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+	if (wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0)
+		return false;
 
-//             if (!CheckIPCFinalTx(*pcoin))
-//                 continue;
+	nDepth = wtx.GetDepthInMainChain();
+	if (nDepth < 0)
+		return false;
 
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
+	// We should not consider coins which aren't at least in our mempool
+	// It's possible for these to be conflicted via ancestors which we may never be able to detect
+	if (nDepth == 0 && !wtx.InMempool())
+		return false;
 
-            if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+	// We should not consider coins from transactions that are replacing
+	// other transactions.
+	//
+	// Example: There is a transaction A which is replaced by bumpfee
+	// transaction B. In this case, we want to prevent creation of
+	// a transaction B' which spends an output of B.
+	//
+	// Reason: If transaction A were initially confirmed, transactions B
+	// and B' would no longer be valid, so the user would have to create
+	// a new transaction C to replace B'. However, in the case of a
+	// one-block reorg, transactions B' and C might BOTH be accepted,
+	// when the user only wanted one of them. Specifically, there could
+	// be a 1-block reorg away from the chain where transactions A and C
+	// were accepted to another chain where B, B', and C were all
+	// accepted.
+	if (nDepth == 0 && fOnlyConfirmed && wtx.mapValue.count("replaces_txid")) {
+		return false;
+	}
 
-            int nDepth = pcoin->GetDepthInMainChain();
-            if (nDepth < 0)
-                continue;
+	// Similarly, we should not consider coins from transactions that
+	// have been replaced. In the example above, we would want to prevent
+	// creation of a transaction A' spending an output of A, because if
+	// transaction B were initially confirmed, conflicting with A and
+	// A', we wouldn't want to the user to create a transaction D
+	// intending to replace A', but potentially resulting in a scenario
+	// where A, A', and D could all be accepted (instead of just B and
+	// D, or just A and A' like the user would want).
+	if (nDepth == 0 && fOnlyConfirmed && wtx.mapValue.count("replaced_by_txid")) {
+		return false;
+	}
+	return true;
+}
 
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+void CWallet::GetAvailableOutputs(const std::set<COutPoint>& setOutputs, bool fOnlyConfirmed, std::vector<COutput>& vOutputs) const
+{
+	AssertLockHeld(cs_main);
+	AssertLockHeld(cs_wallet);
+	const CWalletTx* pcoin = NULL;
+	bool fAvailable = false;
+	int nDepth = 0;
+	BOOST_FOREACH(const COutPoint& outpoint, setOutputs)
+	{
+		//The outputs of one transaction are next to each other in the set
+		if (!pcoin || pcoin->GetHash() != outpoint.hash)
+		{
+			std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(outpoint.hash);
+			if (mit == mapWallet.end())
+			{
+				pcoin = NULL;
+				continue;
+			}
+			pcoin = &mit->second;
+			fAvailable = IsAvailableTx(*pcoin, fOnlyConfirmed, nDepth);
+		}
+		if (fAvailable && !IsSpent(outpoint.hash, outpoint.n))
+			vOutputs.push_back(COutput(pcoin, outpoint.n, nDepth, false, false));
+	}
+}
 
-            // We should not consider coins from transactions that are replacing
-            // other transactions.
-            //
-            // Example: There is a transaction A which is replaced by bumpfee
-            // transaction B. In this case, we want to prevent creation of
-            // a transaction B' which spends an output of B.
-            //
-            // Reason: If transaction A were initially confirmed, transactions B
-            // and B' would no longer be valid, so the user would have to create
-            // a new transaction C to replace B'. However, in the case of a
-            // one-block reorg, transactions B' and C might BOTH be accepted,
-            // when the user only wanted one of them. Specifically, there could
-            // be a 1-block reorg away from the chain where transactions A and C
-            // were accepted to another chain where B, B', and C were all
-            // accepted.
-            if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaces_txid")) {
-                continue;
-            }
+void CWallet::GetAvailableOutputsOfType(uint8_t txType, bool fOnlyConfirmed, std::vector<COutput>& vOutputs) const
+{
+	std::map<uint8_t, std::set<COutPoint> >::const_iterator it = mapOutputsByType.find(txType);
+	if (it != mapOutputsByType.end())
+		GetAvailableOutputs(it->second, fOnlyConfirmed, vOutputs);
+}
 
-            // Similarly, we should not consider coins from transactions that
-            // have been replaced. In the example above, we would want to prevent
-            // creation of a transaction A' spending an output of A, because if
-            // transaction B were initially confirmed, conflicting with A and
-            // A', we wouldn't want to the user to create a transaction D
-            // intending to replace A', but potentially resulting in a scenario
-            // where A, A', and D could all be accepted (instead of just B and
-            // D, or just A and A' like the user would want).
-            if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaced_by_txid")) {
-                continue;
-            }
+void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue) const
+{
+    vCoins.clear();
 
-            for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-                isminetype mine = IsMine(pcoin->tx->vout[i]);
-                if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))))
-                        vCoins.push_back(COutput(pcoin, i, nDepth,
-                                                 ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-                                                  (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-                                                 (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-            }
+    {
+        LOCK2(cs_main, cs_wallet);
+        std::vector<COutput> vOutputs;
+        for (std::map<uint8_t, std::set<COutPoint> >::const_iterator it = mapOutputsByType.begin(); it != mapOutputsByType.end(); ++it)
+            GetAvailableOutputs(it->second, fOnlyConfirmed, vOutputs);
+        BOOST_FOREACH(const COutput& out, vOutputs)
+        {
+            const CWalletTx* pcoin = out.tx;
+            int i = out.i;
+            isminetype mine = IsMine(pcoin->tx->vout[i]);
+            if (mine != ISMINE_NO &&
+                !IsLockedCoin(pcoin->GetHash(), i) && (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(pcoin->GetHash(), i))))
+                    vCoins.push_back(COutput(pcoin, i, out.nDepth,
+                                             ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+                                              (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+                                             (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
         }
     }
 }
-//add by xxy
 void CWallet::AvailableNormalCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue) const
 {
 	vCoins.clear();
 	{
 		LOCK2(cs_main, cs_wallet);
-		for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+		std::vector<COutput> vOutputs;
+		GetAvailableOutputsOfType(TXOUT_NORMAL, fOnlyConfirmed, vOutputs);
+		GetAvailableOutputsOfType(TXOUT_CAMPAIGN, fOnlyConfirmed, vOutputs);
+		BOOST_FOREACH(const COutput& out, vOutputs)
 		{
-			const uint256& wtxid = it->first;
-			const CWalletTx* pcoin = &(*it).second;
-
-
-			if (fOnlyConfirmed && !pcoin->IsTrusted())
-				continue;
-
-			if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-				continue;
-
-			int nDepth = pcoin->GetDepthInMainChain();
-
-			if (nDepth < nTxConfirmTarget)
-				continue;
-			// We should not consider coins which aren't at least in our mempool
-			// It's possible for these to be conflicted via ancestors which we may never be able to detect
-			if (nDepth == 0 && !pcoin->InMempool())
+			if (out.nDepth < nTxConfirmTarget)
 				continue;
-
-			// We should not consider coins from transactions that are replacing
-			// other transactions.
-			//
-			// Example: There is a transaction A which is replaced by bumpfee
-			// transaction B. In this case, we want to prevent creation of
-			// a transaction B' which spends an output of B.
-			//
-			// Reason: If transaction A were initially confirmed, transactions B
-			// and B' would no longer be valid, so the user would have to create
-			// a new transaction C to replace B'. However, in the case of a
-			// one-block reorg, transactions B' and C might BOTH be accepted,
-			// when the user only wanted one of them. Specifically, there could
-			// be a 1-block reorg away from the chain where transactions A and C
-			// were accepted to another chain where B, B', and C were all
-			// accepted.
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaces_txid")) {
-				continue;
-			}
-
-			// Similarly, we should not consider coins from transactions that
-			// have been replaced. In the example above, we would want to prevent
-			// creation of a transaction A' spending an output of A, because if
-			// transaction B were initially confirmed, conflicting with A and
-			// A', we wouldn't want to the user to create a transaction D
-			// intending to replace A', but potentially resulting in a scenario
-			// where A, A', and D could all be accepted (instead of just B and
-			// D, or just A and A' like the user would want).
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaced_by_txid")) {
-				continue;
-			}
-
-			for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-				isminetype mine = IsMine(pcoin->tx->vout[i]);
-				if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-					!IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-					(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i)))&&
-					(pcoin->tx->vout[i].txType == TXOUT_NORMAL || (pcoin->tx->vout[i].txType == TXOUT_CAMPAIGN && pcoin->tx->vout[i].devoteLabel.ExtendType == TYPE_CONSENSUS_REGISTER && 
-					CConsensusAccountPool::Instance().IsAviableUTXO(pcoin->tx->GetHash())))) 
-					vCoins.push_back(COutput(pcoin, i, nDepth,
-					((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-					(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-					(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-			}
+			const CWalletTx* pcoin = out.tx;
+			int i = out.i;
+			isminetype mine = IsMine(pcoin->tx->vout[i]);
+			if (mine != ISMINE_NO &&
+				!IsLockedCoin(pcoin->GetHash(), i) && (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
+				(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(pcoin->GetHash(), i)))&&
+				(pcoin->tx->vout[i].txType == TXOUT_NORMAL || (pcoin->tx->vout[i].txType == TXOUT_CAMPAIGN && pcoin->tx->vout[i].GetDevoteLabel().ExtendType == TYPE_CONSENSUS_REGISTER && 
+				CConsensusAccountPool::Instance().IsAviableUTXO(pcoin->tx->GetHash())))) 
+				vCoins.push_back(COutput(pcoin, i, out.nDepth,
+				((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+				(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+				(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
 		}
 	}
 	
@@ -3194,71 +3281,21 @@ void CWallet::AvailableIPCCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, co
 
 	{
 		LOCK2(cs_main, cs_wallet);
-		for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+		std::vector<COutput> vOutputs;
+		GetAvailableOutputsOfType(TXOUT_IPCOWNER, fOnlyConfirmed, vOutputs);
+		GetAvailableOutputsOfType(TXOUT_IPCAUTHORIZATION, fOnlyConfirmed, vOutputs);
+		BOOST_FOREACH(const COutput& out, vOutputs)
 		{
-			const uint256& wtxid = it->first;
-			
-			const CWalletTx* pcoin = &(*it).second;
-
-
-			if (fOnlyConfirmed && !pcoin->IsTrusted())
-				continue;
-
-			if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-				continue;
-
-			int nDepth = pcoin->GetDepthInMainChain();
-			if (nDepth < 0)
-				continue;
-
-			// We should not consider coins which aren't at least in our mempool
-			// It's possible for these to be conflicted via ancestors which we may never be able to detect
-			if (nDepth == 0 && !pcoin->InMempool())
-				continue;
-
-			// We should not consider coins from transactions that are replacing
-			// other transactions.
-			//
-			// Example: There is a transaction A which is replaced by bumpfee
-			// transaction B. In this case, we want to prevent creation of
-			// a transaction B' which spends an output of B.
-			//
-			// Reason: If transaction A were initially confirmed, transactions B
-			// and B' would no longer be valid, so the user would have to create
-			// a new transaction C to replace B'. However, in the case of a
-			// one-block reorg, transactions B' and C might BOTH be accepted,
-			// when the user only wanted one of them. Specifically, there could
-			// be a 1-block reorg away from the chain where transactions A and C
-			// were accepted to another chain where B, B', and C were all
-			// accepted.
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaces_txid")) {
-				continue;
-			}
-
-			// Similarly, we should not consider coins from transactions that
-			// have been replaced. In the example above, we would want to prevent
-			// creation of a transaction A' spending an output of A, because if
-			// transaction B were initially confirmed, conflicting with A and
-			// A', we wouldn't want to the user to create a transaction D
-			// intending to replace A', but potentially resulting in a scenario
-			// where A, A', and D could all be accepted (instead of just B and
-			// D, or just A and A' like the user would want).
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaced_by_txid")) {
-				continue;
-			}
-
-			for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-
-				isminetype mine = IsMine(pcoin->tx->vout[i]);
-				if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-					!IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue >= 0 || fIncludeZeroValue) &&
-					(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i)))&&
-					(pcoin->tx->vout[i].txType == TXOUT_IPCOWNER || pcoin->tx->vout[i].txType == TXOUT_IPCAUTHORIZATION))
-					vCoins.push_back(COutput(pcoin, i, nDepth,
-					((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-					(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-					(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-			}
+			const CWalletTx* pcoin = out.tx;
+			int i = out.i;
+			isminetype mine = IsMine(pcoin->tx->vout[i]);
+			if (mine != ISMINE_NO &&
+				!IsLockedCoin(pcoin->GetHash(), i) && (pcoin->tx->vout[i].nValue >= 0 || fIncludeZeroValue) &&
+				(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(pcoin->GetHash(), i))))
+				vCoins.push_back(COutput(pcoin, i, out.nDepth,
+				((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+				(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+				(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
 		}
 	}
 }
@@ -3275,81 +3312,78 @@ void  CWallet::ListTokenBalance(std::map<std::string, uint64_t>& TokenList)
 }
 uint8_t CWallet::GetAccuracyBySymbol(std::string& tokensymbol)
 {
-	if (tokenDataMap.count(tokensymbol) == 0)
+	CTokenRecord record;
+	if (!GetTokenRecord(tokensymbol, record))
 		return 10;
-	return tokenDataMap[tokensymbol].getAccuracy();
+	return record.getAccuracy();
 }
 uint32_t CWallet::GetIssueDateBySymbol(std::string& tokensymbol)
 {
-	if (tokenDataMap.count(tokensymbol) == 0)
+	CTokenRecord record;
+	if (!GetTokenRecord(tokensymbol, record))
 		return 0;
-	return tokenDataMap[tokensymbol].getIssueDate();
+	return record.getIssueDate();
 }
 uint128 CWallet::GetHashBySymbol(std::string& tokensymbol)
 {
     uint128 temp;
-    if (tokenDataMap.count(tokensymbol) == 0)
+    CTokenRecord record;
+    if (!GetTokenRecord(tokensymbol, record))
         return temp;
-    return tokenDataMap[tokensymbol].getHash();
+    return record.getHash();
 }
 
 
+// Symbol and amount of a token output, an empty symbol for other outputs
+static void GetTokenOutputValue(const CTxOut& txout, std::string& strsymbol, uint64_t& nvalue)
+{
+	strsymbol = "";
+	nvalue = 0;
+	if (txout.txType == TXOUT_TOKENREG)
+	{
+		strsymbol = txout.GetTokenRegLabel().getTokenSymbol();
+		nvalue = txout.GetTokenRegLabel().totalCount;
+	}
+	else if (txout.txType == TXOUT_ADDTOKEN)
+	{
+		strsymbol = txout.GetAddTokenLabel().getTokenSymbol();
+		nvalue = txout.GetAddTokenLabel().currentCount;
+	}
+	else if (txout.txType == TXOUT_TOKEN)
+	{
+		strsymbol = txout.GetTokenLabel().getTokenSymbol();
+		nvalue = txout.GetTokenLabel().value;
+	}
+}
+
 bool CWallet::GetSymbolbalance(std::string& tokensymbol, uint64_t& value,std::string unionaddress)
 {
 	value = 0;
+	LOCK2(cs_main, cs_wallet);
 	std::vector<COutput> vAvailableTokenCoins;
 	const CCoinControl *coinControl = NULL;
     if(unionaddress == "")
-        AvailableTokenCoins(vAvailableTokenCoins, true, coinControl);
+        AvailableTokenCoins(tokensymbol, vAvailableTokenCoins, true, coinControl);
     else
         AvailableUnionCoinsCOutput(unionaddress,vAvailableTokenCoins, true, coinControl,true,true);
-	std::cout << "GetSymbolbalance().vAvailableTokenCoins.size():" << vAvailableTokenCoins.size() << std::endl;
 
-	uint8_t txtype = -1;
 	std::string strsymbol = "";
 	uint64_t nvalue = 0;
 	bool isFind = false;
 	for (const auto& coin : vAvailableTokenCoins)
 	{
-		std::cout << "GetSymbolbalance().vAvailableTokenCoins.for:" << std::endl;
-		if (coin.tx->GetDepthInMainChain()<nTxConfirmTarget) //Not enough for eight confirmed filters
+		if (coin.nDepth < nTxConfirmTarget) //Not enough for eight confirmed filters
 			continue;
 		const CTxOut& coinvout = coin.tx->tx->vout[coin.i];
 		if (unionaddress == "" && !(IsMine(coinvout)&ISMINE_SPENDABLE))
 			continue;
-		txtype = coin.tx->tx->vout[coin.i].txType;
-		
-		
-		if (txtype == 4)
-		{
-			strsymbol = coin.tx->tx->vout[coin.i].tokenRegLabel.getTokenSymbol();
-			nvalue = coin.tx->tx->vout[coin.i].tokenRegLabel.totalCount;
-		}
-		else if (txtype == TXOUT_ADDTOKEN)
-		{
-			strsymbol = coin.tx->tx->vout[coin.i].addTokenLabel.getTokenSymbol();
-			nvalue = coin.tx->tx->vout[coin.i].addTokenLabel.currentCount;
-			std::cout << "GetSymbolbalance().vAvailableTokenCoins.currentCount:" << coin.tx->tx->vout[coin.i].addTokenLabel.currentCount<< std::endl;
-		}
-		else if (txtype == 5)
-		{
-			strsymbol = coin.tx->tx->vout[coin.i].tokenLabel.getTokenSymbol();
-			nvalue = coin.tx->tx->vout[coin.i].tokenLabel.value;
-			std::cout << "GetSymbolbalance().vAvailableTokenCoins.value:" << coin.tx->tx->vout[coin.i].tokenLabel.value<< std::endl;
-		}
-		std::cout << "strsymbol:" << strsymbol << " tokensymbol:" << tokensymbol << std::endl;
+		GetTokenOutputValue(coinvout, strsymbol, nvalue);
 		if (strsymbol == tokensymbol) //Symbol symbol is consistent
 		{
-			std::cout << "strsymbol:" << strsymbol << "==tokensymbol:" << tokensymbol << std::endl;
 			isFind = true;
 			value += nvalue;
-		//	if (txtype == 4)   //There could be only one token registered
-		//		return isFind;
 		}
-		//if (tokensymbol != strsymbol)
-		//	continue;
 	}
-	std::cout << "GetSymbolbalance().nvalue:" << value << std::endl;
 	return isFind;
 }
 
@@ -3382,9 +3416,9 @@ void CWallet::getListTokenBuildByMe(tokenInfoMap& tokeninfo)
                     TokenByMeInfo info;
 					uint8_t  accuracy;
 					if (vout.txType == TXOUT_TOKENREG)
-						accuracy = vout.tokenRegLabel.accuracy;
+						accuracy = vout.GetTokenRegLabel().accuracy;
 					else if (vout.txType == TXOUT_ADDTOKEN)
-						accuracy = vout.addTokenLabel.accuracy;
+						accuracy = vout.GetAddTokenLabel().accuracy;
                     info.accuracy =   accuracy ;
                     info.confirmation = pcoin->GetDepthInMainChain();
                     info.txid = pcoin->GetHash().ToString();
@@ -3415,84 +3449,40 @@ void CWallet::getListTokenBuildByMe(tokenInfoMap& tokeninfo)
 
 void CWallet::UpdateTokenBalanceList( )
 {
-	
+	LOCK2(cs_main, cs_wallet);
 	std::vector<COutput> vAvailableTokenCoins;
 	std::string strsymbol = "";
-	std::string cursymbol = "";
-	uint8_t txtype = -1;
-	uint64_t balance = 0;
 	uint64_t nvalue = 0;
 	const CCoinControl *coinControl = NULL;
 	AvailableTokenCoins(vAvailableTokenCoins,true, coinControl);
+
+	//Symbols the wallet held before keep a zero balance
+	TokenValueMap.clear();
+	for (unsigned int i = 0; i < TokensymbolList.size(); i++)
+		TokenValueMap[TokensymbolList[i]] = 0;
 	for (const auto& coin : vAvailableTokenCoins)
 	{
-		txtype = coin.tx->tx->vout[coin.i].txType;
-		if (txtype == 4)
-		{
-			strsymbol = coin.tx->tx->vout[coin.i].tokenRegLabel.getTokenSymbol();
-			nvalue = coin.tx->tx->vout[coin.i].tokenRegLabel.totalCount;
-		}
-		else if (txtype == TXOUT_ADDTOKEN)
+		GetTokenOutputValue(coin.tx->tx->vout[coin.i], strsymbol, nvalue);
+		std::map<std::string, uint64_t>::iterator it = TokenValueMap.find(strsymbol);
+		if (it == TokenValueMap.end())	//If not, add it
 		{
-			strsymbol = coin.tx->tx->vout[coin.i].addTokenLabel.getTokenSymbol();
-			nvalue = coin.tx->tx->vout[coin.i].addTokenLabel.currentCount;
-		}
-		else if (txtype == 5)
-		{
-			strsymbol = coin.tx->tx->vout[coin.i].tokenLabel.getTokenSymbol();
-			nvalue = coin.tx->tx->vout[coin.i].tokenLabel.value;
-		}
-		if (!IsHaveTheTokensymbol(strsymbol))	//If not, add it
-		{ 
 			TokensymbolList.push_back(strsymbol);
+			it = TokenValueMap.insert(std::make_pair(strsymbol, 0)).first;
 		}
-			
-		
-	}
-	TokenValueMap.clear();
-	if (TokensymbolList.size())
-	{
-		for (unsigned int i = 0; i < TokensymbolList.size(); i++)
-		{
-			cursymbol = TokensymbolList[i];
-			balance = 0; //For a symbol, the balance is 0
-			for (const auto& coin : vAvailableTokenCoins)
-			{
-				txtype = coin.tx->tx->vout[coin.i].txType;
-				if (txtype == 4)
-				{
-					strsymbol = coin.tx->tx->vout[coin.i].tokenRegLabel.getTokenSymbol();
-					nvalue = coin.tx->tx->vout[coin.i].tokenRegLabel.totalCount;
-				}
-				else if (txtype == TXOUT_ADDTOKEN)
-				{
-					strsymbol = coin.tx->tx->vout[coin.i].addTokenLabel.getTokenSymbol();
-					nvalue = coin.tx->tx->vout[coin.i].addTokenLabel.currentCount;
-				}
-				else if (txtype == 5)
-				{
-					strsymbol = coin.tx->tx->vout[coin.i].tokenLabel.getTokenSymbol();
-					nvalue = coin.tx->tx->vout[coin.i].tokenLabel.value;
-				}
-				if (cursymbol != strsymbol)
-				continue;
-				balance += nvalue;
-			}
-			TokenValueMap.insert(std::make_pair(cursymbol, balance));
-		}
+		it->second += nvalue;
 	}
 	return;
 }
 bool CWallet::checkVoutAddTokenCanSpend(const CTxOut& vout)const
 {
 	if (vout.txType == TXOUT_ADDTOKEN){
-		if (vout.addTokenLabel.issueDate != 0 && vout.addTokenLabel.issueDate > chainActive.Tip()->GetBlockTime())
+		if (vout.GetAddTokenLabel().issueDate != 0 && vout.GetAddTokenLabel().issueDate > chainActive.Tip()->GetBlockTime())
 			return false;
 			//return state.DoS(100, false, REJECT_INVALID, "Token-reg-starttime-is-up-yet");
 		std::cout << "checkVoutAddTokenCanSpend" << std::endl;
-		std::cout << "vout.addTokenLabel.height:" << vout.addTokenLabel.height << std::endl;
+		std::cout << "vout.GetAddTokenLabel().height:" << vout.GetAddTokenLabel().height << std::endl;
 		std::cout << "chainActive.Height():" << chainActive.Height()<< std::endl;
-		if (vout.addTokenLabel.height > chainActive.Height())
+		if (vout.GetAddTokenLabel().height > chainActive.Height())
 			return false;
 			//return state.DoS(100, false, REJECT_INVALID, "Token-reg-height-is-up-yet");
 		return true;
@@ -3500,76 +3490,50 @@ bool CWallet::checkVoutAddTokenCanSpend(const CTxOut& vout)const
 	else
 		return false;
 }
+void CWallet::FilterTokenCoins(const std::vector<COutput>& vOutputs, std::vector<COutput>& vCoins, const CCoinControl *coinControl, bool fIncludeZeroValue) const
+{
+	BOOST_FOREACH(const COutput& out, vOutputs)
+	{
+		const CWalletTx* pcoin = out.tx;
+		int i = out.i;
+		COutPoint outpoint(pcoin->GetHash(), i);
+		isminetype mine = IsMine(pcoin->tx->vout[i]);
+		if (mine != ISMINE_NO &&
+			!IsLockedCoin(outpoint.hash, i) && (pcoin->tx->vout[i].nValue >= 0 || fIncludeZeroValue) &&
+			(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(outpoint))&&
+			(pcoin->tx->vout[i].txType == TXOUT_TOKEN || pcoin->tx->vout[i].txType == TXOUT_TOKENREG || checkVoutAddTokenCanSpend(pcoin->tx->vout[i])))//
+			vCoins.push_back(COutput(pcoin, i, out.nDepth,
+			((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+			(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+			(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
+	}
+}
+
 void CWallet::AvailableTokenCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue) const
 {
 	vCoins.clear();
 
 	{
 		LOCK2(cs_main, cs_wallet);
-		for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-		{
-			const uint256& wtxid = it->first;
-			const CWalletTx* pcoin = &(*it).second;
-
-
-			if (fOnlyConfirmed && !pcoin->IsTrusted())
-				continue;
-
-			if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-				continue;
-
-			int nDepth = pcoin->GetDepthInMainChain();
-			if (nDepth < 0)
-				continue;
-
-			// We should not consider coins which aren't at least in our mempool
-			// It's possible for these to be conflicted via ancestors which we may never be able to detect
-			if (nDepth == 0 && !pcoin->InMempool())
-				continue;
-
-			// We should not consider coins from transactions that are replacing
-			// other transactions.
-			//
-			// Example: There is a transaction A which is replaced by bumpfee
-			// transaction B. In this case, we want to prevent creation of
-			// a transaction B' which spends an output of B.
-			//
-			// Reason: If transaction A were initially confirmed, transactions B
-			// and B' would no longer be valid, so the user would have to create
-			// a new transaction C to replace B'. However, in the case of a
-			// one-block reorg, transactions B' and C might BOTH be accepted,
-			// when the user only wanted one of them. Specifically, there could
-			// be a 1-block reorg away from the chain where transactions A and C
-			// were accepted to another chain where B, B', and C were all
-			// accepted.
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaces_txid")) {
-				continue;
-			}
+		std::vector<COutput> vOutputs;
+		GetAvailableOutputsOfType(TXOUT_TOKENREG, fOnlyConfirmed, vOutputs);
+		GetAvailableOutputsOfType(TXOUT_TOKEN, fOnlyConfirmed, vOutputs);
+		GetAvailableOutputsOfType(TXOUT_ADDTOKEN, fOnlyConfirmed, vOutputs);
+		FilterTokenCoins(vOutputs, vCoins, coinControl, fIncludeZeroValue);
+	}
+}
 
-			// Similarly, we should not consider coins from transactions that
-			// have been replaced. In the example above, we would want to prevent
-			// creation of a transaction A' spending an output of A, because if
-			// transaction B were initially confirmed, conflicting with A and
-			// A', we wouldn't want to the user to create a transaction D
-			// intending to replace A', but potentially resulting in a scenario
-			// where A, A', and D could all be accepted (instead of just B and
-			// D, or just A and A' like the user would want).
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaced_by_txid")) {
-				continue;
-			}
+void CWallet::AvailableTokenCoins(const std::string& tokensymbol, vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue) const
+{
+	vCoins.clear();
 
-			for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-				isminetype mine = IsMine(pcoin->tx->vout[i]);
-				if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-					!IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue >= 0 || fIncludeZeroValue) &&
-					(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i)))&&
-					(pcoin->tx->vout[i].txType == TXOUT_TOKEN || pcoin->tx->vout[i].txType == TXOUT_TOKENREG || checkVoutAddTokenCanSpend(pcoin->tx->vout[i])))//
-					vCoins.push_back(COutput(pcoin, i, nDepth,
-					((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-					(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-					(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-			}
-		}
+	{
+		LOCK2(cs_main, cs_wallet);
+		std::vector<COutput> vOutputs;
+		std::map<std::string, std::set<COutPoint> >::const_iterator it = mapTokenOutputs.find(tokensymbol);
+		if (it != mapTokenOutputs.end())
+			GetAvailableOutputs(it->second, fOnlyConfirmed, vOutputs);
+		FilterTokenCoins(vOutputs, vCoins, coinControl, fIncludeZeroValue);
 	}
 }
 //end
@@ -3883,9 +3847,9 @@ bool CWallet::SelectTokenCoins(const std::vector<COutput>& vAvailableCoins, std:
 		txtype = out.tx->tx->vout[out.i].txType;
 		if (txtype == 4)
 		{
-			if (symbol != out.tx->tx->vout[out.i].tokenRegLabel.getTokenSymbol())
+			if (symbol != out.tx->tx->vout[out.i].GetTokenRegLabel().getTokenSymbol())
 				continue;
-			if (out.tx->tx->vout[out.i].tokenRegLabel.totalCount >= nTokenValue)
+			if (out.tx->tx->vout[out.i].GetTokenRegLabel().totalCount >= nTokenValue)
 			{
 				setCoinsRet.insert(make_pair(out.tx, out.i));
 				return true;
@@ -3894,17 +3858,17 @@ bool CWallet::SelectTokenCoins(const std::vector<COutput>& vAvailableCoins, std:
 		}
 		else if (txtype == TXOUT_ADDTOKEN)
 		{
-			if (symbol != out.tx->tx->vout[out.i].addTokenLabel.getTokenSymbol())
+			if (symbol != out.tx->tx->vout[out.i].GetAddTokenLabel().getTokenSymbol())
 				continue;
-			if (out.tx->tx->vout[out.i].addTokenLabel.currentCount >= nTokenValue)
+			if (out.tx->tx->vout[out.i].GetAddTokenLabel().currentCount >= nTokenValue)
 			{
 				setCoinsRet.insert(make_pair(out.tx, out.i));
 				return true;
 			}
-			if (out.tx->tx->vout[out.i].addTokenLabel.currentCount < tempValue)
+			if (out.tx->tx->vout[out.i].GetAddTokenLabel().currentCount < tempValue)
 			{
 				setCoinsRet.insert(make_pair(out.tx, out.i));
-				tempValue = tempValue - out.tx->tx->vout[out.i].addTokenLabel.currentCount;
+				tempValue = tempValue - out.tx->tx->vout[out.i].GetAddTokenLabel().currentCount;
 			}
 			else
 			{
@@ -3915,19 +3879,19 @@ bool CWallet::SelectTokenCoins(const std::vector<COutput>& vAvailableCoins, std:
 		}
 		if (txtype == 5)
 		{
-			if (symbol != out.tx->tx->vout[out.i].tokenLabel.getTokenSymbol())
+			if (symbol != out.tx->tx->vout[out.i].GetTokenLabel().getTokenSymbol())
 				continue;
-			if (out.tx->tx->vout[out.i].tokenLabel.value >= nTokenValue)
+			if (out.tx->tx->vout[out.i].GetTokenLabel().value >= nTokenValue)
 			{
 				//clear before
 				setCoinsRet.clear();
 				setCoinsRet.insert(make_pair(out.tx, out.i));
 				return true;
 			}
-			else if (out.tx->tx->vout[out.i].tokenLabel.value < tempValue)
+			else if (out.tx->tx->vout[out.i].GetTokenLabel().value < tempValue)
 			{
 				setCoinsRet.insert(make_pair(out.tx, out.i));
-				tempValue = tempValue - out.tx->tx->vout[out.i].tokenLabel.value;
+				tempValue = tempValue - out.tx->tx->vout[out.i].GetTokenLabel().value;
 			}
 			else
 			{
@@ -3962,9 +3926,9 @@ bool CWallet::SelectUnionTokenCoins(const std::vector<COutput>& vAvailableCoins,
         txtype = out.tx->tx->vout[out.i].txType;
         if (txtype == 4)
         {
-            if (symbol != out.tx->tx->vout[out.i].tokenRegLabel.getTokenSymbol())
+            if (symbol != out.tx->tx->vout[out.i].GetTokenRegLabel().getTokenSymbol())
                 continue;
-            if (out.tx->tx->vout[out.i].tokenRegLabel.totalCount >= nTokenValue)
+            if (out.tx->tx->vout[out.i].GetTokenRegLabel().totalCount >= nTokenValue)
             {
                 setCoinsRet.insert(make_pair(out.tx, out.i));
                 return true;
@@ -3973,19 +3937,19 @@ bool CWallet::SelectUnionTokenCoins(const std::vector<COutput>& vAvailableCoins,
         }
         if (txtype == 5)
         {
-            if (symbol != out.tx->tx->vout[out.i].tokenLabel.getTokenSymbol())
+            if (symbol != out.tx->tx->vout[out.i].GetTokenLabel().getTokenSymbol())
                 continue;
-            if (out.tx->tx->vout[out.i].tokenLabel.value >= nTokenValue)
+            if (out.tx->tx->vout[out.i].GetTokenLabel().value >= nTokenValue)
             {
                 //clear before
                 setCoinsRet.clear();
                 setCoinsRet.insert(make_pair(out.tx, out.i));
                 return true;
             }
-            else if (out.tx->tx->vout[out.i].tokenLabel.value < tempValue)
+            else if (out.tx->tx->vout[out.i].GetTokenLabel().value < tempValue)
             {
                 setCoinsRet.insert(make_pair(out.tx, out.i));
-                tempValue = tempValue - out.tx->tx->vout[out.i].tokenLabel.value;
+                tempValue = tempValue - out.tx->tx->vout[out.i].GetTokenLabel().value;
             }
             else
             {
@@ -4025,9 +3989,9 @@ bool CWallet::SelectUnionTokenCoinsFromLimit(const std::vector<COutput>& vAvaila
         txtype = out.tx->tx->vout[out.i].txType;
         if (txtype == 4)
         {
-            if (symbol != out.tx->tx->vout[out.i].tokenRegLabel.getTokenSymbol())
+            if (symbol != out.tx->tx->vout[out.i].GetTokenRegLabel().getTokenSymbol())
                 continue;
-            if (out.tx->tx->vout[out.i].tokenRegLabel.totalCount >= nTokenValue)
+            if (out.tx->tx->vout[out.i].GetTokenRegLabel().totalCount >= nTokenValue)
             {
                 setCoinsRet.insert(make_pair(out.tx, out.i));
 
@@ -4037,9 +4001,9 @@ bool CWallet::SelectUnionTokenCoinsFromLimit(const std::vector<COutput>& vAvaila
         }
 		else if (txtype == TXOUT_ADDTOKEN)
 		{
-			if (symbol != out.tx->tx->vout[out.i].addTokenLabel.getTokenSymbol())
+			if (symbol != out.tx->tx->vout[out.i].GetAddTokenLabel().getTokenSymbol())
 				continue;
-			if (out.tx->tx->vout[out.i].addTokenLabel.currentCount >= nTokenValue)
+			if (out.tx->tx->vout[out.i].GetAddTokenLabel().currentCount >= nTokenValue)
 			{
 				setCoinsRet.insert(make_pair(out.tx, out.i));
 
@@ -4049,12 +4013,12 @@ bool CWallet::SelectUnionTokenCoinsFromLimit(const std::vector<COutput>& vAvaila
 		}
         if (txtype == 5)
         {
-            if (symbol != out.tx->tx->vout[out.i].tokenLabel.getTokenSymbol())
+            if (symbol != out.tx->tx->vout[out.i].GetTokenLabel().getTokenSymbol())
                 continue;
-            LogPrintf("SelectUnionTokenCoinsFromLimit tempValue:%d value:%d\n",tempValue,out.tx->tx->vout[out.i].tokenLabel.value);
+            LogPrintf("SelectUnionTokenCoinsFromLimit tempValue:%d value:%d\n",tempValue,out.tx->tx->vout[out.i].GetTokenLabel().value);
 
                 setCoinsRet.insert(make_pair(out.tx, out.i));
-                tempValue = tempValue - out.tx->tx->vout[out.i].tokenLabel.value;
+                tempValue = tempValue - out.tx->tx->vout[out.i].GetTokenLabel().value;
                 if(maxvinsize==0&&tempValue<=0){
                     break;
                 }
@@ -4615,7 +4579,7 @@ bool CWallet::ExitCampaign(CWalletTx& wtxNew, CReserveKey& reservekey, CAmount&
 	CTxDestination address(id);
 
 	//Construct system payee
-	CScript scriptPubKey = GetScriptForDestination(CBitcoinAddress(Params().system_account_address).Get());
+	CScript scriptPubKey = Params().SystemAccountScript();
 	vector<CRecipient> vecSend;
 	CRecipient recipient = { scriptPubKey, 0, false };
 	vecSend.push_back(recipient);
@@ -5035,7 +4999,7 @@ bool CWallet::PunishRequest(const CTxDestination &address, const std::string evd
 
 
 	//Construct system payee
-	CScript scriptPubKey = GetScriptForDestination(CBitcoinAddress(Params().system_account_address).Get());
+	CScript scriptPubKey = Params().SystemAccountScript();
 	vector<CRecipient> vecSend;
 	CRecipient recipient = { scriptPubKey, 0, false };
 	vecSend.push_back(recipient);
@@ -6664,7 +6628,7 @@ bool CWallet::CreateIPCSendTransactionWithTxlabel(std::string& txid, int Index,
 		". Use gettransaction for wallet transactions.");
 	
 	IPCLabel ipcSendLabel;
-	ipcSendLabel = tx->vout[Index].ipcLabel; 
+	ipcSendLabel = tx->vout[Index].GetIPCLabel(); 
 	ipcSendLabel.startTime = timeService.GetCurrentTimeSeconds();
 	if (strtxlabel.length() >TXLABLE_MAX_LENGTH -1 )
 	{
@@ -7091,7 +7055,7 @@ bool CWallet::CreateIPCSendTransaction(std::string& txid, int Index, const vecto
 		". Use gettransaction for wallet transactions.");
 
 	IPCLabel ipcSendLabel;
-	ipcSendLabel = tx->vout[Index].ipcLabel;
+	ipcSendLabel = tx->vout[Index].GetIPCLabel();
 	ipcSendLabel.startTime = timeService.GetCurrentTimeSeconds();
 	std::string TxLabel = "";
 
@@ -7560,10 +7524,10 @@ bool CWallet::CreateIPCAuthorizationTransactionWithTxlabel(std::string& txid, in
 /*	label.uniqueAuthorize = (uint8_t)o.get_int();*/
 	label.uniqueAuthorize = 0;
 	bool IsUniqueAuthorize = (bool)(label.uniqueAuthorize);
-	label.ExtendType = tx->vout[Index].ipcLabel.ExtendType;
-	label.hashLen = tx->vout[Index].ipcLabel.hashLen;
-	label.hash = tx->vout[Index].ipcLabel.hash;
-	label.labelTitle = tx->vout[Index].ipcLabel.labelTitle;
+	label.ExtendType = tx->vout[Index].GetIPCLabel().ExtendType;
+	label.hashLen = tx->vout[Index].GetIPCLabel().hashLen;
+	label.hash = tx->vout[Index].GetIPCLabel().hash;
+	label.labelTitle = tx->vout[Index].GetIPCLabel().labelTitle;
 	std::string TxLabel = o.get_str();
 
 	{
@@ -8042,10 +8006,10 @@ bool CWallet::CreateIPCAuthorizationTransaction(std::string& txid, int Index, co
 	label.uniqueAuthorize = (uint8_t)o.get_int(); 
 	label.uniqueAuthorize = 0;
 	bool IsUniqueAuthorize = (bool)(label.uniqueAuthorize);
-	label.ExtendType = tx->vout[Index].ipcLabel.ExtendType;
-	label.hashLen = tx->vout[Index].ipcLabel.hashLen;
-	label.hash = tx->vout[Index].ipcLabel.hash;
-	label.labelTitle = tx->vout[Index].ipcLabel.labelTitle;
+	label.ExtendType = tx->vout[Index].GetIPCLabel().ExtendType;
+	label.hashLen = tx->vout[Index].GetIPCLabel().hashLen;
+	label.hash = tx->vout[Index].GetIPCLabel().hash;
+	label.labelTitle = tx->vout[Index].GetIPCLabel().labelTitle;
 	std::string TxLabel = "";
 
 	{
@@ -9426,12 +9390,13 @@ bool CWallet::CreateTokenTransaction(std::string& tokensymbol, uint64_t TokenVal
 	TokenLabel tokenlabel;
 	memcpy((char*)(tokenlabel.TokenSymbol), (char*)(tokensymbol.c_str()), sizeof(tokenlabel.TokenSymbol));
 	tokenlabel.value = TokenValue;
-	if (tokenDataMap.count(tokenlabel.getTokenSymbol()) == 0)
+	CTokenRecord tokenRecord;
+	if (!GetTokenRecord(tokenlabel.getTokenSymbol(), tokenRecord))
 	{
 		strFailReason = _("Can't found 'accuracy' of the Token");
 		return false;
 	}
-	tokenlabel.accuracy = tokenDataMap[tokenlabel.getTokenSymbol()].getAccuracy();
+	tokenlabel.accuracy = tokenRecord.getAccuracy();
 	{
 
 		set<pair<const CWalletTx*, unsigned int> > setCoins;
@@ -9441,8 +9406,7 @@ bool CWallet::CreateTokenTransaction(std::string& tokensymbol, uint64_t TokenVal
 			std::vector<COutput> vAvailableCoins;
 			AvailableNormalCoins(vAvailableCoins, true, coinControl);
 			std::vector<COutput> vAvailableTokenCoins;
-			AvailableTokenCoins(vAvailableTokenCoins, true, coinControl);
-			std::cout << "CreateTokenTransaction.vAvailableTokenCoins.size:" << vAvailableTokenCoins.size() << std::endl;
+			AvailableTokenCoins(tokensymbol, vAvailableTokenCoins, true, coinControl);
 
 			nFeeRet = 0;
 			// Start with no fee and loop until there is enough fee
@@ -9618,11 +9582,11 @@ bool CWallet::CreateTokenTransaction(std::string& tokensymbol, uint64_t TokenVal
 				for (const auto& coin : setTokenCoins)
 				{
 					if (coin.first->tx->vout[coin.second].txType == 4)
-						TotalvalueVin += coin.first->tx->vout[coin.second].tokenRegLabel.totalCount;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenRegLabel().totalCount;
 					else if (coin.first->tx->vout[coin.second].txType == TXOUT_ADDTOKEN)
-						TotalvalueVin += coin.first->tx->vout[coin.second].addTokenLabel.currentCount;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetAddTokenLabel().currentCount;
 					else
-						TotalvalueVin += coin.first->tx->vout[coin.second].tokenLabel.value;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenLabel().value;
 						
 					if (!getVinscriptPubKey)
 					{
@@ -9880,12 +9844,13 @@ bool  CWallet::CreateTokenTransactionM(std::string& tokensymbol, const std::vect
 	TokenLabel tokenlabel;
 	memcpy((char*)(tokenlabel.TokenSymbol), (char*)(tokensymbol.c_str()), sizeof(tokenlabel.TokenSymbol));
 	tokenlabel.value = 0;
-	if (tokenDataMap.count(tokenlabel.getTokenSymbol()) == 0)
+	CTokenRecord tokenRecord;
+	if (!GetTokenRecord(tokenlabel.getTokenSymbol(), tokenRecord))
 	{
 		strFailReason = _("Can't found 'accuracy' of the Token");
 		return false;
 	}
-	tokenlabel.accuracy = tokenDataMap[tokenlabel.getTokenSymbol()].getAccuracy();
+	tokenlabel.accuracy = tokenRecord.getAccuracy();
 	{
 
 		set<pair<const CWalletTx*, unsigned int> > setCoins;
@@ -9895,7 +9860,7 @@ bool  CWallet::CreateTokenTransactionM(std::string& tokensymbol, const std::vect
 			std::vector<COutput> vAvailableCoins;
 			AvailableNormalCoins(vAvailableCoins, true, coinControl);
 			std::vector<COutput> vAvailableTokenCoins;
-			AvailableTokenCoins(vAvailableTokenCoins, true, coinControl);
+			AvailableTokenCoins(tokensymbol, vAvailableTokenCoins, true, coinControl);
 
 			nFeeRet = 0;
 			// Start with no fee and loop until there is enough fee
@@ -10072,11 +10037,11 @@ bool  CWallet::CreateTokenTransactionM(std::string& tokensymbol, const std::vect
 				for (const auto& coin : setTokenCoins)
 				{
 					if (coin.first->tx->vout[coin.second].txType == 4)
-						TotalvalueVin += coin.first->tx->vout[coin.second].tokenRegLabel.totalCount;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenRegLabel().totalCount;
 					else if (coin.first->tx->vout[coin.second].txType == TXOUT_ADDTOKEN)
-						TotalvalueVin += coin.first->tx->vout[coin.second].addTokenLabel.currentCount;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetAddTokenLabel().currentCount;
 					else
-						TotalvalueVin += coin.first->tx->vout[coin.second].tokenLabel.value;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenLabel().value;
 
 					if (!getVinscriptPubKey)
 					{
@@ -10264,31 +10229,31 @@ int64_t getTokeNmunberFromCOutput(const COutput &out)
     std::string symbol;
     if (txtype == 4)
     {
-        if (symbol == out.tx->tx->vout[out.i].tokenRegLabel.getTokenSymbol())
+        if (symbol == out.tx->tx->vout[out.i].GetTokenRegLabel().getTokenSymbol())
             return 0;
         else
-            return out.tx->tx->vout[out.i].tokenRegLabel.totalCount;
+            return out.tx->tx->vout[out.i].GetTokenRegLabel().totalCount;
     }
 	if (txtype == TXOUT_ADDTOKEN)
 	{
-		if (symbol == out.tx->tx->vout[out.i].addTokenLabel.getTokenSymbol())
+		if (symbol == out.tx->tx->vout[out.i].GetAddTokenLabel().getTokenSymbol())
 			return 0;
 		else
-			return out.tx->tx->vout[out.i].addTokenLabel.currentCount;
+			return out.tx->tx->vout[out.i].GetAddTokenLabel().currentCount;
 	}
     if (txtype == 5)
     {
-        if (symbol == out.tx->tx->vout[out.i].tokenLabel.getTokenSymbol())
+        if (symbol == out.tx->tx->vout[out.i].GetTokenLabel().getTokenSymbol())
             return 0;
         else
-            return  out.tx->tx->vout[out.i].tokenLabel.value;
+            return  out.tx->tx->vout[out.i].GetTokenLabel().value;
     }
 	if (txtype == TXOUT_ADDTOKEN)
 	{
-		if (symbol == out.tx->tx->vout[out.i].addTokenLabel.getTokenSymbol())
+		if (symbol == out.tx->tx->vout[out.i].GetAddTokenLabel().getTokenSymbol())
 			return 0;
 		else
-			return out.tx->tx->vout[out.i].addTokenLabel.currentCount;
+			return out.tx->tx->vout[out.i].GetAddTokenLabel().currentCount;
 	}
 }
 
@@ -10371,12 +10336,13 @@ bool  CWallet::UnionCreateTokenTransactionM(std::string unionaddress,std::string
     TokenLabel tokenlabel;
     memcpy((char*)(tokenlabel.TokenSymbol), (char*)(tokensymbol.c_str()), sizeof(tokenlabel.TokenSymbol));
     tokenlabel.value = 0;
-    if (tokenDataMap.count(tokenlabel.getTokenSymbol()) == 0)
+    CTokenRecord tokenRecord;
+    if (!GetTokenRecord(tokenlabel.getTokenSymbol(), tokenRecord))
     {
         strFailReason = _("Can't found 'accuracy' of the Token");
         return false;
     }
-	tokenlabel.accuracy = tokenDataMap[tokenlabel.getTokenSymbol()].getAccuracy();
+	tokenlabel.accuracy = tokenRecord.getAccuracy();
     {
 
         set<pair<const CWalletTx*, unsigned int> > setCoins;
@@ -10590,11 +10556,11 @@ bool  CWallet::UnionCreateTokenTransactionM(std::string unionaddress,std::string
                 for (const auto& coin : setTokenCoins)
                 {
                     if (coin.first->tx->vout[coin.second].txType == 4)
-                        TotalvalueVin += coin.first->tx->vout[coin.second].tokenRegLabel.totalCount;
+                        TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenRegLabel().totalCount;
 					else if (coin.first->tx->vout[coin.second].txType == TXOUT_ADDTOKEN)
-						TotalvalueVin += coin.first->tx->vout[coin.second].addTokenLabel.currentCount;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetAddTokenLabel().currentCount;
                     else
-                        TotalvalueVin += coin.first->tx->vout[coin.second].tokenLabel.value;
+                        TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenLabel().value;
 
                     if (!getVinscriptPubKey)
                     {
@@ -12361,15 +12327,15 @@ uint64_t CWallet::GetDebitOfToken(const CTransaction& tx, const isminefilter& fi
 				{
 					if (prev.tx->vout[txvin.prevout.n].txType == 4)
 					{
-						debit += prev.tx->vout[txvin.prevout.n].tokenRegLabel.totalCount;
+						debit += prev.tx->vout[txvin.prevout.n].GetTokenRegLabel().totalCount;
 						return debit;
 					}
 					else if (prev.tx->vout[txvin.prevout.n].txType == TXOUT_ADDTOKEN)
 					{
-						debit += prev.tx->vout[txvin.prevout.n].addTokenLabel.currentCount;
+						debit += prev.tx->vout[txvin.prevout.n].GetAddTokenLabel().currentCount;
 					}
 					else if (prev.tx->vout[txvin.prevout.n].txType == 5)
-						debit += prev.tx->vout[txvin.prevout.n].tokenLabel.value;
+						debit += prev.tx->vout[txvin.prevout.n].GetTokenLabel().value;
 				}
 			}
 		}
@@ -12413,15 +12379,15 @@ uint64_t CWallet::GetDebitOfTokenForUnion(const CTransaction& tx, const isminefi
                 {
                     if (prev.tx->vout[txvin.prevout.n].txType == 4)
                     {
-                        debit += prev.tx->vout[txvin.prevout.n].tokenRegLabel.totalCount;
+                        debit += prev.tx->vout[txvin.prevout.n].GetTokenRegLabel().totalCount;
                         return debit;
                     }
 					else  if (prev.tx->vout[txvin.prevout.n].txType == TXOUT_ADDTOKEN)
 					{
-						debit += prev.tx->vout[txvin.prevout.n].addTokenLabel.currentCount;
+						debit += prev.tx->vout[txvin.prevout.n].GetAddTokenLabel().currentCount;
 					}
                     else if (prev.tx->vout[txvin.prevout.n].txType == 5)
-                        debit += prev.tx->vout[txvin.prevout.n].tokenLabel.value;
+                        debit += prev.tx->vout[txvin.prevout.n].GetTokenLabel().value;
                 }
             }
         }
@@ -12504,12 +12470,13 @@ bool CWallet::CreateTokenTransactionForCross(std::string& tokensymbol, const std
 	TokenLabel tokenlabel;
 	memcpy((char*)(tokenlabel.TokenSymbol), (char*)(tokensymbol.c_str()), sizeof(tokenlabel.TokenSymbol));
 	tokenlabel.value = TokenValue;
-	if (tokenDataMap.count(tokenlabel.getTokenSymbol()) == 0)
+	CTokenRecord tokenRecord;
+	if (!GetTokenRecord(tokenlabel.getTokenSymbol(), tokenRecord))
 	{
 		strFailReason = _("Can't found 'accuracy' of the Token");
 		return false;
 	}
-	tokenlabel.accuracy = tokenDataMap[tokenlabel.getTokenSymbol()].getAccuracy();
+	tokenlabel.accuracy = tokenRecord.getAccuracy();
 	{
 
 		set<pair<const CWalletTx*, unsigned int> > setCoins;
@@ -12519,7 +12486,7 @@ bool CWallet::CreateTokenTransactionForCross(std::string& tokensymbol, const std
 			std::vector<COutput> vAvailableCoins;
 			AvailableNormalCoins(vAvailableCoins, true, coinControl);
 			std::vector<COutput> vAvailableTokenCoins;
-			AvailableTokenCoins(vAvailableTokenCoins, true, coinControl);
+			AvailableTokenCoins(tokensymbol, vAvailableTokenCoins, true, coinControl);
 
 			nFeeRet = 0;
 			// Start with no fee and loop until there is enough fee
@@ -12696,11 +12663,11 @@ bool CWallet::CreateTokenTransactionForCross(std::string& tokensymbol, const std
 				for (const auto& coin : setTokenCoins)
 				{
 					if (coin.first->tx->vout[coin.second].txType == 4)
-						TotalvalueVin += coin.first->tx->vout[coin.second].tokenRegLabel.totalCount;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenRegLabel().totalCount;
 					else if (coin.first->tx->vout[coin.second].txType == TXOUT_ADDTOKEN)
-						TotalvalueVin += coin.first->tx->vout[coin.second].addTokenLabel.currentCount;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetAddTokenLabel().currentCount;
 					else
-						TotalvalueVin += coin.first->tx->vout[coin.second].tokenLabel.value;
+						TotalvalueVin += coin.first->tx->vout[coin.second].GetTokenLabel().value;
 
 					if (!getVinscriptPubKey)
 					{
@@ -13281,96 +13248,26 @@ void CWallet::AvailableUnionCoins(std::map<std::string,CAmount>& moneynums,bool
         i.second = 0;
 
         LOCK2(cs_main, cs_wallet);
-        CBitcoinAddress add;
-        txnouttype typeRet;
-        vector<CTxDestination> prevdestes(10);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH( map_t::value_type &i, moneynums )
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
-
-            if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
-
-            int nDepth = pcoin->GetDepthInMainChain();
-			if (nDepth < nTxConfirmTarget)
-                continue;
-			
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
+            CBitcoinAddress add(i.first);
+            if(i.first.size()<=5||(i.first.at(0)!= '2'&&i.first.at(0)!='3')
+                 ||!add.IsValid()||mapAddressBook.count(add.Get()) == 0)
                 continue;
-
-            // We should not consider coins from transactions that are replacing
-            // other transactions.
-            //
-            // Example: There is a transaction A which is replaced by bumpfee
-            // transaction B. In this case, we want to prevent creation of
-            // a transaction B' which spends an output of B.
-            //
-            // Reason: If transaction A were initially confirmed, transactions B
-            // and B' would no longer be valid, so the user would have to create
-            // a new transaction C to replace B'. However, in the case of a
-            // one-block reorg, transactions B' and C might BOTH be accepted,
-            // when the user only wanted one of them. Specifically, there could
-            // be a 1-block reorg away from the chain where transactions A and C
-            // were accepted to another chain where B, B', and C were all
-            // accepted.
-            if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaces_txid")) {
+            std::map<CScript, std::set<COutPoint> >::const_iterator it = mapOutputsByScript.find(GetScriptForDestination(add.Get()));
+            if(it == mapOutputsByScript.end())
                 continue;
-            }
-            // Similarly, we should not consider coins from transactions that
-            // have been replaced. In the example above, we would want to prevent
-            // creation of a transaction A' spending an output of A, because if
-            // transaction B were initially confirmed, conflicting with A and
-            // A', we wouldn't want to the user to create a transaction D
-            // intending to replace A', but potentially resulting in a scenario
-            // where A, A', and D could all be accepted (instead of just B and
-            // D, or just A and A' like the user would want).
-            if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaced_by_txid")) {
-                continue;
-            }
-         
-            for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++)
+            std::vector<COutput> vOutputs;
+            GetAvailableOutputs(it->second, fOnlyConfirmed, vOutputs);
+            BOOST_FOREACH(const COutput& out, vOutputs)
             {
-                const CScript& script= pcoin->tx->vout[i].scriptPubKey;
-                prevdestes.clear();
-                int nRequiredRet;
-                bool fValidAddress = ExtractDestinations(script, typeRet, prevdestes, nRequiredRet);
-                if(!fValidAddress){
-                    LogPrintf("AvailableUnionCoins !fValidAddress txid:%s  voutindex:%d \n",wtxid.ToString(),i);
-                    continue;
-                }
-                bool getunion = false;
-                std::string unionstraddress;
-
-                BOOST_FOREACH(CTxDestination &prevdest, prevdestes)
-                {
-                    add.Set(prevdest);
-                    std::string straddress=add.ToString();
-                    if(straddress.size()>5&&(straddress.at(0)== '2'||straddress.at(0)=='3')
-                         &&(mapAddressBook.count(prevdest) != 0))
-                    {
-                      getunion = true;
-                      unionstraddress = straddress;
-                      break;
-                    }
-                }
-                if(!getunion)continue;
-                map_t::iterator itor = moneynums.find(unionstraddress);
-                if(itor != moneynums.end()&&!(IsSpent(wtxid, i)) &&
-                        !IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                        (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))))
-                    {     
-                        itor->second += pcoin->tx->vout[i].nValue;
-
-          
-                    }
+                const CWalletTx* pcoin = out.tx;
+                if(out.nDepth >= nTxConfirmTarget &&
+                        !IsLockedCoin(pcoin->GetHash(), out.i) && (pcoin->tx->vout[out.i].nValue > 0 || fIncludeZeroValue) &&
+                        (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(pcoin->GetHash(), out.i))))
+                    i.second += pcoin->tx->vout[out.i].nValue;
+            }
         }
-    }
         BOOST_FOREACH( map_t::value_type &i, moneynums )
             LogPrintf("AvailableUnionCoins address: %s  money:%d \r\n",i.first,i.second);
 
@@ -14468,73 +14365,25 @@ void CWallet::AvailableUnionCoinsCOutput(std::string& straddress, std::vector<CO
 	vCoins.clear();
 	{
 		LOCK2(cs_main, cs_wallet);
-		for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+		std::map<CScript, std::set<COutPoint> >::const_iterator it = mapOutputsByScript.find(strunionaddress);
+		std::vector<COutput> vOutputs;
+		if (it != mapOutputsByScript.end())
+			GetAvailableOutputs(it->second, fOnlyConfirmed, vOutputs);
+		BOOST_FOREACH(const COutput& out, vOutputs)
 		{
-			const uint256& wtxid = it->first;
-			const CWalletTx* pcoin = &(*it).second;
-
-
-			if (fOnlyConfirmed && !pcoin->IsTrusted())
-				continue;
-
-			if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-				continue;
-
-			int nDepth = pcoin->GetDepthInMainChain();
-
-			if (nDepth < nTxConfirmTarget)
-				continue;
-			// We should not consider coins which aren't at least in our mempool
-			// It's possible for these to be conflicted via ancestors which we may never be able to detect
-			if (nDepth == 0 && !pcoin->InMempool())
-				continue;
-
-			// We should not consider coins from transactions that are replacing
-			// other transactions.
-			//
-			// Example: There is a transaction A which is replaced by bumpfee
-			// transaction B. In this case, we want to prevent creation of
-			// a transaction B' which spends an output of B.
-			//
-			// Reason: If transaction A were initially confirmed, transactions B
-			// and B' would no longer be valid, so the user would have to create
-			// a new transaction C to replace B'. However, in the case of a
-			// one-block reorg, transactions B' and C might BOTH be accepted,
-			// when the user only wanted one of them. Specifically, there could
-			// be a 1-block reorg away from the chain where transactions A and C
-			// were accepted to another chain where B, B', and C were all
-			// accepted.
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaces_txid")) {
-				continue;
-			}
-
-			// Similarly, we should not consider coins from transactions that
-			// have been replaced. In the example above, we would want to prevent
-			// creation of a transaction A' spending an output of A, because if
-			// transaction B were initially confirmed, conflicting with A and
-			// A', we wouldn't want to the user to create a transaction D
-			// intending to replace A', but potentially resulting in a scenario
-			// where A, A', and D could all be accepted (instead of just B and
-			// D, or just A and A' like the user would want).
-			if (nDepth == 0 && fOnlyConfirmed && pcoin->mapValue.count("replaced_by_txid")) {
+			if (out.nDepth < nTxConfirmTarget)
 				continue;
-			}
-
-			for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-				isminetype mine = IsMine(pcoin->tx->vout[i]);
-				const CScript& multicscript = pcoin->tx->vout[i].scriptPubKey;
-				if (strunionaddress != multicscript)
-					continue;
-				if (!(IsSpent(wtxid, i)) &&
-					!IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-					(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))) &&
-					((!isToken && pcoin->tx->vout[i].txType == TXOUT_NORMAL) || (isToken && (pcoin->tx->vout[i].txType == TXOUT_TOKENREG || pcoin->tx->vout[i].txType == TXOUT_TOKEN || checkVoutAddTokenCanSpend(pcoin->tx->vout[i]))))){
-
-					vCoins.push_back(COutput(pcoin, i, nDepth,
-					((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-					(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-					(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-                }
+			const CWalletTx* pcoin = out.tx;
+			int i = out.i;
+			isminetype mine = IsMine(pcoin->tx->vout[i]);
+			if (!IsLockedCoin(pcoin->GetHash(), i) && (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
+				(!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(pcoin->GetHash(), i))) &&
+				((!isToken && pcoin->tx->vout[i].txType == TXOUT_NORMAL) || (isToken && (pcoin->tx->vout[i].txType == TXOUT_TOKENREG || pcoin->tx->vout[i].txType == TXOUT_TOKEN || checkVoutAddTokenCanSpend(pcoin->tx->vout[i]))))){
+
+				vCoins.push_back(COutput(pcoin, i, out.nDepth,
+				((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+				(coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+				(mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
 			}
 		}
 	}
@@ -14920,8 +14769,8 @@ bool CWallet::CreateAddTokenRegTransaction(std::string& strReglabel, const std::
 					outlabel.extendinfo = recipient.extendinfo;
 					CTxOut txout(CAmount(0), recipient.scriptPubKey, outlabel, recipient.txLabel);
 					txNew.vout.push_back(txout);
-					std::cout << "totalCount :"<<txout.addTokenLabel.totalCount<< std::endl;
-					std::cout << "tokenvalue :" << txout.addTokenLabel.currentCount << std::endl;
+					std::cout << "totalCount :"<<txout.GetAddTokenLabel().totalCount<< std::endl;
+					std::cout << "tokenvalue :" << txout.GetAddTokenLabel().currentCount << std::endl;
 				}
 
 				// Choose coins to use
@@ -708,6 +708,27 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /**
+     * Outputs of wallet transactions by output type, by script and, for
+     * tokens, by symbol, leaving out the ones a wallet transaction spends.
+     * Outputs may stay after being spent, the Available*Coins functions
+     * still check IsSpent.
+     */
+    std::map<uint8_t, std::set<COutPoint> > mapOutputsByType;
+    std::map<CScript, std::set<COutPoint> > mapOutputsByScript;
+    std::map<std::string, std::set<COutPoint> > mapTokenOutputs;
+    bool IsOutputSpentByWallet(const COutPoint& outpoint) const;
+    void AddWalletOutput(const COutPoint& outpoint);
+    void AddWalletOutputs(const CWalletTx& wtx);
+    void RemoveWalletOutput(const COutPoint& outpoint);
+
+    /** Checks every Available*Coins function makes on the transaction of an output */
+    bool IsAvailableTx(const CWalletTx& wtx, bool fOnlyConfirmed, int& nDepth) const;
+    /** Append the unspent outputs of setOutputs whose transaction is available, without the spendable and solvable flags */
+    void GetAvailableOutputs(const std::set<COutPoint>& setOutputs, bool fOnlyConfirmed, std::vector<COutput>& vOutputs) const;
+    void GetAvailableOutputsOfType(uint8_t txType, bool fOnlyConfirmed, std::vector<COutput>& vOutputs) const;
+    void FilterTokenCoins(const std::vector<COutput>& vOutputs, std::vector<COutput>& vCoins, const CCoinControl *coinControl, bool fIncludeZeroValue) const;
+
     /* the HD chain data model (external chain counters) */
     CHDChain hdChain;
 
@@ -824,6 +845,10 @@ public:
 	void AvailableNormalCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed = true, const CCoinControl *coinControl = NULL, bool fIncludeZeroValue = false) const;
 	void AvailableIPCCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed = true, const CCoinControl *coinControl = NULL, bool fIncludeZeroValue = false) const;
 	void AvailableTokenCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed = true, const CCoinControl *coinControl = NULL, bool fIncludeZeroValue = false) const;
+	/** Available coins of one token symbol, without looking at the other outputs of the wallet */
+	void AvailableTokenCoins(const std::string& tokensymbol, std::vector<COutput>& vCoins, bool fOnlyConfirmed = true, const CCoinControl *coinControl = NULL, bool fIncludeZeroValue = false) const;
+	/** Whether every output the wallet has not spent is in the output indexes, for the tests */
+	bool CheckOutputIndexes() const;
 	bool checkVoutAddTokenCanSpend(const CTxOut& vout)const;
     bool GetSymbolbalance(std::string& tokensymbol, uint64_t& value,std::string unionaddress = ""/*, uint64_t nconfirmed = DEFAULT_TX_CONFIRM_TARGET*/);
 	void ListTokenBalance(std::map<std::string, uint64_t>& TokenList);